@@ -59,6 +59,44 @@ export class filesystem {
      */
     static readdirSync(path: string, options?: filesystem.ReadDirOptions | undefined): Array<string>
 	/**
+     *  Lists entries with their type in one pass over each directory;
+     *  subdirectories are listed in parallel on the blocking pool, so entries
+     *  of different directories come in no particular order
+     * @param path: string
+     * @param options: filesystem.WalkOptions | undefined
+     * @returns Promise<Array<filesystem.Dirent>>
+     */
+    static readdirEntries(path: string, options?: filesystem.WalkOptions | undefined): Promise<Array<filesystem.Dirent>>
+	/**
+     * 
+     * @param path: string
+     * @param options: filesystem.WalkOptions | undefined
+     * @returns Array<filesystem.Dirent>
+     */
+    static readdirEntriesSync(path: string, options?: filesystem.WalkOptions | undefined): Array<filesystem.Dirent>
+	/**
+     * 
+     * @param path: string
+     * @param options: filesystem.WalkOptions | undefined
+     * @returns filesystem.DirWalk
+     */
+    static walk(path: string, options?: filesystem.WalkOptions | undefined): filesystem.DirWalk
+	/**
+     *  Walks cwd in parallel, entering only directories a pattern can match
+     *  below. Entries come in batches as they are found, paths relative to cwd.
+     * @param patterns: string | Array<string>
+     * @param options: filesystem.GlobOptions | undefined
+     * @returns filesystem.DirWalk
+     */
+    static glob(patterns: string | Array<string>, options?: filesystem.GlobOptions | undefined): filesystem.DirWalk
+	/**
+     * 
+     * @param patterns: string | Array<string>
+     * @param options: filesystem.GlobOptions | undefined
+     * @returns Array<string>
+     */
+    static globSync(patterns: string | Array<string>, options?: filesystem.GlobOptions | undefined): Array<string>
+	/**
      * 
      * @param path: string
      * @param options: filesystem.MkDirOptions | undefined
@@ -96,9 +134,10 @@ export class filesystem {
      * 
      * @param path: string
      * @param content: string
+     * @param options: filesystem.WriteOptions | undefined
      * @returns Promise<boolean>
      */
-    static writeStringToFile(path: string, content: string): Promise<boolean>
+    static writeStringToFile(path: string, content: string, options?: filesystem.WriteOptions | undefined): Promise<boolean>
 	/**
      *  Binary file I/O (returns/accepts ArrayBuffer on JS side)
      * @param path: string
@@ -115,9 +154,52 @@ export class filesystem {
      * 
      * @param path: string
      * @param content: ArrayBuffer
+     * @param options: filesystem.WriteOptions | undefined
      * @returns Promise<boolean>
      */
-    static writeFile(path: string, content: ArrayBuffer): Promise<boolean>
+    static writeFile(path: string, content: ArrayBuffer, options?: filesystem.WriteOptions | undefined): Promise<boolean>
+	/**
+     *  Enables the cache behind readFile, readFileAsString and their Sync
+     *  variants, it is off by default. Every hit stats the file and is only
+     *  served if its device, inode, size and mtime are unchanged; files
+     *  modified in the last 2 seconds are not cached yet.
+     * @param options: filesystem.ReadCacheOptions | undefined
+     * @returns void
+     */
+    static configureReadCache(options?: filesystem.ReadCacheOptions | undefined): void
+	/**
+     *  Turns the read cache off and drops its contents
+      @returns void
+     */
+    static disableReadCache(): void
+	static clearReadCache(): void
+	static readCacheStats(): filesystem.ReadCacheStats
+	/**
+     *  Maps the file into memory as an ArrayBuffer, unmapped when the buffer is
+     *  collected. Pages are copy-on-write: writes to the buffer are private and
+     *  never reach the file. At most 2 GiB per mapping.
+     * @param path: string
+     * @param options: filesystem.MmapOptions | undefined
+     * @returns ArrayBuffer
+     */
+    static mmap(path: string, options?: filesystem.MmapOptions | undefined): ArrayBuffer
+	/**
+     * 
+     * @param path: string
+     * @param options: filesystem.OpenOptions | undefined
+     * @returns Promise<filesystem.FileHandle>
+     */
+    static open(path: string, options?: filesystem.OpenOptions | undefined): Promise<filesystem.FileHandle>
+	/**
+     *  Calls callback on the JS thread with the changes of the directory or
+     *  file at path. The watch goes on until close() or until the JS context
+     *  is destroyed, whether the watcher is kept or not.
+     * @param path: string
+     * @param options: filesystem.WatchOptions | undefined
+     * @param callback: ((arg0: Array<filesystem.WatchEvent>) => void)
+     * @returns filesystem.Watcher
+     */
+    static watch(path: string, options: filesystem.WatchOptions | undefined, callback: ((arg0: Array<filesystem.WatchEvent>) => void)): filesystem.Watcher
 }
 namespace filesystem {
 export class ReadDirOptions {
@@ -126,6 +208,71 @@ export class ReadDirOptions {
 }
 }
 namespace filesystem {
+export class WalkOptions {
+	recursive: boolean
+	/**
+     *  Report and descend into what symlinks point to
+     */
+    follow_symlinks: boolean
+	/**
+     *  Also fill size and mtime, one statx per entry
+     */
+    stat: boolean
+}
+}
+namespace filesystem {
+export class Dirent {
+	name: string
+	/**
+     *  Relative to the listed directory, '/' separated
+     */
+    path: string
+	/**
+     *  "file", "directory", "symlink" or "other"
+     */
+    type: string
+	inode?: number | undefined
+	/**
+     *  With stat: bytes and milliseconds since the epoch
+     */
+    size?: number | undefined
+    mtime?: number | undefined
+}
+}
+namespace filesystem {
+export class DirWalk {
+	/**
+     *  The next batch of entries, null once the walk is done
+      @returns Promise<Array<filesystem.Dirent> | null>
+     */
+    next(): Promise<Array<filesystem.Dirent> | null>
+	/**
+     *  Yields the entries one by one as the walk finds them
+     */
+    [Symbol.asyncIterator](): AsyncGenerator<filesystem.Dirent>
+}
+}
+namespace filesystem {
+export class GlobOptions {
+	/**
+     *  Directory the patterns are relative to, the current one by default
+     */
+    cwd?: string | undefined
+	/**
+     *  Matches to drop; a directory they match is not entered
+     */
+    ignore?: Array<string> | undefined
+	/**
+     *  Pool threads the walk uses at most
+     */
+    concurrency?: number | undefined
+	/**
+     *  Let wildcards match names starting with a dot
+     */
+    dot: boolean
+}
+}
+namespace filesystem {
 export class MkDirOptions {
 	recursive: boolean
 }
@@ -135,6 +282,157 @@ export class RmOptions {
 	recursive: boolean
 }
 }
+namespace filesystem {
+export class WriteOptions {
+	/**
+     *  Write a temporary file next to path and rename it over path: readers,
+     *  and a crash, see the old content or the new one, never a mix
+     */
+    atomic: boolean
+	/**
+     *  Flush to the disk before resolving, "data" (fdatasync) or "full"
+     *  (fsync); atomic writes also sync the directory holding the rename
+     */
+    sync?: string | undefined
+}
+}
+namespace filesystem {
+export class ReadCacheOptions {
+	/**
+     *  Bytes of file contents kept, 0 for the default (64 MiB)
+     */
+    memory_limit: number
+	/**
+     *  Larger files are read without being kept, 0 for the default (4 MiB)
+     */
+    max_file_size: number
+}
+}
+namespace filesystem {
+export class ReadCacheStats {
+	hits: number
+	misses: number
+	/**
+     *  entries dropped because their file changed
+     */
+    stale: number
+	/**
+     *  entries dropped to stay within memory_limit
+     */
+    evictions: number
+	/**
+     *  file bytes served from the cache instead of the disk
+     */
+    bytes_saved: number
+	hit_ratio: number
+	memory_bytes: number
+	entries: number
+}
+}
+namespace filesystem {
+export class MmapOptions {
+	/**
+     *  Byte range of the file to map, the whole file by default
+     */
+    offset?: number | undefined
+    length?: number | undefined
+	/**
+     *  Access pattern hint: "normal", "sequential", "random" or "willneed"
+     */
+    advice?: string | undefined
+}
+}
+namespace filesystem {
+export class OpenOptions {
+	/**
+     *  "r" (default), "r+", "w", "w+", "a" or "a+", as for fopen
+     */
+    flags?: string | undefined
+}
+}
+namespace filesystem {
+export class FileHandle {
+	/**
+     *  Reads up to length bytes (the rest of buffer by default, at most 1 MiB)
+     *  into buffer at offset, from position or else the current position.
+     *  Resolves with the number of bytes read, 0 at the end of the file.
+     * @param buffer: ArrayBuffer | Uint8Array
+     * @param offset: number | undefined
+     * @param length: number | undefined
+     * @param position: number | undefined
+     * @returns Promise<number>
+     */
+    read(buffer: ArrayBuffer | Uint8Array, offset?: number | undefined, length?: number | undefined, position?: number | undefined): Promise<number>
+	/**
+     *  The complete lines of the next chunk from the current position, without
+     *  their line break. The unterminated last line comes at the end of the
+     *  file, then null. A line over max_length bytes (16 MiB by default) is an
+     *  error and ends the lines.
+     * @param max_length: number | undefined
+     * @returns Promise<Array<string> | null>
+     */
+    readLines(max_length?: number | undefined): Promise<Array<string> | null>
+	/**
+     *  Writes all of data at position or else the current position. Files
+     *  opened for appending are always written at their end.
+     * @param data: string | ArrayBuffer
+     * @param position: number | undefined
+     * @returns Promise<number>
+     */
+    write(data: string | ArrayBuffer, position?: number | undefined): Promise<number>
+	/**
+     *  whence is "set" (default), "current" or "end"; returns the new position
+     * @param offset: number
+     * @param whence: string | undefined
+     * @returns number
+     */
+    seek(offset: number, whence?: string | undefined): number
+	close(): void
+	/**
+     *  Yields the file in chunks of size bytes as one reused Uint8Array, valid
+     *  until the next step. Also the default async iterator.
+     */
+    chunks(size?: number): AsyncGenerator<Uint8Array>
+	/**
+     *  Yields the lines from the current position, without their line break;
+     *  max_length is as for readLines
+     */
+    lines(max_length?: number): AsyncGenerator<string>
+    [Symbol.asyncIterator](): AsyncGenerator<Uint8Array>
+}
+}
+namespace filesystem {
+export class WatchOptions {
+	/**
+     *  Also watch subdirectories, including ones created later
+     */
+    recursive: boolean
+	/**
+     *  Changes to a file within this many milliseconds of the first one are
+     *  reported once, 50 by default
+     */
+    debounce_ms?: number | undefined
+}
+}
+namespace filesystem {
+export class WatchEvent {
+	/**
+     *  Relative to the watched directory, '/' separated; a watched file
+     *  reports its name. Empty when changes were lost and anything may have
+     *  changed.
+     */
+    path: string
+	/**
+     *  "added", "modified" or "removed"
+     */
+    type: string
+}
+}
+namespace filesystem {
+export class Watcher {
+	close(): void
+}
+}
 export class http {
 	/**
      *  Fetch a URL and return a Response
@@ -143,10 +441,33 @@ export class http {
      * @returns Promise<Response>
      */
     static fetch(url: string, init?: http.RequestInit | undefined): Promise<Response>
+	/**
+     *  Enables the HTTP cache used by fetch for GET requests, it is off by
+     *  default. Honours Cache-Control, Expires, ETag and Last-Modified.
+     * @param options: http.CacheOptions | undefined
+     * @returns void
+     */
+    static configureCache(options?: http.CacheOptions | undefined): void
+	/**
+     *  Turns the HTTP cache off and drops its memory tier
+      @returns void
+     */
+    static disableCache(): void
+	/**
+     *  Removes all cached responses, including the on-disk tier
+      @returns void
+     */
+    static clearCache(): void
+	static cacheStats(): http.CacheStats
+	/**
+     *  Concurrency and coalescing counters, limits are set through
+     *  script_context::set_fetch_limits
+      @returns http.FetchStats
+     */
+    static fetchStats(): http.FetchStats
 }
 namespace http {
 export class Headers {
-	list: Array<[string, string]>
 	/**
      * 
      * @param name: string
@@ -179,6 +500,17 @@ export class Headers {
      * @returns void
      */
     remove_(name: string): void
+	/**
+     *  Returns [name, value] pairs in insertion order
+      @returns Array<[string, string]>
+     */
+    entries(): Array<[string, string]>
+	/**
+     *  Calls callback(value, name) for each header in insertion order
+     * @param callback: ((arg0: string, arg1: string) => void)
+     * @returns void
+     */
+    forEach(callback: ((arg0: string, arg1: string) => void)): void
 }
 }
 namespace http {
@@ -203,7 +535,12 @@ export class Response {
       @returns string
      */
     json_text(): string
-	json(): any
+	/**
+     *  Parses the body off the JS thread, only the resulting values are
+     *  created on it
+      @returns Promise<any>
+     */
+    json(): Promise<any>
 	blob(): Blob
 }
 }
@@ -218,6 +555,62 @@ export class RequestInit {
      *  headers: accepts plain object {key: value}
      */
     headers?: std.map<string, string> | undefined
+	/**
+     *  cache mode as in the Fetch standard: "default", "no-store", "reload",
+     *  "no-cache", "force-cache" or "only-if-cached"
+     */
+    cache?: string | undefined
+	/**
+     *  content coding applied to the body before sending, e.g. "gzip"; sets
+     *  Content-Encoding
+     */
+    compress?: string | undefined
+}
+}
+namespace http {
+export class CacheOptions {
+	/**
+     *  size budget of the in-memory LRU tier in bytes, 0 for the default
+     */
+    memory_limit: number
+	/**
+     *  directory of the on-disk tier, memory only when empty
+     */
+    disk_path: string
+}
+}
+namespace http {
+export class CacheStats {
+	hits: number
+	misses: number
+	/**
+     *  hits served after a 304 Not Modified
+     */
+    revalidations: number
+	/**
+     *  response body bytes served from the cache instead of the network
+     */
+    bytes_saved: number
+	hit_ratio: number
+	memory_bytes: number
+	entries: number
+}
+}
+namespace http {
+export class FetchStats {
+	/**
+     *  requests waiting for a concurrency slot right now
+     */
+    queued: number
+	in_flight: number
+	/**
+     *  requests that had to wait for a slot, in total
+     */
+    waited: number
+	/**
+     *  GETs answered by an identical in-flight request, in total
+     */
+    coalesced: number
 }
 }
 export class infra {
@@ -59,6 +59,11 @@ template<> struct js_bind<breeze::js::filesystem> {
                 .static_fun<&breeze::js::filesystem::readFileAsString>("readFileAsString")
                 .static_fun<&breeze::js::filesystem::readdir>("readdir")
                 .static_fun<&breeze::js::filesystem::readdirSync>("readdirSync")
+                .static_fun<&breeze::js::filesystem::readdirEntries>("readdirEntries")
+                .static_fun<&breeze::js::filesystem::readdirEntriesSync>("readdirEntriesSync")
+                .static_fun<&breeze::js::filesystem::walk>("walk")
+                .static_fun<&breeze::js::filesystem::glob>("glob")
+                .static_fun<&breeze::js::filesystem::globSync>("globSync")
                 .static_fun<&breeze::js::filesystem::mkdir>("mkdir")
                 .static_fun<&breeze::js::filesystem::mkdirSync>("mkdirSync")
                 .static_fun<&breeze::js::filesystem::exists>("exists")
@@ -68,6 +73,13 @@ template<> struct js_bind<breeze::js::filesystem> {
                 .static_fun<&breeze::js::filesystem::readFileSync>("readFileSync")
                 .static_fun<&breeze::js::filesystem::readFile>("readFile")
                 .static_fun<&breeze::js::filesystem::writeFile>("writeFile")
+                .static_fun<&breeze::js::filesystem::configureReadCache>("configureReadCache")
+                .static_fun<&breeze::js::filesystem::disableReadCache>("disableReadCache")
+                .static_fun<&breeze::js::filesystem::clearReadCache>("clearReadCache")
+                .static_fun<&breeze::js::filesystem::readCacheStats>("readCacheStats")
+                .static_fun<&breeze::js::filesystem::mmap>("mmap")
+                .static_fun<&breeze::js::filesystem::open>("open")
+                .static_fun<&breeze::js::filesystem::watch>("watch")
             ;
     }
 };
@@ -76,9 +88,9 @@ template <> struct qjs::js_traits<breeze::js::filesystem::ReadDirOptions> {
     static breeze::js::filesystem::ReadDirOptions unwrap(JSContext *ctx, JSValueConst v) {
         breeze::js::filesystem::ReadDirOptions obj;
 
-        obj.recursive = js_traits<bool>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "recursive"));
+        obj.recursive = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "recursive"));
 
-        obj.follow_symlinks = js_traits<bool>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "follow_symlinks"));
+        obj.follow_symlinks = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "follow_symlinks"));
 
         return obj;
     }
@@ -103,11 +115,161 @@ template<> struct js_bind<breeze::js::filesystem::ReadDirOptions> {
     }
 };
 
+template <> struct qjs::js_traits<breeze::js::filesystem::WalkOptions> {
+    static breeze::js::filesystem::WalkOptions unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::WalkOptions obj;
+
+        obj.recursive = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "recursive"));
+
+        obj.follow_symlinks = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "follow_symlinks"));
+
+        obj.stat = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "stat"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::WalkOptions &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "recursive", js_traits<bool>::wrap(ctx, val.recursive));
+
+        JS_SetPropertyStr(ctx, obj, "follow_symlinks", js_traits<bool>::wrap(ctx, val.follow_symlinks));
+
+        JS_SetPropertyStr(ctx, obj, "stat", js_traits<bool>::wrap(ctx, val.stat));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::WalkOptions> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::WalkOptions>("filesystem::WalkOptions")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::WalkOptions::recursive>("recursive")
+                .fun<&breeze::js::filesystem::WalkOptions::follow_symlinks>("follow_symlinks")
+                .fun<&breeze::js::filesystem::WalkOptions::stat>("stat")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::Dirent> {
+    static breeze::js::filesystem::Dirent unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::Dirent obj;
+
+        obj.name = detail::unwrap_free<std::string>(ctx, JS_GetPropertyStr(ctx, v, "name"));
+
+        obj.path = detail::unwrap_free<std::string>(ctx, JS_GetPropertyStr(ctx, v, "path"));
+
+        obj.type = detail::unwrap_free<std::string>(ctx, JS_GetPropertyStr(ctx, v, "type"));
+
+        obj.inode = detail::unwrap_free<std::optional<uint64_t>>(ctx, JS_GetPropertyStr(ctx, v, "inode"));
+
+        obj.size = detail::unwrap_free<std::optional<uint64_t>>(ctx, JS_GetPropertyStr(ctx, v, "size"));
+
+        obj.mtime = detail::unwrap_free<std::optional<double>>(ctx, JS_GetPropertyStr(ctx, v, "mtime"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::Dirent &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "name", js_traits<std::string>::wrap(ctx, val.name));
+
+        JS_SetPropertyStr(ctx, obj, "path", js_traits<std::string>::wrap(ctx, val.path));
+
+        JS_SetPropertyStr(ctx, obj, "type", js_traits<std::string>::wrap(ctx, val.type));
+
+        JS_SetPropertyStr(ctx, obj, "inode", js_traits<std::optional<uint64_t>>::wrap(ctx, val.inode));
+
+        JS_SetPropertyStr(ctx, obj, "size", js_traits<std::optional<uint64_t>>::wrap(ctx, val.size));
+
+        JS_SetPropertyStr(ctx, obj, "mtime", js_traits<std::optional<double>>::wrap(ctx, val.mtime));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::Dirent> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::Dirent>("filesystem::Dirent")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::Dirent::name>("name")
+                .fun<&breeze::js::filesystem::Dirent::path>("path")
+                .fun<&breeze::js::filesystem::Dirent::type>("type")
+                .fun<&breeze::js::filesystem::Dirent::inode>("inode")
+                .fun<&breeze::js::filesystem::Dirent::size>("size")
+                .fun<&breeze::js::filesystem::Dirent::mtime>("mtime")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::DirWalk> {
+    static breeze::js::filesystem::DirWalk unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::DirWalk obj;
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::DirWalk &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::DirWalk> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::DirWalk>("filesystem::DirWalk")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::DirWalk::next>("next")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::GlobOptions> {
+    static breeze::js::filesystem::GlobOptions unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::GlobOptions obj;
+
+        obj.cwd = detail::unwrap_free<std::optional<std::string>>(ctx, JS_GetPropertyStr(ctx, v, "cwd"));
+
+        obj.ignore = detail::unwrap_free<std::optional<std::vector<std::string>>>(ctx, JS_GetPropertyStr(ctx, v, "ignore"));
+
+        obj.concurrency = detail::unwrap_free<std::optional<size_t>>(ctx, JS_GetPropertyStr(ctx, v, "concurrency"));
+
+        obj.dot = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "dot"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::GlobOptions &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "cwd", js_traits<std::optional<std::string>>::wrap(ctx, val.cwd));
+
+        JS_SetPropertyStr(ctx, obj, "ignore", js_traits<std::optional<std::vector<std::string>>>::wrap(ctx, val.ignore));
+
+        JS_SetPropertyStr(ctx, obj, "concurrency", js_traits<std::optional<size_t>>::wrap(ctx, val.concurrency));
+
+        JS_SetPropertyStr(ctx, obj, "dot", js_traits<bool>::wrap(ctx, val.dot));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::GlobOptions> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::GlobOptions>("filesystem::GlobOptions")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::GlobOptions::cwd>("cwd")
+                .fun<&breeze::js::filesystem::GlobOptions::ignore>("ignore")
+                .fun<&breeze::js::filesystem::GlobOptions::concurrency>("concurrency")
+                .fun<&breeze::js::filesystem::GlobOptions::dot>("dot")
+            ;
+    }
+};
+
 template <> struct qjs::js_traits<breeze::js::filesystem::MkDirOptions> {
     static breeze::js::filesystem::MkDirOptions unwrap(JSContext *ctx, JSValueConst v) {
         breeze::js::filesystem::MkDirOptions obj;
 
-        obj.recursive = js_traits<bool>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "recursive"));
+        obj.recursive = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "recursive"));
 
         return obj;
     }
@@ -133,7 +295,7 @@ template <> struct qjs::js_traits<breeze::js::filesystem::RmOptions> {
     static breeze::js::filesystem::RmOptions unwrap(JSContext *ctx, JSValueConst v) {
         breeze::js::filesystem::RmOptions obj;
 
-        obj.recursive = js_traits<bool>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "recursive"));
+        obj.recursive = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "recursive"));
 
         return obj;
     }
@@ -155,6 +317,301 @@ template<> struct js_bind<breeze::js::filesystem::RmOptions> {
     }
 };
 
+template <> struct qjs::js_traits<breeze::js::filesystem::WriteOptions> {
+    static breeze::js::filesystem::WriteOptions unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::WriteOptions obj;
+
+        obj.atomic = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "atomic"));
+
+        obj.sync = detail::unwrap_free<std::optional<std::string>>(ctx, JS_GetPropertyStr(ctx, v, "sync"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::WriteOptions &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "atomic", js_traits<bool>::wrap(ctx, val.atomic));
+
+        JS_SetPropertyStr(ctx, obj, "sync", js_traits<std::optional<std::string>>::wrap(ctx, val.sync));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::WriteOptions> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::WriteOptions>("filesystem::WriteOptions")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::WriteOptions::atomic>("atomic")
+                .fun<&breeze::js::filesystem::WriteOptions::sync>("sync")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::ReadCacheOptions> {
+    static breeze::js::filesystem::ReadCacheOptions unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::ReadCacheOptions obj;
+
+        obj.memory_limit = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "memory_limit"));
+
+        obj.max_file_size = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "max_file_size"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::ReadCacheOptions &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "memory_limit", js_traits<size_t>::wrap(ctx, val.memory_limit));
+
+        JS_SetPropertyStr(ctx, obj, "max_file_size", js_traits<size_t>::wrap(ctx, val.max_file_size));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::ReadCacheOptions> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::ReadCacheOptions>("filesystem::ReadCacheOptions")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::ReadCacheOptions::memory_limit>("memory_limit")
+                .fun<&breeze::js::filesystem::ReadCacheOptions::max_file_size>("max_file_size")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::ReadCacheStats> {
+    static breeze::js::filesystem::ReadCacheStats unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::ReadCacheStats obj;
+
+        obj.hits = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "hits"));
+
+        obj.misses = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "misses"));
+
+        obj.stale = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "stale"));
+
+        obj.evictions = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "evictions"));
+
+        obj.bytes_saved = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "bytes_saved"));
+
+        obj.hit_ratio = detail::unwrap_free<double>(ctx, JS_GetPropertyStr(ctx, v, "hit_ratio"));
+
+        obj.memory_bytes = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "memory_bytes"));
+
+        obj.entries = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "entries"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::ReadCacheStats &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "hits", js_traits<size_t>::wrap(ctx, val.hits));
+
+        JS_SetPropertyStr(ctx, obj, "misses", js_traits<size_t>::wrap(ctx, val.misses));
+
+        JS_SetPropertyStr(ctx, obj, "stale", js_traits<size_t>::wrap(ctx, val.stale));
+
+        JS_SetPropertyStr(ctx, obj, "evictions", js_traits<size_t>::wrap(ctx, val.evictions));
+
+        JS_SetPropertyStr(ctx, obj, "bytes_saved", js_traits<size_t>::wrap(ctx, val.bytes_saved));
+
+        JS_SetPropertyStr(ctx, obj, "hit_ratio", js_traits<double>::wrap(ctx, val.hit_ratio));
+
+        JS_SetPropertyStr(ctx, obj, "memory_bytes", js_traits<size_t>::wrap(ctx, val.memory_bytes));
+
+        JS_SetPropertyStr(ctx, obj, "entries", js_traits<size_t>::wrap(ctx, val.entries));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::ReadCacheStats> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::ReadCacheStats>("filesystem::ReadCacheStats")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::ReadCacheStats::hits>("hits")
+                .fun<&breeze::js::filesystem::ReadCacheStats::misses>("misses")
+                .fun<&breeze::js::filesystem::ReadCacheStats::stale>("stale")
+                .fun<&breeze::js::filesystem::ReadCacheStats::evictions>("evictions")
+                .fun<&breeze::js::filesystem::ReadCacheStats::bytes_saved>("bytes_saved")
+                .fun<&breeze::js::filesystem::ReadCacheStats::hit_ratio>("hit_ratio")
+                .fun<&breeze::js::filesystem::ReadCacheStats::memory_bytes>("memory_bytes")
+                .fun<&breeze::js::filesystem::ReadCacheStats::entries>("entries")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::MmapOptions> {
+    static breeze::js::filesystem::MmapOptions unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::MmapOptions obj;
+
+        obj.offset = detail::unwrap_free<std::optional<size_t>>(ctx, JS_GetPropertyStr(ctx, v, "offset"));
+
+        obj.length = detail::unwrap_free<std::optional<size_t>>(ctx, JS_GetPropertyStr(ctx, v, "length"));
+
+        obj.advice = detail::unwrap_free<std::optional<std::string>>(ctx, JS_GetPropertyStr(ctx, v, "advice"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::MmapOptions &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "offset", js_traits<std::optional<size_t>>::wrap(ctx, val.offset));
+
+        JS_SetPropertyStr(ctx, obj, "length", js_traits<std::optional<size_t>>::wrap(ctx, val.length));
+
+        JS_SetPropertyStr(ctx, obj, "advice", js_traits<std::optional<std::string>>::wrap(ctx, val.advice));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::MmapOptions> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::MmapOptions>("filesystem::MmapOptions")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::MmapOptions::offset>("offset")
+                .fun<&breeze::js::filesystem::MmapOptions::length>("length")
+                .fun<&breeze::js::filesystem::MmapOptions::advice>("advice")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::OpenOptions> {
+    static breeze::js::filesystem::OpenOptions unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::OpenOptions obj;
+
+        obj.flags = detail::unwrap_free<std::optional<std::string>>(ctx, JS_GetPropertyStr(ctx, v, "flags"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::OpenOptions &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "flags", js_traits<std::optional<std::string>>::wrap(ctx, val.flags));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::OpenOptions> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::OpenOptions>("filesystem::OpenOptions")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::OpenOptions::flags>("flags")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::FileHandle> {
+    static breeze::js::filesystem::FileHandle unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::FileHandle obj;
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::FileHandle &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::FileHandle> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::FileHandle>("filesystem::FileHandle")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::FileHandle::read>("read")
+                .fun<&breeze::js::filesystem::FileHandle::readLines>("readLines")
+                .fun<&breeze::js::filesystem::FileHandle::write>("write")
+                .fun<&breeze::js::filesystem::FileHandle::seek>("seek")
+                .fun<&breeze::js::filesystem::FileHandle::close>("close")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::WatchOptions> {
+    static breeze::js::filesystem::WatchOptions unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::WatchOptions obj;
+
+        obj.recursive = detail::unwrap_free<bool>(ctx, JS_GetPropertyStr(ctx, v, "recursive"));
+
+        obj.debounce_ms = detail::unwrap_free<std::optional<size_t>>(ctx, JS_GetPropertyStr(ctx, v, "debounce_ms"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::WatchOptions &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "recursive", js_traits<bool>::wrap(ctx, val.recursive));
+
+        JS_SetPropertyStr(ctx, obj, "debounce_ms", js_traits<std::optional<size_t>>::wrap(ctx, val.debounce_ms));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::WatchOptions> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::WatchOptions>("filesystem::WatchOptions")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::WatchOptions::recursive>("recursive")
+                .fun<&breeze::js::filesystem::WatchOptions::debounce_ms>("debounce_ms")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::WatchEvent> {
+    static breeze::js::filesystem::WatchEvent unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::WatchEvent obj;
+
+        obj.path = detail::unwrap_free<std::string>(ctx, JS_GetPropertyStr(ctx, v, "path"));
+
+        obj.type = detail::unwrap_free<std::string>(ctx, JS_GetPropertyStr(ctx, v, "type"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::WatchEvent &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "path", js_traits<std::string>::wrap(ctx, val.path));
+
+        JS_SetPropertyStr(ctx, obj, "type", js_traits<std::string>::wrap(ctx, val.type));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::WatchEvent> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::WatchEvent>("filesystem::WatchEvent")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::WatchEvent::path>("path")
+                .fun<&breeze::js::filesystem::WatchEvent::type>("type")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::filesystem::Watcher> {
+    static breeze::js::filesystem::Watcher unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::filesystem::Watcher obj;
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::filesystem::Watcher &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::filesystem::Watcher> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::filesystem::Watcher>("filesystem::Watcher")
+            .constructor<>()
+                .fun<&breeze::js::filesystem::Watcher::close>("close")
+            ;
+    }
+};
+
 template <> struct qjs::js_traits<breeze::js::http> {
     static breeze::js::http unwrap(JSContext *ctx, JSValueConst v) {
         breeze::js::http obj;
@@ -173,25 +630,36 @@ template<> struct js_bind<breeze::js::http> {
         mod.class_<breeze::js::http>("http")
             .constructor<>()
                 .static_fun<&breeze::js::http::fetch>("fetch")
+                .static_fun<&breeze::js::http::configureCache>("configureCache")
+                .static_fun<&breeze::js::http::disableCache>("disableCache")
+                .static_fun<&breeze::js::http::clearCache>("clearCache")
+                .static_fun<&breeze::js::http::cacheStats>("cacheStats")
+                .static_fun<&breeze::js::http::fetchStats>("fetchStats")
             ;
     }
 };
 
 template <> struct qjs::js_traits<breeze::js::http::Headers> {
+    // A Headers instance is copied, other values are read as {name: value}
+    // or [[name, value], ...] like the Headers constructor does
     static breeze::js::http::Headers unwrap(JSContext *ctx, JSValueConst v) {
+        using instance = js_traits<std::shared_ptr<breeze::js::http::Headers>>;
+        if (instance::QJSClassId != 0 && JS_GetClassID(v) == instance::QJSClassId)
+            return *instance::unwrap(ctx, v);
         breeze::js::http::Headers obj;
-
-        obj.list = js_traits<std::vector<std::pair<std::string, std::string>>>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "list"));
-
+        if (JS_IsArray(ctx, v) == 1) {
+            for (auto &[name, value] : js_traits<std::vector<std::pair<std::string, std::string>>>::unwrap(ctx, v))
+                obj.append(std::move(name), std::move(value));
+        } else {
+            for (auto &[name, value] : js_traits<std::map<std::string, std::string>>::unwrap(ctx, v))
+                obj.append(name, value);
+        }
         return obj;
     }
 
     static JSValue wrap(JSContext *ctx, const breeze::js::http::Headers &val) noexcept {
-        JSValue obj = JS_NewObject(ctx);
-
-        JS_SetPropertyStr(ctx, obj, "list", js_traits<std::vector<std::pair<std::string, std::string>>>::wrap(ctx, val.list));
-
-        return obj;
+        return js_traits<std::shared_ptr<breeze::js::http::Headers>>::wrap(
+            ctx, std::make_shared<breeze::js::http::Headers>(val));
     }
 };
 template<> struct js_bind<breeze::js::http::Headers> {
@@ -203,7 +671,8 @@ template<> struct js_bind<breeze::js::http::Headers> {
                 .fun<&breeze::js::http::Headers::has>("has")
                 .fun<&breeze::js::http::Headers::append>("append")
                 .fun<&breeze::js::http::Headers::remove_>("remove_")
-                .fun<&breeze::js::http::Headers::list>("list")
+                .fun<&breeze::js::http::Headers::entries>("entries")
+                .fun<&breeze::js::http::Headers::forEach>("forEach")
             ;
     }
 };
@@ -248,11 +717,15 @@ template <> struct qjs::js_traits<breeze::js::http::RequestInit> {
     static breeze::js::http::RequestInit unwrap(JSContext *ctx, JSValueConst v) {
         breeze::js::http::RequestInit obj;
 
-        obj.method = js_traits<std::string>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "method"));
+        obj.method = detail::unwrap_free<std::string>(ctx, JS_GetPropertyStr(ctx, v, "method"));
 
-        obj.body = js_traits<std::optional<std::variant<std::string, std::vector<uint8_t>, std::shared_ptr<breeze::js::Blob>>>>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "body"));
+        obj.body = detail::unwrap_free<std::optional<std::variant<std::string, std::vector<uint8_t>, std::shared_ptr<breeze::js::Blob>>>>(ctx, JS_GetPropertyStr(ctx, v, "body"));
 
-        obj.headers = js_traits<std::optional<std::map<std::string, std::string>>>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "headers"));
+        obj.headers = detail::unwrap_free<std::optional<std::map<std::string, std::string>>>(ctx, JS_GetPropertyStr(ctx, v, "headers"));
+
+        obj.cache = detail::unwrap_free<std::optional<std::string>>(ctx, JS_GetPropertyStr(ctx, v, "cache"));
+
+        obj.compress = detail::unwrap_free<std::optional<std::string>>(ctx, JS_GetPropertyStr(ctx, v, "compress"));
 
         return obj;
     }
@@ -266,6 +739,10 @@ template <> struct qjs::js_traits<breeze::js::http::RequestInit> {
 
         JS_SetPropertyStr(ctx, obj, "headers", js_traits<std::optional<std::map<std::string, std::string>>>::wrap(ctx, val.headers));
 
+        JS_SetPropertyStr(ctx, obj, "cache", js_traits<std::optional<std::string>>::wrap(ctx, val.cache));
+
+        JS_SetPropertyStr(ctx, obj, "compress", js_traits<std::optional<std::string>>::wrap(ctx, val.compress));
+
         return obj;
     }
 };
@@ -276,6 +753,136 @@ template<> struct js_bind<breeze::js::http::RequestInit> {
                 .fun<&breeze::js::http::RequestInit::method>("method")
                 .fun<&breeze::js::http::RequestInit::body>("body")
                 .fun<&breeze::js::http::RequestInit::headers>("headers")
+                .fun<&breeze::js::http::RequestInit::cache>("cache")
+                .fun<&breeze::js::http::RequestInit::compress>("compress")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::http::CacheOptions> {
+    static breeze::js::http::CacheOptions unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::http::CacheOptions obj;
+
+        obj.memory_limit = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "memory_limit"));
+
+        obj.disk_path = detail::unwrap_free<std::string>(ctx, JS_GetPropertyStr(ctx, v, "disk_path"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::http::CacheOptions &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "memory_limit", js_traits<size_t>::wrap(ctx, val.memory_limit));
+
+        JS_SetPropertyStr(ctx, obj, "disk_path", js_traits<std::string>::wrap(ctx, val.disk_path));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::http::CacheOptions> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::http::CacheOptions>("http::CacheOptions")
+            .constructor<>()
+                .fun<&breeze::js::http::CacheOptions::memory_limit>("memory_limit")
+                .fun<&breeze::js::http::CacheOptions::disk_path>("disk_path")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::http::CacheStats> {
+    static breeze::js::http::CacheStats unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::http::CacheStats obj;
+
+        obj.hits = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "hits"));
+
+        obj.misses = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "misses"));
+
+        obj.revalidations = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "revalidations"));
+
+        obj.bytes_saved = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "bytes_saved"));
+
+        obj.hit_ratio = detail::unwrap_free<double>(ctx, JS_GetPropertyStr(ctx, v, "hit_ratio"));
+
+        obj.memory_bytes = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "memory_bytes"));
+
+        obj.entries = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "entries"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::http::CacheStats &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "hits", js_traits<size_t>::wrap(ctx, val.hits));
+
+        JS_SetPropertyStr(ctx, obj, "misses", js_traits<size_t>::wrap(ctx, val.misses));
+
+        JS_SetPropertyStr(ctx, obj, "revalidations", js_traits<size_t>::wrap(ctx, val.revalidations));
+
+        JS_SetPropertyStr(ctx, obj, "bytes_saved", js_traits<size_t>::wrap(ctx, val.bytes_saved));
+
+        JS_SetPropertyStr(ctx, obj, "hit_ratio", js_traits<double>::wrap(ctx, val.hit_ratio));
+
+        JS_SetPropertyStr(ctx, obj, "memory_bytes", js_traits<size_t>::wrap(ctx, val.memory_bytes));
+
+        JS_SetPropertyStr(ctx, obj, "entries", js_traits<size_t>::wrap(ctx, val.entries));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::http::CacheStats> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::http::CacheStats>("http::CacheStats")
+            .constructor<>()
+                .fun<&breeze::js::http::CacheStats::hits>("hits")
+                .fun<&breeze::js::http::CacheStats::misses>("misses")
+                .fun<&breeze::js::http::CacheStats::revalidations>("revalidations")
+                .fun<&breeze::js::http::CacheStats::bytes_saved>("bytes_saved")
+                .fun<&breeze::js::http::CacheStats::hit_ratio>("hit_ratio")
+                .fun<&breeze::js::http::CacheStats::memory_bytes>("memory_bytes")
+                .fun<&breeze::js::http::CacheStats::entries>("entries")
+            ;
+    }
+};
+
+template <> struct qjs::js_traits<breeze::js::http::FetchStats> {
+    static breeze::js::http::FetchStats unwrap(JSContext *ctx, JSValueConst v) {
+        breeze::js::http::FetchStats obj;
+
+        obj.queued = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "queued"));
+
+        obj.in_flight = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "in_flight"));
+
+        obj.waited = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "waited"));
+
+        obj.coalesced = detail::unwrap_free<size_t>(ctx, JS_GetPropertyStr(ctx, v, "coalesced"));
+
+        return obj;
+    }
+
+    static JSValue wrap(JSContext *ctx, const breeze::js::http::FetchStats &val) noexcept {
+        JSValue obj = JS_NewObject(ctx);
+
+        JS_SetPropertyStr(ctx, obj, "queued", js_traits<size_t>::wrap(ctx, val.queued));
+
+        JS_SetPropertyStr(ctx, obj, "in_flight", js_traits<size_t>::wrap(ctx, val.in_flight));
+
+        JS_SetPropertyStr(ctx, obj, "waited", js_traits<size_t>::wrap(ctx, val.waited));
+
+        JS_SetPropertyStr(ctx, obj, "coalesced", js_traits<size_t>::wrap(ctx, val.coalesced));
+
+        return obj;
+    }
+};
+template<> struct js_bind<breeze::js::http::FetchStats> {
+    static void bind(qjs::Context::Module &mod) {
+        mod.class_<breeze::js::http::FetchStats>("http::FetchStats")
+            .constructor<>()
+                .fun<&breeze::js::http::FetchStats::queued>("queued")
+                .fun<&breeze::js::http::FetchStats::in_flight>("in_flight")
+                .fun<&breeze::js::http::FetchStats::waited>("waited")
+                .fun<&breeze::js::http::FetchStats::coalesced>("coalesced")
             ;
     }
 };
@@ -313,7 +920,7 @@ template <> struct qjs::js_traits<breeze::js::infra::URLSearchParams> {
     static breeze::js::infra::URLSearchParams unwrap(JSContext *ctx, JSValueConst v) {
         breeze::js::infra::URLSearchParams obj;
 
-        obj.list = js_traits<std::vector<std::pair<std::string, std::string>>>::unwrap(ctx, JS_GetPropertyStr(ctx, v, "list"));
+        obj.list = detail::unwrap_free<std::vector<std::pair<std::string, std::string>>>(ctx, JS_GetPropertyStr(ctx, v, "list"));
 
         return obj;
     }
@@ -431,10 +1038,36 @@ inline void breeze_bindAll(qjs::Context::Module &mod) {
 
     js_bind<breeze::js::filesystem::ReadDirOptions>::bind(mod);
 
+    js_bind<breeze::js::filesystem::WalkOptions>::bind(mod);
+
+    js_bind<breeze::js::filesystem::Dirent>::bind(mod);
+
+    js_bind<breeze::js::filesystem::DirWalk>::bind(mod);
+
+    js_bind<breeze::js::filesystem::GlobOptions>::bind(mod);
+
     js_bind<breeze::js::filesystem::MkDirOptions>::bind(mod);
 
     js_bind<breeze::js::filesystem::RmOptions>::bind(mod);
 
+    js_bind<breeze::js::filesystem::WriteOptions>::bind(mod);
+
+    js_bind<breeze::js::filesystem::ReadCacheOptions>::bind(mod);
+
+    js_bind<breeze::js::filesystem::ReadCacheStats>::bind(mod);
+
+    js_bind<breeze::js::filesystem::MmapOptions>::bind(mod);
+
+    js_bind<breeze::js::filesystem::OpenOptions>::bind(mod);
+
+    js_bind<breeze::js::filesystem::FileHandle>::bind(mod);
+
+    js_bind<breeze::js::filesystem::WatchOptions>::bind(mod);
+
+    js_bind<breeze::js::filesystem::WatchEvent>::bind(mod);
+
+    js_bind<breeze::js::filesystem::Watcher>::bind(mod);
+
     js_bind<breeze::js::http>::bind(mod);
 
     js_bind<breeze::js::http::Headers>::bind(mod);
@@ -443,6 +1076,11 @@ inline void breeze_bindAll(qjs::Context::Module &mod) {
 
     js_bind<breeze::js::http::RequestInit>::bind(mod);
 
+    js_bind<breeze::js::http::CacheOptions>::bind(mod);
+
+    js_bind<breeze::js::http::CacheStats>::bind(mod);
+    js_bind<breeze::js::http::FetchStats>::bind(mod);
+
     js_bind<breeze::js::infra>::bind(mod);
 
     js_bind<breeze::js::infra::URLSearchParams>::bind(mod);
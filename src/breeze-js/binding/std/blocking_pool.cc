@@ -0,0 +1,82 @@
+#include "blocking_pool.h"
+#include <algorithm>
+#include <thread>
+
+namespace breeze::js {
+
+blocking_pool &blocking_pool::instance() {
+  // Never destroyed: the threads are detached and may still be in a job
+  // when the process exits
+  static auto *pool = new blocking_pool;
+  return *pool;
+}
+
+void blocking_pool::configure(size_t n) {
+  {
+    std::lock_guard lock(mutex);
+    max_threads = std::max<size_t>(n, 1);
+  }
+  // Idle threads above the new limit exit
+  cv.notify_all();
+}
+
+size_t blocking_pool::get_max_threads() {
+  std::lock_guard lock(mutex);
+  return max_threads;
+}
+
+void blocking_pool::post(std::function<void()> job) {
+  bool spawn = false;
+  {
+    std::lock_guard lock(mutex);
+    jobs.push_back(std::move(job));
+    if (jobs.size() > idle) {
+      if (threads < max_threads) {
+        threads++;
+        spawn = true;
+      } else {
+        waited++;
+      }
+    }
+  }
+  if (spawn)
+    std::thread([this] { work(); }).detach();
+  else
+    cv.notify_one();
+}
+
+void blocking_pool::work() {
+  std::unique_lock lock(mutex);
+  while (true) {
+    if (threads > max_threads)
+      break;
+    if (jobs.empty()) {
+      idle++;
+      cv.wait(lock);
+      idle--;
+      continue;
+    }
+    auto job = std::move(jobs.front());
+    jobs.pop_front();
+    running++;
+    lock.unlock();
+    job();
+    // Destroy the captures before taking the lock again, they may be large
+    job = nullptr;
+    lock.lock();
+    running--;
+  }
+  threads--;
+}
+
+blocking_pool::stats blocking_pool::get_stats() {
+  std::lock_guard lock(mutex);
+  return {
+      .queued = jobs.size(),
+      .running = running,
+      .threads = threads,
+      .waited = waited,
+  };
+}
+
+} // namespace breeze::js
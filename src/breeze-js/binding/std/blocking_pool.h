@@ -0,0 +1,76 @@
+#pragma once
+#include "async_simple/Promise.h"
+#include "async_simple/coro/FutureAwaiter.h"
+#include "async_simple/coro/Lazy.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+namespace breeze::js {
+
+// Threads for the filesystem calls that block, keeping them off the JS
+// thread and off the coro_io executor that the network shares. At most
+// max_threads jobs run at once, the others wait in FIFO order. Threads are
+// started on demand and then kept.
+class blocking_pool {
+public:
+  struct stats {
+    // Jobs waiting for a thread right now
+    uint64_t queued = 0;
+    uint64_t running = 0;
+    uint64_t threads = 0;
+    // Jobs that had to wait for a thread, in total
+    uint64_t waited = 0;
+  };
+
+  static blocking_pool &instance();
+
+  // Lowering the limit lets the extra threads exit once their job is done.
+  // 0 is treated as 1.
+  void configure(size_t max_threads);
+  size_t get_max_threads();
+
+  // Runs fn on a pool thread. Its result, or what it throws, completes the
+  // returned Lazy.
+  template <typename F>
+  async_simple::coro::Lazy<std::invoke_result_t<F>> run(F fn) {
+    using R = std::invoke_result_t<F>;
+    async_simple::Promise<R> promise;
+    auto future = promise.getFuture();
+    post([promise = std::move(promise), fn = std::move(fn)]() mutable {
+      try {
+        promise.setValue(fn());
+      } catch (...) {
+        promise.setException(std::current_exception());
+      }
+    });
+    co_return co_await std::move(future);
+  }
+
+  // Runs job on a pool thread without waiting for it
+  void post(std::function<void()> job);
+
+  stats get_stats();
+
+private:
+  blocking_pool() = default;
+
+  void work();
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::function<void()>> jobs;
+  // Same default as the libuv thread pool
+  size_t max_threads = 4;
+  size_t threads = 0;
+  size_t idle = 0;
+  size_t running = 0;
+  uint64_t waited = 0;
+};
+
+} // namespace breeze::js
@@ -0,0 +1,437 @@
+#include "dir_walk.h"
+#include "blocking_pool.h"
+#include "async_simple/coro/FutureAwaiter.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace breeze::js {
+
+// Entries per batch handed to the reader, a large directory is split
+static constexpr size_t batch_size = 4096;
+// Batches waiting for the reader before workers stop taking directories
+static constexpr size_t max_ready = 64;
+
+static std::runtime_error dir_error(const std::string &root,
+                                    const std::string &rel,
+                                    const std::string &message) {
+  return std::runtime_error(
+      std::format("Error reading directory '{}': {}",
+                  rel.empty() ? root : root + "/" + rel, message));
+}
+
+std::shared_ptr<dir_walk> dir_walk::start(std::string root,
+                                          filesystem::WalkOptions options,
+                                          scope narrow) {
+  std::shared_ptr<dir_walk> walk(new dir_walk);
+  walk->root = std::move(root);
+  walk->options = options;
+  walk->narrow = std::move(narrow);
+  walk->dirs.push_back({});
+  std::unique_lock lock(walk->mutex);
+  walk->launch(lock);
+  return walk;
+}
+
+dir_walk::~dir_walk() {
+#ifndef _WIN32
+  if (root_fd >= 0)
+    ::close(root_fd);
+#endif
+}
+
+void dir_walk::launch(std::unique_lock<std::mutex> &) {
+  size_t max_workers = blocking_pool::instance().get_max_threads();
+  if (narrow.max_workers)
+    max_workers = std::min(max_workers, narrow.max_workers);
+  while (!error && !cancelled && ready.size() < max_ready &&
+         workers < max_workers && workers - listing < dirs.size()) {
+    workers++;
+    blocking_pool::instance().post(
+        [self = shared_from_this()] { self->work(); });
+  }
+}
+
+void dir_walk::wake(std::unique_lock<std::mutex> &lock) {
+  cv.notify_all();
+  if (waiter) {
+    auto promise = std::move(*waiter);
+    waiter.reset();
+    lock.unlock();
+    promise.setValue(true);
+    lock.lock();
+  }
+}
+
+void dir_walk::work() {
+  std::unique_lock lock(mutex);
+  while (!error && !cancelled && !dirs.empty() && ready.size() < max_ready) {
+    auto dir = std::move(dirs.front());
+    dirs.pop_front();
+    listing++;
+    lock.unlock();
+    std::exception_ptr failed;
+    try {
+      list(dir);
+    } catch (...) {
+      failed = std::current_exception();
+    }
+    lock.lock();
+    listing--;
+    if (failed && !error)
+      error = failed;
+  }
+  workers--;
+  wake(lock);
+}
+
+void dir_walk::flush(entries &batch, std::vector<pending_dir> &subdirs) {
+  std::unique_lock lock(mutex);
+  std::ranges::move(subdirs, std::back_inserter(dirs));
+  subdirs.clear();
+  if (!batch.empty()) {
+    ready.push_back(std::move(batch));
+    batch.clear();
+  }
+  launch(lock);
+  wake(lock);
+}
+
+async_simple::coro::Lazy<std::optional<dir_walk::entries>> dir_walk::next() {
+  while (true) {
+    async_simple::Promise<bool> promise;
+    auto future = promise.getFuture();
+    {
+      std::unique_lock lock(mutex);
+      if (!ready.empty()) {
+        auto batch = std::move(ready.front());
+        ready.pop_front();
+        launch(lock);
+        co_return batch;
+      }
+      if (error)
+        std::rethrow_exception(error);
+      if (cancelled || (dirs.empty() && workers == 0))
+        co_return std::nullopt;
+      if (waiter)
+        throw std::runtime_error(
+            "DirWalk is busy, await the previous call first");
+      waiter = std::move(promise);
+      launch(lock);
+    }
+    co_await std::move(future);
+  }
+}
+
+dir_walk::entries dir_walk::collect() {
+  entries all;
+  std::unique_lock lock(mutex);
+  while (true) {
+    for (; !ready.empty(); ready.pop_front())
+      std::ranges::move(ready.front(), std::back_inserter(all));
+    if (error)
+      std::rethrow_exception(error);
+    if (cancelled || (dirs.empty() && workers == 0))
+      return all;
+    launch(lock);
+    cv.wait(lock);
+  }
+}
+
+void dir_walk::cancel() {
+  std::unique_lock lock(mutex);
+  cancelled = true;
+  dirs.clear();
+  ready.clear();
+  wake(lock);
+}
+
+#ifdef _WIN32
+
+// No inodes and no loop detection here: a symlinked directory is reported
+// but not descended into, even when following symlinks
+void dir_walk::list(const pending_dir &pending) {
+  namespace fs = std::filesystem;
+  const auto &rel = pending.rel;
+  auto dir = fs::path(std::u8string(root.begin(), root.end())) /
+             fs::path(std::u8string(rel.begin(), rel.end()));
+  std::string prefix = rel.empty() ? "" : rel + "/";
+  entries batch;
+  std::vector<pending_dir> subdirs;
+  std::error_code ec;
+  fs::directory_iterator it(dir, ec);
+  if (ec) {
+    // Removed since its parent was listed
+    if (ec == std::errc::no_such_file_or_directory && !rel.empty())
+      return;
+    throw dir_error(root, rel, ec.message());
+  }
+  for (; it != fs::directory_iterator(); it.increment(ec)) {
+    if (ec)
+      throw dir_error(root, rel, ec.message());
+    const auto &entry = *it;
+    // Both come from the listing's cached data, a link to nothing is
+    // reported as the link
+    auto status = entry.symlink_status(ec);
+    bool link = !ec && fs::is_symlink(status);
+    if (link && options.follow_symlinks) {
+      auto target = entry.status(ec);
+      if (!ec && fs::exists(target))
+        status = target;
+      ec.clear();
+    }
+    if (ec) {
+      if (ec == std::errc::no_such_file_or_directory)
+        continue;
+      throw dir_error(root, rel, ec.message());
+    }
+    auto u8name = entry.path().filename().u8string();
+    filesystem::Dirent e;
+    e.name.assign(u8name.begin(), u8name.end());
+    e.path = prefix + e.name;
+    e.type = fs::is_regular_file(status) ? "file"
+             : fs::is_directory(status)  ? "directory"
+             : fs::is_symlink(status)    ? "symlink"
+                                         : "other";
+    if (options.stat) {
+      if (fs::is_regular_file(status))
+        e.size = entry.file_size(ec);
+      auto time = entry.last_write_time(ec);
+      if (!ec)
+        e.mtime = std::chrono::duration<double, std::milli>(
+                      std::chrono::clock_cast<std::chrono::system_clock>(time)
+                          .time_since_epoch())
+                      .count();
+      ec.clear();
+    }
+    if (options.recursive && fs::is_directory(status) && !link &&
+        (!narrow.descend || narrow.descend(e.path)))
+      subdirs.push_back({e.path});
+    if (!narrow.keep || narrow.keep(e))
+      batch.push_back(std::move(e));
+    if (batch.size() >= batch_size)
+      flush(batch, subdirs);
+  }
+  flush(batch, subdirs);
+}
+
+#else
+
+namespace {
+
+struct stat_data {
+  uint32_t mode;
+  uint64_t ino;
+  uint64_t size;
+  double mtime;
+};
+
+// Returns 0 or the errno
+int stat_at(int dir_fd, const char *name, bool follow, bool full,
+            stat_data &out) {
+#if defined(__linux__) && defined(STATX_TYPE)
+  struct statx stx;
+  unsigned mask =
+      STATX_TYPE | STATX_INO | (full ? STATX_SIZE | STATX_MTIME : 0);
+  if (statx(dir_fd, name, follow ? 0 : AT_SYMLINK_NOFOLLOW, mask, &stx) != 0)
+    return errno;
+  out = {stx.stx_mode, stx.stx_ino, stx.stx_size,
+         stx.stx_mtime.tv_sec * 1e3 + stx.stx_mtime.tv_nsec / 1e6};
+#else
+  struct stat st;
+  if (fstatat(dir_fd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) != 0)
+    return errno;
+#ifdef __APPLE__
+  auto &mtime = st.st_mtimespec;
+#else
+  auto &mtime = st.st_mtim;
+#endif
+  out = {uint32_t(st.st_mode), uint64_t(st.st_ino), uint64_t(st.st_size),
+         mtime.tv_sec * 1e3 + mtime.tv_nsec / 1e6};
+#endif
+  return 0;
+}
+
+// nullptr when the listing does not tell
+const char *dirent_type(unsigned char d_type) {
+  switch (d_type) {
+  case DT_REG:
+    return "file";
+  case DT_DIR:
+    return "directory";
+  case DT_LNK:
+    return "symlink";
+  case DT_UNKNOWN:
+    return nullptr;
+  default:
+    return "other";
+  }
+}
+
+const char *mode_type(uint32_t mode) {
+  return S_ISREG(mode)   ? "file"
+         : S_ISDIR(mode) ? "directory"
+         : S_ISLNK(mode) ? "symlink"
+                         : "other";
+}
+
+struct scoped_fd {
+  int fd;
+  ~scoped_fd() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+};
+
+#ifdef __linux__
+// What getdents64 fills, glibc only declares it since 2.30
+struct linux_dirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];
+};
+
+// Calls fn(name, d_type, d_ino) for each entry; returns 0 or the errno
+template <typename F> int read_entries(int fd, F fn) {
+  alignas(linux_dirent64) char buf[64 << 10];
+  while (true) {
+    long n = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return errno;
+    if (n == 0)
+      return 0;
+    for (long at = 0; at < n;) {
+      auto *d = reinterpret_cast<linux_dirent64 *>(buf + at);
+      at += d->d_reclen;
+      fn(d->d_name, d->d_type, d->d_ino);
+    }
+  }
+}
+#else
+template <typename F> int read_entries(int fd, F fn) {
+  // closedir closes the fd it was given, the caller keeps its own
+  int copy = dup(fd);
+  DIR *dir = copy < 0 ? nullptr : fdopendir(copy);
+  if (!dir) {
+    int error = errno;
+    if (copy >= 0)
+      ::close(copy);
+    return error;
+  }
+  std::unique_ptr<DIR, int (*)(DIR *)> guard(dir, closedir);
+  while (true) {
+    errno = 0;
+    auto *d = ::readdir(dir);
+    if (!d)
+      return errno;
+    fn(d->d_name, d->d_type, uint64_t(d->d_ino));
+  }
+}
+#endif
+
+} // namespace
+
+void dir_walk::list(const pending_dir &pending) {
+  const auto &rel = pending.rel;
+  int fd;
+  if (rel.empty()) {
+    fd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+      throw dir_error(root, rel, std::system_category().message(errno));
+    std::lock_guard lock(mutex);
+    root_fd = fd;
+  } else {
+    fd = openat(root_fd, rel.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    // Removed since its parent was listed
+    if (fd < 0 && errno == ENOENT)
+      return;
+    if (fd < 0)
+      throw dir_error(root, rel, std::system_category().message(errno));
+  }
+  // The root stays open for the subdirectories
+  scoped_fd guard{rel.empty() ? -1 : fd};
+
+  std::shared_ptr<const ancestor> self;
+  if (options.follow_symlinks) {
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+      throw dir_error(root, rel, std::system_category().message(errno));
+    // Reached again through a symlink: reported, but not listed again
+    for (auto *a = pending.parents.get(); a; a = a->parent.get()) {
+      if (a->dev == uint64_t(st.st_dev) && a->ino == uint64_t(st.st_ino))
+        return;
+    }
+    self = std::make_shared<ancestor>(uint64_t(st.st_dev), uint64_t(st.st_ino),
+                                      pending.parents);
+  }
+
+  std::string prefix = rel.empty() ? "" : rel + "/";
+  entries batch;
+  std::vector<pending_dir> subdirs;
+  int error = read_entries(fd, [&](const char *name, unsigned char d_type,
+                                   uint64_t ino) {
+    if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+      return;
+    const char *type = dirent_type(d_type);
+    filesystem::Dirent e;
+    if (options.stat || !type ||
+        (d_type == DT_LNK && options.follow_symlinks)) {
+      stat_data st;
+      int err = stat_at(fd, name, options.follow_symlinks, options.stat, st);
+      // A link to nothing, or to itself, is reported as the link
+      if ((err == ENOENT || err == ELOOP) && options.follow_symlinks)
+        err = stat_at(fd, name, false, options.stat, st);
+      // Removed since listed
+      if (err == ENOENT)
+        return;
+      if (err)
+        throw dir_error(root, prefix + name,
+                        std::system_category().message(err));
+      type = mode_type(st.mode);
+      ino = st.ino;
+      if (options.stat) {
+        e.size = st.size;
+        e.mtime = st.mtime;
+      }
+    }
+    e.name = name;
+    e.path = prefix + name;
+    e.type = type;
+    e.inode = ino;
+    if (options.recursive && std::string_view(type) == "directory" &&
+        (!narrow.descend || narrow.descend(e.path)))
+      subdirs.push_back({e.path, self});
+    if (!narrow.keep || narrow.keep(e))
+      batch.push_back(std::move(e));
+    if (batch.size() >= batch_size)
+      flush(batch, subdirs);
+  });
+  if (error)
+    throw dir_error(root, rel, std::system_category().message(error));
+  flush(batch, subdirs);
+}
+
+#endif
+
+} // namespace breeze::js
@@ -0,0 +1,98 @@
+#pragma once
+#include "async_simple/Promise.h"
+#include "async_simple/coro/Lazy.h"
+#include "filesystem.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace breeze::js {
+
+// Lists a directory tree on the blocking pool. A directory is read in one
+// pass that yields names, types and inodes together (getdents64 on Linux),
+// with a statx only where the listing leaves the type open or stat data is
+// asked for. Subdirectories are queued and listed by as many pool threads as
+// the pool allows, and entries go out in batches while the walk runs.
+// Workers stop taking directories while enough batches wait to be consumed,
+// so a slow reader holds the walk back instead of growing memory, and no
+// pool thread ever waits for the reader.
+class dir_walk : public std::enable_shared_from_this<dir_walk> {
+public:
+  using entries = std::vector<filesystem::Dirent>;
+
+  // Narrows a walk, the defaults take everything. The functions run on
+  // pool threads, several at once.
+  struct scope {
+    // Whether an entry goes to the reader
+    std::function<bool(const filesystem::Dirent &)> keep;
+    // Whether a directory, by its relative path, is listed
+    std::function<bool(const std::string &)> descend;
+    // Pool threads used at most, 0 for as many as the pool has
+    size_t max_workers = 0;
+  };
+
+  static std::shared_ptr<dir_walk> start(std::string root,
+                                         filesystem::WalkOptions options,
+                                         scope narrow);
+  ~dir_walk();
+
+  // The next batch, nullopt once the walk is done. One call at a time.
+  async_simple::coro::Lazy<std::optional<entries>> next();
+  // Blocks until the walk is done. Not on a pool thread: with one thread
+  // the walk could not make progress.
+  entries collect();
+  // Workers stop before their next directory
+  void cancel();
+
+private:
+  // A directory entered and those above it, to notice a followed symlink
+  // that leads back up
+  struct ancestor {
+    uint64_t dev;
+    uint64_t ino;
+    std::shared_ptr<const ancestor> parent;
+  };
+  struct pending_dir {
+    // Relative path, "" is the root
+    std::string rel;
+    // Only kept when symlinks are followed
+    std::shared_ptr<const ancestor> parents;
+  };
+
+  dir_walk() = default;
+
+  // Both with the mutex held
+  void launch(std::unique_lock<std::mutex> &lock);
+  void wake(std::unique_lock<std::mutex> &lock);
+  void work();
+  // Lists root/rel, flushing entries and queueing subdirectories as it goes
+  void list(const pending_dir &dir);
+  void flush(entries &batch, std::vector<pending_dir> &subdirs);
+
+  std::string root;
+  filesystem::WalkOptions options;
+  scope narrow;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<pending_dir> dirs;
+  std::deque<entries> ready;
+  size_t workers = 0;
+  // Workers inside list(), the others are about to take a directory
+  size_t listing = 0;
+  std::exception_ptr error;
+  bool cancelled = false;
+  std::optional<async_simple::Promise<bool>> waiter;
+  // Subdirectories are opened relative to it, set once the root is open
+  int root_fd = -1;
+};
+
+} // namespace breeze::js
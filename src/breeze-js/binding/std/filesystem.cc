@@ -1,13 +1,332 @@
 #include "./filesystem.h"
+#include "./blocking_pool.h"
+#include "./dir_walk.h"
+#include "./glob.h"
+#include "./read_cache.h"
+#include "./watch_hub.h"
+#include "async_simple/Promise.h"
+#include "async_simple/coro/FutureAwaiter.h"
 #include "async_simple/coro/SyncAwait.h"
 #include "cinatra/ylt/coro_io/coro_file.hpp"
 #include "breeze-js/quickjspp.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace breeze::js {
 
-std::string filesystem::readFileAsStringSync(std::string path) {
+#ifdef _WIN32
+// The CRT has no positional I/O, calls on one handle never overlap so the
+// seek and the transfer cannot interleave with another call's
+
+static int open_file(const std::string &path, int flags) {
+  std::filesystem::path wpath(std::u8string(path.begin(), path.end()));
+  return _wopen(wpath.c_str(), flags | _O_BINARY | _O_NOINHERIT,
+                _S_IREAD | _S_IWRITE);
+}
+
+static int64_t read_at(int fd, void *data, size_t size, uint64_t position) {
+  if (_lseeki64(fd, position, SEEK_SET) < 0)
+    return -1;
+  return _read(fd, data, unsigned(std::min<size_t>(size, INT_MAX)));
+}
+
+static int64_t write_at(int fd, const void *data, size_t size,
+                        uint64_t position, bool append) {
+  if (!append && _lseeki64(fd, position, SEEK_SET) < 0)
+    return -1;
+  return _write(fd, data, unsigned(std::min<size_t>(size, INT_MAX)));
+}
+
+static int64_t file_size(int fd) { return _filelengthi64(fd); }
+
+#else
+
+static int open_file(const std::string &path, int flags) {
+  return ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+}
+
+static int64_t read_at(int fd, void *data, size_t size, uint64_t position) {
+  ssize_t n;
+  do {
+    n = pread(fd, data, size, position);
+  } while (n < 0 && errno == EINTR);
+  return n;
+}
+
+// O_APPEND makes write() go to the end; pwrite() would not on every platform
+static int64_t write_at(int fd, const void *data, size_t size,
+                        uint64_t position, bool append) {
+  ssize_t n;
+  do {
+    n = append ? ::write(fd, data, size) : pwrite(fd, data, size, position);
+  } while (n < 0 && errno == EINTR);
+  return n;
+}
+
+static int64_t file_size(int fd) {
+  struct stat st;
+  return fstat(fd, &st) == 0 ? int64_t(st.st_size) : -1;
+}
+
+#endif
+
+static std::runtime_error write_error(const char *what, const std::string &path,
+                                      std::error_code error) {
+  return std::runtime_error(what + path + " - " + error.message());
+}
+
+static std::error_code last_error() {
+  return std::error_code(errno, std::generic_category());
+}
+
+static std::error_code write_all(int fd, const uint8_t *data, size_t size) {
+  for (size_t done = 0; done < size;) {
+    int64_t n = write_at(fd, data + done, size - done, done, false);
+    if (n < 0)
+      return last_error();
+    if (n == 0)
+      return std::make_error_code(std::errc::io_error);
+    done += n;
+  }
+  return {};
+}
+
+#ifdef _WIN32
+
+// Windows has no data-only flush, both modes commit everything
+static std::error_code sync_file(int fd, const std::string &) {
+  if (_commit(fd) != 0)
+    return last_error();
+  return {};
+}
+
+#else
+
+// "data" flushes the content and what is needed to read it back, "full"
+// all metadata too; on macOS only F_FULLFSYNC gets past the drive's cache
+static std::error_code sync_file(int fd, const std::string &mode) {
+#ifdef __APPLE__
+  if (mode == "full" ? fcntl(fd, F_FULLFSYNC) != 0 : fsync(fd) != 0)
+    return last_error();
+#else
+  if (mode == "full" ? fsync(fd) != 0 : fdatasync(fd) != 0)
+    return last_error();
+#endif
+  return {};
+}
+
+#endif
+
+#ifdef _WIN32
+
+// No directory handles to flush, MOVEFILE_WRITE_THROUGH covers the rename
+static std::error_code sync_dir(const std::filesystem::path &) { return {}; }
+
+#else
+
+// A rename is durable once its directory is synced. Atomic writes into one
+// directory at the same time share a sync of it: a caller waits for the
+// first sync that starts after its rename, and whoever finds none running
+// starts it.
+static std::error_code sync_dir(const std::filesystem::path &dir) {
+  struct pending {
+    uint64_t started = 0;
+    uint64_t done = 0;
+    bool running = false;
+    size_t users = 0;
+    std::error_code error;
+  };
+  static std::mutex mutex;
+  static std::condition_variable cv;
+  static std::unordered_map<std::string, pending> dirs;
+
+  std::unique_lock lock(mutex);
+  auto key = dir.empty() ? std::string(".") : dir.string();
+  auto &d = dirs[key];
+  d.users++;
+  uint64_t wanted = d.started + 1;
+  while (d.done < wanted) {
+    if (d.running) {
+      cv.wait(lock);
+      continue;
+    }
+    d.running = true;
+    uint64_t generation = ++d.started;
+    lock.unlock();
+    std::error_code error;
+    int fd = ::open(key.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || fsync(fd) != 0)
+      error = last_error();
+    if (fd >= 0)
+      ::close(fd);
+    lock.lock();
+    d.done = generation;
+    d.error = error;
+    d.running = false;
+    cv.notify_all();
+  }
+  auto error = d.error;
+  if (--d.users == 0)
+    dirs.erase(key);
+  return error;
+}
+
+#endif
+
+static std::error_code rename_over(const std::string &from,
+                                   const std::string &to) {
+#ifdef _WIN32
+  std::filesystem::path wfrom(std::u8string(from.begin(), from.end()));
+  std::filesystem::path wto(std::u8string(to.begin(), to.end()));
+  if (!MoveFileExW(wfrom.c_str(), wto.c_str(),
+                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    return std::error_code(GetLastError(), std::system_category());
+#else
+  if (::rename(from.c_str(), to.c_str()) != 0)
+    return last_error();
+#endif
+  return {};
+}
+
+// A hidden sibling, so the rename stays on one filesystem
+static std::string temp_path_for(const std::string &path) {
+  thread_local std::mt19937_64 random{std::random_device{}()};
+  char suffix[17] = {};
+  std::to_chars(suffix, suffix + 16, random(), 16);
+  size_t slash = path.find_last_of("/\\");
+  size_t name = slash == std::string::npos ? 0 : slash + 1;
+  return path.substr(0, name) + "." + path.substr(name) + "." + suffix +
+         ".tmp";
+}
+
+// One open with O_CREAT | O_TRUNC, a second only when the parent
+// directories are missing. Atomic writes go to a temporary file renamed
+// over path, which is removed again on any failure.
+static void write_file_sync(const std::string &path, const uint8_t *data,
+                            size_t size,
+                            const filesystem::WriteOptions &options) {
+  std::string target = options.atomic ? temp_path_for(path) : path;
+  int flags = O_WRONLY | O_CREAT | (options.atomic ? O_EXCL : O_TRUNC);
+  int fd = open_file(target, flags);
+  if (fd < 0 && errno == ENOENT) {
+    std::error_code ec;
+    std::filesystem::create_directories(
+        std::filesystem::path(std::u8string(path.begin(), path.end()))
+            .parent_path(),
+        ec);
+    fd = open_file(target, flags);
+  }
+  if (fd < 0)
+    throw write_error("Error opening file for writing: ", path, last_error());
+  auto error = write_all(fd, data, size);
+  if (!error && options.sync)
+    error = sync_file(fd, *options.sync);
+  if (::close(fd) != 0 && !error)
+    error = last_error();
+  if (options.atomic) {
+    if (!error)
+      error = rename_over(target, path);
+    std::error_code ec;
+    if (error)
+      std::filesystem::remove(
+          std::filesystem::path(std::u8string(target.begin(), target.end())),
+          ec);
+  }
+  if (error)
+    throw write_error("Error writing to file: ", path, error);
+  if (options.atomic && options.sync) {
+    auto parent =
+        std::filesystem::path(std::u8string(path.begin(), path.end()))
+            .parent_path();
+    if (auto error = sync_dir(parent))
+      throw write_error("Error syncing the directory of: ", path, error);
+  }
+}
+
+static async_simple::coro::Lazy<bool>
+write_file(std::string path,
+           std::variant<std::string, std::vector<uint8_t>> content,
+           std::optional<filesystem::WriteOptions> options) {
+  setDefault(options);
+  if (options->sync && *options->sync != "data" && *options->sync != "full")
+    throw std::runtime_error("Unknown sync mode: " + *options->sync);
+  co_return co_await blocking_pool::instance().run([&] {
+    std::visit(
+        [&](const auto &bytes) {
+          write_file_sync(path,
+                          reinterpret_cast<const uint8_t *>(bytes.data()),
+                          bytes.size(), *options);
+        },
+        content);
+    return true;
+  });
+}
+
+// With the read cache on, the identity of path before it is read and its
+// cached content when that is still current
+struct cache_probe {
+  std::optional<read_cache::identity> id;
+  std::shared_ptr<const read_cache::entry> hit;
+};
+
+static cache_probe probe_read_cache(const std::string &path) {
+  auto &cache = read_cache::instance();
+  if (!cache.enabled())
+    return {};
+  cache_probe probe{read_cache::stat(path), nullptr};
+  // A missing file is left to the read to report
+  if (probe.id)
+    probe.hit = cache.lookup(path, *probe.id);
+  return probe;
+}
+
+static void fill_read_cache(const std::string &path, const cache_probe &probe,
+                            std::string_view content) {
+  if (probe.id)
+    read_cache::instance().store(path, *probe.id, content);
+}
+
+static std::string_view as_chars(const std::vector<uint8_t> &bytes) {
+  return {reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+}
+
+static qjs::shared_buffer copy_to_buffer(const std::string &content) {
+  // Handed out as a mutable ArrayBuffer, the cached bytes must stay intact
+  return qjs::shared_buffer::from(
+      std::vector<uint8_t>(content.begin(), content.end()));
+}
+
+static std::string read_string_sync(const std::string &path) {
   std::ifstream file(path);
   if (!file.is_open()) {
     throw std::runtime_error("Error opening file: " + path);
@@ -16,8 +335,17 @@ std::string filesystem::readFileAsStringSync(std::string path) {
                       std::istreambuf_iterator<char>());
   return content;
 }
-async_simple::coro::Lazy<std::string>
-filesystem::readFileAsString(std::string path) {
+
+std::string filesystem::readFileAsStringSync(std::string path) {
+  auto probe = probe_read_cache(path);
+  if (probe.hit)
+    return probe.hit->content;
+  auto content = read_string_sync(path);
+  fill_read_cache(path, probe, content);
+  return content;
+}
+
+static async_simple::coro::Lazy<std::string> read_string(std::string path) {
   coro_io::coro_file file(path, std::ios::in | std::ios::binary);
   if (!file.is_open()) {
     throw std::runtime_error("Error opening file: " + path);
@@ -44,6 +372,32 @@ filesystem::readFileAsString(std::string path) {
 
   co_return content;
 }
+
+async_simple::coro::Lazy<std::string>
+filesystem::readFileAsString(std::string path) {
+  auto probe = probe_read_cache(path);
+  if (probe.hit)
+    co_return probe.hit->content;
+  auto content = co_await read_string(path);
+  fill_read_cache(path, probe, content);
+  co_return content;
+}
+
+// The entry's cached type avoids a stat per entry where the platform
+// reports it while listing (d_type on Linux)
+static void readdir_into(const std::filesystem::path &path,
+                         const filesystem::ReadDirOptions &options,
+                         std::vector<std::string> &result) {
+  for (const auto &entry : std::filesystem::directory_iterator(path)) {
+    if (options.follow_symlinks || !entry.is_symlink()) {
+      result.push_back(entry.path().filename().string());
+    }
+    if (options.recursive && entry.is_directory()) {
+      readdir_into(entry.path(), options, result);
+    }
+  }
+}
+
 std::vector<std::string>
 filesystem::readdirSync(std::string path,
                         std::optional<ReadDirOptions> options) {
@@ -51,15 +405,7 @@ filesystem::readdirSync(std::string path,
 
   std::vector<std::string> result;
   try {
-    for (const auto &entry : std::filesystem::directory_iterator(path)) {
-      if (options->follow_symlinks || !std::filesystem::is_symlink(entry)) {
-        result.push_back(entry.path().filename().string());
-      }
-      if (options->recursive && entry.is_directory()) {
-        auto sub_entries = readdirSync(entry.path().string(), options);
-        result.insert(result.end(), sub_entries.begin(), sub_entries.end());
-      }
-    }
+    readdir_into(path, *options, result);
   } catch (const std::filesystem::filesystem_error &e) {
     throw std::runtime_error(
         std::format("Error reading directory '{}': {}", path, e.what()));
@@ -69,11 +415,104 @@ filesystem::readdirSync(std::string path,
 
 async_simple::coro::Lazy<std::vector<std::string>>
 filesystem::readdir(std::string path, std::optional<ReadDirOptions> options) {
-  co_return readdirSync(path, options);
+  co_return co_await blocking_pool::instance().run(
+      [path = std::move(path), options] { return readdirSync(path, options); });
+}
+
+std::vector<filesystem::Dirent>
+filesystem::readdirEntriesSync(std::string path,
+                               std::optional<WalkOptions> options) {
+  setDefault(options);
+  return dir_walk::start(std::move(path), *options, {})->collect();
+}
+
+// Awaits batches rather than running collect() on the pool, which would hold
+// a pool thread that the walk itself needs
+async_simple::coro::Lazy<std::vector<filesystem::Dirent>>
+filesystem::readdirEntries(std::string path,
+                           std::optional<WalkOptions> options) {
+  setDefault(options);
+  auto walk = dir_walk::start(std::move(path), *options, {});
+  std::vector<Dirent> result;
+  while (auto batch = co_await walk->next())
+    std::ranges::move(*batch, std::back_inserter(result));
+  co_return result;
+}
+
+struct filesystem::DirWalk::$state {
+  std::shared_ptr<dir_walk> walk;
+
+  // Dropping the JS object stops the workers
+  ~$state() { walk->cancel(); }
+};
+
+std::shared_ptr<filesystem::DirWalk>
+filesystem::walk(std::string path, std::optional<WalkOptions> options) {
+  setDefault(options);
+  auto handle = std::make_shared<DirWalk>();
+  handle->$s = std::make_shared<DirWalk::$state>();
+  handle->$s->walk = dir_walk::start(std::move(path), *options, {});
+  return handle;
+}
+
+static std::shared_ptr<dir_walk>
+start_glob(std::variant<std::string, std::vector<std::string>> patterns,
+           std::optional<filesystem::GlobOptions> options) {
+  setDefault(options);
+  auto list = std::holds_alternative<std::string>(patterns)
+                  ? std::vector{std::get<std::string>(patterns)}
+                  : std::get<std::vector<std::string>>(std::move(patterns));
+  auto matcher = std::make_shared<glob_matcher>(
+      list, options->ignore.value_or(std::vector<std::string>{}),
+      options->dot);
+  return dir_walk::start(
+      options->cwd.value_or("."), {.recursive = true},
+      {
+          .keep =
+              [matcher](const filesystem::Dirent &e) {
+                return matcher->matches(e.path, e.type == "directory");
+              },
+          .descend =
+              [matcher](const std::string &path) {
+                return matcher->descend(path);
+              },
+          .max_workers = options->concurrency.value_or(0),
+      });
+}
+
+std::shared_ptr<filesystem::DirWalk> filesystem::glob(
+    std::variant<std::string, std::vector<std::string>> patterns,
+    std::optional<GlobOptions> options) {
+  auto handle = std::make_shared<DirWalk>();
+  handle->$s = std::make_shared<DirWalk::$state>();
+  handle->$s->walk = start_glob(std::move(patterns), std::move(options));
+  return handle;
+}
+
+std::vector<std::string> filesystem::globSync(
+    std::variant<std::string, std::vector<std::string>> patterns,
+    std::optional<GlobOptions> options) {
+  std::vector<std::string> result;
+  for (auto &entry :
+       start_glob(std::move(patterns), std::move(options))->collect())
+    result.push_back(std::move(entry.path));
+  return result;
+}
+
+static async_simple::coro::Lazy<std::optional<std::vector<filesystem::Dirent>>>
+next_batch(std::shared_ptr<dir_walk> walk) {
+  co_return co_await walk->next();
+}
+
+async_simple::coro::Lazy<std::optional<std::vector<filesystem::Dirent>>>
+filesystem::DirWalk::next() {
+  return next_batch($s->walk);
 }
+
 async_simple::coro::Lazy<bool>
 filesystem::mkdir(std::string path, std::optional<MkDirOptions> options) {
-  co_return mkdirSync(path, options);
+  co_return co_await blocking_pool::instance().run(
+      [path = std::move(path), options] { return mkdirSync(path, options); });
 }
 bool filesystem::mkdirSync(std::string path,
                            std::optional<MkDirOptions> options) {
@@ -90,7 +529,7 @@ bool filesystem::mkdirSync(std::string path,
         std::format("Error creating directory '{}': {}", path, e.what()));
   }
 }
-bool filesystem::exists(std::string path) {
+bool filesystem::exists(std::string_view path) {
   return std::filesystem::exists(path);
 }
 bool filesystem::rmSync(std::string path, std::optional<RmOptions> options) {
@@ -104,55 +543,49 @@ bool filesystem::rmSync(std::string path, std::optional<RmOptions> options) {
   return !std::filesystem::exists(path);
 };
 async_simple::coro::Lazy<bool>
-filesystem::writeStringToFile(std::string path, std::string content) {
-  // create first if it doesn't exist
-  if (!std::filesystem::exists(path)) {
-    std::filesystem::create_directories(
-        std::filesystem::path(path).parent_path());
-    std::ofstream file(path, std::ios::out | std::ios::binary);
-    if (!file.is_open()) {
-      throw std::runtime_error("Error creating file: " + path);
-    }
-    file.close();
-  }
-  coro_io::coro_file file(path, std::ios::out | std::ios::binary);
-  if (!file.is_open()) {
-    throw std::runtime_error("Error opening file for writing: " + path);
-  }
-
-  auto [ec, write_size] = co_await file.async_write(
-      std::string_view(content.data(), content.size()));
-
-  if (ec) {
-    throw std::runtime_error("Error writing to file: " + path + " - " +
-                             ec.message());
-  }
-
-  if (write_size != content.size()) {
-    throw std::runtime_error(
-        "Error writing to file: " + path +
-        " - Expected size: " + std::to_string(content.size()) +
-        ", Written size: " + std::to_string(write_size));
-  }
-
-  co_return true;
+filesystem::writeStringToFile(std::string path, std::string content,
+                              std::optional<WriteOptions> options) {
+  co_return co_await write_file(std::move(path), std::move(content),
+                                std::move(options));
 }
+
 async_simple::coro::Lazy<bool>
 filesystem::rm(std::string path, std::optional<RmOptions> options) {
-  co_return rmSync(path, options);
+  co_return co_await blocking_pool::instance().run(
+      [path = std::move(path), options] { return rmSync(path, options); });
 }
 
-std::vector<uint8_t> filesystem::readFileSync(std::string path) {
+static std::vector<uint8_t> read_bytes_sync(const std::string &path) {
   std::ifstream file(path, std::ios::in | std::ios::binary);
   if (!file.is_open()) {
     throw std::runtime_error("Error opening file: " + path);
   }
-  return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
-                              std::istreambuf_iterator<char>());
+  file.seekg(0, std::ios::end);
+  std::streamoff size = file.tellg();
+  file.clear();
+  file.seekg(0);
+  if (size <= 0) {
+    // Pipes and procfs files report no size, read them until the end
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+  }
+  std::vector<uint8_t> content(size);
+  file.read(reinterpret_cast<char *>(content.data()), size);
+  content.resize(file.gcount());
+  return content;
 }
 
-async_simple::coro::Lazy<std::vector<uint8_t>>
-filesystem::readFile(std::string path) {
+qjs::shared_buffer filesystem::readFileSync(std::string path) {
+  auto probe = probe_read_cache(path);
+  if (probe.hit)
+    return copy_to_buffer(probe.hit->content);
+  auto content = read_bytes_sync(path);
+  fill_read_cache(path, probe, as_chars(content));
+  return qjs::shared_buffer::from(std::move(content));
+}
+
+static async_simple::coro::Lazy<std::vector<uint8_t>>
+read_bytes(std::string path) {
   coro_io::coro_file file(path, std::ios::in | std::ios::binary);
   if (!file.is_open()) {
     throw std::runtime_error("Error opening file: " + path);
@@ -179,37 +612,520 @@ filesystem::readFile(std::string path) {
   co_return content;
 }
 
+async_simple::coro::Lazy<qjs::shared_buffer>
+filesystem::readFile(std::string path) {
+  auto probe = probe_read_cache(path);
+  if (probe.hit)
+    co_return copy_to_buffer(probe.hit->content);
+  auto content = co_await read_bytes(path);
+  fill_read_cache(path, probe, as_chars(content));
+  co_return qjs::shared_buffer::from(std::move(content));
+}
+
 async_simple::coro::Lazy<bool>
-filesystem::writeFile(std::string path, std::vector<uint8_t> content) {
-  if (!std::filesystem::exists(path)) {
-    std::filesystem::create_directories(
-        std::filesystem::path(path).parent_path());
-    std::ofstream file(path, std::ios::out | std::ios::binary);
-    if (!file.is_open()) {
-      throw std::runtime_error("Error creating file: " + path);
-    }
-    file.close();
+filesystem::writeFile(std::string path, std::vector<uint8_t> content,
+                      std::optional<WriteOptions> options) {
+  co_return co_await write_file(std::move(path), std::move(content),
+                                std::move(options));
+}
+
+void filesystem::configureReadCache(std::optional<ReadCacheOptions> options) {
+  setDefault(options);
+  // Unset fields arrive as 0 from JS
+  if (options->memory_limit == 0)
+    options->memory_limit = ReadCacheOptions{}.memory_limit;
+  if (options->max_file_size == 0)
+    options->max_file_size = ReadCacheOptions{}.max_file_size;
+  read_cache::instance().configure(read_cache::options{
+      .memory_limit = options->memory_limit,
+      .max_file_size = options->max_file_size,
+  });
+}
+
+void filesystem::disableReadCache() {
+  read_cache::instance().configure(std::nullopt);
+}
+
+void filesystem::clearReadCache() { read_cache::instance().clear(); }
+
+filesystem::ReadCacheStats filesystem::readCacheStats() {
+  auto s = read_cache::instance().get_stats();
+  ReadCacheStats stats;
+  stats.hits = s.hits;
+  stats.misses = s.misses;
+  stats.stale = s.stale;
+  stats.evictions = s.evictions;
+  stats.bytes_saved = s.bytes_saved;
+  stats.memory_bytes = s.memory_bytes;
+  stats.entries = s.entries;
+  if (s.hits + s.misses)
+    stats.hit_ratio = double(s.hits) / double(s.hits + s.misses);
+  return stats;
+}
+
+// Checks the requested range against the file and resolves its defaults
+static std::pair<size_t, size_t>
+map_range(const std::string &path, size_t file_size,
+          const filesystem::MmapOptions &options) {
+  size_t offset = options.offset.value_or(0);
+  if (offset > file_size)
+    throw std::runtime_error(
+        std::format("Offset {} is past the end of '{}' ({} bytes)", offset,
+                    path, file_size));
+  size_t length = options.length.value_or(file_size - offset);
+  if (length > file_size - offset)
+    throw std::runtime_error(
+        std::format("Range {}+{} is past the end of '{}' ({} bytes)", offset,
+                    length, path, file_size));
+  // The limit of an ArrayBuffer
+  if (length > INT32_MAX)
+    throw std::runtime_error(
+        std::format("Cannot map {} bytes of '{}' at once, the limit is 2 GiB",
+                    length, path));
+  return {offset, length};
+}
+
+#ifdef _WIN32
+
+qjs::shared_buffer filesystem::mmap(std::string path,
+                                    std::optional<MmapOptions> options) {
+  setDefault(options);
+  // Windows has no equivalent to the access hints, they are only checked
+  if (options->advice && *options->advice != "normal" &&
+      *options->advice != "sequential" && *options->advice != "random" &&
+      *options->advice != "willneed")
+    throw std::runtime_error("Unknown mmap advice: " + *options->advice);
+
+  std::filesystem::path wpath(std::u8string(path.begin(), path.end()));
+  HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE |
+                                FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Error opening file: " + path);
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    throw std::runtime_error("Error reading file size: " + path);
   }
-  coro_io::coro_file file(path, std::ios::out | std::ios::binary);
-  if (!file.is_open()) {
-    throw std::runtime_error("Error opening file for writing: " + path);
+  size_t offset, length;
+  try {
+    std::tie(offset, length) = map_range(path, file_size.QuadPart, *options);
+  } catch (...) {
+    CloseHandle(file);
+    throw;
+  }
+  if (length == 0) {
+    CloseHandle(file);
+    return {};
   }
 
-  auto [ec, write_size] = co_await file.async_write(std::string_view(
-      reinterpret_cast<const char *>(content.data()), content.size()));
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  size_t start = offset - offset % info.dwAllocationGranularity;
+  size_t span = length + (offset - start);
+  // The view keeps the mapping and the file open
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping)
+    throw std::runtime_error("Error mapping file: " + path + " - " +
+                             std::system_category().message(GetLastError()));
+  void *view = MapViewOfFile(mapping, FILE_MAP_COPY,
+                             DWORD(uint64_t(start) >> 32), DWORD(start), span);
+  DWORD error = GetLastError();
+  CloseHandle(mapping);
+  if (!view)
+    throw std::runtime_error("Error mapping file: " + path + " - " +
+                             std::system_category().message(error));
+  std::shared_ptr<void> owner(view, [](void *p) { UnmapViewOfFile(p); });
+  return {owner, static_cast<uint8_t *>(view) + (offset - start), length};
+}
 
-  if (ec) {
-    throw std::runtime_error("Error writing to file: " + path + " - " +
-                             ec.message());
+#else
+
+qjs::shared_buffer filesystem::mmap(std::string path,
+                                    std::optional<MmapOptions> options) {
+  setDefault(options);
+  int advice = MADV_NORMAL;
+  if (options->advice) {
+    if (*options->advice == "sequential")
+      advice = MADV_SEQUENTIAL;
+    else if (*options->advice == "random")
+      advice = MADV_RANDOM;
+    else if (*options->advice == "willneed")
+      advice = MADV_WILLNEED;
+    else if (*options->advice != "normal")
+      throw std::runtime_error("Unknown mmap advice: " + *options->advice);
+  }
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    throw std::runtime_error("Error opening file: " + path);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int error = errno;
+    ::close(fd);
+    throw std::runtime_error("Error reading file size: " + path + " - " +
+                             std::system_category().message(error));
+  }
+  size_t offset, length;
+  try {
+    std::tie(offset, length) = map_range(path, st.st_size, *options);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  if (length == 0) {
+    ::close(fd);
+    return {};
+  }
+
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t start = offset - offset % page;
+  size_t span = length + (offset - start);
+  // Private so that writes from JS stay in the process; the mapping keeps
+  // the file open
+  void *base =
+      ::mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, start);
+  int error = errno;
+  ::close(fd);
+  if (base == MAP_FAILED)
+    throw std::runtime_error("Error mapping file: " + path + " - " +
+                             std::system_category().message(error));
+  if (advice != MADV_NORMAL)
+    madvise(base, span, advice);
+  std::shared_ptr<void> owner(base, [span](void *p) { munmap(p, span); });
+  return {owner, static_cast<uint8_t *>(base) + (offset - start), length};
+}
+
+#endif
+
+struct filesystem::FileHandle::$state {
+  std::string path;
+  int fd = -1;
+  bool append = false;
+  uint64_t position = 0;
+  // Staging area of read and readLines, reused by every call
+  std::vector<uint8_t> buffer;
+  // Start of a line readLines has not seen the end of yet
+  std::string pending;
+  bool eof = false;
+  std::atomic<bool> busy = false;
+
+  ~$state() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+};
+
+using file_state = filesystem::FileHandle::$state;
+
+// Marks a handle busy from the call on the JS thread until the coroutine
+// doing its I/O is done or dropped
+struct busy_lock {
+  std::shared_ptr<file_state> s;
+
+  explicit busy_lock(const filesystem::FileHandle &handle) : s(handle.$s) {
+    if (!s || s->fd < 0)
+      throw std::runtime_error("FileHandle is closed");
+    if (s->busy.exchange(true)) {
+      s = nullptr;
+      throw std::runtime_error(
+          "FileHandle is busy, await the previous call first");
+    }
+  }
+  busy_lock(busy_lock &&other) noexcept : s(std::move(other.s)) {}
+  ~busy_lock() {
+    if (s)
+      s->busy = false;
   }
-  if (write_size != content.size()) {
+};
+
+static constexpr size_t max_read = 1 << 20;
+static constexpr size_t line_chunk = 64 << 10;
+static constexpr size_t default_max_line = 16 << 20;
+
+static int open_flags(const std::string &flags) {
+  if (flags == "r")
+    return O_RDONLY;
+  if (flags == "r+")
+    return O_RDWR;
+  if (flags == "w")
+    return O_WRONLY | O_CREAT | O_TRUNC;
+  if (flags == "w+")
+    return O_RDWR | O_CREAT | O_TRUNC;
+  if (flags == "a")
+    return O_WRONLY | O_CREAT | O_APPEND;
+  if (flags == "a+")
+    return O_RDWR | O_CREAT | O_APPEND;
+  throw std::runtime_error("Unknown open flags: " + flags);
+}
+
+static std::runtime_error file_error(const char *what, const file_state &s,
+                                     int error) {
+  return std::runtime_error(std::string(what) + s.path + " - " +
+                            std::system_category().message(error));
+}
+
+async_simple::coro::Lazy<std::shared_ptr<filesystem::FileHandle>>
+filesystem::open(std::string path, std::optional<OpenOptions> options) {
+  setDefault(options);
+  std::string flags = options->flags.value_or("r");
+  int mode = open_flags(flags);
+  auto [fd, error] = co_await blocking_pool::instance().run([&] {
+    int fd = open_file(path, mode);
+    return std::pair(fd, fd < 0 ? errno : 0);
+  });
+  if (fd < 0)
+    throw std::runtime_error("Error opening file: " + path + " - " +
+                             std::system_category().message(error));
+  auto handle = std::make_shared<FileHandle>();
+  handle->$s = std::make_shared<FileHandle::$state>();
+  handle->$s->path = std::move(path);
+  handle->$s->fd = fd;
+  handle->$s->append = flags[0] == 'a';
+  co_return handle;
+}
+
+// Runs fn on the thread of the JS context v belongs to, where JS memory may
+// be touched, and waits for it
+template <typename F>
+static async_simple::coro::Lazy<void> on_js_thread(const qjs::Value &v,
+                                                   F fn) {
+  auto context = v.ctx_holder ? v.ctx_holder->lock() : nullptr;
+  if (!context)
+    throw std::runtime_error("The JS context is gone");
+  async_simple::Promise<bool> promise;
+  auto future = promise.getFuture();
+  context->postTask([&fn, promise = std::move(promise)]() mutable {
+    try {
+      fn();
+      promise.setValue(true);
+    } catch (...) {
+      promise.setException(std::current_exception());
+    }
+  });
+  co_await std::move(future);
+}
+
+static async_simple::coro::Lazy<size_t>
+read_into(busy_lock lock, qjs::Value target, size_t offset, size_t length,
+          std::optional<size_t> position) {
+  auto &s = *lock.s;
+  uint64_t at = position.value_or(s.position);
+  if (s.buffer.size() < length)
+    s.buffer.resize(length);
+  auto [n, error] = co_await blocking_pool::instance().run([&] {
+    int64_t n = read_at(s.fd, s.buffer.data(), length, at);
+    return std::pair(n, n < 0 ? errno : 0);
+  });
+  if (n < 0)
+    throw file_error("Error reading file: ", s, error);
+  if (!position)
+    s.position += n;
+  // The buffer may have been detached or shrunk while the read ran
+  co_await on_js_thread(target, [&] {
+    auto view = qjs::detail::typed_array_view<uint8_t>(target.ctx, target.v);
+    if (!view || view->size() < offset + n)
+      throw std::runtime_error("FileHandle.read: the buffer shrank");
+    std::memcpy(const_cast<uint8_t *>(view->data()) + offset, s.buffer.data(),
+                n);
+  });
+  co_return n;
+}
+
+async_simple::coro::Lazy<size_t>
+filesystem::FileHandle::read(qjs::Value buffer, std::optional<size_t> offset,
+                             std::optional<size_t> length,
+                             std::optional<size_t> position) {
+  // Called on the JS thread, so the buffer can be checked before any I/O
+  auto view = qjs::detail::typed_array_view<uint8_t>(buffer.ctx, buffer.v);
+  if (!view)
     throw std::runtime_error(
-        "Error writing to file: " + path +
-        " - Expected size: " + std::to_string(content.size()) +
-        ", Written size: " + std::to_string(write_size));
+        "FileHandle.read expects an ArrayBuffer or a Uint8Array");
+  size_t start = offset.value_or(0);
+  if (start > view->size())
+    throw std::runtime_error("FileHandle.read: offset is past the buffer");
+  size_t count = length.value_or(view->size() - start);
+  if (count > view->size() - start)
+    throw std::runtime_error("FileHandle.read: length is past the buffer");
+  busy_lock lock(*this);
+  return read_into(std::move(lock), std::move(buffer), start,
+                   std::min(count, max_read), position);
+}
+
+static async_simple::coro::Lazy<std::optional<std::vector<std::string>>>
+read_lines(busy_lock lock, size_t max_line) {
+  auto &s = *lock.s;
+  co_return co_await blocking_pool::instance().run(
+      [&]() -> std::optional<std::vector<std::string>> {
+        // Ends the lines of the handle, later calls resolve with null
+        auto too_long = [&] {
+          s.pending = {};
+          s.eof = true;
+          return std::runtime_error(std::format(
+              "Line longer than {} bytes in '{}'", max_line, s.path));
+        };
+        std::vector<std::string> lines;
+        // A chunk without a line break only extends pending
+        while (lines.empty()) {
+          if (s.eof)
+            return std::nullopt;
+          s.buffer.resize(std::max(s.buffer.size(), line_chunk));
+          int64_t n = read_at(s.fd, s.buffer.data(), line_chunk, s.position);
+          if (n < 0)
+            throw file_error("Error reading file: ", s, errno);
+          if (n == 0) {
+            s.eof = true;
+            if (s.pending.empty())
+              return std::nullopt;
+            if (s.pending.size() > max_line)
+              throw too_long();
+            lines.push_back(std::move(s.pending));
+            s.pending.clear();
+            break;
+          }
+          s.position += n;
+          auto *begin = reinterpret_cast<const char *>(s.buffer.data());
+          auto *end = begin + n;
+          while (auto *nl = static_cast<const char *>(
+                     std::memchr(begin, '\n', end - begin))) {
+            s.pending.append(begin, nl);
+            if (!s.pending.empty() && s.pending.back() == '\r')
+              s.pending.pop_back();
+            if (s.pending.size() > max_line)
+              throw too_long();
+            lines.push_back(std::move(s.pending));
+            s.pending.clear();
+            begin = nl + 1;
+          }
+          s.pending.append(begin, end);
+          // Leaves room for the \r of a line break split across chunks
+          if (s.pending.size() > max_line + 1)
+            throw too_long();
+        }
+        return lines;
+      });
+}
+
+async_simple::coro::Lazy<std::optional<std::vector<std::string>>>
+filesystem::FileHandle::readLines(std::optional<size_t> max_length) {
+  return read_lines(busy_lock(*this),
+                    max_length.value_or(default_max_line));
+}
+
+static async_simple::coro::Lazy<size_t>
+write_from(busy_lock lock, std::variant<std::string, std::vector<uint8_t>> data,
+           std::optional<size_t> position) {
+  auto &s = *lock.s;
+  auto bytes = std::visit(
+      [](auto &d) {
+        return std::string_view(reinterpret_cast<const char *>(d.data()),
+                                d.size());
+      },
+      data);
+  uint64_t at = position.value_or(s.position);
+  co_await blocking_pool::instance().run([&] {
+    for (size_t done = 0; done < bytes.size();) {
+      int64_t n = write_at(s.fd, bytes.data() + done, bytes.size() - done,
+                           at + done, s.append);
+      if (n < 0)
+        throw file_error("Error writing to file: ", s, errno);
+      done += n;
+    }
+    return true;
+  });
+  if (!position && !s.append)
+    s.position = at + bytes.size();
+  co_return bytes.size();
+}
+
+async_simple::coro::Lazy<size_t> filesystem::FileHandle::write(
+    std::variant<std::string, std::vector<uint8_t>> data,
+    std::optional<size_t> position) {
+  return write_from(busy_lock(*this), std::move(data), position);
+}
+
+size_t filesystem::FileHandle::seek(int64_t offset,
+                                    std::optional<std::string> whence) {
+  busy_lock lock(*this);
+  auto &s = *lock.s;
+  int64_t base = 0;
+  if (!whence || *whence == "set") {
+    base = 0;
+  } else if (*whence == "current") {
+    base = s.position;
+  } else if (*whence == "end") {
+    base = file_size(s.fd);
+    if (base < 0)
+      throw file_error("Error reading file size: ", s, errno);
+  } else {
+    throw std::runtime_error("Unknown seek origin: " + *whence);
   }
+  if (base + offset < 0)
+    throw std::runtime_error("Cannot seek before the start of the file");
+  s.position = base + offset;
+  // Lines are read from the new position on
+  s.pending.clear();
+  s.eof = false;
+  return s.position;
+}
+
+void filesystem::FileHandle::close() {
+  busy_lock lock(*this);
+  ::close(std::exchange(lock.s->fd, -1));
+}
+
+struct filesystem::Watcher::$state {
+  uint64_t id = 0;
+  // Also read by the hub thread and by batches already posted
+  std::shared_ptr<std::atomic<bool>> closed =
+      std::make_shared<std::atomic<bool>>(false);
+};
+
+std::shared_ptr<filesystem::Watcher>
+filesystem::watch(std::string path, std::optional<WatchOptions> options,
+                  std::function<void(std::vector<WatchEvent>)> callback) {
+  setDefault(options);
+  auto context = qjs::Context::current->weak_from_this();
+  auto watcher = std::make_shared<Watcher>();
+  watcher->$s = std::make_shared<Watcher::$state>();
+  auto closed = watcher->$s->closed;
+  // Never copied off the JS thread, the function holds a JS value
+  auto fn = std::make_shared<std::function<void(std::vector<WatchEvent>)>>(
+      std::move(callback));
+
+  watch_hub::options opts{.recursive = options->recursive};
+  if (options->debounce_ms)
+    opts.debounce = std::chrono::milliseconds(*options->debounce_ms);
+  watcher->$s->id = watch_hub::instance().add(
+      path, opts, [context, closed, fn](std::vector<watch_hub::event> events) {
+        auto ctx = context.lock();
+        if (!ctx || *closed)
+          return false;
+        std::vector<WatchEvent> batch;
+        batch.reserve(events.size());
+        for (auto &e : events)
+          batch.push_back({std::move(e.path), watch_hub::name(e.type)});
+        ctx->postTask([closed, fn, batch = std::move(batch)]() mutable {
+          if (*closed)
+            return;
+          try {
+            (*fn)(std::move(batch));
+          } catch (std::exception &e) {
+            std::cerr << "Error in watch callback: " << e.what() << std::endl;
+          }
+        });
+        return true;
+      });
+  return watcher;
+}
 
-  co_return true;
+void filesystem::Watcher::close() {
+  if (!$s->closed->exchange(true))
+    watch_hub::instance().remove($s->id);
 }
 
-} // namespace breeze::js
\ No newline at end of file
+} // namespace breeze::js
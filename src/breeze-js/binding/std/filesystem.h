@@ -1,6 +1,12 @@
 #pragma once
 #include "../binding_helpers.h"
+#include <cstdint>
+#include <functional>
 
+namespace qjs {
+class Value;
+struct shared_buffer;
+}
 
 namespace breeze::js {
 struct filesystem {
@@ -19,6 +25,66 @@ struct filesystem {
   static std::vector<std::string>
   readdirSync(std::string path, std::optional<ReadDirOptions> options);
 
+  struct WalkOptions {
+    bool recursive = false;
+    // Report and descend into what symlinks point to
+    bool follow_symlinks = false;
+    // Also fill size and mtime, one statx per entry
+    bool stat = false;
+  };
+
+  struct Dirent {
+    std::string name;
+    // Relative to the listed directory, '/' separated
+    std::string path;
+    // "file", "directory", "symlink" or "other"
+    std::string type;
+    std::optional<uint64_t> inode;
+    // With stat: bytes and milliseconds since the epoch
+    std::optional<uint64_t> size;
+    std::optional<double> mtime;
+  };
+
+  // Lists entries with their type in one pass over each directory;
+  // subdirectories are listed in parallel on the blocking pool, so entries
+  // of different directories come in no particular order
+  static async_simple::coro::Lazy<std::vector<Dirent>>
+  readdirEntries(std::string path, std::optional<WalkOptions> options);
+  static std::vector<Dirent>
+  readdirEntriesSync(std::string path, std::optional<WalkOptions> options);
+
+  // A walk that hands out entries while it is still running
+  struct DirWalk {
+    // The next batch of entries, null once the walk is done
+    async_simple::coro::Lazy<std::optional<std::vector<Dirent>>> next();
+
+    struct $state;
+    std::shared_ptr<$state> $s;
+  };
+
+  static std::shared_ptr<DirWalk> walk(std::string path,
+                                       std::optional<WalkOptions> options);
+
+  struct GlobOptions {
+    // Directory the patterns are relative to, the current one by default
+    std::optional<std::string> cwd;
+    // Matches to drop; a directory they match is not entered
+    std::optional<std::vector<std::string>> ignore;
+    // Pool threads the walk uses at most
+    std::optional<size_t> concurrency;
+    // Let wildcards match names starting with a dot
+    bool dot = false;
+  };
+
+  // Walks cwd in parallel, entering only directories a pattern can match
+  // below. Entries come in batches as they are found, paths relative to cwd.
+  static std::shared_ptr<DirWalk>
+  glob(std::variant<std::string, std::vector<std::string>> patterns,
+       std::optional<GlobOptions> options);
+  static std::vector<std::string>
+  globSync(std::variant<std::string, std::vector<std::string>> patterns,
+           std::optional<GlobOptions> options);
+
   struct MkDirOptions {
     bool recursive = false;
   };
@@ -28,7 +94,7 @@ struct filesystem {
 
   static bool mkdirSync(std::string path, std::optional<MkDirOptions> options);
 
-  static bool exists(std::string path);
+  static bool exists(std::string_view path);
 
   struct RmOptions {
     bool recursive = false;
@@ -39,14 +105,139 @@ struct filesystem {
 
   static bool rmSync(std::string path, std::optional<RmOptions> options);
 
-  static async_simple::coro::Lazy<bool> writeStringToFile(std::string path,
-                                                          std::string content);
+  struct WriteOptions {
+    // Write a temporary file next to path and rename it over path: readers,
+    // and a crash, see the old content or the new one, never a mix
+    bool atomic = false;
+    // Flush to the disk before resolving, "data" (fdatasync) or "full"
+    // (fsync); atomic writes also sync the directory holding the rename
+    std::optional<std::string> sync;
+  };
+
+  static async_simple::coro::Lazy<bool>
+  writeStringToFile(std::string path, std::string content,
+                    std::optional<WriteOptions> options);
 
   // Binary file I/O (returns/accepts ArrayBuffer on JS side)
-  static std::vector<uint8_t> readFileSync(std::string path);
-  static async_simple::coro::Lazy<std::vector<uint8_t>>
+  static qjs::shared_buffer readFileSync(std::string path);
+  static async_simple::coro::Lazy<qjs::shared_buffer>
   readFile(std::string path);
-  static async_simple::coro::Lazy<bool> writeFile(std::string path,
-                                                   std::vector<uint8_t> content);
+  static async_simple::coro::Lazy<bool>
+  writeFile(std::string path, std::vector<uint8_t> content,
+            std::optional<WriteOptions> options);
+
+  struct ReadCacheOptions {
+    // Bytes of file contents kept, 0 for the default (64 MiB)
+    size_t memory_limit = 64 * 1024 * 1024;
+    // Larger files are read without being kept, 0 for the default (4 MiB)
+    size_t max_file_size = 4 * 1024 * 1024;
+  };
+
+  struct ReadCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    // entries dropped because their file changed
+    size_t stale = 0;
+    // entries dropped to stay within memory_limit
+    size_t evictions = 0;
+    // file bytes served from the cache instead of the disk
+    size_t bytes_saved = 0;
+    double hit_ratio = 0;
+    size_t memory_bytes = 0;
+    size_t entries = 0;
+  };
+
+  // Enables the cache behind readFile, readFileAsString and their Sync
+  // variants, it is off by default. Every hit stats the file and is only
+  // served if its device, inode, size and mtime are unchanged; files
+  // modified in the last 2 seconds are not cached yet.
+  static void configureReadCache(std::optional<ReadCacheOptions> options);
+  // Turns the read cache off and drops its contents
+  static void disableReadCache();
+  static void clearReadCache();
+  static ReadCacheStats readCacheStats();
+
+  struct MmapOptions {
+    // Byte range of the file to map, the whole file by default
+    std::optional<size_t> offset;
+    std::optional<size_t> length;
+    // Access pattern hint: "normal", "sequential", "random" or "willneed"
+    std::optional<std::string> advice;
+  };
+
+  // Maps the file into memory as an ArrayBuffer, unmapped when the buffer is
+  // collected. Pages are copy-on-write: writes to the buffer are private and
+  // never reach the file. At most 2 GiB per mapping.
+  static qjs::shared_buffer mmap(std::string path,
+                                 std::optional<MmapOptions> options);
+
+  struct OpenOptions {
+    // "r" (default), "r+", "w", "w+", "a" or "a+", as for fopen
+    std::optional<std::string> flags;
+  };
+
+  // An open file read and written piece by piece, so that files of any size
+  // are processed in constant memory. Reads go through one buffer owned by
+  // the handle. One call at a time: await each before starting the next.
+  struct FileHandle {
+    // Reads up to length bytes (the rest of buffer by default, at most 1 MiB)
+    // into buffer at offset, from position or else the current position.
+    // Resolves with the number of bytes read, 0 at the end of the file.
+    async_simple::coro::Lazy<size_t> read(qjs::Value buffer,
+                                          std::optional<size_t> offset,
+                                          std::optional<size_t> length,
+                                          std::optional<size_t> position);
+    // The complete lines of the next chunk from the current position, without
+    // their line break. The unterminated last line comes at the end of the
+    // file, then null. A line over max_length bytes (16 MiB by default) is an
+    // error and ends the lines.
+    async_simple::coro::Lazy<std::optional<std::vector<std::string>>>
+    readLines(std::optional<size_t> max_length);
+    // Writes all of data at position or else the current position. Files
+    // opened for appending are always written at their end.
+    async_simple::coro::Lazy<size_t>
+    write(std::variant<std::string, std::vector<uint8_t>> data,
+          std::optional<size_t> position);
+    // whence is "set" (default), "current" or "end"; returns the new position
+    size_t seek(int64_t offset, std::optional<std::string> whence);
+    void close();
+
+    struct $state;
+    std::shared_ptr<$state> $s;
+  };
+
+  static async_simple::coro::Lazy<std::shared_ptr<FileHandle>>
+  open(std::string path, std::optional<OpenOptions> options);
+
+  struct WatchOptions {
+    // Also watch subdirectories, including ones created later
+    bool recursive = false;
+    // Changes to a file within this many milliseconds of the first one are
+    // reported once, 50 by default
+    std::optional<size_t> debounce_ms;
+  };
+
+  struct WatchEvent {
+    // Relative to the watched directory, '/' separated; a watched file
+    // reports its name. Empty when changes were lost and anything may have
+    // changed.
+    std::string path;
+    // "added", "modified" or "removed"
+    std::string type;
+  };
+
+  struct Watcher {
+    void close();
+
+    struct $state;
+    std::shared_ptr<$state> $s;
+  };
+
+  // Calls callback on the JS thread with the changes of the directory or
+  // file at path. The watch goes on until close() or until the JS context
+  // is destroyed, whether the watcher is kept or not.
+  static std::shared_ptr<Watcher>
+  watch(std::string path, std::optional<WatchOptions> options,
+        std::function<void(std::vector<WatchEvent>)> callback);
 };
 } // namespace breeze::js
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "glob.h"
+#include <cstdint>
+#include <stdexcept>
+
+namespace breeze::js {
+
+// Decodes the UTF-8 character at i and moves past it; a stray byte counts
+// as one character
+static uint32_t next_char(std::string_view s, size_t &i) {
+  auto lead = static_cast<unsigned char>(s[i]);
+  size_t len = lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : lead >= 0xc0 ? 2 : 1;
+  if (i + len > s.size())
+    len = 1;
+  uint32_t c = len == 1 ? lead : lead & (0x7f >> len);
+  for (size_t k = 1; k < len; k++)
+    c = c << 6 | (static_cast<unsigned char>(s[i + k]) & 0x3f);
+  i += len;
+  return c;
+}
+
+// Matches one element of p (?, a class, an escaped or plain character)
+// against one character of s, moving past both
+static bool step(std::string_view p, size_t &pi, std::string_view s,
+                 size_t &si) {
+  uint32_t c = next_char(s, si);
+  if (p[pi] == '?') {
+    pi++;
+    return true;
+  }
+  if (p[pi] == '[') {
+    size_t end = pi + 1;
+    bool negate = end < p.size() && (p[end] == '!' || p[end] == '^');
+    if (negate)
+      end++;
+    bool found = false;
+    // A ] right after the opening is part of the class
+    for (bool first = true; end < p.size() && (p[end] != ']' || first);
+         first = false) {
+      if (p[end] == '\\' && end + 1 < p.size())
+        end++;
+      uint32_t lo = next_char(p, end), hi = lo;
+      if (end + 1 < p.size() && p[end] == '-' && p[end + 1] != ']') {
+        end++;
+        if (p[end] == '\\' && end + 1 < p.size())
+          end++;
+        hi = next_char(p, end);
+      }
+      if (lo <= c && c <= hi)
+        found = true;
+    }
+    if (end < p.size()) {
+      pi = end + 1;
+      return found != negate;
+    }
+    // Never closed: a plain [
+  }
+  if (p[pi] == '\\' && pi + 1 < p.size())
+    pi++;
+  return next_char(p, pi) == c;
+}
+
+bool glob_matcher::match_segment(std::string_view p, std::string_view s) {
+  size_t pi = 0, si = 0;
+  // Where to resume after the last *, and the name position it took
+  size_t star = std::string_view::npos, mark = 0;
+  while (si < s.size()) {
+    if (pi < p.size()) {
+      if (p[pi] == '*') {
+        star = ++pi;
+        mark = si;
+        continue;
+      }
+      size_t next_pi = pi, next_si = si;
+      if (step(p, next_pi, s, next_si)) {
+        pi = next_pi;
+        si = next_si;
+        continue;
+      }
+    }
+    if (star == std::string_view::npos)
+      return false;
+    // Let the * take one more character
+    pi = star;
+    next_char(s, mark);
+    si = mark;
+  }
+  while (pi < p.size() && p[pi] == '*')
+    pi++;
+  return pi == p.size();
+}
+
+// Expands the first {a,b} of glob, and recursively the rest. A brace
+// without a comma, or never closed, is literal.
+static void expand_braces(const std::string &glob,
+                          std::vector<std::string> &out) {
+  for (size_t i = 0; i < glob.size(); i++) {
+    if (glob[i] == '\\') {
+      i++;
+      continue;
+    }
+    if (glob[i] != '{')
+      continue;
+    int depth = 0;
+    size_t close = std::string::npos;
+    std::vector<size_t> commas;
+    for (size_t k = i; k < glob.size() && close == std::string::npos; k++) {
+      if (glob[k] == '\\')
+        k++;
+      else if (glob[k] == '{')
+        depth++;
+      else if (glob[k] == '}' && --depth == 0)
+        close = k;
+      else if (glob[k] == ',' && depth == 1)
+        commas.push_back(k);
+    }
+    if (close == std::string::npos)
+      break;
+    if (commas.empty())
+      continue;
+    commas.push_back(close);
+    size_t start = i + 1;
+    for (size_t comma : commas) {
+      expand_braces(glob.substr(0, i) + glob.substr(start, comma - start) +
+                        glob.substr(close + 1),
+                    out);
+      start = comma + 1;
+    }
+    return;
+  }
+  out.push_back(glob);
+}
+
+std::vector<glob_matcher::pattern>
+glob_matcher::compile(const std::vector<std::string> &globs) {
+  std::vector<pattern> result;
+  std::vector<std::string> expanded;
+  for (auto &glob : globs)
+    expand_braces(glob, expanded);
+  for (auto &glob : expanded) {
+    if (glob.starts_with('/') || (glob.size() > 1 && glob[1] == ':'))
+      throw std::runtime_error("glob: pattern is not relative: " + glob);
+    pattern p;
+    p.dir_only = glob.ends_with('/');
+    size_t start = 0;
+    while (start <= glob.size()) {
+      size_t end = glob.find('/', start);
+      if (end == std::string::npos)
+        end = glob.size();
+      std::string_view text(glob.data() + start, end - start);
+      start = end + 1;
+      if (text.empty() || text == ".")
+        continue;
+      if (text == "..")
+        throw std::runtime_error("glob: pattern leaves the base directory: " +
+                                 glob);
+      if (text == "**") {
+        if (p.segments.empty() || p.segments.back().kind != segment::globstar)
+          p.segments.push_back({segment::globstar, {}});
+        continue;
+      }
+      segment s{segment::literal, {}};
+      for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '*' || text[i] == '?' || text[i] == '[')
+          s.kind = segment::wildcard;
+        if (text[i] == '\\' && i + 1 < text.size())
+          i++;
+      }
+      if (s.kind == segment::wildcard) {
+        s.text = text;
+      } else {
+        for (size_t i = 0; i < text.size(); i++) {
+          if (text[i] == '\\' && i + 1 < text.size())
+            i++;
+          s.text += text[i];
+        }
+      }
+      p.segments.push_back(std::move(s));
+    }
+    if (!p.segments.empty())
+      result.push_back(std::move(p));
+  }
+  return result;
+}
+
+glob_matcher::glob_matcher(const std::vector<std::string> &patterns,
+                           const std::vector<std::string> &ignore_patterns,
+                           bool dot)
+    : include(compile(patterns)), ignore(compile(ignore_patterns)), dot(dot) {
+  for (auto &p : ignore) {
+    if (p.segments.size() > 1 &&
+        p.segments.back().kind == segment::globstar) {
+      ignore_dirs.push_back(p);
+      ignore_dirs.back().segments.pop_back();
+    }
+  }
+}
+
+bool glob_matcher::name_matches(const segment &s, std::string_view name) const {
+  if (s.kind == segment::literal)
+    return s.text == name;
+  if (!dot && name.starts_with('.') && !s.text.starts_with('.'))
+    return false;
+  return match_segment(s.text, name);
+}
+
+// With prefix, whether something below path can match instead
+bool glob_matcher::match(const pattern &p, size_t i,
+                         const std::vector<std::string_view> &path, size_t j,
+                         bool prefix) const {
+  for (; i < p.segments.size(); i++, j++) {
+    const auto &s = p.segments[i];
+    if (s.kind == segment::globstar) {
+      // Takes zero or more names, not hidden ones unless dot
+      for (size_t k = j;; k++) {
+        if (match(p, i + 1, path, k, prefix))
+          return true;
+        if (k == path.size())
+          return prefix;
+        if (!dot && path[k].starts_with('.'))
+          return false;
+      }
+    }
+    if (j == path.size())
+      return prefix;
+    if (!name_matches(s, path[j]))
+      return false;
+  }
+  return !prefix && j == path.size();
+}
+
+static std::vector<std::string_view> split_path(std::string_view path) {
+  std::vector<std::string_view> names;
+  while (!path.empty()) {
+    size_t end = path.find('/');
+    names.push_back(path.substr(0, end));
+    if (end == std::string_view::npos)
+      break;
+    path.remove_prefix(end + 1);
+  }
+  return names;
+}
+
+bool glob_matcher::matches(std::string_view path, bool is_dir) const {
+  auto names = split_path(path);
+  for (auto &p : ignore) {
+    if ((!p.dir_only || is_dir) && match(p, 0, names, 0, false))
+      return false;
+  }
+  for (auto &p : include) {
+    if ((!p.dir_only || is_dir) && match(p, 0, names, 0, false))
+      return true;
+  }
+  return false;
+}
+
+bool glob_matcher::descend(std::string_view path) const {
+  auto names = split_path(path);
+  for (auto *patterns : {&ignore, &ignore_dirs}) {
+    for (auto &p : *patterns) {
+      if (match(p, 0, names, 0, false))
+        return false;
+    }
+  }
+  for (auto &p : include) {
+    if (match(p, 0, names, 0, true))
+      return true;
+  }
+  return false;
+}
+
+} // namespace breeze::js
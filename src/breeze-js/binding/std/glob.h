@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace breeze::js {
+
+// Glob patterns compiled for matching '/' separated relative paths, as a
+// directory walk produces them. Supports *, ?, [...] with ! or ^ negation
+// and ranges, {a,b} alternatives, ** for any number of directories and
+// backslash escapes. A trailing / only matches directories. Wildcards skip
+// names starting with a dot unless dot is set or the pattern spells the dot
+// out.
+class glob_matcher {
+public:
+  // Throws std::runtime_error for a pattern that leaves the base directory
+  glob_matcher(const std::vector<std::string> &patterns,
+               const std::vector<std::string> &ignore, bool dot);
+
+  // Whether a walk should report path
+  bool matches(std::string_view path, bool is_dir) const;
+  // Whether a walk should list directory path: some pattern can match below
+  // it and no ignore pattern covers it
+  bool descend(std::string_view path) const;
+
+  // Matches one name against one pattern segment
+  static bool match_segment(std::string_view pattern, std::string_view name);
+
+private:
+  struct segment {
+    enum kind_t { literal, wildcard, globstar } kind;
+    // Unescaped for literal
+    std::string text;
+  };
+  struct pattern {
+    std::vector<segment> segments;
+    bool dir_only = false;
+  };
+
+  static std::vector<pattern> compile(const std::vector<std::string> &globs);
+  bool match(const pattern &p, size_t i,
+             const std::vector<std::string_view> &path, size_t j,
+             bool prefix) const;
+  bool name_matches(const segment &s, std::string_view name) const;
+
+  std::vector<pattern> include;
+  std::vector<pattern> ignore;
+  // Ignore patterns ending in /**, without it: whole directories to skip
+  std::vector<pattern> ignore_dirs;
+  bool dot;
+};
+
+} // namespace breeze::js
@@ -1,4 +1,8 @@
 #include "http.h"
+#include "http_cache.h"
+#include "http_encoding.h"
+#include "http_limiter.h"
+#include "http_transport.h"
 #include <exception>
 #include <stdexcept>
 
@@ -12,63 +16,73 @@ namespace breeze::js {
 
 // --- Headers ---
 
-std::string http::Headers::get(std::string name) {
-  std::string lower_name = name;
-  std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(),
-                 ::tolower);
-  for (const auto &[k, v] : list) {
-    std::string lower_k = k;
-    std::transform(lower_k.begin(), lower_k.end(), lower_k.begin(), ::tolower);
-    if (lower_k == lower_name)
-      return v;
-  }
-  return "";
+static char ascii_tolower(char c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
 }
 
-void http::Headers::set(std::string name, std::string value) {
-  std::string lower_name = name;
-  std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(),
-                 ::tolower);
-  for (auto &[k, v] : list) {
-    std::string lower_k = k;
-    std::transform(lower_k.begin(), lower_k.end(), lower_k.begin(), ::tolower);
-    if (lower_k == lower_name) {
-      v = value;
-      return;
-    }
+size_t http::Headers::$name_hash::operator()(std::string_view name) const {
+  // FNV-1a over the lowercased name
+  size_t hash = 14695981039346656037ull;
+  for (char c : name) {
+    hash ^= static_cast<unsigned char>(ascii_tolower(c));
+    hash *= 1099511628211ull;
   }
-  list.emplace_back(name, value);
+  return hash;
+}
+
+bool http::Headers::$name_equal::operator()(std::string_view a,
+                                            std::string_view b) const {
+  return std::ranges::equal(a, b, [](char x, char y) {
+    return ascii_tolower(x) == ascii_tolower(y);
+  });
+}
+
+void http::Headers::$reindex() {
+  $index.clear();
+  for (size_t i = 0; i < $list.size(); i++)
+    $index.try_emplace($list[i].first, i);
 }
 
-bool http::Headers::has(std::string name) {
-  std::string lower_name = name;
-  std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(),
-                 ::tolower);
-  for (const auto &[k, v] : list) {
-    std::string lower_k = k;
-    std::transform(lower_k.begin(), lower_k.end(), lower_k.begin(), ::tolower);
-    if (lower_k == lower_name)
-      return true;
+std::string http::Headers::get(std::string_view name) {
+  auto it = $index.find(name);
+  return it != $index.end() ? $list[it->second].second : "";
+}
+
+void http::Headers::set(std::string name, std::string value) {
+  auto it = $index.find(name);
+  if (it != $index.end()) {
+    $list[it->second].second = std::move(value);
+    return;
   }
-  return false;
+  append(std::move(name), std::move(value));
 }
 
+bool http::Headers::has(std::string_view name) { return $index.contains(name); }
+
 void http::Headers::append(std::string name, std::string value) {
-  list.emplace_back(name, value);
+  $index.try_emplace(name, $list.size());
+  $list.emplace_back(std::move(name), std::move(value));
+}
+
+void http::Headers::remove_(std::string_view name) {
+  if (!$index.contains(name))
+    return;
+  std::erase_if($list, [&](const auto &pair) {
+    return $name_equal{}(pair.first, name);
+  });
+  $reindex();
 }
 
-void http::Headers::remove_(std::string name) {
-  std::string lower_name = name;
-  std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(),
-                 ::tolower);
-  list.erase(std::remove_if(list.begin(), list.end(),
-                            [&](const auto &pair) {
-                              std::string lower_k = pair.first;
-                              std::transform(lower_k.begin(), lower_k.end(),
-                                             lower_k.begin(), ::tolower);
-                              return lower_k == lower_name;
-                            }),
-             list.end());
+const std::vector<std::pair<std::string, std::string>> &
+http::Headers::entries() const {
+  return $list;
+}
+
+void http::Headers::forEach(
+    std::function<void(std::string_view, std::string_view)> callback) {
+  // The callback may modify the headers, so index instead of iterating
+  for (size_t i = 0; i < $list.size(); i++)
+    callback($list[i].second, $list[i].first);
 }
 
 // --- Response ---
@@ -97,14 +111,16 @@ std::string http::Response::json_text() {
   return text();
 }
 
-JSValue http::Response::json() {
-  auto *ctx = qjs::Context::current->ctx;
-  auto str = text();
-  JSValue result = JS_ParseJSON(ctx, str.c_str(), str.size(), "<json>");
-  if (JS_IsException(result)) {
-    throw qjs::exception{ctx};
-  }
-  return result;
+// Takes the body by value: the Response may be collected while the parse
+// runs on the executor
+static async_simple::coro::Lazy<qjs::json_document>
+parse_json(std::vector<uint8_t> body) {
+  co_return qjs::json_document::parse(std::string_view(
+      reinterpret_cast<const char *>(body.data()), body.size()));
+}
+
+async_simple::coro::Lazy<qjs::json_document> http::Response::json() {
+  return parse_json($body);
 }
 
 std::shared_ptr<Blob> http::Response::blob() {
@@ -153,11 +169,80 @@ static std::string http_status_text(int status) {
   }
 }
 
-async_simple::coro::Lazy<std::shared_ptr<http::Response>>
-http::fetch(std::string url, std::optional<RequestInit> init) {
-  cinatra::coro_http_client client;
+static std::shared_ptr<http::Response>
+response_from_cache(const http_cache::entry &e) {
+  auto response = std::make_shared<http::Response>();
+  response->$status = e.status;
+  response->$statusText = http_status_text(e.status);
+  response->$url = e.url;
+  response->$ok = e.status >= 200 && e.status < 300;
+  response->$body = e.body;
+  response->$headers = std::make_shared<http::Headers>();
+  for (const auto &[name, value] : e.headers)
+    response->$headers->append(name, value);
+  return response;
+}
+
+void http::configureCache(std::optional<CacheOptions> options) {
+  setDefault(options);
+  // Unset fields arrive as 0 from JS
+  if (options->memory_limit == 0)
+    options->memory_limit = CacheOptions{}.memory_limit;
+  http_cache::instance().configure(http_cache::options{
+      .memory_limit = options->memory_limit,
+      .disk_path = options->disk_path,
+  });
+}
+
+void http::disableCache() { http_cache::instance().configure(std::nullopt); }
+
+void http::clearCache() { http_cache::instance().clear(); }
+
+http::CacheStats http::cacheStats() {
+  auto s = http_cache::instance().get_stats();
+  CacheStats stats;
+  stats.hits = s.hits;
+  stats.misses = s.misses;
+  stats.revalidations = s.revalidations;
+  stats.bytes_saved = s.bytes_saved;
+  stats.memory_bytes = s.memory_bytes;
+  stats.entries = s.entries;
+  if (s.hits + s.misses)
+    stats.hit_ratio = double(s.hits) / double(s.hits + s.misses);
+  return stats;
+}
+
+static async_simple::coro::Lazy<cinatra::resp_data>
+send_request(cinatra::coro_http_client &client, const std::string &method,
+             const std::string &url, std::string body,
+             cinatra::req_content_type content_type) {
   client.set_req_timeout(std::chrono::seconds(30));
+  if (method == "GET")
+    co_return co_await client.async_get(url);
+  if (method == "POST")
+    co_return co_await client.async_post(url, std::move(body), content_type);
+  if (method == "PUT")
+    co_return co_await client.async_put(url, std::move(body), content_type);
+  if (method == "DELETE")
+    co_return co_await client.async_delete(url, std::move(body), content_type);
+
+  // Fallback: use async_request with appropriate http_method
+  cinatra::req_context<std::string> ctx{};
+  ctx.content = std::move(body);
+  cinatra::http_method hm = cinatra::http_method::GET;
+  if (method == "PATCH")
+    hm = cinatra::http_method::PATCH;
+  else if (method == "HEAD")
+    hm = cinatra::http_method::HEAD;
+  else if (method == "OPTIONS")
+    hm = cinatra::http_method::OPTIONS;
+  co_return co_await client.async_request(url, hm, std::move(ctx));
+}
 
+static async_simple::coro::Lazy<std::shared_ptr<http::Response>>
+fetch_impl(std::string url, std::optional<http::RequestInit> init) {
+  using Response = http::Response;
+  using Headers = http::Headers;
   std::string method = "GET";
   std::string body;
   bool body_is_binary = false;
@@ -196,13 +281,6 @@ http::fetch(std::string url, std::optional<RequestInit> init) {
     }
   }
 
-  // Apply headers using add_header for reliable HTTP formatting
-  for (const auto &[k, v] : req_headers) {
-    client.add_header(k, v);
-  }
-
-  cinatra::resp_data resp;
-
   // Determine content type from headers or body type
   cinatra::req_content_type content_type = cinatra::req_content_type::text;
   if (auto it = req_headers.find("Content-Type"); it != req_headers.end()) {
@@ -222,31 +300,88 @@ http::fetch(std::string url, std::optional<RequestInit> init) {
   std::transform(upper_method.begin(), upper_method.end(), upper_method.begin(),
                  ::toupper);
 
-  if (upper_method == "GET") {
-    resp = co_await client.async_get(url);
-  } else if (upper_method == "POST") {
-    resp = co_await client.async_post(url, std::move(body), content_type);
-  } else if (upper_method == "PUT") {
-    resp = co_await client.async_put(url, std::move(body), content_type);
-  } else if (upper_method == "DELETE") {
-    resp = co_await client.async_delete(url, std::move(body), content_type);
-  } else {
-    // Fallback: use async_request with appropriate http_method
-    cinatra::req_context<std::string> ctx{};
-    ctx.content = std::move(body);
-    cinatra::http_method hm = cinatra::http_method::GET;
-    if (upper_method == "PATCH")
-      hm = cinatra::http_method::PATCH;
-    else if (upper_method == "HEAD")
-      hm = cinatra::http_method::HEAD;
-    else if (upper_method == "OPTIONS")
-      hm = cinatra::http_method::OPTIONS;
-    resp = co_await client.async_request(url, hm, std::move(ctx));
+  auto &cache = http_cache::instance();
+  std::string cache_mode = "default";
+  if (init && init->cache && *init->cache != "undefined")
+    cache_mode = *init->cache;
+  bool use_cache =
+      upper_method == "GET" && cache_mode != "no-store" && cache.enabled();
+  std::shared_ptr<const http_cache::entry> cached;
+  if (use_cache && cache_mode != "reload") {
+    cached = cache.lookup(url, req_headers);
+    if (cached && (cache_mode == "force-cache" ||
+                   cache_mode == "only-if-cached" ||
+                   (cache_mode == "default" &&
+                    cached->fresh(http_cache::clock::now())))) {
+      cache.record_hit(*cached, false);
+      co_return response_from_cache(*cached);
+    }
+  }
+  if (cache_mode == "only-if-cached")
+    throw std::runtime_error("fetch failed: no cached response for " + url);
+  auto user_header = [&](std::string_view name) {
+    return std::ranges::any_of(req_headers, [&](const auto &h) {
+      return std::ranges::equal(h.first, name, [](char a, char b) {
+        return ascii_tolower(a) == ascii_tolower(b);
+      });
+    });
+  };
+
+  // Headers sent on the wire: req_headers plus negotiation, body coding and
+  // cache validators
+  auto send_headers = req_headers;
+  if (!user_header("accept-encoding"))
+    send_headers.emplace("Accept-Encoding", http_encoding::accept_encoding());
+  if (init && init->compress && !init->compress->empty() &&
+      *init->compress != "undefined" && *init->compress != "identity") {
+    if (!http_encoding::supported(*init->compress))
+      throw std::runtime_error("Unsupported compress encoding: " +
+                               *init->compress);
+    body = http_encoding::encode(*init->compress, body);
+    send_headers.insert_or_assign("Content-Encoding", *init->compress);
+  }
+  if (cached) {
+    // Revalidate the stored response, a 304 answer is served from the cache
+    if (auto etag = cached->header("etag");
+        !etag.empty() && !user_header("if-none-match"))
+      send_headers.emplace("If-None-Match", etag);
+    if (auto modified = cached->header("last-modified");
+        !modified.empty() && !user_header("if-modified-since"))
+      send_headers.emplace("If-Modified-Since", modified);
+  }
+
+  // resp views into the client's buffers, conn must outlive its last use
+  auto permit = co_await http_limiter::instance().acquire(url);
+  auto &transport = http_transport::instance();
+  auto conn = transport.acquire(url, send_headers);
+  // A GET may be retried below, so its body is copied instead of moved
+  auto resp = co_await send_request(conn.client(), upper_method, url,
+                                    upper_method == "GET" ? body
+                                                          : std::move(body),
+                                    content_type);
+  if (resp.net_err && conn.reused() && upper_method == "GET") {
+    // The server may have closed the idle connection, GET is safe to retry
+    conn = transport.acquire(url, send_headers, true);
+    resp = co_await send_request(conn.client(), upper_method, url,
+                                 std::move(body), content_type);
   }
 
   if (resp.net_err) {
     throw std::runtime_error("fetch failed: " + resp.net_err.message());
   }
+  if (http_transport::keep_alive_allowed(resp))
+    conn.keep_alive();
+
+  http_cache::header_list resp_headers;
+  resp_headers.reserve(resp.resp_headers.size());
+  for (const auto &hdr : resp.resp_headers)
+    resp_headers.emplace_back(hdr.name, hdr.value);
+
+  if (cached && resp.status == 304) {
+    auto updated = cache.revalidate(cached, resp_headers);
+    cache.record_hit(*updated, true);
+    co_return response_from_cache(*updated);
+  }
 
   auto response = std::make_shared<Response>();
   response->$status = resp.status;
@@ -254,20 +389,95 @@ http::fetch(std::string url, std::optional<RequestInit> init) {
   response->$url = url;
   response->$ok = resp.status >= 200 && resp.status < 300;
 
-  // Copy body
-  auto body_sv = resp.resp_body;
-  response->$body.assign(reinterpret_cast<const uint8_t *>(body_sv.data()),
-                         reinterpret_cast<const uint8_t *>(body_sv.data()) +
-                             body_sv.size());
+  // Copy body, undoing its Content-Encoding. This coroutine runs on the
+  // coro_io executor, so decompression stays off the JS thread.
+  std::span<const uint8_t> body_bytes(
+      reinterpret_cast<const uint8_t *>(resp.resp_body.data()),
+      resp.resp_body.size());
+  auto coding = std::ranges::find_if(resp_headers, [](const auto &h) {
+    return std::ranges::equal(h.first, std::string_view("content-encoding"),
+                              [](char a, char b) {
+                                return ascii_tolower(a) == b;
+                              });
+  });
+  if (coding != resp_headers.end() && !body_bytes.empty() &&
+      http_encoding::decodable(coding->second)) {
+    try {
+      response->$body = http_encoding::decode(
+          coding->second, body_bytes,
+          http_limiter::instance().get_limits().max_decoded_size);
+    } catch (const std::runtime_error &e) {
+      throw std::runtime_error("fetch failed: " + std::string(e.what()));
+    }
+  } else {
+    response->$body.assign(body_bytes.begin(), body_bytes.end());
+  }
 
   // Copy headers
   response->$headers = std::make_shared<Headers>();
-  for (const auto &hdr : resp.resp_headers) {
-    response->$headers->list.emplace_back(std::string(hdr.name),
-                                          std::string(hdr.value));
+  for (const auto &[name, value] : resp_headers) {
+    response->$headers->append(name, value);
+  }
+
+  if (use_cache) {
+    cache.record_miss();
+    cache.store(url, resp.status, std::move(resp_headers), response->$body,
+                req_headers);
+  } else if (response->$ok && upper_method != "GET" &&
+             upper_method != "HEAD" && upper_method != "OPTIONS") {
+    // A successful unsafe request invalidates what is cached for the URL
+    cache.invalidate(url);
   }
 
   co_return response;
 }
 
+async_simple::coro::Lazy<std::shared_ptr<http::Response>>
+http::fetch(std::string url, std::optional<RequestInit> init) {
+  auto &limiter = http_limiter::instance();
+  bool is_get = !init || init->method.empty() || init->method == "undefined" ||
+                std::ranges::equal(init->method, std::string_view("get"),
+                                   [](char a, char b) {
+                                     return ascii_tolower(a) == b;
+                                   });
+  if (!is_get || (init && init->body) || !limiter.get_limits().coalesce_gets)
+    co_return co_await fetch_impl(std::move(url), std::move(init));
+
+  // Identical GETs: same URL, request headers and cache mode
+  std::string key = url;
+  if (init && init->headers) {
+    for (const auto &[k, v] : *init->headers) {
+      key += '\n';
+      key += k;
+      key += ':';
+      key += v;
+    }
+  }
+  if (init && init->cache)
+    key += "\ncache:" + *init->cache;
+
+  if (auto joined = limiter.join(key))
+    co_return co_await std::move(*joined);
+
+  async_simple::Try<std::shared_ptr<Response>> result;
+  try {
+    result = co_await fetch_impl(std::move(url), std::move(init));
+  } catch (...) {
+    result = async_simple::Try<std::shared_ptr<Response>>(
+        std::current_exception());
+  }
+  limiter.finish(key, result);
+  co_return std::move(result).value();
+}
+
+http::FetchStats http::fetchStats() {
+  auto s = http_limiter::instance().get_stats();
+  FetchStats stats;
+  stats.queued = s.queued;
+  stats.in_flight = s.in_flight;
+  stats.waited = s.waited;
+  stats.coalesced = s.coalesced;
+  return stats;
+}
+
 } // namespace breeze::js
@@ -1,24 +1,50 @@
 #pragma once
 #include "../binding_helpers.h"
 #include "blob.h"
+#include <functional>
 #include <map>
 #include <memory>
+#include <string_view>
+#include <unordered_map>
 #include <variant>
 
 struct JSValue;
+namespace qjs {
+struct json_document;
+}
 
 namespace breeze::js {
 struct http {
 
   struct Headers {
-    std::vector<std::pair<std::string, std::string>> list;
-
-    std::string get(std::string name);
+    std::string get(std::string_view name);
     void set(std::string name, std::string value);
-    bool has(std::string name);
+    bool has(std::string_view name);
     void append(std::string name, std::string value);
     // Note: named 'remove_' to avoid conflict with C macro 'remove'
-    void remove_(std::string name);
+    void remove_(std::string_view name);
+    // The [name, value] pairs in insertion order, valid until the next change
+    const std::vector<std::pair<std::string, std::string>> &entries() const;
+    // Calls callback(value, name) for each header in insertion order
+    void
+    forEach(std::function<void(std::string_view, std::string_view)> callback);
+
+  private:
+    // Case-insensitive hashing so lookups need no lowercased copies
+    struct $name_hash {
+      using is_transparent = void;
+      size_t operator()(std::string_view name) const;
+    };
+    struct $name_equal {
+      using is_transparent = void;
+      bool operator()(std::string_view a, std::string_view b) const;
+    };
+
+    void $reindex();
+
+    std::vector<std::pair<std::string, std::string>> $list;
+    // Position of the first header with a given name in $list
+    std::unordered_map<std::string, size_t, $name_hash, $name_equal> $index;
   };
 
   struct Response {
@@ -41,7 +67,9 @@ struct http {
     std::vector<uint8_t> arrayBuffer();
     // Returns body as JSON string (caller can JSON.parse on JS side)
     std::string json_text();
-    JSValue json();
+    // Parses the body off the JS thread, only the resulting values are
+    // created on it
+    async_simple::coro::Lazy<qjs::json_document> json();
     std::shared_ptr<Blob> blob();
   };
 
@@ -53,10 +81,57 @@ struct http {
         body;
     // headers: accepts plain object {key: value}
     std::optional<std::map<std::string, std::string>> headers;
+    // cache mode as in the Fetch standard: "default", "no-store", "reload",
+    // "no-cache", "force-cache" or "only-if-cached"
+    std::optional<std::string> cache;
+    // content coding applied to the body before sending, e.g. "gzip"; sets
+    // Content-Encoding
+    std::optional<std::string> compress;
+  };
+
+  struct CacheOptions {
+    // size budget of the in-memory LRU tier in bytes, 0 for the default
+    size_t memory_limit = 32 * 1024 * 1024;
+    // directory of the on-disk tier, memory only when empty
+    std::string disk_path;
+  };
+
+  struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    // hits served after a 304 Not Modified
+    size_t revalidations = 0;
+    // response body bytes served from the cache instead of the network
+    size_t bytes_saved = 0;
+    double hit_ratio = 0;
+    size_t memory_bytes = 0;
+    size_t entries = 0;
+  };
+
+  struct FetchStats {
+    // requests waiting for a concurrency slot right now
+    size_t queued = 0;
+    size_t in_flight = 0;
+    // requests that had to wait for a slot, in total
+    size_t waited = 0;
+    // GETs answered by an identical in-flight request, in total
+    size_t coalesced = 0;
   };
 
   // Fetch a URL and return a Response
   static async_simple::coro::Lazy<std::shared_ptr<Response>>
   fetch(std::string url, std::optional<RequestInit> init);
+
+  // Enables the HTTP cache used by fetch for GET requests, it is off by
+  // default. Honours Cache-Control, Expires, ETag and Last-Modified.
+  static void configureCache(std::optional<CacheOptions> options);
+  // Turns the HTTP cache off and drops its memory tier
+  static void disableCache();
+  // Removes all cached responses, including the on-disk tier
+  static void clearCache();
+  static CacheStats cacheStats();
+  // Concurrency and coalescing counters, limits are set through
+  // script_context::set_fetch_limits
+  static FetchStats fetchStats();
 };
 } // namespace breeze::js
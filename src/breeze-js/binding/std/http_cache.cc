@@ -0,0 +1,447 @@
+#include "http_cache.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <ranges>
+
+namespace breeze::js {
+
+namespace {
+
+constexpr std::string_view disk_magic = "breeze-http-cache 1";
+
+char ascii_tolower(char c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+  return std::ranges::equal(a, b, [](char x, char y) {
+    return ascii_tolower(x) == ascii_tolower(y);
+  });
+}
+
+std::string_view trim(std::string_view s) {
+  auto first = s.find_first_not_of(" \t");
+  if (first == std::string_view::npos)
+    return {};
+  return s.substr(first, s.find_last_not_of(" \t") - first + 1);
+}
+
+std::string_view find_request_header(const http_cache::request_headers &h,
+                                     std::string_view name) {
+  for (const auto &[k, v] : h) {
+    if (iequals(k, name))
+      return v;
+  }
+  return {};
+}
+
+// Parses an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT"), the only format
+// servers are allowed to send
+std::optional<http_cache::clock::time_point>
+parse_http_date(std::string_view s) {
+  static constexpr std::string_view months[] = {"Jan", "Feb", "Mar", "Apr",
+                                                "May", "Jun", "Jul", "Aug",
+                                                "Sep", "Oct", "Nov", "Dec"};
+  std::string str(s);
+  int day, year, hour, minute, second;
+  char month_name[4] = {};
+  if (std::sscanf(str.c_str(), "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &day,
+                  month_name, &year, &hour, &minute, &second) != 6)
+    return std::nullopt;
+  auto month = std::ranges::find(months, std::string_view(month_name));
+  if (month == std::end(months))
+    return std::nullopt;
+  std::chrono::year_month_day date{
+      std::chrono::year{year},
+      std::chrono::month{unsigned(month - std::begin(months) + 1)},
+      std::chrono::day{unsigned(day)}};
+  if (!date.ok())
+    return std::nullopt;
+  return std::chrono::sys_days{date} + std::chrono::hours{hour} +
+         std::chrono::minutes{minute} + std::chrono::seconds{second};
+}
+
+struct cache_control {
+  bool no_store = false;
+  bool no_cache = false;
+  std::optional<int64_t> max_age;
+};
+
+cache_control parse_cache_control(std::string_view value) {
+  cache_control cc;
+  for (auto part : value | std::views::split(',')) {
+    auto directive = trim(std::string_view(part.begin(), part.end()));
+    auto eq = directive.find('=');
+    auto name = trim(directive.substr(0, eq));
+    if (iequals(name, "no-store")) {
+      cc.no_store = true;
+    } else if (iequals(name, "no-cache")) {
+      cc.no_cache = true;
+    } else if (iequals(name, "max-age") && eq != std::string_view::npos) {
+      auto arg = trim(directive.substr(eq + 1));
+      if (arg.size() >= 2 && arg.front() == '"' && arg.back() == '"')
+        arg = arg.substr(1, arg.size() - 2);
+      int64_t seconds;
+      auto [ptr, ec] =
+          std::from_chars(arg.data(), arg.data() + arg.size(), seconds);
+      if (ec == std::errc{})
+        cc.max_age = seconds;
+    }
+  }
+  return cc;
+}
+
+// Computes expires_at from the stored headers. Returns false when the
+// response must not be stored.
+bool apply_freshness(http_cache::entry &e) {
+  using namespace std::chrono;
+  auto cc = parse_cache_control(e.header("cache-control"));
+  if (cc.no_store)
+    return false;
+  e.no_cache = cc.no_cache;
+
+  http_cache::clock::duration lifetime{};
+  if (cc.max_age) {
+    lifetime = seconds{*cc.max_age};
+  } else if (auto expires = parse_http_date(e.header("expires"))) {
+    auto date = parse_http_date(e.header("date")).value_or(e.stored_at);
+    lifetime = *expires - date;
+  } else if (auto modified = parse_http_date(e.header("last-modified"))) {
+    // Heuristic freshness, RFC 9111 4.2.2
+    lifetime = std::min<http_cache::clock::duration>(
+        (e.stored_at - *modified) / 10, hours{24});
+  }
+
+  int64_t age = 0;
+  auto age_header = e.header("age");
+  std::from_chars(age_header.data(), age_header.data() + age_header.size(),
+                  age);
+  e.expires_at = e.stored_at + lifetime - seconds{age};
+  return true;
+}
+
+int64_t to_unix(http_cache::clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch())
+      .count();
+}
+
+http_cache::clock::time_point from_unix(int64_t s) {
+  return http_cache::clock::time_point{std::chrono::seconds{s}};
+}
+
+} // namespace
+
+std::string_view http_cache::entry::header(std::string_view name) const {
+  for (const auto &[k, v] : headers) {
+    if (iequals(k, name))
+      return v;
+  }
+  return {};
+}
+
+bool http_cache::entry::fresh(clock::time_point now) const {
+  return !no_cache && now < expires_at;
+}
+
+bool http_cache::entry::has_validator() const {
+  return !header("etag").empty() || !header("last-modified").empty();
+}
+
+size_t http_cache::entry::footprint() const {
+  size_t size = sizeof(entry) + url.size() + body.size();
+  for (const auto &[k, v] : headers)
+    size += k.size() + v.size();
+  for (const auto &[k, v] : vary)
+    size += k.size() + v.size();
+  return size;
+}
+
+http_cache &http_cache::instance() {
+  static http_cache cache;
+  return cache;
+}
+
+void http_cache::configure(std::optional<options> new_opts) {
+  std::lock_guard lock(mutex);
+  opts = std::move(new_opts);
+  if (!opts) {
+    lru.clear();
+    by_url.clear();
+    memory_bytes = 0;
+    return;
+  }
+  while (memory_bytes > opts->memory_limit && !lru.empty())
+    erase_memory(lru.back()->url);
+  if (!opts->disk_path.empty()) {
+    std::error_code ec;
+    std::filesystem::create_directories(opts->disk_path, ec);
+  }
+}
+
+bool http_cache::enabled() {
+  std::lock_guard lock(mutex);
+  return opts.has_value();
+}
+
+std::shared_ptr<const http_cache::entry>
+http_cache::lookup(const std::string &url, const request_headers &req_headers) {
+  std::shared_ptr<const entry> e;
+  {
+    std::lock_guard lock(mutex);
+    if (!opts)
+      return nullptr;
+    if (auto it = by_url.find(url); it != by_url.end()) {
+      lru.splice(lru.begin(), lru, it->second);
+      e = *it->second;
+    }
+  }
+  if (!e) {
+    auto loaded = read_disk(url);
+    if (!loaded)
+      return nullptr;
+    std::lock_guard lock(mutex);
+    if (opts)
+      insert_memory(loaded);
+    e = std::move(loaded);
+  }
+  for (const auto &[name, value] : e->vary) {
+    if (find_request_header(req_headers, name) != value)
+      return nullptr;
+  }
+  return e;
+}
+
+void http_cache::store(const std::string &url, int status,
+                       header_list headers, std::vector<uint8_t> body,
+                       const request_headers &req_headers) {
+  if (status != 200 && status != 203)
+    return;
+  auto e = std::make_shared<entry>();
+  e->url = url;
+  e->status = status;
+  e->headers = std::move(headers);
+  e->body = std::move(body);
+  e->stored_at = clock::now();
+
+  auto vary = e->header("vary");
+  if (trim(vary) == "*" || !apply_freshness(*e)) {
+    invalidate(url);
+    return;
+  }
+  for (auto part : vary | std::views::split(',')) {
+    auto name = trim(std::string_view(part.begin(), part.end()));
+    if (!name.empty())
+      e->vary.emplace_back(name, find_request_header(req_headers, name));
+  }
+  // Stale on arrival and nothing to revalidate with
+  if (!e->fresh(e->stored_at) && !e->has_validator())
+    return;
+
+  {
+    std::lock_guard lock(mutex);
+    if (!opts)
+      return;
+    insert_memory(e);
+  }
+  write_disk(*e);
+}
+
+std::shared_ptr<const http_cache::entry>
+http_cache::revalidate(const std::shared_ptr<const entry> &stale,
+                       const header_list &not_modified_headers) {
+  auto e = std::make_shared<entry>(*stale);
+  for (const auto &[name, value] : not_modified_headers) {
+    // These describe the (empty) 304 body, not the stored one
+    if (iequals(name, "content-length") || iequals(name, "transfer-encoding"))
+      continue;
+    auto it = std::ranges::find_if(
+        e->headers, [&](const auto &h) { return iequals(h.first, name); });
+    if (it != e->headers.end())
+      it->second = value;
+    else
+      e->headers.emplace_back(name, value);
+  }
+  e->stored_at = clock::now();
+  if (!apply_freshness(*e)) {
+    invalidate(e->url);
+    return e;
+  }
+  {
+    std::lock_guard lock(mutex);
+    if (opts)
+      insert_memory(e);
+  }
+  write_disk(*e);
+  return e;
+}
+
+void http_cache::invalidate(const std::string &url) {
+  std::lock_guard lock(mutex);
+  if (!opts)
+    return;
+  erase_memory(url);
+  if (!opts->disk_path.empty()) {
+    std::error_code ec;
+    std::filesystem::remove(disk_file(url), ec);
+  }
+}
+
+void http_cache::clear() {
+  std::lock_guard lock(mutex);
+  lru.clear();
+  by_url.clear();
+  memory_bytes = 0;
+  if (opts && !opts->disk_path.empty()) {
+    std::error_code ec;
+    for (const auto &file :
+         std::filesystem::directory_iterator(opts->disk_path, ec)) {
+      if (file.path().extension() == ".cache")
+        std::filesystem::remove(file.path(), ec);
+    }
+  }
+}
+
+void http_cache::record_hit(const entry &e, bool revalidated) {
+  std::lock_guard lock(mutex);
+  counters.hits++;
+  counters.bytes_saved += e.body.size();
+  if (revalidated)
+    counters.revalidations++;
+}
+
+void http_cache::record_miss() {
+  std::lock_guard lock(mutex);
+  counters.misses++;
+}
+
+http_cache::stats http_cache::get_stats() {
+  std::lock_guard lock(mutex);
+  stats s = counters;
+  s.memory_bytes = memory_bytes;
+  s.entries = lru.size();
+  return s;
+}
+
+void http_cache::insert_memory(std::shared_ptr<const entry> e) {
+  erase_memory(e->url);
+  size_t size = e->footprint();
+  if (size > opts->memory_limit)
+    return;
+  lru.push_front(std::move(e));
+  by_url[lru.front()->url] = lru.begin();
+  memory_bytes += size;
+  while (memory_bytes > opts->memory_limit)
+    erase_memory(lru.back()->url);
+}
+
+void http_cache::erase_memory(const std::string &url) {
+  auto it = by_url.find(url);
+  if (it == by_url.end())
+    return;
+  memory_bytes -= (*it->second)->footprint();
+  lru.erase(it->second);
+  by_url.erase(it);
+}
+
+std::filesystem::path http_cache::disk_file(const std::string &url) const {
+  // FNV-1a; the file records the full URL to rule out collisions
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : url) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return opts->disk_path / std::format("{:016x}.cache", hash);
+}
+
+void http_cache::write_disk(const entry &e) {
+  std::filesystem::path file;
+  {
+    std::lock_guard lock(mutex);
+    if (!opts || opts->disk_path.empty())
+      return;
+    file = disk_file(e.url);
+  }
+  auto tmp = file;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out)
+      return;
+    out << disk_magic << '\n'
+        << e.url << '\n'
+        << e.status << ' ' << to_unix(e.stored_at) << ' '
+        << to_unix(e.expires_at) << ' ' << e.no_cache << ' '
+        << e.headers.size() << ' ' << e.vary.size() << ' ' << e.body.size()
+        << '\n';
+    for (const auto &[k, v] : e.headers)
+      out << k << ':' << v << '\n';
+    for (const auto &[k, v] : e.vary)
+      out << k << ':' << v << '\n';
+    out.write(reinterpret_cast<const char *>(e.body.data()), e.body.size());
+    if (!out)
+      return;
+  }
+  // Readers never see a partially written entry
+  std::error_code ec;
+  std::filesystem::rename(tmp, file, ec);
+  if (ec)
+    std::filesystem::remove(tmp, ec);
+}
+
+std::shared_ptr<http_cache::entry>
+http_cache::read_disk(const std::string &url) {
+  std::filesystem::path file;
+  {
+    std::lock_guard lock(mutex);
+    if (!opts || opts->disk_path.empty())
+      return nullptr;
+    file = disk_file(url);
+  }
+  std::ifstream in(file, std::ios::binary);
+  if (!in)
+    return nullptr;
+
+  std::string line;
+  if (!std::getline(in, line) || line != disk_magic)
+    return nullptr;
+  if (!std::getline(in, line) || line != url)
+    return nullptr;
+
+  auto e = std::make_shared<entry>();
+  e->url = url;
+  int64_t stored_at, expires_at;
+  size_t header_count, vary_count, body_size;
+  in >> e->status >> stored_at >> expires_at >> e->no_cache >> header_count >>
+      vary_count >> body_size;
+  in.ignore(1);
+  if (!in)
+    return nullptr;
+  e->stored_at = from_unix(stored_at);
+  e->expires_at = from_unix(expires_at);
+
+  auto read_pairs = [&](header_list &list, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      if (!std::getline(in, line))
+        return false;
+      auto colon = line.find(':');
+      if (colon == std::string::npos)
+        return false;
+      list.emplace_back(line.substr(0, colon), line.substr(colon + 1));
+    }
+    return true;
+  };
+  if (!read_pairs(e->headers, header_count) ||
+      !read_pairs(e->vary, vary_count))
+    return nullptr;
+
+  e->body.resize(body_size);
+  in.read(reinterpret_cast<char *>(e->body.data()), body_size);
+  if (size_t(in.gcount()) != body_size)
+    return nullptr;
+  return e;
+}
+
+} // namespace breeze::js
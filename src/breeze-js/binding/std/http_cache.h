@@ -0,0 +1,102 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace breeze::js {
+
+// Private HTTP cache in front of http::fetch, following the parts of
+// RFC 9111 a client cache needs: an LRU memory tier backed by an optional
+// on-disk tier, Cache-Control/Expires freshness and ETag/Last-Modified
+// revalidation. Only successful GET responses are stored, one per URL.
+class http_cache {
+public:
+  using clock = std::chrono::system_clock;
+  using header_list = std::vector<std::pair<std::string, std::string>>;
+  using request_headers = std::unordered_map<std::string, std::string>;
+
+  struct entry {
+    std::string url;
+    int status = 0;
+    header_list headers;
+    std::vector<uint8_t> body;
+    // Request header values selected by the response's Vary header
+    header_list vary;
+    clock::time_point stored_at;
+    clock::time_point expires_at;
+    // Cache-Control: no-cache, the entry must be revalidated before use
+    bool no_cache = false;
+
+    // Returns the value of a response header, or an empty string
+    std::string_view header(std::string_view name) const;
+    bool fresh(clock::time_point now) const;
+    bool has_validator() const;
+    size_t footprint() const;
+  };
+
+  struct options {
+    size_t memory_limit = 32 * 1024 * 1024;
+    // No disk tier when empty
+    std::filesystem::path disk_path;
+  };
+
+  struct stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t revalidations = 0;
+    uint64_t bytes_saved = 0;
+    uint64_t memory_bytes = 0;
+    uint64_t entries = 0;
+  };
+
+  static http_cache &instance();
+
+  void configure(std::optional<options> opts);
+  bool enabled();
+
+  // Returns the entry for url when it was stored for matching request
+  // headers, promoting it from the disk tier if needed
+  std::shared_ptr<const entry> lookup(const std::string &url,
+                                      const request_headers &req_headers);
+  // Stores a response if its status and Cache-Control allow it
+  void store(const std::string &url, int status, header_list headers,
+             std::vector<uint8_t> body, const request_headers &req_headers);
+  // Refreshes an entry with the headers of a 304 response
+  std::shared_ptr<const entry>
+  revalidate(const std::shared_ptr<const entry> &stale,
+             const header_list &not_modified_headers);
+  // Drops the entry for url, e.g. after an unsafe request to it
+  void invalidate(const std::string &url);
+  void clear();
+
+  void record_hit(const entry &e, bool revalidated);
+  void record_miss();
+  stats get_stats();
+
+private:
+  using lru_list = std::list<std::shared_ptr<const entry>>;
+
+  void insert_memory(std::shared_ptr<const entry> e);
+  void erase_memory(const std::string &url);
+  std::filesystem::path disk_file(const std::string &url) const;
+  void write_disk(const entry &e);
+  std::shared_ptr<entry> read_disk(const std::string &url);
+
+  std::mutex mutex;
+  std::optional<options> opts;
+  lru_list lru;
+  std::unordered_map<std::string, lru_list::iterator> by_url;
+  size_t memory_bytes = 0;
+  stats counters;
+};
+
+} // namespace breeze::js
@@ -0,0 +1,297 @@
+#include "http_encoding.h"
+#include <algorithm>
+#include <stdexcept>
+
+#include <zlib.h>
+#ifdef BREEZE_ENABLE_BROTLI
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
+#ifdef BREEZE_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace breeze::js::http_encoding {
+
+// Output grows in steps of this size while decoding a stream
+static constexpr size_t chunk_size = 64 * 1024;
+
+static bool iequals(std::string_view a, std::string_view b) {
+  return std::ranges::equal(a, b, [](char x, char y) {
+    auto lower = [](char c) {
+      return c >= 'A' && c <= 'Z' ? char(c + ('a' - 'A')) : c;
+    };
+    return lower(x) == lower(y);
+  });
+}
+
+static std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+    s.remove_prefix(1);
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+    s.remove_suffix(1);
+  return s;
+}
+
+// Whether decoded output has outgrown max_size, 0 for no limit
+static bool exceeds(const std::vector<uint8_t> &out, size_t max_size) {
+  return max_size != 0 && out.size() > max_size;
+}
+
+[[noreturn]] static void throw_too_large(size_t max_size) {
+  throw too_large("decoded body exceeds " + std::to_string(max_size) +
+                  " bytes");
+}
+
+// Splits a Content-Encoding value into its codings, in application order
+static std::vector<std::string_view> split_codings(std::string_view value) {
+  std::vector<std::string_view> codings;
+  while (!value.empty()) {
+    auto comma = value.find(',');
+    auto coding = trim(value.substr(0, comma));
+    if (!coding.empty())
+      codings.push_back(coding);
+    if (comma == std::string_view::npos)
+      break;
+    value.remove_prefix(comma + 1);
+  }
+  return codings;
+}
+
+// gzip and zlib streams; raw selects headerless deflate data, which some
+// servers send for "deflate"
+static std::vector<uint8_t> inflate_zlib(std::span<const uint8_t> in,
+                                         bool raw, size_t max_size) {
+  z_stream zs{};
+  // 15 + 32 detects a gzip or zlib header, -15 expects none
+  if (inflateInit2(&zs, raw ? -15 : 15 + 32) != Z_OK)
+    throw std::runtime_error("failed to initialize zlib");
+
+  std::vector<uint8_t> out;
+  zs.next_in = const_cast<Bytef *>(in.data());
+  zs.avail_in = static_cast<uInt>(in.size());
+  int ret = Z_OK;
+  while (true) {
+    out.resize(out.size() + chunk_size);
+    zs.next_out = out.data() + out.size() - chunk_size;
+    zs.avail_out = chunk_size;
+    ret = inflate(&zs, Z_NO_FLUSH);
+    out.resize(out.size() - zs.avail_out);
+    if (exceeds(out, max_size))
+      break;
+    if (ret == Z_STREAM_END) {
+      // Concatenated gzip members decode to the concatenated data
+      if (zs.avail_in == 0 || raw)
+        break;
+      if (inflateReset(&zs) != Z_OK)
+        break;
+      continue;
+    }
+    if (ret != Z_OK || (zs.avail_in == 0 && zs.avail_out != 0))
+      break;
+  }
+  inflateEnd(&zs);
+  if (exceeds(out, max_size))
+    throw_too_large(max_size);
+  if (ret != Z_STREAM_END)
+    throw std::runtime_error("corrupt gzip/deflate data");
+  return out;
+}
+
+static std::string deflate_zlib(std::string_view in, bool gzip) {
+  z_stream zs{};
+  // 15 + 16 writes a gzip header and trailer instead of the zlib ones
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                   gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    throw std::runtime_error("failed to initialize zlib");
+
+  std::string out(deflateBound(&zs, static_cast<uLong>(in.size())), '\0');
+  zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+  zs.avail_in = static_cast<uInt>(in.size());
+  zs.next_out = reinterpret_cast<Bytef *>(out.data());
+  zs.avail_out = static_cast<uInt>(out.size());
+  int ret = deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  if (ret != Z_STREAM_END)
+    throw std::runtime_error("failed to compress body");
+  return out;
+}
+
+#ifdef BREEZE_ENABLE_BROTLI
+static std::vector<uint8_t> decode_brotli(std::span<const uint8_t> in,
+                                          size_t max_size) {
+  auto *state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+  if (!state)
+    throw std::runtime_error("failed to initialize brotli");
+
+  std::vector<uint8_t> out;
+  size_t avail_in = in.size();
+  const uint8_t *next_in = in.data();
+  auto result = BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+  while (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT &&
+         !exceeds(out, max_size)) {
+    out.resize(out.size() + chunk_size);
+    size_t avail_out = chunk_size;
+    uint8_t *next_out = out.data() + out.size() - chunk_size;
+    result = BrotliDecoderDecompressStream(state, &avail_in, &next_in,
+                                           &avail_out, &next_out, nullptr);
+    out.resize(out.size() - avail_out);
+  }
+  BrotliDecoderDestroyInstance(state);
+  if (exceeds(out, max_size))
+    throw_too_large(max_size);
+  if (result != BROTLI_DECODER_RESULT_SUCCESS)
+    throw std::runtime_error("corrupt brotli data");
+  return out;
+}
+
+static std::string encode_brotli(std::string_view in) {
+  std::string out(BrotliEncoderMaxCompressedSize(in.size()), '\0');
+  size_t size = out.size();
+  // Quality 5 is close to gzip's speed at a better ratio
+  if (!BrotliEncoderCompress(
+          5, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC, in.size(),
+          reinterpret_cast<const uint8_t *>(in.data()), &size,
+          reinterpret_cast<uint8_t *>(out.data())))
+    throw std::runtime_error("failed to compress body");
+  out.resize(size);
+  return out;
+}
+#endif
+
+#ifdef BREEZE_ENABLE_ZSTD
+static std::vector<uint8_t> decode_zstd(std::span<const uint8_t> in,
+                                        size_t max_size) {
+  auto *dctx = ZSTD_createDCtx();
+  if (!dctx)
+    throw std::runtime_error("failed to initialize zstd");
+
+  std::vector<uint8_t> out;
+  ZSTD_inBuffer input{in.data(), in.size(), 0};
+  size_t ret = 0;
+  bool truncated = false;
+  do {
+    out.resize(out.size() + chunk_size);
+    ZSTD_outBuffer output{out.data() + out.size() - chunk_size, chunk_size, 0};
+    ret = ZSTD_decompressStream(dctx, &output, &input);
+    out.resize(out.size() - chunk_size + output.pos);
+    if (ZSTD_isError(ret) || exceeds(out, max_size))
+      break;
+    // ret is 0 once a frame is complete and flushed; input ran out midway
+    // through a frame if the output was not filled
+    truncated =
+        ret != 0 && input.pos == input.size && output.pos < output.size;
+  } while (!truncated && (ret != 0 || input.pos < input.size));
+  ZSTD_freeDCtx(dctx);
+  if (exceeds(out, max_size))
+    throw_too_large(max_size);
+  if (ZSTD_isError(ret) || truncated)
+    throw std::runtime_error("corrupt zstd data");
+  return out;
+}
+
+static std::string encode_zstd(std::string_view in) {
+  std::string out(ZSTD_compressBound(in.size()), '\0');
+  size_t size = ZSTD_compress(out.data(), out.size(), in.data(), in.size(),
+                              ZSTD_CLEVEL_DEFAULT);
+  if (ZSTD_isError(size))
+    throw std::runtime_error("failed to compress body");
+  out.resize(size);
+  return out;
+}
+#endif
+
+std::string_view accept_encoding() {
+  return "gzip, deflate"
+#ifdef BREEZE_ENABLE_BROTLI
+         ", br"
+#endif
+#ifdef BREEZE_ENABLE_ZSTD
+         ", zstd"
+#endif
+      ;
+}
+
+bool supported(std::string_view coding) {
+  if (iequals(coding, "identity") || iequals(coding, "gzip") ||
+      iequals(coding, "x-gzip") || iequals(coding, "deflate"))
+    return true;
+#ifdef BREEZE_ENABLE_BROTLI
+  if (iequals(coding, "br"))
+    return true;
+#endif
+#ifdef BREEZE_ENABLE_ZSTD
+  if (iequals(coding, "zstd"))
+    return true;
+#endif
+  return false;
+}
+
+bool decodable(std::string_view content_encoding) {
+  return std::ranges::all_of(split_codings(content_encoding), supported);
+}
+
+static std::vector<uint8_t> decode_one(std::string_view coding,
+                                       std::span<const uint8_t> in,
+                                       size_t max_size) {
+  if (iequals(coding, "gzip") || iequals(coding, "x-gzip"))
+    return inflate_zlib(in, false, max_size);
+  if (iequals(coding, "deflate")) {
+    try {
+      return inflate_zlib(in, false, max_size);
+    } catch (const too_large &) {
+      throw;
+    } catch (const std::runtime_error &) {
+      return inflate_zlib(in, true, max_size);
+    }
+  }
+#ifdef BREEZE_ENABLE_BROTLI
+  if (iequals(coding, "br"))
+    return decode_brotli(in, max_size);
+#endif
+#ifdef BREEZE_ENABLE_ZSTD
+  if (iequals(coding, "zstd"))
+    return decode_zstd(in, max_size);
+#endif
+  throw std::runtime_error("unsupported content encoding: " +
+                           std::string(coding));
+}
+
+std::vector<uint8_t> decode(std::string_view content_encoding,
+                            std::span<const uint8_t> body, size_t max_size) {
+  auto codings = split_codings(content_encoding);
+  std::vector<uint8_t> out;
+  std::span<const uint8_t> in = body;
+  // The last coding listed was applied last
+  for (auto it = codings.rbegin(); it != codings.rend(); ++it) {
+    if (iequals(*it, "identity"))
+      continue;
+    out = decode_one(*it, in, max_size);
+    in = out;
+  }
+  if (in.data() == body.data())
+    out.assign(body.begin(), body.end());
+  return out;
+}
+
+std::string encode(std::string_view coding, std::string_view body) {
+  if (iequals(coding, "identity"))
+    return std::string(body);
+  if (iequals(coding, "gzip"))
+    return deflate_zlib(body, true);
+  if (iequals(coding, "deflate"))
+    return deflate_zlib(body, false);
+#ifdef BREEZE_ENABLE_BROTLI
+  if (iequals(coding, "br"))
+    return encode_brotli(body);
+#endif
+#ifdef BREEZE_ENABLE_ZSTD
+  if (iequals(coding, "zstd"))
+    return encode_zstd(body);
+#endif
+  throw std::runtime_error("unsupported content encoding: " +
+                           std::string(coding));
+}
+
+} // namespace breeze::js::http_encoding
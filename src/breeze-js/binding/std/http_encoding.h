@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// HTTP content codings (RFC 9110 section 8.4) for fetch bodies. gzip and
+// deflate are always available, br and zstd when built with
+// BREEZE_ENABLE_BROTLI and BREEZE_ENABLE_ZSTD.
+namespace breeze::js::http_encoding {
+
+// Accept-Encoding value listing every coding this build can decode
+std::string_view accept_encoding();
+
+// Whether coding can be decoded and encoded, identity included
+bool supported(std::string_view coding);
+
+// Whether every coding of a Content-Encoding value is supported
+bool decodable(std::string_view content_encoding);
+
+// Thrown by decode when a body decodes to more than its max_size
+struct too_large : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// Undoes a Content-Encoding value, whose codings were applied in order.
+// Throws std::runtime_error for unsupported codings or corrupt data, and
+// too_large once a coding's output passes max_size, 0 for no limit.
+std::vector<uint8_t> decode(std::string_view content_encoding,
+                            std::span<const uint8_t> body,
+                            size_t max_size = 0);
+
+// Compresses body with a single coding, e.g. for a request body
+std::string encode(std::string_view coding, std::string_view body);
+
+} // namespace breeze::js::http_encoding
@@ -0,0 +1,161 @@
+#include "http_limiter.h"
+#include "async_simple/coro/FutureAwaiter.h"
+#include "http_transport.h"
+#include <utility>
+
+namespace breeze::js {
+
+http_limiter::permit::permit(http_limiter *limiter, std::string origin)
+    : limiter_(limiter), origin_(std::move(origin)) {}
+
+http_limiter::permit::permit(permit &&other) noexcept
+    : limiter_(std::exchange(other.limiter_, nullptr)),
+      origin_(std::move(other.origin_)) {}
+
+http_limiter::permit &http_limiter::permit::operator=(permit &&other) noexcept {
+  if (this != &other) {
+    if (limiter_)
+      limiter_->release(origin_);
+    limiter_ = std::exchange(other.limiter_, nullptr);
+    origin_ = std::move(other.origin_);
+  }
+  return *this;
+}
+
+http_limiter::permit::~permit() {
+  if (limiter_)
+    limiter_->release(origin_);
+}
+
+http_limiter &http_limiter::instance() {
+  static http_limiter limiter;
+  return limiter;
+}
+
+void http_limiter::configure(limits l) {
+  std::vector<async_simple::Promise<bool>> admitted;
+  {
+    std::lock_guard lock(mutex);
+    lim = l;
+    // Raised limits may admit queued requests right away
+    admitted = dispatch();
+  }
+  for (auto &p : admitted)
+    p.setValue(true);
+}
+
+http_limiter::limits http_limiter::get_limits() {
+  std::lock_guard lock(mutex);
+  return lim;
+}
+
+bool http_limiter::can_start(const std::string &origin) const {
+  if (lim.max_concurrent && in_flight >= lim.max_concurrent)
+    return false;
+  if (lim.max_per_origin) {
+    auto it = active_per_origin.find(origin);
+    if (it != active_per_origin.end() && it->second >= lim.max_per_origin)
+      return false;
+  }
+  return true;
+}
+
+void http_limiter::start(const std::string &origin) {
+  in_flight++;
+  active_per_origin[origin]++;
+}
+
+async_simple::coro::Lazy<http_limiter::permit>
+http_limiter::acquire(std::string_view url) {
+  std::string origin(http_transport::origin(url));
+  std::optional<async_simple::Future<bool>> ready;
+  {
+    std::lock_guard lock(mutex);
+    // Waiters for the same origin go first to keep the queue FIFO
+    if (!queued_per_origin.contains(origin) && can_start(origin)) {
+      start(origin);
+    } else {
+      auto &w = waiters.emplace_back(waiter{origin, {}});
+      ready.emplace(w.ready.getFuture());
+      queued_per_origin[origin]++;
+      counters.waited++;
+    }
+  }
+  if (ready)
+    co_await std::move(*ready);
+  co_return permit(this, std::move(origin));
+}
+
+void http_limiter::release(const std::string &origin) {
+  std::vector<async_simple::Promise<bool>> admitted;
+  {
+    std::lock_guard lock(mutex);
+    in_flight--;
+    if (auto it = active_per_origin.find(origin); --it->second == 0)
+      active_per_origin.erase(it);
+    admitted = dispatch();
+  }
+  for (auto &p : admitted)
+    p.setValue(true);
+}
+
+std::vector<async_simple::Promise<bool>> http_limiter::dispatch() {
+  std::vector<async_simple::Promise<bool>> admitted;
+  for (auto it = waiters.begin(); it != waiters.end();) {
+    if (lim.max_concurrent && in_flight >= lim.max_concurrent)
+      break;
+    if (!can_start(it->origin)) {
+      ++it;
+      continue;
+    }
+    start(it->origin);
+    if (auto q = queued_per_origin.find(it->origin); --q->second == 0)
+      queued_per_origin.erase(q);
+    admitted.push_back(std::move(it->ready));
+    it = waiters.erase(it);
+  }
+  return admitted;
+}
+
+std::optional<async_simple::Future<http_limiter::response_ptr>>
+http_limiter::join(const std::string &key) {
+  std::lock_guard lock(mutex);
+  auto [it, leader] = flights.try_emplace(key);
+  if (leader)
+    return std::nullopt;
+  counters.coalesced++;
+  return it->second.emplace_back().getFuture();
+}
+
+void http_limiter::finish(const std::string &key,
+                          async_simple::Try<response_ptr> result) {
+  std::vector<async_simple::Promise<response_ptr>> joined;
+  {
+    std::lock_guard lock(mutex);
+    if (auto it = flights.find(key); it != flights.end()) {
+      joined = std::move(it->second);
+      flights.erase(it);
+    }
+  }
+  for (auto &p : joined) {
+    if (result.hasError()) {
+      p.setException(result.getException());
+      continue;
+    }
+    // Responses are mutable from JS, so every awaiter gets its own
+    auto copy = std::make_shared<http::Response>(*result.value());
+    if (copy->$headers)
+      copy->$headers = std::make_shared<http::Headers>(*copy->$headers);
+    p.setValue(std::move(copy));
+  }
+}
+
+http_limiter::stats http_limiter::get_stats() {
+  std::lock_guard lock(mutex);
+  stats s = counters;
+  s.queued = waiters.size();
+  s.in_flight = in_flight;
+  return s;
+}
+
+} // namespace breeze::js
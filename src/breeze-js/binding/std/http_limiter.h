@@ -0,0 +1,106 @@
+#pragma once
+#include "async_simple/Future.h"
+#include "async_simple/Promise.h"
+#include "async_simple/coro/Lazy.h"
+#include "http.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace breeze::js {
+
+// Admission control for fetch. Requests beyond the global or per-origin
+// limit wait in one FIFO queue; a waiter whose origin is saturated does not
+// hold back those behind it for other origins. Optionally, identical GETs
+// issued while one is in flight share its response instead of going to the
+// network again.
+class http_limiter {
+public:
+  using response_ptr = std::shared_ptr<http::Response>;
+
+  struct limits {
+    // 0 for no limit
+    size_t max_concurrent = 64;
+    size_t max_per_origin = 6;
+    bool coalesce_gets = false;
+    // Applied by fetch when it decodes a body, 0 for no limit
+    size_t max_decoded_size = 256 * 1024 * 1024;
+  };
+
+  struct stats {
+    // Requests waiting for a slot right now
+    uint64_t queued = 0;
+    uint64_t in_flight = 0;
+    // Requests that had to wait for a slot, in total
+    uint64_t waited = 0;
+    // GETs served by another in-flight request, in total
+    uint64_t coalesced = 0;
+  };
+
+  // A network slot held for the duration of one request
+  class permit {
+  public:
+    permit() = default;
+    permit(permit &&other) noexcept;
+    permit &operator=(permit &&other) noexcept;
+    ~permit();
+
+  private:
+    friend class http_limiter;
+    permit(http_limiter *limiter, std::string origin);
+    http_limiter *limiter_ = nullptr;
+    std::string origin_;
+  };
+
+  static http_limiter &instance();
+
+  void configure(limits l);
+  limits get_limits();
+
+  // Waits until url's origin may open another request
+  async_simple::coro::Lazy<permit> acquire(std::string_view url);
+
+  // Returns a future for the response when an identical request is in
+  // flight under key. Otherwise the caller becomes the one performing it
+  // and must call finish with the outcome.
+  std::optional<async_simple::Future<response_ptr>>
+  join(const std::string &key);
+  // Hands the outcome of the request under key to everyone who joined it,
+  // each getting their own copy of the response
+  void finish(const std::string &key, async_simple::Try<response_ptr> result);
+
+  stats get_stats();
+
+private:
+  struct waiter {
+    std::string origin;
+    async_simple::Promise<bool> ready;
+  };
+
+  bool can_start(const std::string &origin) const;
+  void start(const std::string &origin);
+  void release(const std::string &origin);
+  // Admits queued waiters in order while limits allow, returning the
+  // promises to fulfill once the lock is dropped
+  std::vector<async_simple::Promise<bool>> dispatch();
+
+  std::mutex mutex;
+  limits lim;
+  size_t in_flight = 0;
+  std::unordered_map<std::string, size_t> active_per_origin;
+  std::unordered_map<std::string, size_t> queued_per_origin;
+  std::list<waiter> waiters;
+  // Requests that joined an in-flight GET, by coalescing key
+  std::unordered_map<std::string,
+                     std::vector<async_simple::Promise<response_ptr>>>
+      flights;
+  stats counters;
+};
+
+} // namespace breeze::js
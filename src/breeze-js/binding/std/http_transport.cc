@@ -0,0 +1,119 @@
+#include "http_transport.h"
+#include <algorithm>
+#include <utility>
+
+namespace breeze::js {
+
+http_transport::lease::lease(lease &&other) noexcept
+    : transport_(std::exchange(other.transport_, nullptr)),
+      key_(std::move(other.key_)), client_(std::move(other.client_)),
+      reused_(other.reused_), keep_alive_(other.keep_alive_) {}
+
+http_transport::lease &
+http_transport::lease::operator=(lease &&other) noexcept {
+  if (this != &other) {
+    if (transport_ && client_ && keep_alive_)
+      transport_->release(std::move(key_), std::move(client_));
+    transport_ = std::exchange(other.transport_, nullptr);
+    key_ = std::move(other.key_);
+    client_ = std::move(other.client_);
+    reused_ = other.reused_;
+    keep_alive_ = other.keep_alive_;
+  }
+  return *this;
+}
+
+http_transport::lease::~lease() {
+  if (transport_ && client_ && keep_alive_)
+    transport_->release(std::move(key_), std::move(client_));
+}
+
+http_transport &http_transport::instance() {
+  static http_transport transport;
+  return transport;
+}
+
+std::string_view http_transport::origin(std::string_view url) {
+  auto scheme_end = url.find("://");
+  if (scheme_end == std::string_view::npos)
+    return url;
+  auto end = url.find_first_of("/?#", scheme_end + 3);
+  return url.substr(0, end);
+}
+
+http_transport::lease http_transport::acquire(std::string_view url,
+                                              const request_headers &headers,
+                                              bool fresh) {
+  lease l;
+  l.transport_ = this;
+  // fetch sets no proxy, so the origin is all a connection is bound to
+  l.key_ = http_transport::origin(url);
+
+  if (!fresh) {
+    std::lock_guard lock(mutex);
+    if (auto it = idle.find(l.key_); it != idle.end()) {
+      auto &clients = it->second;
+      auto now = std::chrono::steady_clock::now();
+      // Most recently returned connections are at the back
+      while (!clients.empty()) {
+        auto c = std::move(clients.back());
+        clients.pop_back();
+        if (now - c.since < idle_timeout) {
+          l.client_ = std::move(c.client);
+          l.reused_ = true;
+          break;
+        }
+      }
+      if (clients.empty())
+        idle.erase(it);
+    }
+  }
+
+  if (!l.client_)
+    l.client_ = std::make_unique<cinatra::coro_http_client>();
+  // Clients keep added headers across requests, drop the last request's
+  l.client_->set_headers({});
+  for (const auto &[k, v] : headers)
+    l.client_->add_header(k, v);
+  return l;
+}
+
+bool http_transport::keep_alive_allowed(const cinatra::resp_data &resp) {
+  if (resp.net_err)
+    return false;
+  return std::ranges::none_of(resp.resp_headers, [](const auto &h) {
+    auto lower_eq = [](std::string_view a, std::string_view b) {
+      return std::ranges::equal(a, b, [](char x, char y) {
+        return (x >= 'A' && x <= 'Z' ? x + ('a' - 'A') : x) == y;
+      });
+    };
+    return lower_eq(h.name, "connection") && lower_eq(h.value, "close");
+  });
+}
+
+void http_transport::release(
+    std::string key, std::unique_ptr<cinatra::coro_http_client> client) {
+  // Connections are closed after the lock is released
+  std::vector<std::unique_ptr<cinatra::coro_http_client>> closing;
+  std::lock_guard lock(mutex);
+  auto now = std::chrono::steady_clock::now();
+  for (auto it = idle.begin(); it != idle.end();) {
+    std::erase_if(it->second, [&](idle_client &c) {
+      if (now - c.since < idle_timeout)
+        return false;
+      closing.push_back(std::move(c.client));
+      return true;
+    });
+    it = it->second.empty() ? idle.erase(it) : std::next(it);
+  }
+
+  auto &clients = idle[std::move(key)];
+  if (clients.size() >= max_idle_per_origin) {
+    // The oldest connection is the likeliest to be dropped by the server
+    closing.push_back(std::move(clients.front().client));
+    clients.erase(clients.begin());
+  }
+  clients.push_back({std::move(client), now});
+}
+
+} // namespace breeze::js
@@ -0,0 +1,78 @@
+#pragma once
+#include "cinatra/coro_http_client.hpp"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace breeze::js {
+
+// Keep-alive connections shared by fetch calls. Idle clients are kept per
+// origin so sequential and fan-out requests to one host skip the TCP and
+// TLS handshakes. A connection is only opened when no idle one is left, so
+// the sockets open to an origin follow its concurrent requests: the pool
+// itself does not cap them, http_limiter's max_per_origin does.
+class http_transport {
+public:
+  using request_headers = std::unordered_map<std::string, std::string>;
+
+  // Most idle connections kept for one origin
+  static constexpr size_t max_idle_per_origin = 8;
+  // Servers commonly drop idle connections after 5 to 60 seconds
+  static constexpr std::chrono::seconds idle_timeout{15};
+
+  // A client checked out for one request. It goes back to the idle pool when
+  // the lease ends, if the response allowed keeping the connection.
+  class lease {
+  public:
+    lease() = default;
+    lease(lease &&other) noexcept;
+    lease &operator=(lease &&other) noexcept;
+    ~lease();
+
+    cinatra::coro_http_client &client() { return *client_; }
+    // True when the connection was used before and may have been closed by
+    // the server in the meantime
+    bool reused() const { return reused_; }
+    // Marks the connection as reusable, see keep_alive_allowed
+    void keep_alive() { keep_alive_ = true; }
+
+  private:
+    friend class http_transport;
+    http_transport *transport_ = nullptr;
+    std::string key_;
+    std::unique_ptr<cinatra::coro_http_client> client_;
+    bool reused_ = false;
+    bool keep_alive_ = false;
+  };
+
+  static http_transport &instance();
+
+  // scheme://host[:port], the part of a URL a connection is bound to
+  static std::string_view origin(std::string_view url);
+
+  // Checks out a client for url with headers as its only request headers.
+  // Unless fresh is set, an idle connection to the same origin is reused.
+  lease acquire(std::string_view url, const request_headers &headers,
+                bool fresh = false);
+
+  // Whether the response lets the connection be used for another request
+  static bool keep_alive_allowed(const cinatra::resp_data &resp);
+
+private:
+  struct idle_client {
+    std::unique_ptr<cinatra::coro_http_client> client;
+    std::chrono::steady_clock::time_point since;
+  };
+
+  void release(std::string key,
+               std::unique_ptr<cinatra::coro_http_client> client);
+
+  std::mutex mutex;
+  std::unordered_map<std::string, std::vector<idle_client>> idle;
+};
+
+} // namespace breeze::js
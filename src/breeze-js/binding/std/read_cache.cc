@@ -0,0 +1,141 @@
+#include "read_cache.h"
+#include <chrono>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <sys/stat.h>
+#include <sys/types.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace breeze::js {
+
+// A file modified this recently may be modified again within the same
+// timestamp tick (a few ms on Linux, 2 s on FAT) without its mtime moving,
+// so its content is not stored until it has settled
+static constexpr int64_t settle_ns = 2'000'000'000;
+
+size_t read_cache::entry::footprint() const {
+  return sizeof(entry) + path.size() + content.size();
+}
+
+read_cache &read_cache::instance() {
+  static read_cache cache;
+  return cache;
+}
+
+std::optional<read_cache::identity>
+read_cache::stat(const std::string &path) {
+#ifdef _WIN32
+  std::filesystem::path wpath(std::u8string(path.begin(), path.end()));
+  struct _stat64 st;
+  if (_wstat64(wpath.c_str(), &st) != 0)
+    return std::nullopt;
+  // No inode numbers, and mtime in seconds
+  return identity{uint64_t(st.st_dev), 0, uint64_t(st.st_size),
+                  int64_t(st.st_mtime) * 1'000'000'000};
+#else
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0)
+    return std::nullopt;
+#ifdef __APPLE__
+  auto &mtime = st.st_mtimespec;
+#else
+  auto &mtime = st.st_mtim;
+#endif
+  return identity{uint64_t(st.st_dev), uint64_t(st.st_ino),
+                  uint64_t(st.st_size),
+                  int64_t(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec};
+#endif
+}
+
+void read_cache::configure(std::optional<options> new_opts) {
+  std::lock_guard lock(mutex);
+  opts = std::move(new_opts);
+  on = opts.has_value();
+  if (!opts) {
+    lru.clear();
+    by_path.clear();
+    memory_bytes = 0;
+    return;
+  }
+  while (memory_bytes > opts->memory_limit && !lru.empty())
+    erase(std::prev(lru.end()));
+}
+
+std::shared_ptr<const read_cache::entry>
+read_cache::lookup(const std::string &path, const identity &id) {
+  std::lock_guard lock(mutex);
+  auto it = by_path.find(path);
+  if (it == by_path.end()) {
+    counters.misses++;
+    return nullptr;
+  }
+  if ((*it->second)->id != id) {
+    erase(it->second);
+    counters.stale++;
+    counters.misses++;
+    return nullptr;
+  }
+  lru.splice(lru.begin(), lru, it->second);
+  counters.hits++;
+  counters.bytes_saved += id.size;
+  return lru.front();
+}
+
+void read_cache::store(const std::string &path, const identity &id,
+                       std::string_view content) {
+  // Written to since the stat, the next lookup would find it stale anyway
+  if (content.size() != id.size)
+    return;
+  auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+  if (id.mtime_ns > now - settle_ns)
+    return;
+  {
+    std::lock_guard lock(mutex);
+    if (!opts || id.size > opts->max_file_size)
+      return;
+  }
+  // Copied outside the lock
+  auto e = std::make_shared<entry>(path, id, std::string(content));
+  size_t size = e->footprint();
+
+  std::lock_guard lock(mutex);
+  if (!opts || size > opts->memory_limit)
+    return;
+  if (auto it = by_path.find(path); it != by_path.end())
+    erase(it->second);
+  lru.push_front(std::move(e));
+  by_path.emplace(path, lru.begin());
+  memory_bytes += size;
+  while (memory_bytes > opts->memory_limit) {
+    erase(std::prev(lru.end()));
+    counters.evictions++;
+  }
+}
+
+void read_cache::clear() {
+  std::lock_guard lock(mutex);
+  lru.clear();
+  by_path.clear();
+  memory_bytes = 0;
+}
+
+read_cache::stats read_cache::get_stats() {
+  std::lock_guard lock(mutex);
+  stats s = counters;
+  s.memory_bytes = memory_bytes;
+  s.entries = lru.size();
+  return s;
+}
+
+void read_cache::erase(lru_list::iterator it) {
+  memory_bytes -= (*it)->footprint();
+  by_path.erase((*it)->path);
+  lru.erase(it);
+}
+
+} // namespace breeze::js
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace breeze::js {
+
+// Opt-in cache of whole-file reads behind filesystem::readFile and
+// readFileAsString: an LRU bounded in bytes, keyed by path. Before an entry
+// is served the file is stat'ed again and must still have the device, inode,
+// size and mtime it was read with, so a rewritten, replaced or renamed-over
+// file is read anew. Stored contents are never modified and are shared by
+// all readers on all threads.
+class read_cache {
+public:
+  struct identity {
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+
+    bool operator==(const identity &) const = default;
+  };
+
+  struct entry {
+    std::string path;
+    identity id;
+    std::string content;
+
+    size_t footprint() const;
+  };
+
+  struct options {
+    size_t memory_limit = 64 * 1024 * 1024;
+    // Larger files are read without being stored
+    size_t max_file_size = 4 * 1024 * 1024;
+  };
+
+  struct stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Entries dropped because their file changed
+    uint64_t stale = 0;
+    uint64_t evictions = 0;
+    uint64_t bytes_saved = 0;
+    uint64_t memory_bytes = 0;
+    uint64_t entries = 0;
+  };
+
+  static read_cache &instance();
+
+  // The identity of the file path names now, following symlinks
+  static std::optional<identity> stat(const std::string &path);
+
+  void configure(std::optional<options> opts);
+  // Without locking, for the read paths to skip the cache when it is off
+  bool enabled() const { return on.load(std::memory_order_relaxed); }
+
+  // Returns the entry for path if it was read from the file that is there
+  // now. Counts a hit or a miss.
+  std::shared_ptr<const entry> lookup(const std::string &path,
+                                      const identity &id);
+  // Stores a copy of content, read from path after id was taken
+  void store(const std::string &path, const identity &id,
+             std::string_view content);
+  void clear();
+  stats get_stats();
+
+private:
+  using lru_list = std::list<std::shared_ptr<const entry>>;
+
+  void erase(lru_list::iterator it);
+
+  std::mutex mutex;
+  std::optional<options> opts;
+  std::atomic<bool> on = false;
+  lru_list lru;
+  std::unordered_map<std::string, lru_list::iterator> by_path;
+  size_t memory_bytes = 0;
+  stats counters;
+};
+
+} // namespace breeze::js
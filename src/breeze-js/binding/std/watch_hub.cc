@@ -0,0 +1,421 @@
+#include "watch_hub.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include "../../FileWatch.hpp"
+#endif
+
+namespace breeze::js {
+
+using clock_type = std::chrono::steady_clock;
+
+struct watch_hub::watcher {
+  // The watched directory, the parent of a watched file
+  std::string root;
+  // The name of a watched file
+  std::optional<std::string> only;
+  options opts;
+  listener fn;
+  // Changes in arrival order, an empty type for one that cancelled out
+  std::vector<std::pair<std::string, std::optional<change>>> pending;
+  std::unordered_map<std::string, size_t> index;
+  std::optional<clock_type::time_point> deadline;
+#ifdef __linux__
+  std::vector<int> wds;
+#else
+  std::unique_ptr<filewatch::FileWatch<std::string>> file_watch;
+#endif
+};
+
+watch_hub &watch_hub::instance() {
+  // Never destroyed: the hub thread runs until the process exits
+  static auto *hub = new watch_hub;
+  return *hub;
+}
+
+const char *watch_hub::name(change type) {
+  switch (type) {
+  case change::added:
+    return "added";
+  case change::removed:
+    return "removed";
+  default:
+    return "modified";
+  }
+}
+
+void watch_hub::record(watcher &w, std::string path, change type) {
+  if (!path.empty()) {
+    if (w.only && path != *w.only)
+      return;
+    if (!w.opts.recursive && path.find('/') != std::string::npos)
+      return;
+  }
+  auto [it, fresh] = w.index.try_emplace(path, w.pending.size());
+  if (fresh) {
+    w.pending.emplace_back(std::move(path), type);
+  } else {
+    // What the file went through since the last batch, as one change
+    auto &merged = w.pending[it->second].second;
+    if (!merged)
+      merged = type;
+    else if (*merged == change::added && type == change::removed)
+      merged.reset();
+    else if (*merged == change::removed && type == change::added)
+      merged = change::modified;
+    else if (*merged != change::added)
+      merged = type;
+  }
+  if (!w.deadline)
+    w.deadline = clock_type::now() + w.opts.debounce;
+}
+
+void watch_hub::remove(uint64_t id) {
+  std::unique_ptr<watcher> removed;
+  {
+    std::unique_lock lock(mutex);
+    // A listener may end its own watch
+    if (std::this_thread::get_id() != hub_thread)
+      call_done.wait(lock, [&] { return calling != id; });
+    removed = remove_locked(id);
+  }
+}
+
+void watch_hub::run() {
+  std::unique_lock lock(mutex);
+  while (true) {
+    auto next = clock_type::time_point::max();
+    for (auto &[id, w] : watchers) {
+      if (w->deadline)
+        next = std::min(next, *w->deadline);
+    }
+#ifdef __linux__
+    int timeout = -1;
+    if (next != clock_type::time_point::max()) {
+      auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+          next - clock_type::now());
+      timeout = int(std::max<int64_t>(wait.count(), 0));
+    }
+    lock.unlock();
+    pollfd fd{inotify_fd, POLLIN, 0};
+    int ready = ::poll(&fd, 1, timeout);
+    lock.lock();
+    if (ready > 0)
+      read_events();
+#else
+    if (next == clock_type::time_point::max())
+      cv.wait(lock);
+    else
+      cv.wait_until(lock, next);
+#endif
+
+    auto now = clock_type::now();
+    std::vector<std::pair<uint64_t, std::vector<event>>> due;
+    for (auto &[id, w] : watchers) {
+      if (!w->deadline || *w->deadline > now)
+        continue;
+      std::vector<event> events;
+      for (auto &[path, type] : w->pending) {
+        if (type)
+          events.push_back({std::move(path), *type});
+      }
+      w->pending.clear();
+      w->index.clear();
+      w->deadline.reset();
+      if (!events.empty())
+        due.emplace_back(id, std::move(events));
+    }
+    for (auto &[id, events] : due) {
+      auto it = watchers.find(id);
+      if (it == watchers.end())
+        continue;
+      auto &fn = it->second->fn;
+      calling = id;
+      lock.unlock();
+      bool keep = true;
+      try {
+        keep = fn(std::move(events));
+      } catch (std::exception &e) {
+        std::cerr << "Error in watch listener: " << e.what() << std::endl;
+      }
+      lock.lock();
+      calling = 0;
+      call_done.notify_all();
+      if (!keep) {
+        auto removed = remove_locked(id);
+        lock.unlock();
+        removed.reset();
+        lock.lock();
+      }
+    }
+  }
+}
+
+#ifdef __linux__
+
+static constexpr uint32_t watch_mask =
+    IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM |
+    IN_MOVED_TO | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+void watch_hub::start() {
+  if (started)
+    return;
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0)
+    throw std::runtime_error(std::string("Cannot start watching files: ") +
+                             std::strerror(errno));
+  started = true;
+  std::thread thread([this] { run(); });
+  hub_thread = thread.get_id();
+  thread.detach();
+}
+
+uint64_t watch_hub::add(const std::filesystem::path &path, options opts,
+                        listener fn) {
+  std::error_code ec;
+  auto target = std::filesystem::canonical(path, ec);
+  if (ec)
+    throw std::runtime_error("Cannot watch " + path.string() + ": " +
+                             ec.message());
+  auto w = std::make_unique<watcher>();
+  w->opts = opts;
+  w->fn = std::move(fn);
+  if (std::filesystem::is_directory(target, ec)) {
+    w->root = target.string();
+  } else {
+    w->root = target.parent_path().string();
+    w->only = target.filename().string();
+    w->opts.recursive = false;
+  }
+
+  std::lock_guard lock(mutex);
+  start();
+  uint64_t id = next_id++;
+  auto &ref = *w;
+  watchers.emplace(id, std::move(w));
+  watch_dir(id, ref, ref.root, "", false);
+  if (ref.wds.empty()) {
+    int error = errno;
+    watchers.erase(id);
+    throw std::runtime_error("Cannot watch " + path.string() + ": " +
+                             std::strerror(error));
+  }
+  return id;
+}
+
+void watch_hub::watch_dir(uint64_t id, watcher &w, const std::string &dir,
+                          const std::string &rel, bool report) {
+  int wd = inotify_add_watch(inotify_fd, dir.c_str(), watch_mask);
+  if (wd < 0)
+    return;
+  // The same directory for several watchers, or reached again after a move
+  auto &d = dirs[wd];
+  d.path = dir;
+  auto sub =
+      std::ranges::find(d.subs, id, &std::pair<uint64_t, std::string>::first);
+  if (sub != d.subs.end()) {
+    sub->second = rel;
+  } else {
+    d.subs.emplace_back(id, rel);
+    w.wds.push_back(wd);
+  }
+  if (!w.opts.recursive)
+    return;
+
+  std::error_code ec;
+  for (auto &entry : std::filesystem::directory_iterator(
+           dir, std::filesystem::directory_options::skip_permission_denied,
+           ec)) {
+    auto name = entry.path().filename().string();
+    if (report)
+      record(w, rel + name, change::added);
+    // Symlinked directories are reported, not entered
+    if (entry.is_directory(ec) && !entry.is_symlink(ec))
+      watch_dir(id, w, dir + "/" + name, rel + name + "/", report);
+  }
+}
+
+void watch_hub::drop_sub(int wd, uint64_t id) {
+  auto d = dirs.find(wd);
+  if (d == dirs.end())
+    return;
+  std::erase_if(d->second.subs, [&](auto &sub) { return sub.first == id; });
+  if (d->second.subs.empty()) {
+    inotify_rm_watch(inotify_fd, wd);
+    dirs.erase(d);
+  }
+}
+
+void watch_hub::unwatch_tree(uint64_t id, const std::string &dir) {
+  auto it = watchers.find(id);
+  if (it == watchers.end())
+    return;
+  auto &wds = it->second->wds;
+  std::erase_if(wds, [&](int wd) {
+    auto d = dirs.find(wd);
+    if (d == dirs.end())
+      return true;
+    auto &path = d->second.path;
+    if (path != dir && !(path.starts_with(dir) && path[dir.size()] == '/'))
+      return false;
+    drop_sub(wd, id);
+    return true;
+  });
+}
+
+void watch_hub::read_events() {
+  alignas(inotify_event) char buffer[64 * 1024];
+  while (true) {
+    ssize_t n = ::read(inotify_fd, buffer, sizeof(buffer));
+    if (n <= 0)
+      return;
+    for (char *p = buffer; p < buffer + n;) {
+      auto *e = reinterpret_cast<inotify_event *>(p);
+      p += sizeof(inotify_event) + e->len;
+
+      if (e->mask & IN_Q_OVERFLOW) {
+        for (auto &[id, w] : watchers)
+          record(*w, "", change::modified);
+        continue;
+      }
+      auto d = dirs.find(e->wd);
+      if (d == dirs.end())
+        continue;
+      if (e->mask & IN_IGNORED) {
+        // Deleted, or on a file system that went away
+        for (auto &[id, rel] : d->second.subs) {
+          if (auto w = watchers.find(id); w != watchers.end())
+            std::erase(w->second->wds, e->wd);
+        }
+        dirs.erase(d);
+        continue;
+      }
+      if (!e->len)
+        continue;
+
+      std::string name = e->name;
+      bool is_dir = e->mask & IN_ISDIR;
+      change type = e->mask & (IN_CREATE | IN_MOVED_TO)    ? change::added
+                    : e->mask & (IN_DELETE | IN_MOVED_FROM) ? change::removed
+                                                            : change::modified;
+      // watch_dir below may rehash dirs
+      auto dir = d->second.path + "/" + name;
+      auto subs = d->second.subs;
+      for (auto &[id, rel] : subs) {
+        auto w = watchers.find(id);
+        if (w == watchers.end())
+          continue;
+        record(*w->second, rel + name, type);
+        if (!is_dir || !w->second->opts.recursive)
+          continue;
+        if (e->mask & IN_MOVED_FROM)
+          unwatch_tree(id, dir);
+        else if (type == change::added)
+          watch_dir(id, *w->second, dir, rel + name + "/", true);
+      }
+    }
+  }
+}
+
+std::unique_ptr<watch_hub::watcher> watch_hub::remove_locked(uint64_t id) {
+  auto it = watchers.find(id);
+  if (it == watchers.end())
+    return nullptr;
+  auto w = std::move(it->second);
+  watchers.erase(it);
+  for (int wd : w->wds)
+    drop_sub(wd, id);
+  return w;
+}
+
+#else
+
+void watch_hub::start() {
+  if (started)
+    return;
+  started = true;
+  std::thread thread([this] { run(); });
+  hub_thread = thread.get_id();
+  thread.detach();
+}
+
+uint64_t watch_hub::add(const std::filesystem::path &path, options opts,
+                        listener fn) {
+  std::error_code ec;
+  auto target = std::filesystem::absolute(path, ec);
+  if (!std::filesystem::exists(target, ec))
+    throw std::runtime_error("Cannot watch " + path.string() +
+                             ": No such file or directory");
+  auto w = std::make_unique<watcher>();
+  w->opts = opts;
+  w->fn = std::move(fn);
+  if (std::filesystem::is_directory(target, ec)) {
+    w->root = target.generic_string();
+  } else {
+    w->root = target.parent_path().generic_string();
+    w->only = target.filename().string();
+    w->opts.recursive = false;
+  }
+
+  uint64_t id;
+  {
+    std::lock_guard lock(mutex);
+    start();
+    id = next_id++;
+  }
+  // FileWatch reports on its own threads, always recursively, with paths
+  // relative to the directory (Windows) or absolute (macOS)
+  auto on_change = [this, id](const std::string &file, filewatch::Event e) {
+    std::lock_guard lock(mutex);
+    auto it = watchers.find(id);
+    if (it == watchers.end())
+      return;
+    auto &w = *it->second;
+    std::string path = file;
+    std::ranges::replace(path, '\\', '/');
+    if (path.starts_with(w.root + "/"))
+      path.erase(0, w.root.size() + 1);
+    change type = e == filewatch::Event::added ||
+                          e == filewatch::Event::renamed_new
+                      ? change::added
+                  : e == filewatch::Event::removed ||
+                          e == filewatch::Event::renamed_old
+                      ? change::removed
+                      : change::modified;
+    record(w, std::move(path), type);
+    cv.notify_one();
+  };
+  try {
+    w->file_watch = std::make_unique<filewatch::FileWatch<std::string>>(
+        target.string(), on_change);
+  } catch (std::exception &e) {
+    throw std::runtime_error("Cannot watch " + path.string() + ": " +
+                             e.what());
+  }
+  std::lock_guard lock(mutex);
+  watchers.emplace(id, std::move(w));
+  return id;
+}
+
+std::unique_ptr<watch_hub::watcher> watch_hub::remove_locked(uint64_t id) {
+  auto it = watchers.find(id);
+  if (it == watchers.end())
+    return nullptr;
+  // Joining the FileWatch threads happens unlocked, they may be waiting for
+  // the lock in on_change
+  auto w = std::move(it->second);
+  watchers.erase(it);
+  return w;
+}
+
+#endif
+
+} // namespace breeze::js
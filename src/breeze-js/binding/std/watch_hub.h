@@ -0,0 +1,99 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace breeze::js {
+
+// File change notifications for any number of watchers, process-wide. On
+// Linux all watchers share one inotify descriptor read by one thread, and a
+// directory watched twice is one inotify watch; elsewhere each watcher runs
+// a filewatch::FileWatch. Changes are coalesced per file and handed to the
+// watcher's listener debounce after the first one, on the hub thread.
+class watch_hub {
+public:
+  enum class change { added, modified, removed };
+
+  struct event {
+    // Relative to the watched directory, '/' separated. A watched file
+    // reports its name. Empty, as modified, when changes were lost and
+    // anything may have changed.
+    std::string path;
+    change type;
+  };
+
+  struct options {
+    bool recursive = false;
+    std::chrono::milliseconds debounce{50};
+  };
+
+  // Returning false ends the watch
+  using listener = std::function<bool(std::vector<event>)>;
+
+  static watch_hub &instance();
+  static const char *name(change type);
+
+  // Watches a directory, or a single file through its directory. Throws
+  // std::runtime_error when path cannot be watched.
+  uint64_t add(const std::filesystem::path &path, options opts,
+               listener fn);
+  // No listener call for id starts after this returns
+  void remove(uint64_t id);
+
+private:
+  struct watcher;
+
+  watch_hub() = default;
+  void run();
+  // Merges a change into the watcher's pending batch. Called locked.
+  void record(watcher &w, std::string path, change type);
+  // Starts the hub thread on first use. Called locked.
+  void start();
+  // Returned to be destroyed unlocked
+  std::unique_ptr<watcher> remove_locked(uint64_t id);
+#ifdef __linux__
+  struct dir_watch {
+    // Canonical
+    std::string path;
+    // Watcher ids, with the directory's path relative to their root ("" or
+    // ending in '/')
+    std::vector<std::pair<uint64_t, std::string>> subs;
+  };
+
+  // Watches dir as rel below the root of watcher id, and its subdirectories
+  // if the watcher is recursive. With report, what they contain is recorded
+  // as added: it was created before the watch could catch it. Called locked.
+  void watch_dir(uint64_t id, watcher &w, const std::string &dir,
+                 const std::string &rel, bool report);
+  // Stops watching dir and below it for watcher id. Called locked.
+  void unwatch_tree(uint64_t id, const std::string &dir);
+  void drop_sub(int wd, uint64_t id);
+  // Reads what is queued on the inotify descriptor. Called locked.
+  void read_events();
+
+  int inotify_fd = -1;
+  std::unordered_map<int, dir_watch> dirs;
+#endif
+
+  std::mutex mutex;
+  // Signals changes recorded by other threads, without inotify
+  std::condition_variable cv;
+  std::unordered_map<uint64_t, std::unique_ptr<watcher>> watchers;
+  uint64_t next_id = 1;
+  bool started = false;
+  std::thread::id hub_thread;
+  // The watcher whose listener runs right now, remove waits for it
+  uint64_t calling = 0;
+  std::condition_variable call_done;
+};
+
+} // namespace breeze::js
@@ -6,9 +6,11 @@
 #include "cinatra/ylt/coro_io/io_context_pool.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdio>
+#include <cstring>
 #include <expected>
 #include <filesystem>
 #include <fstream>
@@ -21,6 +23,7 @@
 #include <mutex>
 #include <optional>
 #include <ranges>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -211,6 +214,8 @@ public:
   js_string(Args &&...args) : Base(std::forward<Args>(args)...), ctx(nullptr) {}
 
   js_string(const js_string &other) = delete;
+  js_string(js_string &&other) noexcept
+      : Base(other), ctx(std::exchange(other.ctx, nullptr)) {}
 
   operator const char *() const { return this->data(); }
 
@@ -690,6 +695,22 @@ concept is_callable_concept = requires(T t) {
 template <typename T> struct is_byte_vector : std::false_type {};
 template <> struct is_byte_vector<std::vector<uint8_t>> : std::true_type {};
 
+namespace detail {
+/** Value categories std::variant unwrapping dispatches on. */
+enum class variant_kind : uint8_t {
+  string,
+  callable,
+  integer,
+  boolean,
+  number,
+  byte_buffer,
+  array,
+  object,
+  none,
+  count
+};
+} // namespace detail
+
 /** Conversion from const std::variant */
 template <typename... Ts> struct js_traits<std::variant<Ts...>> {
   static JSValue wrap(JSContext *ctx, std::variant<Ts...> value) noexcept {
@@ -730,110 +751,227 @@ template <typename... Ts> struct js_traits<std::variant<Ts...>> {
     static constexpr bool value = is_callable_concept<T>;
   };
 
-  /** Attempt to match common types (integral, floating-point, string, etc.) */
-  template <template <typename R> typename Trait, typename U, typename... Us>
-  static std::optional<std::variant<Ts...>> unwrapImpl(JSContext *ctx,
-                                                       JSValueConst v) {
-    if constexpr (Trait<U>::value) {
-      return js_traits<U>::unwrap(ctx, v);
+  /** Rank of alternative U for values of kind k: lower wins, -1 if U cannot
+   * hold such a value. Follows the historical priority, e.g. an int prefers
+   * integral alternatives over floating point ones.
+   */
+  template <typename U> static constexpr int rank(detail::variant_kind k) {
+    using enum detail::variant_kind;
+    if constexpr (is_variant<U>::value) {
+      // nested variants rank behind direct matches for primitive values
+      if (!js_traits<U>::accepts(k))
+        return -1;
+      return k == byte_buffer || k == array ? 0 : 3;
     }
-    if constexpr ((sizeof...(Us)) > 0) {
-      return unwrapImpl<Trait, Us...>(ctx, v);
+    switch (k) {
+    case string:
+      return is_string<U>::value ? 0 : -1;
+    case callable:
+      return is_callable<U>::value ? 0 : -1;
+    case integer:
+      return std::is_integral_v<U> ? 0 : std::is_floating_point_v<U> ? 1 : -1;
+    case boolean:
+      return is_boolean<U>::value      ? 0
+             : std::is_integral_v<U>       ? 1
+             : std::is_floating_point_v<U> ? 2
+                                           : -1;
+    case number:
+      return is_double<U>::value ? 0 : std::is_floating_point_v<U> ? 1 : -1;
+    case byte_buffer:
+      return is_byte_vector<U>::value ? 0 : -1;
+    case array:
+      return (is_vector<U>::value && !is_byte_vector<U>::value) ||
+                     is_pair<U>::value
+                 ? 0
+                 : -1;
+    default:
+      return -1;
     }
-    return std::nullopt;
   }
 
-  /** Attempt to match class ID with type */
-  template <typename U, typename... Us>
-  static std::optional<std::variant<Ts...>>
-  unwrapObj(JSContext *ctx, JSValueConst v, JSClassID class_id) {
-    if constexpr (is_shared_ptr<U>::value) {
-      if (class_id == js_traits<U>::QJSClassId) {
-        return js_traits<U>::unwrap(ctx, v);
-      }
-    }
+  static constexpr size_t npos = sizeof...(Ts);
 
-    // try to unwrap embedded variant (variant<variant<...>>), might be slow
-    if constexpr (is_variant<U>::value) {
-      if (auto opt = js_traits<std::optional<U>>::unwrap(ctx, v))
-        return *opt;
+  /** Index of the alternative that values of kind k are unwrapped to. */
+  static constexpr size_t best_alternative(detail::variant_kind k) {
+    constexpr size_t n = sizeof...(Ts);
+    const int ranks[n] = {rank<Ts>(k)...};
+    size_t best = npos;
+    for (size_t i = 0; i < n; i++) {
+      if (ranks[i] >= 0 && (best == npos || ranks[i] < ranks[best]))
+        best = i;
     }
+    return best;
+  }
 
-    // try vector<uint8_t> as ArrayBuffer/TypedArray
-    if constexpr (is_byte_vector<U>::value) {
-      size_t size;
-      if (JS_GetArrayBuffer(ctx, &size, v) || JS_GetUint8Array(ctx, &size, v)) {
-        return js_traits<U>::unwrap(ctx, v);
-      }
-    }
+  static constexpr size_t count_alternatives(detail::variant_kind k) {
+    size_t n = 0;
+    ((n += rank<Ts>(k) >= 0 ? 1 : 0), ...);
+    return n;
+  }
 
-    if constexpr (is_vector<U>::value) {
-      if (JS_IsArray(ctx, v) == 1) {
-        auto firstElement = JS_GetPropertyUint32(ctx, v, 0);
-        bool ok = isCompatible<std::decay_t<typename U::value_type>>(
-            ctx, firstElement);
-        JS_FreeValue(ctx, firstElement);
-        if (ok) {
-          return U{js_traits<U>::unwrap(ctx, v)};
-        }
-      }
+  /** kind -> alternative index. Evaluated at compile time by callers. */
+  static constexpr auto dispatch_table() {
+    std::array<size_t, size_t(detail::variant_kind::count)> table{};
+    for (size_t k = 0; k < table.size(); k++)
+      table[k] = best_alternative(detail::variant_kind(k));
+    return table;
+  }
+
+public:
+  static constexpr bool accepts(detail::variant_kind k) {
+    return best_alternative(k) != npos;
+  }
+
+  /** True if objects of class class_id unwrap to one of the alternatives. */
+  static bool accepts_class(JSClassID class_id) noexcept {
+    return (accepts_class_as<Ts>(class_id) || ...);
+  }
+
+private:
+  template <typename U> static bool accepts_class_as(JSClassID class_id) {
+    if constexpr (is_shared_ptr<U>::value)
+      return class_id == js_traits<U>::QJSClassId;
+    else if constexpr (is_variant<U>::value)
+      return js_traits<U>::accepts_class(class_id);
+    else
+      return false;
+  }
+
+  template <size_t I>
+  static std::variant<Ts...> unwrap_as(JSContext *ctx, JSValueConst v) {
+    using U = std::variant_alternative_t<I, std::variant<Ts...>>;
+    return std::variant<Ts...>{std::in_place_index<I>,
+                               js_traits<U>::unwrap(ctx, v)};
+  }
+
+  using unwrap_fn = std::variant<Ts...> (*)(JSContext *, JSValueConst);
+
+  template <size_t... I>
+  static constexpr auto make_unwrappers(std::index_sequence<I...>) {
+    return std::array<unwrap_fn, sizeof...(I)>{&unwrap_as<I>...};
+  }
+
+  /** Object that is not an array or buffer: match on class id. */
+  template <size_t I = 0>
+  static std::variant<Ts...> unwrapClass(JSContext *ctx, JSValueConst v,
+                                         JSClassID class_id) {
+    if constexpr (I < sizeof...(Ts)) {
+      if (accepts_class_as<std::variant_alternative_t<I, std::variant<Ts...>>>(
+              class_id))
+        return unwrap_as<I>(ctx, v);
+      return unwrapClass<I + 1>(ctx, v, class_id);
+    } else {
+      JS_ThrowTypeError(ctx, "Expected type %s, got object with classid %d",
+                        QJSPP_TYPENAME(std::variant<Ts...>), class_id);
+      throw exception{ctx};
     }
+  }
 
-    if constexpr (is_pair<U>::value) {
-      if (JS_IsArray(ctx, v) == 1) {
-        // todo: check length?
-        auto firstElement = JS_GetPropertyUint32(ctx, v, 0);
-        auto secondElement = JS_GetPropertyUint32(ctx, v, 1);
-        bool ok = isCompatible<std::decay_t<typename U::first_type>>(
-                      ctx, firstElement) &&
-                  isCompatible<std::decay_t<typename U::second_type>>(
-                      ctx, secondElement);
-        JS_FreeValue(ctx, firstElement);
-        JS_FreeValue(ctx, secondElement);
-        if (ok) {
-          return U{js_traits<U>::unwrap(ctx, v)};
+  /** Several array-like alternatives: probe the elements, in order. */
+  template <size_t I = 0>
+  static std::variant<Ts...> unwrapArray(JSContext *ctx, JSValueConst v) {
+    if constexpr (I < sizeof...(Ts)) {
+      using U = std::variant_alternative_t<I, std::variant<Ts...>>;
+      if constexpr (rank<U>(detail::variant_kind::array) >= 0) {
+        bool ok;
+        if constexpr (is_variant<U>::value) {
+          ok = true;
+        } else if constexpr (is_vector<U>::value) {
+          auto first = JS_GetPropertyUint32(ctx, v, 0);
+          ok = isCompatible<std::decay_t<typename U::value_type>>(ctx, first);
+          JS_FreeValue(ctx, first);
+        } else {
+          auto first = JS_GetPropertyUint32(ctx, v, 0);
+          auto second = JS_GetPropertyUint32(ctx, v, 1);
+          ok = isCompatible<std::decay_t<typename U::first_type>>(ctx, first) &&
+               isCompatible<std::decay_t<typename U::second_type>>(ctx,
+                                                                   second);
+          JS_FreeValue(ctx, first);
+          JS_FreeValue(ctx, second);
         }
+        if (ok)
+          return unwrap_as<I>(ctx, v);
       }
+      return unwrapArray<I + 1>(ctx, v);
+    } else {
+      JS_ThrowTypeError(ctx, "Expected type %s, got incompatible array",
+                        QJSPP_TYPENAME(std::variant<Ts...>));
+      throw exception{ctx};
     }
-
-    if constexpr ((sizeof...(Us)) > 0) {
-      return unwrapObj<Us...>(ctx, v, class_id);
-    }
-    return std::nullopt;
   }
 
-  /** Attempt to cast to types satisfying traits, ordered in terms of priority
-   */
-  template <template <typename T> typename Trait,
-            template <typename T> typename... Traits>
-  static std::variant<Ts...> unwrapPriority(JSContext *ctx, JSValueConst v) {
-    if (auto result = unwrapImpl<Trait, Ts...>(ctx, v)) {
-      return *result;
-    }
-    if constexpr ((sizeof...(Traits)) > 0) {
-      return unwrapPriority<Traits...>(ctx, v);
+  /** Reads the tag, and for objects the class id, exactly once. */
+  static detail::variant_kind classify(JSContext *ctx, JSValueConst v) {
+    using enum detail::variant_kind;
+    switch (JS_VALUE_GET_TAG(v)) {
+    case JS_TAG_STRING:
+      [[fallthrough]];
+    case JS_TAG_STRING_ROPE:
+      return string;
+    case JS_TAG_FUNCTION_BYTECODE:
+      return callable;
+    case JS_TAG_INT:
+      [[fallthrough]];
+    case JS_TAG_BIG_INT:
+      return integer;
+    case JS_TAG_BOOL:
+      return boolean;
+    case JS_TAG_OBJECT:
+      if (JS_IsFunction(ctx, v))
+        return callable;
+      if constexpr (accepts(byte_buffer)) {
+        if (JS_IsArrayBuffer(v))
+          return byte_buffer;
+        auto ta = JS_GetTypedArrayType(v);
+        if (ta == JS_TYPED_ARRAY_UINT8 || ta == JS_TYPED_ARRAY_UINT8C)
+          return byte_buffer;
+      }
+      if constexpr (accepts(array)) {
+        if (JS_IsArray(ctx, v) == 1)
+          return array;
+      }
+      return object;
+    case JS_TAG_SYMBOL:
+      [[fallthrough]];
+    case JS_TAG_MODULE:
+      [[fallthrough]];
+    case JS_TAG_NULL:
+      [[fallthrough]];
+    case JS_TAG_UNDEFINED:
+      [[fallthrough]];
+    case JS_TAG_UNINITIALIZED:
+      [[fallthrough]];
+    case JS_TAG_CATCH_OFFSET:
+      [[fallthrough]];
+    case JS_TAG_EXCEPTION:
+      return none;
+    case JS_TAG_FLOAT64:
+      [[fallthrough]];
+    default: // more than JS_TAG_FLOAT64 (nan boxing)
+      return number;
     }
-    JS_ThrowTypeError(ctx, "Expected type %s",
-                      QJSPP_TYPENAME(std::variant<Ts...>));
-    throw exception{ctx};
   }
 
+public:
   template <typename T>
   static bool isCompatible(JSContext *ctx, JSValueConst v) noexcept {
-    // const char * type_name = typeid(T).name();
     if (JS_IsFunction(ctx, v)) {
       return is_callable<T>::value;
     }
     switch (JS_VALUE_GET_TAG(v)) {
     case JS_TAG_STRING:
+      [[fallthrough]];
+    case JS_TAG_STRING_ROPE:
       return is_string<T>::value;
 
     case JS_TAG_FUNCTION_BYTECODE:
       return is_callable<T>::value;
     case JS_TAG_OBJECT:
       if constexpr (is_byte_vector<T>::value) {
-        size_t sz;
-        if (JS_GetArrayBuffer(ctx, &sz, v) || JS_GetUint8Array(ctx, &sz, v))
+        if (JS_IsArrayBuffer(v))
+          return true;
+        auto ta = JS_GetTypedArrayType(v);
+        if (ta == JS_TYPED_ARRAY_UINT8 || ta == JS_TYPED_ARRAY_UINT8C)
           return true;
       }
       if (JS_IsArray(ctx, v) == 1)
@@ -852,10 +990,6 @@ template <typename... Ts> struct js_traits<std::variant<Ts...>> {
       return is_boolean<T>::value || std::is_integral_v<T> ||
              std::is_floating_point_v<T>;
 
-    // case JS_TAG_BIG_DECIMAL:
-    //     [[fallthrough]];
-    // case JS_TAG_BIG_FLOAT:
-    //     [[fallthrough]];
     case JS_TAG_FLOAT64:
     default: // >JS_TAG_FLOAT64 (JS_NAN_BOXING)
       return is_double<T>::value || std::is_floating_point_v<T>;
@@ -878,64 +1012,40 @@ template <typename... Ts> struct js_traits<std::variant<Ts...>> {
     return false;
   }
 
+  /** Classifies v once, then jumps to the alternative chosen at compile time
+   * for that kind of value. Only class instances and (if several
+   * alternatives are array-like) arrays need a runtime match.
+   */
   static std::variant<Ts...> unwrap(JSContext *ctx, JSValueConst v) {
-    const auto tag = JS_VALUE_GET_TAG(v);
-
-    if (JS_IsFunction(ctx, v)) {
-      return unwrapPriority<is_callable>(ctx, v);
-    }
-
-    switch (tag) {
-    case JS_TAG_STRING:
-      return unwrapPriority<is_string>(ctx, v);
-
-    case JS_TAG_FUNCTION_BYTECODE:
-      return unwrapPriority<is_callable>(ctx, v);
-    case JS_TAG_OBJECT:
-      if (auto result = unwrapObj<Ts...>(ctx, v, JS_GetClassID(v))) {
-        return *result;
-      }
-      JS_ThrowTypeError(ctx, "Expected type %s, got object with classid %d",
-                        QJSPP_TYPENAME(std::variant<Ts...>), JS_GetClassID(v));
+    using enum detail::variant_kind;
+    static constexpr auto table = dispatch_table();
+    static constexpr auto unwrappers =
+        make_unwrappers(std::index_sequence_for<Ts...>{});
+    const auto k = classify(ctx, v);
+    switch (k) {
+    case object:
+      return unwrapClass(ctx, v, JS_GetClassID(v));
+    case array:
+      if constexpr (count_alternatives(array) > 1)
+        return unwrapArray(ctx, v);
       break;
-
-    case JS_TAG_INT:
-      [[fallthrough]];
-    case JS_TAG_BIG_INT:
-      return unwrapPriority<std::is_integral, std::is_floating_point>(ctx, v);
-    case JS_TAG_BOOL:
-      return unwrapPriority<is_boolean, std::is_integral,
-                            std::is_floating_point>(ctx, v);
-
-    case JS_TAG_SYMBOL:
-      [[fallthrough]];
-    case JS_TAG_MODULE:
-      [[fallthrough]];
-    case JS_TAG_NULL:
-      [[fallthrough]];
-    case JS_TAG_UNDEFINED:
-      [[fallthrough]];
-    case JS_TAG_UNINITIALIZED:
-      [[fallthrough]];
-    case JS_TAG_CATCH_OFFSET:
-      JS_ThrowTypeError(ctx, "Expected type %s, got tag %d",
-                        QJSPP_TYPENAME(std::variant<Ts...>), tag);
-      [[fallthrough]];
-    case JS_TAG_EXCEPTION:
+    case none:
+      if (!JS_IsException(v))
+        JS_ThrowTypeError(ctx, "Expected type %s, got tag %d",
+                          QJSPP_TYPENAME(std::variant<Ts...>),
+                          JS_VALUE_GET_TAG(v));
+      throw exception{ctx};
+    default:
       break;
-
-      // case JS_TAG_BIG_DECIMAL:
-      //     [[fallthrough]];
-      // case JS_TAG_BIG_FLOAT:
-      //     [[fallthrough]];
-
-    case JS_TAG_FLOAT64:
-      [[fallthrough]];
-    default: // more than JS_TAG_FLOAT64 (nan boxing)
-      return unwrapPriority<is_double, std::is_floating_point>(ctx, v);
     }
-
-    throw exception{ctx};
+    const size_t index = table[size_t(k)];
+    if (index == npos) {
+      JS_ThrowTypeError(ctx, "Expected type %s, got tag %d",
+                        QJSPP_TYPENAME(std::variant<Ts...>),
+                        JS_VALUE_GET_TAG(v));
+      throw exception{ctx};
+    }
+    return unwrappers[index](ctx, v);
   }
 };
 
@@ -951,6 +1061,17 @@ template <typename T> struct rest : std::vector<T> {
   using std::vector<T>::operator=;
 };
 
+/** A vector of numbers exchanged with JS as the matching TypedArray
+ * (Float64Array for double, Int32Array for int32_t, ...) instead of an Array.
+ * Plain Arrays are still accepted when unwrapping. */
+template <typename T> struct typed_array : std::vector<T> {
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+                "typed_array<T> requires a numeric element type");
+  using std::vector<T>::vector;
+  using std::vector<T>::operator=;
+  typed_array(std::vector<T> &&v) : std::vector<T>(std::move(v)) {}
+};
+
 namespace detail {
 
 /** Helper function to convert and then free JSValue. */
@@ -970,6 +1091,41 @@ template <typename T> T unwrap_free(JSContext *ctx, JSValue val) {
   }
 }
 
+/** Argument of a std::span<const T> parameter. Borrows the storage of a
+ * matching TypedArray for the duration of the call and only copies when a
+ * plain Array is passed. */
+template <typename T> struct span_arg {
+  std::span<const T> view;
+  std::vector<T> storage;
+  operator std::span<const T>() const { return view; }
+};
+
+/** Type an argument is held as between unwrapping and the call. */
+template <typename T> struct arg_holder {
+  using type = T;
+};
+template <typename T> struct arg_holder<std::span<const T>> {
+  using type = span_arg<T>;
+};
+// Borrows the string's buffer when it is ASCII, see JS_ToCStringLen
+template <> struct arg_holder<std::string_view> {
+  using type = js_string;
+};
+template <> struct arg_holder<const char *> {
+  using type = js_string;
+};
+template <typename T>
+using arg_holder_t = typename arg_holder<std::decay_t<T>>::type;
+
+/** True for argument types that point into JS-owned memory. */
+template <typename T>
+constexpr bool is_borrowed_arg_v =
+    !std::is_same_v<arg_holder_t<T>, std::decay_t<T>>;
+
+template <typename T> struct is_lazy : std::false_type {};
+template <typename T>
+struct is_lazy<async_simple::coro::Lazy<T>> : std::true_type {};
+
 template <typename T, size_t I, size_t NArgs> struct unwrap_arg_impl {
   static auto unwrap(JSContext *ctx, int argc, JSValueConst *argv) {
     if (size_t(argc) > I) {
@@ -1000,6 +1156,17 @@ struct unwrap_arg_impl<rest<T>, I, NArgs> {
   }
 };
 
+template <size_t I, size_t NArgs> struct unwrap_arg_impl<js_string, I, NArgs> {
+  static js_string unwrap(JSContext *ctx, int argc, JSValueConst *argv) {
+    if (size_t(argc) <= I) {
+      JS_ThrowTypeError(ctx, "Expected at least %lu arguments but received %d",
+                        (unsigned long)NArgs, argc);
+      throw exception{ctx};
+    }
+    return js_traits<std::string_view>::unwrap(ctx, argv[I]);
+  }
+};
+
 template <class Tuple, std::size_t... I>
 Tuple unwrap_args_impl(JSContext *ctx, int argc, JSValueConst *argv,
                        std::index_sequence<I...>) {
@@ -1012,9 +1179,9 @@ Tuple unwrap_args_impl(JSContext *ctx, int argc, JSValueConst *argv,
  * @tparam Args C++ types of the argv array
  */
 template <typename... Args>
-std::tuple<std::decay_t<Args>...> unwrap_args(JSContext *ctx, int argc,
+std::tuple<arg_holder_t<Args>...> unwrap_args(JSContext *ctx, int argc,
                                               JSValueConst *argv) {
-  return unwrap_args_impl<std::tuple<std::decay_t<Args>...>>(
+  return unwrap_args_impl<std::tuple<arg_holder_t<Args>...>>(
       ctx, argc, argv, std::make_index_sequence<sizeof...(Args)>());
 }
 
@@ -1030,6 +1197,10 @@ std::tuple<std::decay_t<Args>...> unwrap_args(JSContext *ctx, int argc,
 template <typename R, typename... Args, typename Callable>
 JSValue wrap_call(JSContext *ctx, Callable &&f, int argc,
                   JSValueConst *argv) noexcept {
+  static_assert(!is_lazy<std::decay_t<R>>::value ||
+                    !(is_borrowed_arg_v<Args> || ...),
+                "Borrowed arguments do not outlive the first co_await, take "
+                "them by value in coroutines");
   try {
     setCurrentContext(ctx);
     if constexpr (std::is_same_v<R, void>) {
@@ -1058,6 +1229,10 @@ JSValue wrap_call(JSContext *ctx, Callable &&f, int argc,
 template <typename R, typename FirstArg, typename... Args, typename Callable>
 JSValue wrap_this_call(JSContext *ctx, Callable &&f, JSValueConst this_value,
                        int argc, JSValueConst *argv) noexcept {
+  static_assert(!is_lazy<std::decay_t<R>>::value ||
+                    !(is_borrowed_arg_v<Args> || ...),
+                "Borrowed arguments do not outlive the first co_await, take "
+                "them by value in coroutines");
   try {
     setCurrentContext(ctx);
     if constexpr (std::is_same_v<R, void>) {
@@ -1917,7 +2092,7 @@ public:
 
     JS_SetHostPromiseRejectionTracker(rt, promise_unhandled_rejection_tracker,
                                       NULL);
-    JS_SetModuleLoaderFunc(rt, nullptr, module_loader, nullptr);
+    JS_SetModuleLoaderFunc(rt, module_normalize, module_loader, nullptr);
   }
 
   // noncopyable
@@ -1938,6 +2113,8 @@ private:
                                                   JS_BOOL is_handled,
                                                   void *opaque);
 
+  static char *module_normalize(JSContext *ctx, const char *base_name,
+                                const char *name, void *opaque);
   static JSModuleDef *module_loader(JSContext *ctx, const char *module_name,
                                     void *opaque);
 };
@@ -1956,6 +2133,36 @@ readFile(std::filesystem::path const &filepath) {
   return sstream.str();
 }
 
+// The QuickJS default: a name starting with '.' is resolved against the
+// directory of base_name, only its leading "./" and "../" are normalized
+inline std::string normalizeModuleName(std::string_view base_name,
+                                       std::string_view name) {
+  if (!name.starts_with('.'))
+    return std::string{name};
+  auto slash = base_name.rfind('/');
+  std::string filename{slash == std::string_view::npos
+                           ? std::string_view{}
+                           : base_name.substr(0, slash)};
+  while (true) {
+    if (name.starts_with("./")) {
+      name.remove_prefix(2);
+    } else if (name.starts_with("../") && !filename.empty()) {
+      auto p = filename.rfind('/');
+      auto last = p == std::string::npos ? filename : filename.substr(p + 1);
+      if (last == "." || last == "..")
+        break;
+      filename.resize(p == std::string::npos ? 0 : p);
+      name.remove_prefix(3);
+    } else {
+      break;
+    }
+  }
+  if (!filename.empty())
+    filename += '/';
+  filename += name;
+  return filename;
+}
+
 inline std::string toUri(std::string_view filename) {
   auto fname = std::string{filename};
   if (fname.find("://") < fname.find("/"))
@@ -2301,6 +2508,11 @@ public:
     return ModuleData{detail::toUri(filename), detail::readFile(filename)};
   };
 
+  /** Function called to resolve the name imported by the module base_name.
+   * Modules are loaded and cached by the name it returns. */
+  std::function<std::string(std::string_view base_name, std::string_view name)>
+      moduleNormalizer = detail::normalizeModuleName;
+
   template <typename Function> void enqueueJob(Function &&job);
 
   /** Create module and return a reference to it */
@@ -2525,39 +2737,75 @@ template <> struct js_traits<std::vector<uint8_t>> {
 
   static std::vector<uint8_t> unwrap(JSContext *ctx, JSValueConst v) {
     size_t size;
-    // Try ArrayBuffer first
-    uint8_t *ptr = JS_GetArrayBuffer(ctx, &size, v);
+    // Check the class first: the getters throw on a mismatch
+    uint8_t *ptr = JS_IsArrayBuffer(v) ? JS_GetArrayBuffer(ctx, &size, v)
+                                       : JS_GetUint8Array(ctx, &size, v);
     if (ptr) {
       return std::vector<uint8_t>(ptr, ptr + size);
     }
-    // Try TypedArray (Uint8Array etc.)
-    ptr = JS_GetUint8Array(ctx, &size, v);
-    if (ptr) {
-      return std::vector<uint8_t>(ptr, ptr + size);
-    }
-    JS_ThrowTypeError(ctx, "Expected ArrayBuffer or TypedArray");
+    if (!JS_HasException(ctx))
+      JS_ThrowTypeError(ctx, "Expected ArrayBuffer or TypedArray");
     throw exception{ctx};
   }
 };
 
+/** Bytes an ArrayBuffer uses in place instead of copying. The buffer keeps a
+ * reference to owner and drops it when collected, so owner decides how the
+ * memory is released (a vector, an unmapped file view).
+ */
+struct shared_buffer {
+  std::shared_ptr<void> owner;
+  uint8_t *data = nullptr;
+  size_t size = 0;
+
+  static shared_buffer from(std::vector<uint8_t> &&bytes) {
+    auto vec = std::make_shared<std::vector<uint8_t>>(std::move(bytes));
+    return {vec, vec->data(), vec->size()};
+  }
+};
+
+template <> struct js_traits<shared_buffer> {
+  static JSValue wrap(JSContext *ctx, const shared_buffer &buf) noexcept {
+    auto *ref = new std::shared_ptr<void>(buf.owner);
+    JSValue v = JS_NewArrayBuffer(
+        ctx, buf.data, buf.size,
+        [](JSRuntime *, void *opaque, void *) {
+          delete static_cast<std::shared_ptr<void> *>(opaque);
+        },
+        ref, false);
+    // Not released by the engine when the buffer could not be created
+    if (JS_IsException(v))
+      delete ref;
+    return v;
+  }
+};
+
 /** Convert from std::vector<T> to Array and vice-versa. If Array holds objects
  * that are non-convertible to T throws qjs::exception */
 template <class T> struct js_traits<std::vector<T>> {
   static JSValue wrap(JSContext *ctx, const std::vector<T> &arr) noexcept {
+    std::vector<JSValue> values;
     try {
-      auto jsarray = Value{weakFromContext(ctx), JS_NewArray(ctx)};
-      for (uint32_t i = 0; i < (uint32_t)arr.size(); i++)
-        jsarray[i] = arr[i];
-      return jsarray.release();
+      values.reserve(arr.size());
+      for (auto &&item : arr) {
+        JSValue v = js_traits<T>::wrap(ctx, item);
+        if (JS_IsException(v))
+          break;
+        values.push_back(v);
+      }
     } catch (exception) {
-      return JS_EXCEPTION;
     } catch (std::exception const &err) {
       JS_ThrowInternalError(ctx, "%s", err.what());
-      return JS_EXCEPTION;
     } catch (...) {
       JS_ThrowInternalError(ctx, "Unknown error");
+    }
+    if (values.size() != arr.size()) {
+      for (JSValue v : values)
+        JS_FreeValue(ctx, v);
       return JS_EXCEPTION;
     }
+    // Elements are moved into a preallocated fast array
+    return JS_NewArrayFrom(ctx, (int)values.size(), values.data());
   }
 
   static std::vector<T> unwrap(JSContext *ctx, JSValueConst jsarr) {
@@ -2566,16 +2814,141 @@ template <class T> struct js_traits<std::vector<T>> {
       JS_ThrowTypeError(ctx, "js_traits<std::vector<T>>::unwrap expects array");
     if (e <= 0)
       throw exception{ctx};
-    Value jsarray{ctx, JS_DupValue(ctx, jsarr)};
+    JSValue *values;
+    uint32_t count;
+    int64_t len;
+    bool fast = JS_GetFastArray(ctx, jsarr, &values, &count);
+    if (fast)
+      len = count;
+    else if (JS_GetLength(ctx, jsarr, &len) < 0)
+      throw exception{ctx};
     std::vector<T> arr;
-    auto len = static_cast<int32_t>(jsarray["length"]);
     arr.reserve((uint32_t)len);
-    for (uint32_t i = 0; i < (uint32_t)len; i++)
-      arr.push_back(static_cast<T>(jsarray[i]));
+    for (uint32_t i = 0; i < (uint32_t)len; i++) {
+      JSValue item = fast && i < count ? JS_DupValue(ctx, values[i])
+                                       : JS_GetPropertyUint32(ctx, jsarr, i);
+      if (JS_IsException(item))
+        throw exception{ctx};
+      // Converting an object may run JS that reshapes the array, so the
+      // storage is looked up again afterwards
+      bool may_run_js = JS_IsObject(item);
+      arr.push_back(detail::unwrap_free<T>(ctx, item));
+      if (may_run_js)
+        fast = JS_GetFastArray(ctx, jsarr, &values, &count);
+    }
     return arr;
   }
 };
 
+namespace detail {
+template <typename T> constexpr JSTypedArrayEnum typed_array_type() {
+  if constexpr (std::is_floating_point_v<T>)
+    return sizeof(T) == 4 ? JS_TYPED_ARRAY_FLOAT32 : JS_TYPED_ARRAY_FLOAT64;
+  else if constexpr (sizeof(T) == 1)
+    return std::is_signed_v<T> ? JS_TYPED_ARRAY_INT8 : JS_TYPED_ARRAY_UINT8;
+  else if constexpr (sizeof(T) == 2)
+    return std::is_signed_v<T> ? JS_TYPED_ARRAY_INT16 : JS_TYPED_ARRAY_UINT16;
+  else if constexpr (sizeof(T) == 4)
+    return std::is_signed_v<T> ? JS_TYPED_ARRAY_INT32 : JS_TYPED_ARRAY_UINT32;
+  else
+    return std::is_signed_v<T> ? JS_TYPED_ARRAY_BIG_INT64
+                               : JS_TYPED_ARRAY_BIG_UINT64;
+}
+} // namespace detail
+
+namespace detail {
+/** Create a TypedArray of the type matching T holding a copy of the data. */
+template <typename T>
+JSValue new_typed_array(JSContext *ctx, const T *data, size_t count) noexcept {
+  JSValue buf = JS_NewArrayBufferCopy(
+      ctx, reinterpret_cast<const uint8_t *>(data), count * sizeof(T));
+  if (JS_IsException(buf))
+    return buf;
+  // The constructor reads offset and length without checking argc
+  JSValue args[] = {buf, JS_UNDEFINED, JS_UNDEFINED};
+  JSValue ta = JS_NewTypedArray(ctx, 3, args, typed_array_type<T>());
+  JS_FreeValue(ctx, buf);
+  return ta;
+}
+
+/** Borrow the elements of a TypedArray of the type matching T (for bytes
+ * also an ArrayBuffer). Returns nullopt for any other value. The view is
+ * valid as long as v is alive and no JS code runs. */
+template <typename T>
+std::optional<std::span<const T>> typed_array_view(JSContext *ctx,
+                                                   JSValueConst v) {
+  size_t offset = 0, length, size;
+  uint8_t *data;
+  int type = JS_GetTypedArrayType(v);
+  if (type == typed_array_type<T>() ||
+      (sizeof(T) == 1 && type == JS_TYPED_ARRAY_UINT8C)) {
+    JSValue buf = JS_GetTypedArrayBuffer(ctx, v, &offset, &length, nullptr);
+    if (JS_IsException(buf))
+      throw exception{ctx};
+    data = JS_GetArrayBuffer(ctx, &size, buf);
+    JS_FreeValue(ctx, buf);
+  } else if (sizeof(T) == 1 && JS_IsArrayBuffer(v)) {
+    data = JS_GetArrayBuffer(ctx, &length, v);
+  } else {
+    return std::nullopt;
+  }
+  if (!data)
+    throw exception{ctx};
+  return std::span<const T>(reinterpret_cast<const T *>(data + offset),
+                            length / sizeof(T));
+}
+} // namespace detail
+
+/** Convert from typed_array<T> to the matching TypedArray with a single copy
+ * of the element storage, and back from the same TypedArray or an Array. */
+template <class T> struct js_traits<typed_array<T>> {
+  static JSValue wrap(JSContext *ctx, const typed_array<T> &arr) noexcept {
+    return detail::new_typed_array(ctx, arr.data(), arr.size());
+  }
+
+  static typed_array<T> unwrap(JSContext *ctx, JSValueConst v) {
+    if (auto view = detail::typed_array_view<T>(ctx, v))
+      return typed_array<T>(view->begin(), view->end());
+    return js_traits<std::vector<T>>::unwrap(ctx, v);
+  }
+};
+
+/** std::span<const T> is returned as a copy in the matching TypedArray. As a
+ * function parameter it borrows the TypedArray storage, see span_arg. */
+template <class T> struct js_traits<std::span<const T>> {
+  static JSValue wrap(JSContext *ctx, std::span<const T> arr) noexcept {
+    return detail::new_typed_array(ctx, arr.data(), arr.size());
+  }
+
+  static std::span<const T> unwrap(JSContext *ctx, JSValueConst v) {
+    if (auto view = detail::typed_array_view<T>(ctx, v))
+      return *view;
+    JS_ThrowTypeError(ctx, "Expected a TypedArray of matching element type");
+    throw exception{ctx};
+  }
+};
+
+namespace detail {
+template <typename T, size_t I, size_t NArgs>
+struct unwrap_arg_impl<span_arg<T>, I, NArgs> {
+  static span_arg<T> unwrap(JSContext *ctx, int argc, JSValueConst *argv) {
+    if (size_t(argc) <= I) {
+      JS_ThrowTypeError(ctx, "Expected at least %lu arguments but received %d",
+                        (unsigned long)NArgs, argc);
+      throw exception{ctx};
+    }
+    span_arg<T> arg;
+    if (auto view = typed_array_view<T>(ctx, argv[I])) {
+      arg.view = *view;
+    } else {
+      arg.storage = js_traits<std::vector<T>>::unwrap(ctx, argv[I]);
+      arg.view = arg.storage;
+    }
+    return arg;
+  }
+};
+} // namespace detail
+
 template <typename U, typename V> struct js_traits<std::pair<U, V>> {
   static JSValue wrap(JSContext *ctx, std::pair<U, V> obj) noexcept {
     try {
@@ -2880,6 +3253,23 @@ inline void Runtime::promise_unhandled_rejection_tracker(JSContext *ctx,
   }
 }
 
+inline char *Runtime::module_normalize(JSContext *ctx, const char *base_name,
+                                      const char *name, void *opaque) {
+  auto &context = Context::get(ctx);
+  try {
+    auto normalized = context.moduleNormalizer
+                          ? context.moduleNormalizer(base_name, name)
+                          : detail::normalizeModuleName(base_name, name);
+    return js_strdup(ctx, normalized.c_str());
+  } catch (std::exception const &err) {
+    JS_ThrowInternalError(ctx, "%s", err.what());
+    return NULL;
+  } catch (...) {
+    JS_ThrowInternalError(ctx, "Unknown error");
+    return NULL;
+  }
+}
+
 inline JSModuleDef *
 Runtime::module_loader(JSContext *ctx, const char *module_name, void *opaque) {
   Context::ModuleData data;
@@ -2955,6 +3345,48 @@ inline std::weak_ptr<Context> weakFromContext(JSContext *ctx) {
   return Context::get(ctx).weak_from_this();
 }
 
+/** JSON text validated and parsed into a flat tape, which can happen on any
+ * thread. Wrapping the document only allocates the JS values, so returning
+ * it from a Lazy keeps the JS thread out of tokenizing, number conversion
+ * and unescaping. */
+struct json_document {
+  enum class kind : uint8_t {
+    null,
+    false_,
+    true_,
+    number,
+    string,
+    array,
+    object
+  };
+  struct node {
+    kind type;
+    // Elements of an array, members of an object or bytes of a string
+    uint32_t count;
+    union {
+      double number;
+      // Start of a string in strings
+      size_t offset;
+    };
+  };
+
+  // Values in document order; an object's members are key string nodes
+  // each followed by their value
+  std::vector<node> nodes;
+  // Unescaped UTF-8 of every string and key
+  std::string strings;
+  // Set instead of the tape when the text holds escapes UTF-8 cannot carry
+  // (lone surrogates); wrapping then falls back to JS_ParseJSON
+  std::string source;
+
+  /** Throws std::runtime_error when text is not valid JSON. */
+  static json_document parse(std::string_view text);
+};
+
+template <> struct js_traits<json_document> {
+  static JSValue wrap(JSContext *ctx, const json_document &doc);
+};
+
 #ifdef ASYNC_SUPPORT
 template <typename T> struct LazyWrapper {
   async_simple::coro::RescheduleLazy<T> lazy;
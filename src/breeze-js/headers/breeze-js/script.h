@@ -41,9 +41,45 @@ struct script_context {
   std::expected<qjs::Value, std::string>
   eval_string(const std::string &script, std::string_view filename = "<eval>");
   std::string current_exception_string();
+  // Evaluates the .js files directly in path, then keeps them up to date
+  // with their files and the modules they import from path or module_base.
+  // A change re-evaluates only the scripts it affects: the changed script,
+  // or the ones importing a changed module, directly or through other
+  // modules. Those modules are loaded anew, the others stay as they are.
+  // Re-evaluated scripts share the context, and so the globals, of the
+  // others. A script may export dispose() to undo its effects before it is
+  // evaluated again. Removing a script still resets the runtime and
+  // evaluates them all. on_reload runs before each reload; changes it
+  // refuses are offered again every 300 ms. Blocks the calling thread,
+  // which runs the reloads.
   void watch_folder(
       const std::filesystem::path &path,
       std::function<bool()> on_reload = []() { return true; });
+  // watch_folder on a thread of its own: returns once the scripts are
+  // evaluated. The watch lasts until the context is destroyed or watches
+  // another folder.
+  void start_watch_folder(
+      const std::filesystem::path &path,
+      std::function<bool()> on_reload = []() { return true; });
+
+  // Bounds on concurrent fetch calls and on what they may allocate. They
+  // apply process-wide, like the connection pool and HTTP cache behind
+  // fetch.
+  struct fetch_limits {
+    // 0 for no limit
+    size_t max_concurrent = 64;
+    size_t max_per_origin = 6;
+    // Identical in-flight GETs share one network request
+    bool coalesce_gets = false;
+    // Largest body a gzip, deflate, br or zstd response may decode to, a
+    // fetch whose body grows past it fails. 0 for no limit.
+    size_t max_decoded_size = 256 * 1024 * 1024;
+  };
+  void set_fetch_limits(const fetch_limits &limits);
+
+  // Threads running the blocking filesystem calls behind the async
+  // breeze.filesystem API, process-wide. 4 by default.
+  void set_blocking_io_threads(size_t threads);
 
   void post(std::function<void()> task);
   bool is_js_thread() const;
@@ -88,8 +124,34 @@ struct script_context {
   }
 
 private:
+  struct hot_reload;
+  struct folder_watch;
+
+  // With exports, the module namespace of the script is stored there
   std::expected<qjs::Value, std::string>
-  eval_string_impl(const std::string &script, std::string_view filename);
+  eval_string_impl(const std::string &script, std::string_view filename,
+                   qjs::Value *exports = nullptr);
+  // Evaluates the .js files directly in the watched folder. On the JS thread.
+  void eval_folder();
+  // On the JS thread
+  void eval_script(const std::filesystem::path &path);
+  // Calls dispose() of the script's last evaluation. On the JS thread.
+  void dispose_script(const std::filesystem::path &path);
+  // Evaluates the folder and starts watching it for run_watch
+  std::shared_ptr<folder_watch>
+  begin_watch(const std::filesystem::path &path,
+              std::function<bool()> on_reload);
+  // Applies the changes watch reports until it is stopped
+  void run_watch(folder_watch &watch);
+  void stop_watch();
+  // Re-evaluates the scripts the changes affect; watching thread
+  void apply_changes(const std::vector<std::filesystem::path> &changed);
+  // The JS thread part of apply_changes. Returns false when the changes
+  // take a fresh runtime instead.
+  bool reload_scripts(const std::vector<std::filesystem::path> &changed);
+  std::shared_ptr<folder_watch> watch;
+  // JS thread only
+  std::shared_ptr<hot_reload> reload;
   platform_thread::id js_thread_id_;
 };
 } // namespace breeze
@@ -0,0 +1,476 @@
+#include "breeze-js/quickjspp.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace qjs {
+
+namespace {
+
+using kind = json_document::kind;
+
+constexpr uint64_t repeat_byte(uint8_t b) { return 0x0101010101010101ull * b; }
+
+// Nonzero when one of the 8 bytes in w is '"', '\\' or a control character,
+// the bytes that end the plain run of a string
+inline uint64_t string_special(uint64_t w) {
+  auto has_zero = [](uint64_t x) {
+    return (x - repeat_byte(0x01)) & ~x & repeat_byte(0x80);
+  };
+  return has_zero(w ^ repeat_byte('"')) | has_zero(w ^ repeat_byte('\\')) |
+         ((w - repeat_byte(0x20)) & ~w & repeat_byte(0x80));
+}
+
+inline int hex_digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+void append_utf8(std::string &out, uint32_t c) {
+  if (c < 0x80) {
+    out += char(c);
+  } else if (c < 0x800) {
+    out += char(0xC0 | (c >> 6));
+    out += char(0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    out += char(0xE0 | (c >> 12));
+    out += char(0x80 | ((c >> 6) & 0x3F));
+    out += char(0x80 | (c & 0x3F));
+  } else {
+    out += char(0xF0 | (c >> 18));
+    out += char(0x80 | ((c >> 12) & 0x3F));
+    out += char(0x80 | ((c >> 6) & 0x3F));
+    out += char(0x80 | (c & 0x3F));
+  }
+}
+
+// Iterative RFC 8259 parser, so deeply nested input cannot overflow the
+// stack of the thread it runs on
+struct json_parser {
+  const char *begin;
+  const char *p;
+  const char *end;
+  json_document &doc;
+  // Containers still open, as indices into doc.nodes
+  std::vector<size_t> open;
+  bool lone_surrogate = false;
+
+  [[noreturn]] void fail(const char *what) {
+    throw std::runtime_error("JSON.parse: " + std::string(what) +
+                             " at position " + std::to_string(p - begin));
+  }
+
+  void skip_ws() {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+      p++;
+  }
+
+  void push(kind type, uint32_t count = 0) {
+    auto &n = doc.nodes.emplace_back();
+    n.type = type;
+    n.count = count;
+    n.offset = 0;
+  }
+
+  void parse_string() {
+    // p is at the opening quote
+    p++;
+    size_t offset = doc.strings.size();
+    while (true) {
+      const char *run = p;
+      while (end - p >= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        if (string_special(w))
+          break;
+        p += 8;
+      }
+      while (p < end && *p != '"' && *p != '\\' &&
+             static_cast<unsigned char>(*p) >= 0x20)
+        p++;
+      doc.strings.append(run, p);
+      if (p == end)
+        fail("unterminated string");
+      if (*p == '"') {
+        p++;
+        break;
+      }
+      if (*p != '\\')
+        fail("bad control character in string literal");
+      if (++p == end)
+        fail("unterminated string");
+      switch (*p++) {
+      case '"':
+        doc.strings += '"';
+        break;
+      case '\\':
+        doc.strings += '\\';
+        break;
+      case '/':
+        doc.strings += '/';
+        break;
+      case 'b':
+        doc.strings += '\b';
+        break;
+      case 'f':
+        doc.strings += '\f';
+        break;
+      case 'n':
+        doc.strings += '\n';
+        break;
+      case 'r':
+        doc.strings += '\r';
+        break;
+      case 't':
+        doc.strings += '\t';
+        break;
+      case 'u': {
+        uint32_t c = parse_hex4();
+        if (c >= 0xD800 && c < 0xDC00 && end - p >= 6 && p[0] == '\\' &&
+            p[1] == 'u') {
+          const char *save = p;
+          p += 2;
+          uint32_t low = parse_hex4();
+          if (low >= 0xDC00 && low < 0xE000) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+          } else {
+            p = save;
+          }
+        }
+        if (c >= 0xD800 && c < 0xE000)
+          lone_surrogate = true;
+        append_utf8(doc.strings, c);
+        break;
+      }
+      default:
+        p--;
+        fail("bad escape sequence");
+      }
+    }
+    size_t length = doc.strings.size() - offset;
+    if (length > UINT32_MAX)
+      fail("string too long");
+    auto &n = doc.nodes.emplace_back();
+    n.type = kind::string;
+    n.count = static_cast<uint32_t>(length);
+    n.offset = offset;
+  }
+
+  uint32_t parse_hex4() {
+    if (end - p < 4)
+      fail("bad Unicode escape");
+    uint32_t c = 0;
+    for (int i = 0; i < 4; i++) {
+      int d = hex_digit(p[i]);
+      if (d < 0)
+        fail("bad Unicode escape");
+      c = (c << 4) | d;
+    }
+    p += 4;
+    return c;
+  }
+
+  void parse_number() {
+    const char *start = p;
+    bool neg = false;
+    if (*p == '-') {
+      neg = true;
+      p++;
+    }
+    if (p == end || *p < '0' || *p > '9')
+      fail("no number after minus sign");
+    const char *digits = p;
+    if (*p == '0') {
+      p++;
+    } else {
+      while (p < end && *p >= '0' && *p <= '9')
+        p++;
+    }
+    bool integer = true;
+    if (p < end && *p == '.') {
+      integer = false;
+      if (++p == end || *p < '0' || *p > '9')
+        fail("unterminated fractional number");
+      while (p < end && *p >= '0' && *p <= '9')
+        p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+      integer = false;
+      p++;
+      if (p < end && (*p == '+' || *p == '-'))
+        p++;
+      if (p == end || *p < '0' || *p > '9')
+        fail("exponent part is missing a number");
+      while (p < end && *p >= '0' && *p <= '9')
+        p++;
+    }
+
+    double value;
+    if (integer && p - digits <= 15) {
+      // Exact in a double, no need for strtod
+      int64_t n = 0;
+      for (const char *d = digits; d < p; d++)
+        n = n * 10 + (*d - '0');
+      value = neg ? -double(n) : double(n);
+    } else {
+      // strtod needs a terminated copy; JS_ParseJSON converts with it too
+      char buf[64];
+      std::string heap;
+      size_t len = p - start;
+      char *copy = buf;
+      if (len >= sizeof(buf)) {
+        heap.assign(start, len);
+        copy = heap.data();
+      } else {
+        std::memcpy(buf, start, len);
+        buf[len] = '\0';
+      }
+      value = std::strtod(copy, nullptr);
+    }
+    auto &n = doc.nodes.emplace_back();
+    n.type = kind::number;
+    n.count = 0;
+    n.number = value;
+  }
+
+  void parse_literal(const char *word, size_t len, kind type) {
+    if (size_t(end - p) < len || std::memcmp(p, word, len) != 0)
+      fail("unexpected token");
+    p += len;
+    push(type);
+  }
+
+  void expect_key() {
+    skip_ws();
+    if (p == end || *p != '"')
+      fail("expecting property name");
+    parse_string();
+    skip_ws();
+    if (p == end || *p != ':')
+      fail("expecting ':'");
+    p++;
+  }
+
+  void run() {
+    bool expect_value = true;
+    while (true) {
+      skip_ws();
+      if (expect_value) {
+        if (p == end)
+          fail("unexpected end of input");
+        switch (*p) {
+        case '{':
+          p++;
+          open.push_back(doc.nodes.size());
+          push(kind::object);
+          skip_ws();
+          if (p < end && *p == '}') {
+            p++;
+            open.pop_back();
+            expect_value = false;
+          } else {
+            expect_key();
+          }
+          continue;
+        case '[':
+          p++;
+          open.push_back(doc.nodes.size());
+          push(kind::array);
+          skip_ws();
+          if (p < end && *p == ']') {
+            p++;
+            open.pop_back();
+            expect_value = false;
+          }
+          continue;
+        case '"':
+          parse_string();
+          break;
+        case 't':
+          parse_literal("true", 4, kind::true_);
+          break;
+        case 'f':
+          parse_literal("false", 5, kind::false_);
+          break;
+        case 'n':
+          parse_literal("null", 4, kind::null);
+          break;
+        default:
+          if (*p == '-' || (*p >= '0' && *p <= '9'))
+            parse_number();
+          else
+            fail("unexpected token");
+        }
+        expect_value = false;
+        continue;
+      }
+
+      // A value just ended
+      if (open.empty()) {
+        if (p != end)
+          fail("unexpected data after JSON");
+        return;
+      }
+      auto &container = doc.nodes[open.back()];
+      if (container.count == UINT32_MAX)
+        fail("too many elements");
+      container.count++;
+      if (p == end)
+        fail("unexpected end of input");
+      bool is_object = container.type == kind::object;
+      if (*p == ',') {
+        p++;
+        if (is_object)
+          expect_key();
+        expect_value = true;
+      } else if (*p == (is_object ? '}' : ']')) {
+        p++;
+        open.pop_back();
+      } else {
+        fail(is_object ? "expecting ',' or '}'" : "expecting ',' or ']'");
+      }
+    }
+  }
+};
+
+} // namespace
+
+json_document json_document::parse(std::string_view text) {
+  json_document doc;
+  // Most documents hold about one value per 8 bytes of text
+  doc.nodes.reserve(text.size() / 8 + 1);
+  doc.strings.reserve(text.size() / 2);
+  json_parser parser{text.data(), text.data(), text.data() + text.size(),
+                     doc};
+  parser.run();
+  if (parser.lone_surrogate) {
+    doc.nodes.clear();
+    doc.strings.clear();
+    doc.source = text;
+  }
+  return doc;
+}
+
+JSValue js_traits<json_document>::wrap(JSContext *ctx,
+                                       const json_document &doc) {
+  if (!doc.source.empty())
+    return JS_ParseJSON(ctx, doc.source.c_str(), doc.source.size(), "<json>");
+
+  struct frame {
+    bool is_array;
+    uint32_t remaining;
+    // Object being filled, or the start of the elements in values
+    JSValue object;
+    size_t base;
+    JSAtom key;
+  };
+  std::vector<frame> frames;
+  std::vector<JSValue> values;
+  // Objects in API responses tend to repeat the same keys
+  std::unordered_map<std::string_view, JSAtom> atoms;
+  JSValue result = JS_UNDEFINED;
+
+  auto string_of = [&](const json_document::node &n) {
+    return std::string_view(doc.strings.data() + n.offset, n.count);
+  };
+  auto cleanup = [&] {
+    for (auto &f : frames) {
+      if (!f.is_array)
+        JS_FreeValue(ctx, f.object);
+    }
+    for (auto v : values)
+      JS_FreeValue(ctx, v);
+    for (auto &[_, atom] : atoms)
+      JS_FreeAtom(ctx, atom);
+  };
+
+  for (const auto &n : doc.nodes) {
+    if (!frames.empty() && !frames.back().is_array &&
+        frames.back().key == JS_ATOM_NULL) {
+      auto key = string_of(n);
+      auto [it, inserted] = atoms.try_emplace(key, JS_ATOM_NULL);
+      if (inserted)
+        it->second = JS_NewAtomLen(ctx, key.data(), key.size());
+      frames.back().key = it->second;
+      continue;
+    }
+
+    JSValue v;
+    switch (n.type) {
+    case kind::null:
+      v = JS_NULL;
+      break;
+    case kind::false_:
+      v = JS_FALSE;
+      break;
+    case kind::true_:
+      v = JS_TRUE;
+      break;
+    case kind::number:
+      v = JS_NewNumber(ctx, n.number);
+      break;
+    case kind::string: {
+      auto s = string_of(n);
+      v = JS_NewStringLen(ctx, s.data(), s.size());
+      break;
+    }
+    case kind::array:
+      if (n.count) {
+        frames.push_back({true, n.count, JS_UNDEFINED, values.size(),
+                          JS_ATOM_NULL});
+        continue;
+      }
+      v = JS_NewArray(ctx);
+      break;
+    case kind::object:
+      v = JS_NewObject(ctx);
+      if (n.count && !JS_IsException(v)) {
+        frames.push_back({false, n.count, v, 0, JS_ATOM_NULL});
+        continue;
+      }
+      break;
+    }
+
+    // Hand v to its container, closing every container it completes
+    while (true) {
+      if (JS_IsException(v)) {
+        cleanup();
+        return JS_EXCEPTION;
+      }
+      if (frames.empty()) {
+        result = v;
+        break;
+      }
+      auto &f = frames.back();
+      if (f.is_array) {
+        values.push_back(v);
+      } else {
+        JS_DefinePropertyValue(ctx, f.object, f.key, v, JS_PROP_C_W_E);
+        f.key = JS_ATOM_NULL;
+      }
+      if (--f.remaining)
+        break;
+      if (f.is_array) {
+        size_t count = values.size() - f.base;
+        v = JS_NewArrayFrom(ctx, static_cast<int>(count),
+                            values.data() + f.base);
+        values.resize(f.base);
+      } else {
+        v = f.object;
+      }
+      frames.pop_back();
+    }
+  }
+
+  for (auto &[_, atom] : atoms)
+    JS_FreeAtom(ctx, atom);
+  return result;
+}
+
+} // namespace qjs
@@ -1,6 +1,9 @@
 #include "breeze-js/script.h"
 #include "async_simple/coro/Lazy.h"
 #include "binding/binding_types.breezejs.qjs.h"
+#include "binding/std/blocking_pool.h"
+#include "binding/std/http_limiter.h"
+#include "binding/std/watch_hub.h"
 
 #include <algorithm>
 #include <codecvt>
@@ -11,9 +14,9 @@
 #include <sstream>
 #include <string_view>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
-#include "FileWatch.hpp"
 #include "breeze-js/quickjs.h"
 #include "breeze-js/quickjspp.hpp"
 
@@ -21,7 +24,58 @@ namespace breeze {
 
 namespace {
 constexpr std::size_t kJsThreadStackSizeBytes = 4 * 1024 * 1024;
+
+// A module whose file changed is imported as "name?v=N" from then on. The
+// instance it replaces is freed, but not while it is still evaluating, so the
+// new source needs a name of its own.
+constexpr std::string_view kVersionMark = "?v=";
+
+std::string_view unversioned(std::string_view name) {
+  return name.substr(0, name.rfind(kVersionMark));
+}
+
+// JSModuleFilterFunc selecting the modules named in the set opaque points
+// to, under any version
+JS_BOOL is_superseded(JSContext *ctx, JSModuleDef *m, void *opaque) {
+  auto &names = *static_cast<std::unordered_set<std::string> *>(opaque);
+  JSAtom atom = JS_GetModuleName(ctx, m);
+  const char *name = JS_AtomToCString(ctx, atom);
+  JS_FreeAtom(ctx, atom);
+  bool superseded = name && names.contains(std::string(unversioned(name)));
+  JS_FreeCString(ctx, name);
+  return superseded;
 }
+} // namespace
+
+// What watch_folder knows of the scripts it evaluated and the modules they
+// import, recorded as modules are resolved. JS thread only.
+struct script_context::hot_reload {
+  // Canonical
+  std::filesystem::path folder;
+  // Importers of each module by unversioned name, scripts by path
+  std::unordered_map<std::string, std::unordered_set<std::string>> importers;
+  // Module name of each loaded file, by canonical path
+  std::unordered_map<std::string, std::string> modules;
+  // Times each module was loaded anew
+  std::unordered_map<std::string, unsigned> versions;
+  // Module namespace of each evaluated script, for dispose()
+  std::unordered_map<std::string, qjs::Value> exports;
+};
+
+// The watching side of watch_folder: changes the watch hub reports wait here
+// until on_reload accepts them
+struct script_context::folder_watch {
+  std::function<bool()> on_reload;
+  std::vector<uint64_t> watch_ids;
+  // Runs run_watch for start_watch_folder
+  std::thread thread;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  // An empty path for lost events
+  std::vector<std::filesystem::path> changed;
+  bool stopped = false;
+};
 
 std::wstring utf8_to_wstring(const std::string &str) {
   std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
@@ -108,6 +162,24 @@ globalThis.Blob = breeze.Blob;
 globalThis.Headers = breeze.http.Headers;
 globalThis.Response = breeze.http.Response;
 
+const fileHandle = breeze.filesystem.FileHandle.prototype;
+// One buffer for the whole file: each chunk is valid until the next step
+fileHandle.chunks = async function* (size = 65536) {
+  const buf = new Uint8Array(size);
+  for (let n; (n = await this.read(buf, 0, size)) > 0;)
+    yield buf.subarray(0, n);
+};
+fileHandle.lines = async function* (maxLength) {
+  for (let batch; (batch = await this.readLines(maxLength)) !== null;)
+    yield* batch;
+};
+fileHandle[Symbol.asyncIterator] = fileHandle.chunks;
+
+breeze.filesystem.DirWalk.prototype[Symbol.asyncIterator] = async function* () {
+  for (let batch; (batch = await this.next()) !== null;)
+    yield* batch;
+};
+
     )");
 
   for (auto &fn : on_bind) {
@@ -116,6 +188,19 @@ globalThis.Response = breeze.http.Response;
 }
 script_context::script_context() : rt{}, js{} {}
 
+void script_context::set_fetch_limits(const fetch_limits &limits) {
+  js::http_limiter::instance().configure({
+      .max_concurrent = limits.max_concurrent,
+      .max_per_origin = limits.max_per_origin,
+      .coalesce_gets = limits.coalesce_gets,
+      .max_decoded_size = limits.max_decoded_size,
+  });
+}
+
+void script_context::set_blocking_io_threads(size_t threads) {
+  js::blocking_pool::instance().configure(threads);
+}
+
 void script_context::post(std::function<void()> task) {
   task_queue.enqueue(std::move(task));
   task_queue_size.fetch_add(1, std::memory_order_release);
@@ -160,6 +245,13 @@ void script_context::run_event_loop() {
 }
 
 void script_context::reset_runtime() {
+  // Values must not outlive the context they belong to
+  if (js_thread && js_thread->joinable())
+    post_sync([this] {
+      if (reload)
+        reload->exports.clear();
+    });
+
   shutdown_deadline = std::chrono::steady_clock::now();
   task_queue_cv.notify_all();
   if (js_thread && js_thread->joinable())
@@ -179,14 +271,33 @@ void script_context::reset_runtime() {
     js = std::make_shared<qjs::Context>(*rt);
     js->script_ctx = this;
 
+    js->moduleNormalizer = [this](std::string_view base_name,
+                                  std::string_view name) {
+      base_name = unversioned(base_name);
+      auto normalized = qjs::detail::normalizeModuleName(base_name, name);
+      if (!reload)
+        return normalized;
+      reload->importers[normalized].emplace(base_name);
+      if (auto v = reload->versions.find(normalized);
+          v != reload->versions.end())
+        normalized += std::string(kVersionMark) + std::to_string(v->second);
+      return normalized;
+    };
+
     js->moduleLoader = [&](std::string_view module_name) {
-      auto module_path = module_base / (std::string(module_name) + ".js");
+      auto name = unversioned(module_name);
+      auto module_path = module_base / (std::string(name) + ".js");
       if (!std::filesystem::exists(module_path)) {
         return qjs::Context::ModuleData{};
       }
       std::ifstream file(module_path);
       std::string script((std::istreambuf_iterator<char>(file)),
                          std::istreambuf_iterator<char>());
+      if (reload) {
+        std::error_code ec;
+        auto canonical = std::filesystem::weakly_canonical(module_path, ec);
+        reload->modules[canonical.generic_string()] = name;
+      }
       return qjs::Context::ModuleData{script};
     };
 
@@ -219,7 +330,8 @@ script_context::eval_file(const std::filesystem::path &path) {
 
 std::expected<qjs::Value, std::string>
 script_context::eval_string_impl(const std::string &script,
-                                 std::string_view filename) {
+                                 std::string_view filename,
+                                 qjs::Value *exports) {
   try {
     JS_UpdateStackTop(rt->rt);
     auto func = JS_Eval(js->ctx, script.c_str(), script.size(), filename.data(),
@@ -256,6 +368,8 @@ script_context::eval_string_impl(const std::string &script,
                               val["stack"].as<std::string>();
       return std::unexpected(error_msg);
     }
+    if (exports)
+      *exports = qjs::Value{js->ctx, JS_GetModuleNamespace(js->ctx, m)};
     return val;
   } catch (std::exception &e) {
     std::string error_msg =
@@ -276,48 +390,218 @@ script_context::eval_string(const std::string &script,
   });
 }
 
-void script_context::watch_folder(const std::filesystem::path &path,
-                                  std::function<bool()> on_reload) {
-  bool has_update = false;
-
-  auto reload_all = [&]() {
-    reset_runtime();
-
-    std::vector<std::filesystem::path> files;
-    std::ranges::copy(std::filesystem::directory_iterator(path) |
-                          std::ranges::views::filter([](auto &entry) {
-                            return entry.path().extension() == ".js";
-                          }),
-                      std::back_inserter(files));
-
-    for (auto &path : files) {
-      if (auto res = eval_file(path); !res) {
-        std::cerr << "Error evaluating file: " << path.generic_string() << ": "
-                  << res.error() << std::endl;
-      } else {
-      }
+void script_context::dispose_script(const std::filesystem::path &path) {
+  auto name = path.generic_string();
+  auto old = reload->exports.find(name);
+  if (old == reload->exports.end())
+    return;
+  qjs::Value dispose = old->second["dispose"];
+  if (JS_IsFunction(js->ctx, dispose.v)) {
+    qjs::Value res{js->ctx,
+                   JS_Call(js->ctx, dispose.v, old->second.v, 0, nullptr)};
+    if (JS_IsException(res.v)) {
+      auto error_val = js->getException();
+      std::cerr << "Error disposing file: " << name << ": "
+                << error_val.as<std::string>() << std::endl;
     }
+  }
+  reload->exports.erase(old);
+}
+
+void script_context::eval_script(const std::filesystem::path &path) {
+  auto name = path.generic_string();
+  auto script = qjs::detail::readFile(path);
+  if (!script) {
+    std::cerr << "Error opening file: " << name << std::endl;
+    return;
+  }
+  qjs::Value exports{js->ctx, JS_UNDEFINED};
+  if (auto res = eval_string_impl(*script, name, &exports); !res) {
+    std::cerr << "Error evaluating file: " << name << ": " << res.error()
+              << std::endl;
+    return;
+  }
+  reload->exports.insert_or_assign(name, std::move(exports));
+}
+
+void script_context::eval_folder() {
+  std::error_code ec;
+  std::vector<std::filesystem::path> files;
+  std::ranges::copy(std::filesystem::directory_iterator(reload->folder, ec) |
+                        std::ranges::views::filter([](auto &entry) {
+                          return entry.path().extension() == ".js";
+                        }) |
+                        std::ranges::views::transform(
+                            [](auto &entry) { return entry.path(); }),
+                    std::back_inserter(files));
+  if (ec)
+    std::cerr << "Error reading folder: " << reload->folder.generic_string()
+              << ": " << ec.message() << std::endl;
+  std::ranges::sort(files);
+
+  for (auto &path : files)
+    eval_script(path);
+}
+
+bool script_context::reload_scripts(
+    const std::vector<std::filesystem::path> &changed) {
+  auto is_script = [&](const std::filesystem::path &path) {
+    return path.parent_path() == reload->folder && path.extension() == ".js";
   };
 
-  reload_all();
+  // Lost changes and removed scripts take a fresh runtime
+  bool full = std::ranges::any_of(changed, [&](auto &path) {
+    return path.empty() ||
+           (is_script(path) && !std::filesystem::exists(path));
+  });
+  if (full) {
+    reload->importers.clear();
+    reload->modules.clear();
+    reload->versions.clear();
+    return false;
+  }
+
+  std::vector<std::string> pending;
+  for (auto &path : changed) {
+    if (auto m = reload->modules.find(path.generic_string());
+        m != reload->modules.end())
+      pending.push_back(m->second);
+    if (is_script(path))
+      pending.push_back(path.generic_string());
+  }
+
+  // Everything importing a changed module, through any number of modules
+  std::unordered_set<std::string> affected(pending.begin(), pending.end());
+  while (!pending.empty()) {
+    auto name = std::move(pending.back());
+    pending.pop_back();
+    if (auto it = reload->importers.find(name); it != reload->importers.end())
+      for (auto &importer : it->second)
+        if (affected.insert(importer).second)
+          pending.push_back(importer);
+  }
+
+  std::vector<std::filesystem::path> scripts;
+  for (auto &name : affected) {
+    if (is_script(name))
+      scripts.emplace_back(name);
+    else
+      reload->versions[name]++;
+  }
+  if (scripts.empty())
+    return true;
+  std::ranges::sort(scripts);
+
+  for (auto &path : scripts)
+    dispose_script(path);
+  // Nothing else imports the affected modules and scripts, so their old
+  // instances go before the new ones load
+  JS_FreeModules(js->ctx, is_superseded, &affected);
+  for (auto &path : scripts)
+    eval_script(path);
+  return true;
+}
+
+void script_context::apply_changes(
+    const std::vector<std::filesystem::path> &changed) {
+  if (post_sync([&] { return reload_scripts(changed); }))
+    return;
+  reset_runtime();
+  post_sync([this] { eval_folder(); });
+}
+
+std::shared_ptr<script_context::folder_watch>
+script_context::begin_watch(const std::filesystem::path &path,
+                            std::function<bool()> on_reload) {
+  stop_watch();
+  auto next = std::make_shared<hot_reload>();
+  next->folder = std::filesystem::canonical(path);
+  reset_runtime();
+  post_sync([&] {
+    reload = next;
+    eval_folder();
+  });
 
-  filewatch::FileWatch<std::string> watch(
-      path.generic_string(),
-      [&](const std::string &path, const filewatch::Event change_type) {
-        if (!path.ends_with(".js")) {
-          return;
-        }
+  auto w = std::make_shared<folder_watch>();
+  w->on_reload = std::move(on_reload);
+  std::vector<std::filesystem::path> roots{next->folder};
+  if (!module_base.empty()) {
+    std::error_code ec;
+    auto base = std::filesystem::weakly_canonical(module_base, ec);
+    auto rel = base.lexically_relative(next->folder);
+    if (!ec && std::filesystem::is_directory(base) &&
+        (rel.empty() || *rel.begin() == ".."))
+      roots.push_back(base);
+  }
 
-        has_update = true;
-      });
+  auto &hub = js::watch_hub::instance();
+  for (auto &root : roots) {
+    auto listener = [w = w.get(),
+                     root](std::vector<js::watch_hub::event> events) {
+      std::lock_guard lock(w->mutex);
+      for (auto &event : events) {
+        if (event.path.empty())
+          w->changed.emplace_back();
+        else if (event.path.ends_with(".js"))
+          w->changed.push_back((root / event.path).lexically_normal());
+      }
+      w->cv.notify_one();
+      return true;
+    };
+    w->watch_ids.push_back(hub.add(
+        root, {.recursive = true, .debounce = std::chrono::milliseconds(10)},
+        std::move(listener)));
+  }
+  watch = w;
+  return w;
+}
 
+void script_context::run_watch(folder_watch &w) {
+  std::unique_lock lock(w.mutex);
   while (true) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(300));
-    if (has_update && on_reload()) {
-      has_update = false;
-      reload_all();
+    w.cv.wait(lock, [&] { return w.stopped || !w.changed.empty(); });
+    if (w.stopped)
+      return;
+    lock.unlock();
+    bool accepted = w.on_reload();
+    lock.lock();
+    if (!accepted) {
+      w.cv.wait_for(lock, std::chrono::milliseconds(300),
+                    [&] { return w.stopped; });
+      continue;
     }
+    auto changed = std::exchange(w.changed, {});
+    lock.unlock();
+    apply_changes(changed);
+    lock.lock();
+  }
+}
+
+void script_context::stop_watch() {
+  if (!watch)
+    return;
+  for (auto id : watch->watch_ids)
+    js::watch_hub::instance().remove(id);
+  {
+    std::lock_guard lock(watch->mutex);
+    watch->stopped = true;
   }
+  watch->cv.notify_all();
+  if (watch->thread.joinable())
+    watch->thread.join();
+  watch.reset();
+}
+
+void script_context::watch_folder(const std::filesystem::path &path,
+                                  std::function<bool()> on_reload) {
+  auto w = begin_watch(path, std::move(on_reload));
+  run_watch(*w);
+}
+
+void script_context::start_watch_folder(const std::filesystem::path &path,
+                                        std::function<bool()> on_reload) {
+  auto w = begin_watch(path, std::move(on_reload));
+  w->thread = std::thread([this, w = w.get()] { run_watch(*w); });
 }
 
 std::string script_context::current_exception_string() {
@@ -334,6 +618,7 @@ std::string script_context::current_exception_string() {
   return "No exception occurred";
 }
 script_context::~script_context() {
+  stop_watch();
   stop_event_loop_in_time(std::chrono::milliseconds(100));
 }
 void script_context::stop_event_loop_in_time(
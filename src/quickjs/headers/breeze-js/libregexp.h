@@ -54,6 +54,15 @@ int lre_exec(uint8_t **capture,
              const uint8_t *bc_buf, const uint8_t *cbuf, int cindex, int clen,
              int cbuf_type, void *opaque);
 
+/* precomputed fast paths of a regexp, see lre_exec_matcher() */
+typedef struct LREMatcher LREMatcher;
+LREMatcher *lre_matcher_new(const uint8_t *bc_buf, void *opaque);
+void lre_matcher_free(LREMatcher *m);
+size_t lre_matcher_size(const LREMatcher *m);
+int lre_exec_matcher(uint8_t **capture, const uint8_t *bc_buf,
+                     LREMatcher *m, const uint8_t *cbuf, int cindex,
+                     int clen, int cbuf_type, void *opaque);
+
 int lre_parse_escape(const uint8_t **pp, int allow_utf16);
 LRE_BOOL lre_is_space(int c);
 
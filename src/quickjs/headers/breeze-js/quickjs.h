@@ -74,6 +74,7 @@ enum {
     JS_TAG_BIG_INT     = -9,
     JS_TAG_SYMBOL      = -8,
     JS_TAG_STRING      = -7,
+    JS_TAG_STRING_ROPE = -6, /* lazy concatenation, see JS_IsString() */
     JS_TAG_MODULE      = -3, /* used internally */
     JS_TAG_FUNCTION_BYTECODE = -2, /* used internally */
     JS_TAG_OBJECT      = -1,
@@ -597,9 +598,12 @@ static inline JS_BOOL JS_IsUninitialized(JSValue v)
     return JS_VALUE_GET_TAG(v) == JS_TAG_UNINITIALIZED;
 }
 
+/* Also true for JS_TAG_STRING_ROPE: the result of a long concatenation,
+   which JS_ToCString() and JS_ToString() accept like any string. */
 static inline JS_BOOL JS_IsString(JSValue v)
 {
-    return JS_VALUE_GET_TAG(v) == JS_TAG_STRING;
+    return JS_VALUE_GET_TAG(v) == JS_TAG_STRING ||
+        JS_VALUE_GET_TAG(v) == JS_TAG_STRING_ROPE;
 }
 
 static inline JS_BOOL JS_IsSymbol(JSValue v)
@@ -673,6 +677,9 @@ JS_EXTERN JS_BOOL JS_IsConstructor(JSContext* ctx, JSValue val);
 JS_EXTERN JS_BOOL JS_SetConstructorBit(JSContext *ctx, JSValue func_obj, JS_BOOL val);
 
 JS_EXTERN JSValue JS_NewArray(JSContext *ctx);
+JS_EXTERN JSValue JS_NewArrayFrom(JSContext *ctx, int count, const JSValue *values);
+JS_EXTERN JS_BOOL JS_GetFastArray(JSContext *ctx, JSValue obj, JSValue **arrpp,
+                                  uint32_t *countp);
 JS_EXTERN int JS_IsArray(JSContext *ctx, JSValue val);
 
 JS_EXTERN JSValue JS_NewDate(JSContext *ctx, double epoch_ms);
@@ -685,6 +692,16 @@ JS_EXTERN JSValue JS_GetPropertyInt64(JSContext *ctx, JSValue this_obj,
 JS_EXTERN JSValue JS_GetPropertyStr(JSContext *ctx, JSValue this_obj,
                                     const char *prop);
 
+/* Per call site lookup cache for JS_GetPropertyCached(). Zero-initialize
+   before first use. */
+typedef struct JSPropertyCache {
+    const void *shape;
+    uint32_t slot;
+} JSPropertyCache;
+
+JS_EXTERN JSValue JS_GetPropertyCached(JSContext *ctx, JSValue this_obj,
+                                       JSAtom prop, JSPropertyCache *cache);
+
 JS_EXTERN int JS_SetProperty(JSContext *ctx, JSValue this_obj,
                              JSAtom prop, JSValue val);
 JS_EXTERN int JS_SetPropertyUint32(JSContext *ctx, JSValue this_obj,
@@ -856,6 +873,15 @@ JS_EXTERN void JS_SetModuleLoaderFunc(JSRuntime *rt,
 JS_EXTERN JSValue JS_GetImportMeta(JSContext *ctx, JSModuleDef *m);
 JS_EXTERN JSAtom JS_GetModuleName(JSContext *ctx, JSModuleDef *m);
 JS_EXTERN JSValue JS_GetModuleNamespace(JSContext *ctx, JSModuleDef *m);
+typedef JS_BOOL JSModuleFilterFunc(JSContext *ctx, JSModuleDef *m, void *opaque);
+/* Frees the evaluated modules 'filter' selects, such as the instances a
+   module loaded again under a new name replaces. A module imported by one
+   that stays loaded stays too. Functions and values taken from a freed
+   module remain usable; import.meta in them resolves to the module loaded
+   under the same name, if any. 'filter' must not load modules. Returns the
+   number of modules freed. */
+JS_EXTERN int JS_FreeModules(JSContext *ctx, JSModuleFilterFunc *filter,
+                             void *opaque);
 
 /* JS Job support */
 
@@ -2448,12 +2448,1205 @@ static intptr_t lre_exec_backtrack(REExecContext *s, uint8_t **capture,
     }
 }
 
+/* Fast paths for lre_exec().
+
+   A matcher is derived from the bytecode of a non sticky regexp and
+   kept by the caller between executions. It holds:
+
+   - the literal prefix that starts every match, if any. The start
+     positions are found with memchr() instead of trying the regexp at
+     each position of the subject.
+
+   - a DFA for the regexps without back references, lookahead or
+     lookbehind. It is built lazily from an NFA translated from the
+     bytecode, the counted loops being unrolled. One pass over the
+     subject tells whether it contains a match and from which position
+     the leftmost match can start, so that the backtracking
+     interpreter only runs on the subjects that match, from that
+     position.
+*/
+
+/* split_goto_first, any, goto emitted by lre_compile() to iterate
+   over the start positions of non sticky regexps */
+#define LRE_LOOP_LEN 11
+
+#define LRE_PREFIX_MAX      16
+#define LRE_NFA_NODES_MAX   4096
+#define LRE_DFA_CLASSES_MAX 256
+#define LRE_DFA_STATES_MAX  4096
+#define LRE_DFA_TRANS_MAX   (1 << 20) /* size of the transition table */
+#define LRE_DFA_KERNELS_MAX (1 << 20) /* size of the NFA nodes of the states */
+#define LRE_DFA_RESETS_MAX  8
+
+typedef enum {
+    LRE_NODE_EPS,    /* go to 'out', removed once the NFA is built */
+    LRE_NODE_CHAR,   /* consume a char of the set 'set' and go to 'out' */
+    LRE_NODE_SPLIT,  /* go to 'out' and 'out1' */
+    LRE_NODE_ASSERT, /* go to 'out' if the assertion REOP_'op' holds */
+    LRE_NODE_MATCH,
+} LRENodeTypeEnum;
+
+typedef struct {
+    uint8_t type;
+    uint8_t op;
+    uint16_t set;
+    int out;
+    int out1;
+} LRENode;
+
+/* context of a DFA state, only the bits in 'flag_mask' are kept */
+#define LRE_DFA_AT_START  (1 << 0) /* at the start of the subject */
+#define LRE_DFA_PREV_LT   (1 << 1) /* previous char is a line terminator */
+#define LRE_DFA_PREV_WORD (1 << 2) /* previous char is a word char */
+
+/* special transitions */
+#define LRE_DFA_UNKNOWN (-1) /* not computed yet */
+#define LRE_DFA_MATCH   (-2) /* a match ends before the char */
+#define LRE_DFA_FAIL    (-3) /* too many states or out of memory */
+
+typedef struct {
+    uint32_t hash;
+    uint8_t flags;
+    uint8_t is_start; /* only the loop over the start positions is alive */
+    int8_t eoi_match; /* match at the end of the subject, -1 if unknown */
+    uint32_t kernel; /* offset of the NFA nodes in 'kernels' */
+    uint32_t kernel_len;
+} LREDFAState;
+
+struct LREMatcher {
+    void *opaque;
+    int re_flags;
+    BOOL anchored; /* starts with '^' and no multiline flag */
+    BOOL prefix_wide; /* the prefix cannot appear in 8 bit strings */
+    int prefix_len;
+    int prefix_rare; /* index of the prefix char given to memchr() */
+    uint16_t prefix[LRE_PREFIX_MAX];
+
+    /* NFA, node_count = 0 if the DFA is not used */
+    LRENode *nodes;
+    int node_count;
+    int start_node;
+    int flag_mask;
+    /* the chars are partitioned in classes that no char set separates */
+    int class_count;
+    uint8_t class8[256];
+    uint8_t class_flags[LRE_DFA_CLASSES_MAX]; /* LRE_DFA_PREV_x */
+    int interval_count;
+    uint32_t *intervals; /* first char of each interval */
+    uint8_t *interval_class;
+    int set_words;
+    uint32_t *set_bits; /* bitmap of the classes of each char set */
+    size_t nfa_size; /* bytes allocated for the NFA and the classes */
+
+    /* DFA states, built on demand */
+    LREDFAState *states;
+    int state_count;
+    int state_size;
+    int states_max;
+    int32_t *trans; /* class_count entries per state */
+    DynBuf kernels; /* uint16_t NFA nodes of the states */
+    int *hash;
+    int hash_size;
+    int start_states[8];
+    int reset_count;
+
+    /* closure computation */
+    uint32_t *visited;
+    uint32_t visit_gen;
+    int *stack;
+    uint16_t *kernel_buf;
+};
+
+typedef struct {
+    const uint8_t *bc;
+    int bc_len;
+    void *opaque;
+    DynBuf nodes; /* LRENode */
+    int *set_of_pc; /* char set of the instruction at each pc, or -1 */
+    DynBuf sets; /* uint32_t offset in 'points' and number of ranges */
+    DynBuf points; /* uint32_t [start, end) pairs */
+    BOOL has_line_start;
+    BOOL has_line_end;
+    BOOL has_word_boundary;
+} LRENFABuilder;
+
+#define NFA_NODE(b, i) (((LRENode *)(b)->nodes.buf)[i])
+
+static int re_get_op_len(const uint8_t *bc, int pos)
+{
+    int len = reopcode_info[bc[pos]].size;
+    if (bc[pos] == REOP_range)
+        len += get_u16(bc + pos + 1) * 4;
+    else if (bc[pos] == REOP_range32)
+        len += get_u16(bc + pos + 1) * 8;
+    return len;
+}
+
+/* rough frequency of the chars in text: the rarest char of the prefix
+   is the one searched for */
+static int lre_char_rank(uint32_t c)
+{
+    if (c == ' ')
+        return 4;
+    if (c != 0 && c < 128 && strchr("etaoinsrhl", c))
+        return 3;
+    if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+        return 2;
+    return 1;
+}
+
+static void lre_find_literal_prefix(LREMatcher *m, const uint8_t *bc,
+                                    int pos, int bc_len)
+{
+    uint32_t c;
+    int i, n;
+
+    if (m->re_flags & LRE_FLAG_IGNORECASE)
+        return;
+    n = 0;
+    while (pos < bc_len && n < LRE_PREFIX_MAX) {
+        switch(bc[pos]) {
+        case REOP_char8:
+            c = bc[pos + 1];
+            break;
+        case REOP_char16:
+            c = get_u16(bc + pos + 1);
+            /* not a char boundary in UTF-16 */
+            if (is_surrogate(c))
+                goto done;
+            break;
+        case REOP_save_start:
+        case REOP_save_end:
+            pos += 2;
+            continue;
+        default:
+            goto done;
+        }
+        m->prefix[n++] = c;
+        pos += reopcode_info[bc[pos]].size;
+    }
+ done:
+    m->prefix_len = n;
+    for(i = 0; i < n; i++) {
+        if (m->prefix[i] >= 256)
+            m->prefix_wide = TRUE;
+        if (lre_char_rank(m->prefix[i]) < lre_char_rank(m->prefix[m->prefix_rare]))
+            m->prefix_rare = i;
+    }
+}
+
+/* Return the first occurrence of the prefix at or after 'cptr' or NULL */
+static const uint8_t *lre_find_prefix(const LREMatcher *m, const uint8_t *cptr,
+                                      const uint8_t *cbuf_end, int cbuf_type)
+{
+    size_t len, i, n, k;
+    uint32_t c;
+
+    n = m->prefix_len;
+    k = m->prefix_rare;
+    c = m->prefix[k];
+    if (cbuf_type == 0) {
+        const uint8_t *p, *q, *last;
+        if ((size_t)(cbuf_end - cptr) < n)
+            return NULL;
+        /* last possible start of the prefix */
+        last = cbuf_end - n;
+        for(q = cptr; q <= last; q = p + 1) {
+            p = memchr(q + k, c, last - q + 1);
+            if (!p)
+                break;
+            p -= k;
+            for(i = 0; i < n; i++) {
+                if (p[i] != m->prefix[i])
+                    break;
+            }
+            if (i == n)
+                return p;
+        }
+    } else {
+        const uint16_t *p = (const uint16_t *)cptr;
+        len = (const uint16_t *)cbuf_end - p;
+        for(i = 0; i + n <= len; i++) {
+            if (p[i + k] == c) {
+                size_t j;
+                for(j = 0; j < n; j++) {
+                    if (p[i + j] != m->prefix[j])
+                        break;
+                }
+                if (j == n)
+                    return (const uint8_t *)(p + i);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int nfa_new_node(LRENFABuilder *b, int type, int out)
+{
+    LRENode n;
+    int idx;
+
+    idx = b->nodes.size / sizeof(LRENode);
+    if (idx >= LRE_NFA_NODES_MAX)
+        return -1;
+    memset(&n, 0, sizeof(n));
+    n.type = type;
+    n.out = out;
+    n.out1 = -1;
+    if (dbuf_put(&b->nodes, (uint8_t *)&n, sizeof(n)))
+        return -1;
+    return idx;
+}
+
+static int nfa_add_range(LRENFABuilder *b, uint32_t start, uint32_t end)
+{
+    return dbuf_put_u32(&b->points, start) || dbuf_put_u32(&b->points, end);
+}
+
+/* return the index of the set of chars matched by the instruction at
+   'pos' or -1 if error */
+static int nfa_get_set(LRENFABuilder *b, int pos)
+{
+    const uint8_t *bc = b->bc;
+    const uint32_t *points, *sets;
+    uint32_t c, low, high, start, len, i, n, set_count;
+
+    if (b->set_of_pc[pos] >= 0)
+        return b->set_of_pc[pos];
+    start = b->points.size / 4;
+    switch(bc[pos]) {
+    case REOP_char8:
+        c = bc[pos + 1];
+        goto add_char;
+    case REOP_char16:
+        c = get_u16(bc + pos + 1);
+        goto add_char;
+    case REOP_char32:
+        c = get_u32(bc + pos + 1);
+    add_char:
+        if (nfa_add_range(b, c, c + 1))
+            return -1;
+        break;
+    case REOP_dot:
+        if (nfa_add_range(b, 0, '\n') ||
+            nfa_add_range(b, '\n' + 1, '\r') ||
+            nfa_add_range(b, '\r' + 1, CP_LS) ||
+            nfa_add_range(b, CP_PS + 1, 0x110000))
+            return -1;
+        break;
+    case REOP_any:
+        if (nfa_add_range(b, 0, 0x110000))
+            return -1;
+        break;
+    case REOP_range:
+        n = get_u16(bc + pos + 1);
+        for(i = 0; i < n; i++) {
+            low = get_u16(bc + pos + 3 + i * 4);
+            high = get_u16(bc + pos + 3 + i * 4 + 2);
+            /* 0xffff in for last value means +infinity */
+            if (i == n - 1 && high == 0xffff)
+                high = 0x10ffff;
+            if (nfa_add_range(b, low, high + 1))
+                return -1;
+        }
+        break;
+    case REOP_range32:
+        n = get_u16(bc + pos + 1);
+        for(i = 0; i < n; i++) {
+            low = get_u32(bc + pos + 3 + i * 8);
+            high = get_u32(bc + pos + 3 + i * 8 + 4);
+            if (nfa_add_range(b, low, high + 1))
+                return -1;
+        }
+        break;
+    default:
+        abort();
+    }
+    if (dbuf_error(&b->points))
+        return -1;
+    len = (b->points.size / 4 - start) / 2;
+
+    /* share the identical sets */
+    points = (const uint32_t *)b->points.buf;
+    sets = (const uint32_t *)b->sets.buf;
+    set_count = b->sets.size / 8;
+    for(i = 0; i < set_count; i++) {
+        if (sets[2 * i + 1] == len &&
+            !memcmp(points + sets[2 * i], points + start, len * 8)) {
+            b->points.size = start * 4;
+            break;
+        }
+    }
+    if (i == set_count) {
+        if (dbuf_put_u32(&b->sets, start) || dbuf_put_u32(&b->sets, len))
+            return -1;
+    }
+    b->set_of_pc[pos] = i;
+    return i;
+}
+
+/* Return the length of the instruction at 'pos'. The counted loops
+   are returned as a whole, up to their final 'drop'. */
+static int nfa_get_len(LRENFABuilder *b, int pos, int end)
+{
+    const uint8_t *bc = b->bc;
+    int p, depth, len;
+
+    switch(bc[pos]) {
+    case REOP_simple_greedy_quant:
+        len = 17 + get_u32(bc + pos + 1);
+        break;
+    case REOP_push_i32:
+        depth = 0;
+        for(p = pos; p < end; p += re_get_op_len(bc, p)) {
+            if (bc[p] == REOP_push_i32 || bc[p] == REOP_push_char_pos) {
+                depth++;
+            } else if (bc[p] == REOP_drop || bc[p] == REOP_check_advance) {
+                if (--depth == 0)
+                    break;
+            }
+        }
+        if (p >= end || bc[p] != REOP_drop)
+            return -1;
+        len = p + 1 - pos;
+        break;
+    default:
+        len = re_get_op_len(bc, pos);
+        break;
+    }
+    if (len <= 0 || len > end - pos)
+        return -1;
+    return len;
+}
+
+static int nfa_translate(LRENFABuilder *b, int start, int end, int out);
+
+/* 'min' copies of the instructions in [start, end) followed by 'max -
+   min' optional ones, max = INT32_MAX meaning no limit. Return the
+   entry node or -1 if error. */
+static int nfa_repeat(LRENFABuilder *b, int start, int end,
+                      uint32_t min, uint32_t max, int out)
+{
+    int e, split, body;
+    uint32_t i;
+
+    e = out;
+    if (max == INT32_MAX) {
+        split = nfa_new_node(b, LRE_NODE_SPLIT, -1);
+        if (split < 0)
+            return -1;
+        body = nfa_translate(b, start, end, split);
+        if (body < 0)
+            return -1;
+        NFA_NODE(b, split).out = body;
+        NFA_NODE(b, split).out1 = out;
+        e = split;
+    } else {
+        for(i = min; i < max; i++) {
+            split = nfa_new_node(b, LRE_NODE_SPLIT, -1);
+            if (split < 0)
+                return -1;
+            body = nfa_translate(b, start, end, e);
+            if (body < 0)
+                return -1;
+            NFA_NODE(b, split).out = body;
+            NFA_NODE(b, split).out1 = out;
+            e = split;
+        }
+    }
+    for(i = 0; i < min; i++) {
+        e = nfa_translate(b, start, end, e);
+        if (e < 0)
+            return -1;
+    }
+    return e;
+}
+
+/* Translate the instructions in [start, end) to NFA nodes continuing
+   with 'out'. Return the entry node or -1 if error or if an
+   instruction is not supported. */
+static int nfa_translate(LRENFABuilder *b, int start, int end, int out)
+{
+    const uint8_t *bc = b->bc;
+    int *map, pos, len, idx, next, target, ret, e;
+    uint32_t count;
+
+    if (start == end)
+        return out;
+    map = lre_realloc(b->opaque, NULL, sizeof(map[0]) * (end - start + 1));
+    if (!map)
+        return -1;
+    for(pos = start; pos <= end; pos++)
+        map[pos - start] = -1;
+    map[end - start] = out;
+    ret = -1;
+
+    /* a node for each instruction so that the jumps can be resolved */
+    for(pos = start; pos < end; pos += len) {
+        len = nfa_get_len(b, pos, end);
+        if (len < 0)
+            goto done;
+        map[pos - start] = nfa_new_node(b, LRE_NODE_EPS, -1);
+        if (map[pos - start] < 0)
+            goto done;
+    }
+
+    for(pos = start; pos < end; pos += len) {
+        len = nfa_get_len(b, pos, end);
+        idx = map[pos - start];
+        next = map[pos + len - start];
+        switch(bc[pos]) {
+        case REOP_char8:
+        case REOP_char16:
+        case REOP_char32:
+        case REOP_dot:
+        case REOP_any:
+        case REOP_range:
+        case REOP_range32:
+            ret = nfa_get_set(b, pos);
+            if (ret < 0)
+                goto fail;
+            NFA_NODE(b, idx).type = LRE_NODE_CHAR;
+            NFA_NODE(b, idx).set = ret;
+            NFA_NODE(b, idx).out = next;
+            break;
+        case REOP_goto:
+        case REOP_split_goto_first:
+        case REOP_split_next_first:
+            target = pos + len + (int)get_u32(bc + pos + 1);
+            if (target < start || target > end || map[target - start] < 0)
+                goto fail;
+            NFA_NODE(b, idx).out = map[target - start];
+            if (bc[pos] != REOP_goto) {
+                NFA_NODE(b, idx).type = LRE_NODE_SPLIT;
+                NFA_NODE(b, idx).out1 = next;
+            }
+            break;
+        case REOP_save_start:
+        case REOP_save_end:
+        case REOP_save_reset:
+        case REOP_push_char_pos:
+        case REOP_check_advance:
+            /* the captures are only computed by lre_exec_backtrack()
+               and the empty iterations of a loop do not change the
+               set of matching strings */
+            NFA_NODE(b, idx).out = next;
+            break;
+        case REOP_line_start:
+            b->has_line_start = TRUE;
+            goto assertion;
+        case REOP_line_end:
+            b->has_line_end = TRUE;
+            goto assertion;
+        case REOP_word_boundary:
+        case REOP_not_word_boundary:
+            b->has_word_boundary = TRUE;
+        assertion:
+            NFA_NODE(b, idx).type = LRE_NODE_ASSERT;
+            NFA_NODE(b, idx).op = bc[pos];
+            NFA_NODE(b, idx).out = next;
+            break;
+        case REOP_match:
+            NFA_NODE(b, idx).type = LRE_NODE_MATCH;
+            break;
+        case REOP_simple_greedy_quant:
+            /* the atom ends with REOP_match */
+            if (bc[pos + len - 1] != REOP_match)
+                goto fail;
+            e = nfa_repeat(b, pos + 17, pos + len - 1, get_u32(bc + pos + 5),
+                           get_u32(bc + pos + 9), next);
+            goto set_entry;
+        case REOP_push_i32:
+            {
+                int loop = pos + len - 6;
+                count = get_u32(bc + pos + 1);
+                if (bc[loop] != REOP_loop ||
+                    loop + 5 + (int)get_u32(bc + loop + 1) != pos + 5)
+                    goto fail;
+                if ((bc[pos + 5] == REOP_split_goto_first ||
+                     bc[pos + 5] == REOP_split_next_first) &&
+                    pos + 10 + (int)get_u32(bc + pos + 6) == pos + len - 1) {
+                    /* at most 'count' iterations */
+                    e = nfa_repeat(b, pos + 10, loop, 0, count, next);
+                } else {
+                    /* exactly 'count' iterations */
+                    e = nfa_repeat(b, pos + 5, loop, count, count, next);
+                }
+            }
+        set_entry:
+            if (e < 0)
+                goto fail;
+            NFA_NODE(b, idx).out = e;
+            break;
+        default:
+            /* back references, lookahead and lookbehind */
+            goto fail;
+        }
+        if (bc[pos] != REOP_match && next < 0)
+            goto fail;
+    }
+    ret = map[0];
+    goto done;
+ fail:
+    ret = -1;
+ done:
+    lre_realloc(b->opaque, map, 0);
+    return ret;
+}
+
+static int nfa_resolve(const LRENode *nodes, int node_count, int i)
+{
+    int n;
+    for(n = 0; i >= 0 && nodes[i].type == LRE_NODE_EPS; n++) {
+        if (n >= node_count)
+            return -1;
+        i = nodes[i].out;
+    }
+    return i;
+}
+
+static int lre_cmp_u32(const void *a, const void *b, void *opaque)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Split 'cls' so that the intervals inside or outside the set of
+   'len' ranges of 'points' are in different classes. Return the new
+   number of classes or -1 if error. */
+static int lre_refine_classes(LREMatcher *m, int *cls, int class_count,
+                              const uint32_t *points, int len)
+{
+    int *remap, i, j, key, n;
+
+    remap = lre_realloc(m->opaque, NULL, sizeof(remap[0]) * class_count * 2);
+    if (!remap)
+        return -1;
+    for(i = 0; i < class_count * 2; i++)
+        remap[i] = -1;
+    n = 0;
+    j = 0;
+    for(i = 0; i < m->interval_count; i++) {
+        while (j < len && points[2 * j + 1] <= m->intervals[i])
+            j++;
+        key = cls[i] * 2 + (j < len && points[2 * j] <= m->intervals[i]);
+        if (remap[key] < 0)
+            remap[key] = n++;
+        cls[i] = remap[key];
+    }
+    lre_realloc(m->opaque, remap, 0);
+    return n;
+}
+
+static const uint32_t lre_word_points[] = {
+    '0', '9' + 1, 'A', 'Z' + 1, '_', '_' + 1, 'a', 'z' + 1,
+};
+
+static const uint32_t lre_line_terminator_points[] = {
+    '\n', '\n' + 1, '\r', '\r' + 1, CP_LS, CP_PS + 1,
+};
+
+static int lre_build_classes(LREMatcher *m, LRENFABuilder *b)
+{
+    const uint32_t *points = (const uint32_t *)b->points.buf;
+    const uint32_t *sets = (const uint32_t *)b->sets.buf;
+    int set_count = b->sets.size / 8;
+    int point_count = b->points.size / 4;
+    int *cls, i, j, n, k, class_count, ret;
+    uint32_t *bounds, c;
+
+    ret = -1;
+    n = point_count + countof(lre_word_points) +
+        countof(lre_line_terminator_points) + 1;
+    bounds = lre_realloc(m->opaque, NULL, sizeof(bounds[0]) * n);
+    cls = lre_realloc(m->opaque, NULL, sizeof(cls[0]) * n);
+    if (!bounds || !cls)
+        goto done;
+    n = 0;
+    bounds[n++] = 0;
+    for(i = 0; i < point_count; i++)
+        bounds[n++] = points[i];
+    for(i = 0; i < countof(lre_word_points); i++)
+        bounds[n++] = lre_word_points[i];
+    for(i = 0; i < countof(lre_line_terminator_points); i++)
+        bounds[n++] = lre_line_terminator_points[i];
+    rqsort(bounds, n, sizeof(bounds[0]), lre_cmp_u32, NULL);
+    for(i = j = 0; i < n; i++) {
+        if (bounds[i] < 0x110000 && (j == 0 || bounds[i] != bounds[j - 1]))
+            bounds[j++] = bounds[i];
+    }
+    m->intervals = bounds;
+    m->interval_count = j;
+    bounds = NULL;
+    for(i = 0; i < m->interval_count; i++)
+        cls[i] = 0;
+    class_count = 1;
+
+    for(i = 0; i < set_count && class_count > 0; i++) {
+        class_count = lre_refine_classes(m, cls, class_count,
+                                         points + sets[2 * i], sets[2 * i + 1]);
+    }
+    if (class_count > 0 && b->has_word_boundary) {
+        class_count = lre_refine_classes(m, cls, class_count, lre_word_points,
+                                         countof(lre_word_points) / 2);
+    }
+    if (class_count > 0) {
+        /* also needed by the dot and the multiline assertions */
+        class_count = lre_refine_classes(m, cls, class_count,
+                                         lre_line_terminator_points,
+                                         countof(lre_line_terminator_points) / 2);
+    }
+    if (class_count <= 0 || class_count > LRE_DFA_CLASSES_MAX)
+        goto done;
+    m->class_count = class_count;
+
+    m->interval_class = lre_realloc(m->opaque, NULL, m->interval_count);
+    m->set_words = (class_count + 31) / 32;
+    m->set_bits = lre_realloc(m->opaque, NULL, sizeof(m->set_bits[0]) *
+                              m->set_words * max_int(set_count, 1));
+    if (!m->interval_class || !m->set_bits)
+        goto done;
+    m->nfa_size = (sizeof(m->intervals[0]) + 1) * m->interval_count +
+        sizeof(m->set_bits[0]) * m->set_words * max_int(set_count, 1);
+    for(i = 0; i < m->interval_count; i++) {
+        m->interval_class[i] = cls[i];
+        c = m->intervals[i];
+        m->class_flags[cls[i]] = (is_line_terminator(c) ? LRE_DFA_PREV_LT : 0) |
+            (is_word_char(c) ? LRE_DFA_PREV_WORD : 0);
+    }
+    memset(m->set_bits, 0, sizeof(m->set_bits[0]) * m->set_words * set_count);
+    for(k = 0; k < set_count; k++) {
+        const uint32_t *p = points + sets[2 * k];
+        int len = sets[2 * k + 1];
+        uint32_t *bits = m->set_bits + k * m->set_words;
+        for(i = j = 0; i < m->interval_count; i++) {
+            while (j < len && p[2 * j + 1] <= m->intervals[i])
+                j++;
+            if (j < len && p[2 * j] <= m->intervals[i])
+                bits[cls[i] >> 5] |= 1U << (cls[i] & 31);
+        }
+    }
+    ret = 0;
+ done:
+    lre_realloc(m->opaque, bounds, 0);
+    lre_realloc(m->opaque, cls, 0);
+    return ret;
+}
+
+static int lre_find_class(const LREMatcher *m, uint32_t c)
+{
+    int lo, hi, mid;
+
+    /* last interval starting at or before c */
+    lo = 0;
+    hi = m->interval_count - 1;
+    while (lo < hi) {
+        mid = (lo + hi + 1) >> 1;
+        if (m->intervals[mid] <= c)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return m->interval_class[lo];
+}
+
+static inline int lre_dfa_class(const LREMatcher *m, uint32_t c)
+{
+    if (c < 256)
+        return m->class8[c];
+    if (m->re_flags & LRE_FLAG_IGNORECASE)
+        c = lre_canonicalize(c, (m->re_flags & LRE_FLAG_UNICODE) != 0);
+    return lre_find_class(m, c);
+}
+
+static void lre_build_dfa(LREMatcher *m, const uint8_t *bc, int start,
+                          int bc_len)
+{
+    LRENFABuilder b_s, *b = &b_s;
+    LRENode *nodes;
+    int i, entry, node_count;
+    uint32_t c;
+
+    memset(b, 0, sizeof(*b));
+    b->bc = bc;
+    b->bc_len = bc_len;
+    b->opaque = m->opaque;
+    dbuf_init2(&b->nodes, m->opaque, lre_realloc);
+    dbuf_init2(&b->sets, m->opaque, lre_realloc);
+    dbuf_init2(&b->points, m->opaque, lre_realloc);
+    b->set_of_pc = lre_realloc(m->opaque, NULL, sizeof(int) * bc_len);
+    if (!b->set_of_pc)
+        goto done;
+    for(i = 0; i < bc_len; i++)
+        b->set_of_pc[i] = -1;
+
+    entry = nfa_translate(b, start, bc_len, -1);
+    if (entry < 0 || dbuf_error(&b->nodes))
+        goto done;
+    /* the word chars are not closed under case folding */
+    if (b->has_word_boundary && (m->re_flags & LRE_FLAG_IGNORECASE))
+        goto done;
+
+    nodes = (LRENode *)b->nodes.buf;
+    node_count = b->nodes.size / sizeof(LRENode);
+    for(i = 0; i < node_count; i++) {
+        switch(nodes[i].type) {
+        case LRE_NODE_SPLIT:
+            nodes[i].out1 = nfa_resolve(nodes, node_count, nodes[i].out1);
+            if (nodes[i].out1 < 0)
+                goto done;
+            /* fall thru */
+        case LRE_NODE_CHAR:
+        case LRE_NODE_ASSERT:
+            nodes[i].out = nfa_resolve(nodes, node_count, nodes[i].out);
+            if (nodes[i].out < 0)
+                goto done;
+            break;
+        }
+    }
+    m->start_node = nfa_resolve(nodes, node_count, entry);
+    if (m->start_node < 0)
+        goto done;
+
+    if (lre_build_classes(m, b))
+        goto done;
+    for(c = 0; c < 256; c++) {
+        if (m->re_flags & LRE_FLAG_IGNORECASE)
+            m->class8[c] = lre_find_class(m, lre_canonicalize(c, (m->re_flags & LRE_FLAG_UNICODE) != 0));
+        else
+            m->class8[c] = lre_find_class(m, c);
+    }
+
+    if (b->has_line_start) {
+        m->flag_mask |= LRE_DFA_AT_START;
+        if (m->re_flags & LRE_FLAG_MULTILINE)
+            m->flag_mask |= LRE_DFA_PREV_LT;
+    }
+    if (b->has_word_boundary)
+        m->flag_mask |= LRE_DFA_PREV_WORD;
+
+    m->states_max = min_int(LRE_DFA_STATES_MAX,
+                            LRE_DFA_TRANS_MAX / (m->class_count * sizeof(int32_t)));
+    for(m->hash_size = 16; m->hash_size < m->states_max * 2; m->hash_size *= 2)
+        continue;
+    m->visited = lre_realloc(m->opaque, NULL, sizeof(m->visited[0]) * node_count);
+    m->stack = lre_realloc(m->opaque, NULL, sizeof(m->stack[0]) * node_count * 3);
+    m->kernel_buf = lre_realloc(m->opaque, NULL, sizeof(m->kernel_buf[0]) * node_count);
+    if (!m->visited || !m->stack || !m->kernel_buf)
+        goto done;
+    memset(m->visited, 0, sizeof(m->visited[0]) * node_count);
+    m->nodes = nodes;
+    m->node_count = node_count;
+    m->nfa_size += b->nodes.allocated_size +
+        (sizeof(m->visited[0]) + sizeof(m->stack[0]) * 3 +
+         sizeof(m->kernel_buf[0])) * node_count;
+    b->nodes.buf = NULL;
+ done:
+    dbuf_free(&b->nodes);
+    dbuf_free(&b->sets);
+    dbuf_free(&b->points);
+    lre_realloc(m->opaque, b->set_of_pc, 0);
+}
+
+static void lre_dfa_reset(LREMatcher *m)
+{
+    int i;
+
+    m->state_count = 0;
+    m->kernels.size = 0;
+    if (m->hash) {
+        for(i = 0; i < m->hash_size; i++)
+            m->hash[i] = -1;
+    }
+    for(i = 0; i < countof(m->start_states); i++)
+        m->start_states[i] = -1;
+}
+
+/* Return the state of the NFA nodes 'kernel' in the context 'flags',
+   creating it if needed, or LRE_DFA_FAIL. */
+static int lre_dfa_find_state(LREMatcher *m, int flags,
+                              const uint16_t *kernel, int len)
+{
+    LREDFAState *st;
+    uint32_t h;
+    int i, si, idx;
+
+    if (!m->hash) {
+        m->hash = lre_realloc(m->opaque, NULL, sizeof(m->hash[0]) * m->hash_size);
+        if (!m->hash)
+            return LRE_DFA_FAIL;
+        for(i = 0; i < m->hash_size; i++)
+            m->hash[i] = -1;
+    }
+    h = 2166136261u ^ flags;
+    for(i = 0; i < len; i++)
+        h = (h ^ kernel[i]) * 16777619u;
+    idx = h & (m->hash_size - 1);
+    while ((si = m->hash[idx]) >= 0) {
+        st = &m->states[si];
+        if (st->hash == h && st->flags == flags && st->kernel_len == len &&
+            !memcmp(m->kernels.buf + st->kernel, kernel, len * sizeof(kernel[0])))
+            return si;
+        idx = (idx + 1) & (m->hash_size - 1);
+    }
+
+    if (m->state_count >= m->states_max ||
+        m->kernels.size + len * sizeof(kernel[0]) > LRE_DFA_KERNELS_MAX)
+        return LRE_DFA_FAIL;
+    if (m->state_count >= m->state_size) {
+        LREDFAState *new_states;
+        int32_t *new_trans;
+        int new_size = min_int(max_int(16, m->state_size * 3 / 2), m->states_max);
+        new_states = lre_realloc(m->opaque, m->states,
+                                 sizeof(m->states[0]) * new_size);
+        if (!new_states)
+            return LRE_DFA_FAIL;
+        m->states = new_states;
+        new_trans = lre_realloc(m->opaque, m->trans, sizeof(m->trans[0]) *
+                                new_size * m->class_count);
+        if (!new_trans)
+            return LRE_DFA_FAIL;
+        m->trans = new_trans;
+        m->state_size = new_size;
+    }
+    si = m->state_count;
+    st = &m->states[si];
+    st->hash = h;
+    st->flags = flags;
+    st->is_start = !m->anchored && len == 1 && kernel[0] == m->start_node;
+    st->eoi_match = -1;
+    st->kernel = m->kernels.size;
+    st->kernel_len = len;
+    if (dbuf_put(&m->kernels, (const uint8_t *)kernel, len * sizeof(kernel[0])))
+        return LRE_DFA_FAIL;
+    for(i = 0; i < m->class_count; i++)
+        m->trans[si * m->class_count + i] = LRE_DFA_UNKNOWN;
+    m->hash[idx] = si;
+    m->state_count++;
+    return si;
+}
+
+static BOOL lre_dfa_check_assert(const LREMatcher *m, int op, int flags, int k)
+{
+    BOOL v1, v2;
+
+    switch(op) {
+    case REOP_line_start:
+        return (flags & LRE_DFA_AT_START) ||
+            ((m->re_flags & LRE_FLAG_MULTILINE) && (flags & LRE_DFA_PREV_LT));
+    case REOP_line_end:
+        return k < 0 || ((m->re_flags & LRE_FLAG_MULTILINE) &&
+                         (m->class_flags[k] & LRE_DFA_PREV_LT));
+    default:
+        v1 = (flags & LRE_DFA_PREV_WORD) != 0;
+        v2 = k >= 0 && (m->class_flags[k] & LRE_DFA_PREV_WORD);
+        return (v1 ^ v2) == (op == REOP_word_boundary);
+    }
+}
+
+static int lre_cmp_u16(const void *a, const void *b, void *opaque)
+{
+    return *(const uint16_t *)a - *(const uint16_t *)b;
+}
+
+/* Store in 'kernel_buf' the NFA nodes reached from the state 'si' by
+   consuming a char of the class 'k' (k < 0 for the end of the
+   subject). Return their number or -1 if a match ends before that
+   char. */
+static int lre_dfa_closure(LREMatcher *m, int si, int k)
+{
+    const LREDFAState *st = &m->states[si];
+    const uint16_t *kernel = (const uint16_t *)(m->kernels.buf + st->kernel);
+    const LRENode *node;
+    uint32_t gen;
+    int sp, n, i, x;
+
+    gen = ++m->visit_gen;
+    if (gen == 0) {
+        memset(m->visited, 0, sizeof(m->visited[0]) * m->node_count);
+        gen = m->visit_gen = 1;
+    }
+    sp = 0;
+    for(i = st->kernel_len - 1; i >= 0; i--)
+        m->stack[sp++] = kernel[i];
+    n = 0;
+    while (sp > 0) {
+        x = m->stack[--sp];
+        if (m->visited[x] == gen)
+            continue;
+        m->visited[x] = gen;
+        node = &m->nodes[x];
+        switch(node->type) {
+        case LRE_NODE_CHAR:
+            if (k >= 0 && (m->set_bits[node->set * m->set_words + (k >> 5)] >> (k & 31)) & 1)
+                m->kernel_buf[n++] = node->out;
+            break;
+        case LRE_NODE_SPLIT:
+            m->stack[sp++] = node->out1;
+            m->stack[sp++] = node->out;
+            break;
+        case LRE_NODE_ASSERT:
+            if (lre_dfa_check_assert(m, node->op, st->flags, k))
+                m->stack[sp++] = node->out;
+            break;
+        default:
+            return -1;
+        }
+    }
+    rqsort(m->kernel_buf, n, sizeof(m->kernel_buf[0]), lre_cmp_u16, NULL);
+    for(i = x = 0; i < n; i++) {
+        if (x == 0 || m->kernel_buf[i] != m->kernel_buf[x - 1])
+            m->kernel_buf[x++] = m->kernel_buf[i];
+    }
+    return x;
+}
+
+static int lre_dfa_compute(LREMatcher *m, int si, int k)
+{
+    int n, ni;
+
+    n = lre_dfa_closure(m, si, k);
+    if (n < 0) {
+        ni = LRE_DFA_MATCH;
+    } else {
+        ni = lre_dfa_find_state(m, m->class_flags[k] & m->flag_mask,
+                                m->kernel_buf, n);
+        if (ni == LRE_DFA_FAIL)
+            return ni;
+    }
+    m->trans[si * m->class_count + k] = ni;
+    return ni;
+}
+
+static int lre_dfa_start_state(LREMatcher *m, const uint8_t *cbuf,
+                               const uint8_t *cptr, int cbuf_type)
+{
+    uint16_t kernel[1];
+    uint32_t c;
+    int flags, si;
+
+    if (cptr == cbuf) {
+        flags = LRE_DFA_AT_START;
+    } else {
+        PEEK_PREV_CHAR(c, cptr, cbuf, cbuf_type);
+        flags = (is_line_terminator(c) ? LRE_DFA_PREV_LT : 0) |
+            (is_word_char(c) ? LRE_DFA_PREV_WORD : 0);
+    }
+    flags &= m->flag_mask;
+    si = m->start_states[flags];
+    if (si < 0) {
+        kernel[0] = m->start_node;
+        si = lre_dfa_find_state(m, flags, kernel, 1);
+        if (si >= 0)
+            m->start_states[flags] = si;
+    }
+    return si;
+}
+
+/* Return 0 if the subject has no match from 'cptr', 1 if it has one
+   and -1 if the DFA gave up. In case of match, the leftmost one
+   starts at or after *pstart. */
+static int lre_dfa_exec(LREMatcher *m, const uint8_t *cbuf,
+                        const uint8_t *cptr, const uint8_t *cbuf_end,
+                        int cbuf_type, const uint8_t **pstart)
+{
+    const uint8_t *start, *p;
+    const LREDFAState *st;
+    uint32_t c;
+    int si, ni, k;
+
+    si = lre_dfa_start_state(m, cbuf, cptr, cbuf_type);
+    if (si < 0)
+        goto fail;
+    start = cptr;
+    for(;;) {
+        st = &m->states[si];
+        if (st->is_start) {
+            /* no match can start before this position */
+            start = cptr;
+            if (m->prefix_len > 0) {
+                p = lre_find_prefix(m, cptr, cbuf_end, cbuf_type);
+                if (!p)
+                    return 0;
+                if (p != cptr) {
+                    start = cptr = p;
+                    si = lre_dfa_start_state(m, cbuf, cptr, cbuf_type);
+                    if (si < 0)
+                        goto fail;
+                }
+            }
+        } else if (st->kernel_len == 0) {
+            return 0;
+        }
+        if (cptr >= cbuf_end) {
+            if (m->states[si].eoi_match < 0)
+                m->states[si].eoi_match = (lre_dfa_closure(m, si, -1) < 0);
+            if (!m->states[si].eoi_match)
+                return 0;
+            break;
+        }
+        GET_CHAR(c, cptr, cbuf_end, cbuf_type);
+        k = lre_dfa_class(m, c);
+        ni = m->trans[si * m->class_count + k];
+        if (ni < 0) {
+            if (ni == LRE_DFA_UNKNOWN)
+                ni = lre_dfa_compute(m, si, k);
+            if (ni == LRE_DFA_MATCH)
+                break;
+            if (ni == LRE_DFA_FAIL)
+                goto fail;
+        }
+        si = ni;
+    }
+    *pstart = start;
+    return 1;
+ fail:
+    /* the states are rebuilt on the next execution, unless the
+       regexp needs too many of them */
+    lre_dfa_reset(m);
+    if (++m->reset_count >= LRE_DFA_RESETS_MAX) {
+        m->node_count = 0;
+        lre_realloc(m->opaque, m->states, 0);
+        lre_realloc(m->opaque, m->trans, 0);
+        lre_realloc(m->opaque, m->hash, 0);
+        m->states = NULL;
+        m->trans = NULL;
+        m->hash = NULL;
+        m->state_size = 0;
+        dbuf_free(&m->kernels);
+    }
+    return -1;
+}
+
+LREMatcher *lre_matcher_new(const uint8_t *bc_buf, void *opaque)
+{
+    LREMatcher *m;
+    const uint8_t *bc;
+    int bc_len, i;
+
+    m = lre_realloc(opaque, NULL, sizeof(*m));
+    if (!m)
+        return NULL;
+    memset(m, 0, sizeof(*m));
+    m->opaque = opaque;
+    m->re_flags = lre_get_flags(bc_buf);
+    dbuf_init2(&m->kernels, opaque, lre_realloc);
+    for(i = 0; i < countof(m->start_states); i++)
+        m->start_states[i] = -1;
+    if (m->re_flags & LRE_FLAG_STICKY)
+        return m;
+
+    bc = bc_buf + RE_HEADER_LEN;
+    bc_len = get_u32(bc_buf + RE_HEADER_BYTECODE_LEN);
+    /* save_start 0 follows the loop over the start positions */
+    if (bc[LRE_LOOP_LEN + 2] == REOP_line_start &&
+        !(m->re_flags & LRE_FLAG_MULTILINE)) {
+        m->anchored = TRUE;
+        lre_build_dfa(m, bc, LRE_LOOP_LEN, bc_len);
+    } else {
+        lre_find_literal_prefix(m, bc, LRE_LOOP_LEN, bc_len);
+        lre_build_dfa(m, bc, 0, bc_len);
+    }
+    return m;
+}
+
+void lre_matcher_free(LREMatcher *m)
+{
+    void *opaque;
+
+    if (!m)
+        return;
+    opaque = m->opaque;
+    lre_realloc(opaque, m->nodes, 0);
+    lre_realloc(opaque, m->intervals, 0);
+    lre_realloc(opaque, m->interval_class, 0);
+    lre_realloc(opaque, m->set_bits, 0);
+    lre_realloc(opaque, m->states, 0);
+    lre_realloc(opaque, m->trans, 0);
+    lre_realloc(opaque, m->hash, 0);
+    lre_realloc(opaque, m->visited, 0);
+    lre_realloc(opaque, m->stack, 0);
+    lre_realloc(opaque, m->kernel_buf, 0);
+    dbuf_free(&m->kernels);
+    lre_realloc(opaque, m, 0);
+}
+
+/* Return the bytes allocated by the matcher. The DFA states it builds
+   while running make it grow, up to about LRE_DFA_TRANS_MAX +
+   LRE_DFA_KERNELS_MAX. */
+size_t lre_matcher_size(const LREMatcher *m)
+{
+    size_t size;
+
+    size = sizeof(*m) + m->nfa_size + m->kernels.allocated_size +
+        (sizeof(m->states[0]) + sizeof(m->trans[0]) * m->class_count) *
+        m->state_size;
+    if (m->hash)
+        size += sizeof(m->hash[0]) * m->hash_size;
+    return size;
+}
+
+/* lre_exec_backtrack() restricted to the positions where a match can
+   start according to the matcher */
+static intptr_t lre_exec_matcher_backtrack(LREMatcher *m, REExecContext *s,
+                                           uint8_t **capture, StackInt *stack,
+                                           const uint8_t *pc,
+                                           const uint8_t *cptr)
+{
+    const uint8_t *start;
+    intptr_t ret;
+    int i;
+
+    if (m->anchored) {
+        /* '^' only matches at the start of the subject */
+        if (cptr != s->cbuf)
+            return 0;
+        pc += LRE_LOOP_LEN;
+    } else if (m->prefix_wide && s->cbuf_type == 0) {
+        return 0;
+    }
+    if (m->node_count > 0) {
+        ret = lre_dfa_exec(m, s->cbuf, cptr, s->cbuf_end, s->cbuf_type, &start);
+        if (ret == 0)
+            return 0;
+        if (ret > 0)
+            cptr = start;
+    }
+    if (m->anchored || m->prefix_len == 0)
+        return lre_exec_backtrack(s, capture, stack, 0, pc, cptr, FALSE);
+
+    /* run the regexp without the loop at each occurrence of the prefix */
+    pc += LRE_LOOP_LEN;
+    for(;;) {
+        cptr = lre_find_prefix(m, cptr, s->cbuf_end, s->cbuf_type);
+        if (!cptr)
+            return 0;
+        ret = lre_exec_backtrack(s, capture, stack, 0, pc, cptr, FALSE);
+        if (ret != 0)
+            return ret;
+        for(i = 0; i < s->capture_count * 2; i++)
+            capture[i] = NULL;
+        /* the prefix does not start with a surrogate */
+        cptr += 1 << (s->cbuf_type != 0);
+    }
+}
+
 /* Return 1 if match, 0 if not match or -1 if error. cindex is the
    starting position of the match and must be such as 0 <= cindex <=
    clen. */
 int lre_exec(uint8_t **capture,
              const uint8_t *bc_buf, const uint8_t *cbuf, int cindex, int clen,
              int cbuf_type, void *opaque)
+{
+    return lre_exec_matcher(capture, bc_buf, NULL, cbuf, cindex, clen,
+                            cbuf_type, opaque);
+}
+
+/* Same as lre_exec() using the fast paths of 'm' if not NULL. 'm' must
+   have been created from 'bc_buf'. */
+int lre_exec_matcher(uint8_t **capture, const uint8_t *bc_buf,
+                     LREMatcher *m, const uint8_t *cbuf, int cindex,
+                     int clen, int cbuf_type, void *opaque)
 {
     REExecContext s_s, *s = &s_s;
     int re_flags, i, alloca_size, ret;
@@ -2483,8 +3676,14 @@ int lre_exec(uint8_t **capture,
         capture[i] = NULL;
     alloca_size = s->stack_size_max * sizeof(stack_buf[0]);
     stack_buf = alloca(alloca_size);
-    ret = lre_exec_backtrack(s, capture, stack_buf, 0, bc_buf + RE_HEADER_LEN,
-                             cbuf + (cindex << cbuf_type), FALSE);
+    if (m && !(re_flags & LRE_FLAG_STICKY)) {
+        ret = lre_exec_matcher_backtrack(m, s, capture, stack_buf,
+                                         bc_buf + RE_HEADER_LEN,
+                                         cbuf + (cindex << cbuf_type));
+    } else {
+        ret = lre_exec_backtrack(s, capture, stack_buf, 0, bc_buf + RE_HEADER_LEN,
+                                 cbuf + (cindex << cbuf_type), FALSE);
+    }
     lre_realloc(s->opaque, s->state_stack, 0);
     return ret;
 }
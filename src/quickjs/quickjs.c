@@ -38,6 +38,7 @@
 #endif
 #include <time.h>
 #include <fenv.h>
+#include <float.h>
 #include <math.h>
 
 #include "cutils.h"
@@ -46,6 +47,14 @@
 #include "libregexp.h"
 #include "libbf.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define JSON_SCAN_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define JSON_SCAN_NEON
+#endif
+
 #if defined(EMSCRIPTEN) || defined(_MSC_VER)
 #define DIRECT_DISPATCH  0
 #else
@@ -396,6 +405,25 @@ typedef enum {
    enough to call the interrupt callback often. */
 #define JS_INTERRUPT_COUNTER_INIT 10000
 
+#define JS_REGEXP_MATCHER_CACHE_SIZE 32
+/* bytes the matchers of a context may take together. A matcher alone
+   stays under 3 MB, see lre_matcher_size(). */
+#define JS_REGEXP_MATCHERS_SIZE_MAX (4 << 20)
+
+typedef struct JSRegExpMatcherEntry {
+    JSString *bytecode;
+    LREMatcher *matcher; /* NULL until the bytecode is executed twice */
+    size_t size; /* lre_matcher_size() after its last execution */
+} JSRegExpMatcherEntry;
+
+#define JS_PROP_STR_CACHE_BITS 6
+#define JS_PROP_STR_CACHE_SIZE (1 << JS_PROP_STR_CACHE_BITS)
+
+typedef struct JSPropStrCacheEntry {
+    JSAtom atom; /* JS_ATOM_NULL if the entry is unused */
+    JSPropertyCache prop;
+} JSPropStrCacheEntry;
+
 struct JSContext {
     JSGCObjectHeader header; /* must come first */
     JSRuntime *rt;
@@ -443,6 +471,11 @@ struct JSContext {
                              const char *input, size_t input_len,
                              const char *filename, int flags, int scope_idx);
     void *user_opaque;
+    /* fast paths of the recently executed regexps, indexed by bytecode */
+    JSRegExpMatcherEntry regexp_matchers[JS_REGEXP_MATCHER_CACHE_SIZE];
+    size_t regexp_matchers_size; /* sum of their 'size' */
+    /* atoms of the names recently passed to JS_GetPropertyStr() */
+    JSPropStrCacheEntry prop_str_cache[JS_PROP_STR_CACHE_SIZE];
 };
 
 typedef union JSFloat64Union {
@@ -507,6 +540,19 @@ struct JSString {
     } u;
 };
 
+/* Lazy concatenation of two strings (JS_TAG_STRING_ROPE). JS_ConcatString()
+   builds one instead of copying when the result is long, and the characters
+   are only copied into a JSString on first access. The flat string is then
+   kept in 'left' with 'right' set to JS_NULL. */
+typedef struct JSStringRope {
+    JSRefCountHeader header; /* must come first, 32-bit */
+    uint32_t len : 31;
+    uint8_t is_wide_char : 1;
+    uint32_t depth; /* 1 + depth of the deepest child rope */
+    JSValue left; /* JS_TAG_STRING or JS_TAG_STRING_ROPE */
+    JSValue right;
+} JSStringRope;
+
 typedef struct JSClosureVar {
     uint8_t is_local : 1;
     uint8_t is_arg : 1;
@@ -866,6 +912,8 @@ struct JSModuleDef {
     BOOL eval_has_exception : 8;
     JSValue eval_exception;
     JSValue meta_obj; /* for import.meta */
+    /* temp use during JS_FreeModules() */
+    BOOL free_pending : 8;
 };
 
 typedef struct JSJobEntry {
@@ -1123,6 +1171,7 @@ static void js_for_in_iterator_finalizer(JSRuntime *rt, JSValue val);
 static void js_for_in_iterator_mark(JSRuntime *rt, JSValue val,
                                 JS_MarkFunc *mark_func);
 static void js_regexp_finalizer(JSRuntime *rt, JSValue val);
+static void js_regexp_free_matchers(JSContext *ctx);
 static void js_array_buffer_finalizer(JSRuntime *rt, JSValue val);
 static void js_typed_array_finalizer(JSRuntime *rt, JSValue val);
 static void js_typed_array_mark(JSRuntime *rt, JSValue val,
@@ -1164,6 +1213,8 @@ static void js_promise_resolve_function_mark(JSRuntime *rt, JSValue val,
 #define HINT_FORCE_ORDINARY (1 << 4) // don't try Symbol.toPrimitive
 static JSValue JS_ToPrimitiveFree(JSContext *ctx, JSValue val, int hint);
 static JSValue JS_ToStringFree(JSContext *ctx, JSValue val);
+static JSValue js_string_flat(JSContext *ctx, JSValueConst val);
+static JSValue js_string_flat_free(JSContext *ctx, JSValue val);
 static int JS_ToBoolFree(JSContext *ctx, JSValue val);
 static int JS_ToInt32Free(JSContext *ctx, int32_t *pres, JSValue val);
 static int JS_ToFloat64Free(JSContext *ctx, double *pres, JSValue val);
@@ -2505,6 +2556,11 @@ void JS_FreeContext(JSContext *ctx)
     JS_FreeValue(ctx, ctx->promise_ctor);
     JS_FreeValue(ctx, ctx->array_ctor);
     JS_FreeValue(ctx, ctx->regexp_ctor);
+    js_regexp_free_matchers(ctx);
+    for(i = 0; i < JS_PROP_STR_CACHE_SIZE; i++) {
+        if (ctx->prop_str_cache[i].atom != JS_ATOM_NULL)
+            JS_FreeAtom(ctx, ctx->prop_str_cache[i].atom);
+    }
     JS_FreeValue(ctx, ctx->function_ctor);
     JS_FreeValue(ctx, ctx->function_proto);
 
@@ -4144,10 +4200,13 @@ const char *JS_ToCStringLen2(JSContext *ctx, size_t *plen, JSValue val1, BOOL ce
         goto fail;
 
     val = JS_GetProperty(ctx, val1, JS_ATOM_message);
-    if (JS_VALUE_GET_TAG(val) != JS_TAG_STRING) {
+    if (!JS_IsString(val)) {
         JS_FreeValue(ctx, val);
         goto fail;
     }
+    val = js_string_flat_free(ctx, val);
+    if (JS_IsException(val))
+        goto fail;
 
 go:
     str = JS_VALUE_GET_STRING(val);
@@ -4331,50 +4390,358 @@ static JSValue JS_ConcatString1(JSContext *ctx,
     return JS_MKPTR(JS_TAG_STRING, p);
 }
 
+/* Ropes */
+
+/* Shorter concatenations are copied, longer ones build a rope */
+#define JS_ROPE_MIN_LEN 256
+/* Size up to which '+=' keeps appending to the last leaf of a rope */
+#define JS_ROPE_LEAF_MAX 8192
+
+static inline BOOL tag_is_string(uint32_t tag)
+{
+    return tag == JS_TAG_STRING || tag == JS_TAG_STRING_ROPE;
+}
+
+static inline BOOL js_rope_is_flat(const JSStringRope *r)
+{
+    return JS_VALUE_GET_TAG(r->right) == JS_TAG_NULL;
+}
+
+/* 'v' must be a string or a rope */
+static inline uint32_t js_string_value_len(JSValueConst v)
+{
+    if (JS_VALUE_GET_TAG(v) == JS_TAG_STRING)
+        return JS_VALUE_GET_STRING(v)->len;
+    return ((JSStringRope *)JS_VALUE_GET_PTR(v))->len;
+}
+
+static inline int js_string_value_is_wide(JSValueConst v)
+{
+    if (JS_VALUE_GET_TAG(v) == JS_TAG_STRING)
+        return JS_VALUE_GET_STRING(v)->is_wide_char;
+    return ((JSStringRope *)JS_VALUE_GET_PTR(v))->is_wide_char;
+}
+
+static inline uint32_t js_string_value_depth(JSValueConst v)
+{
+    JSStringRope *r;
+
+    if (JS_VALUE_GET_TAG(v) != JS_TAG_STRING_ROPE)
+        return 0;
+    r = JS_VALUE_GET_PTR(v);
+    return js_rope_is_flat(r) ? 0 : r->depth;
+}
+
+/* Free a rope whose reference count dropped to zero. Child ropes dying
+   with it are rotated into a right leaning chain, so neither the C stack
+   nor the heap grows with the depth of the tree. */
+static void js_free_rope(JSRuntime *rt, JSStringRope *r)
+{
+    JSStringRope *l;
+    JSValue v;
+
+    for(;;) {
+        v = r->left;
+        if (JS_VALUE_GET_TAG(v) == JS_TAG_STRING_ROPE) {
+            l = JS_VALUE_GET_PTR(v);
+            if (l->header.ref_count == 1) {
+                r->left = l->right;
+                r->header.ref_count = 1;
+                l->right = JS_MKPTR(JS_TAG_STRING_ROPE, r);
+                l->header.ref_count = 0;
+                r = l;
+                continue;
+            }
+        }
+        JS_FreeValueRT(rt, v);
+        v = r->right;
+        js_free_rt(rt, r);
+        if (JS_VALUE_GET_TAG(v) == JS_TAG_STRING_ROPE) {
+            l = JS_VALUE_GET_PTR(v);
+            if (l->header.ref_count == 1) {
+                l->header.ref_count = 0;
+                r = l;
+                continue;
+            }
+        }
+        JS_FreeValueRT(rt, v);
+        break;
+    }
+}
+
+/* Return the characters of 'r' as a flat string, copying them on first
+   use. The string is owned by the rope. Return NULL on exception. */
+static JSString *js_rope_flatten(JSContext *ctx, JSStringRope *r)
+{
+    JSValue stack_buf[32], *stack, v;
+    JSStringRope *n;
+    JSString *p, *s;
+    uint32_t pos, sp;
+
+    if (js_rope_is_flat(r))
+        return JS_VALUE_GET_STRING(r->left);
+    p = js_alloc_string(ctx, r->len, r->is_wide_char);
+    if (!p)
+        return NULL;
+    /* right children still to copy, at most one per level */
+    stack = stack_buf;
+    if (r->depth > countof(stack_buf)) {
+        stack = js_malloc(ctx, sizeof(stack[0]) * r->depth);
+        if (!stack) {
+            js_free_string(ctx->rt, p);
+            return NULL;
+        }
+    }
+    sp = 0;
+    pos = 0;
+    v = JS_MKPTR(JS_TAG_STRING_ROPE, r);
+    for(;;) {
+        if (JS_VALUE_GET_TAG(v) == JS_TAG_STRING_ROPE) {
+            n = JS_VALUE_GET_PTR(v);
+            v = n->left;
+            if (!js_rope_is_flat(n)) {
+                stack[sp++] = n->right;
+                continue;
+            }
+        }
+        s = JS_VALUE_GET_STRING(v);
+        if (p->is_wide_char)
+            copy_str16(p->u.str16 + pos, s, 0, s->len);
+        else
+            memcpy(p->u.str8 + pos, s->u.str8, s->len);
+        pos += s->len;
+        if (sp == 0)
+            break;
+        v = stack[--sp];
+    }
+    assert(pos == r->len);
+    if (!p->is_wide_char)
+        p->u.str8[pos] = '\0';
+    if (stack != stack_buf)
+        js_free(ctx, stack);
+    JS_FreeValue(ctx, r->left);
+    JS_FreeValue(ctx, r->right);
+    r->left = JS_MKPTR(JS_TAG_STRING, p);
+    r->right = JS_NULL;
+    return p;
+}
+
+/* Return 'val' as a JS_TAG_STRING value owned by 'val', flattening it if
+   it is a rope. Return JS_EXCEPTION on exception. */
+static JSValue js_string_flat(JSContext *ctx, JSValueConst val)
+{
+    JSString *p;
+
+    if (JS_VALUE_GET_TAG(val) != JS_TAG_STRING_ROPE)
+        return val;
+    p = js_rope_flatten(ctx, JS_VALUE_GET_PTR(val));
+    if (!p)
+        return JS_EXCEPTION;
+    return JS_MKPTR(JS_TAG_STRING, p);
+}
+
+/* same as js_string_flat() but 'val' is freed and the result is owned by
+   the caller */
+static JSValue js_string_flat_free(JSContext *ctx, JSValue val)
+{
+    JSValue ret;
+
+    if (JS_VALUE_GET_TAG(val) != JS_TAG_STRING_ROPE)
+        return val;
+    ret = js_string_flat(ctx, val);
+    if (!JS_IsException(ret))
+        ret = js_dup(ret);
+    JS_FreeValue(ctx, val);
+    return ret;
+}
+
+/* Append the characters of p2 to p1 in the unused space at the end of
+   its allocation. p1 must not be shared. */
+static BOOL js_string_append_chars(JSContext *ctx, JSString *p1,
+                                   const JSString *p2)
+{
+    if (p1->is_wide_char != p2->is_wide_char
+    ||  js_malloc_usable_size(ctx, p1) < sizeof(*p1) + ((p1->len + p2->len) << p2->is_wide_char) + 1 - p1->is_wide_char)
+        return FALSE;
+    if (p1->is_wide_char) {
+        memcpy(p1->u.str16 + p1->len, p2->u.str16, p2->len << 1);
+        p1->len += p2->len;
+    } else {
+        memcpy(p1->u.str8 + p1->len, p2->u.str8, p2->len);
+        p1->len += p2->len;
+        p1->u.str8[p1->len] = '\0';
+    }
+    return TRUE;
+}
+
+/* Append 'op2' to 'op1' by mutating 'op1', which is only possible when
+   nothing else references it. A rope appends to its last leaf, which is
+   given room to grow so that '+=' in a loop costs amortized O(1) per
+   character. Nothing is modified and no exception is raised when FALSE is
+   returned. */
+static BOOL js_string_append_in_place(JSContext *ctx, JSValueConst op1,
+                                      JSValueConst op2)
+{
+    JSStringRope *r;
+    JSString *p1, *p2, *leaf;
+    uint32_t len;
+    int cap;
+
+    if (JS_VALUE_GET_TAG(op2) != JS_TAG_STRING)
+        return FALSE;
+    p2 = JS_VALUE_GET_STRING(op2);
+    if (JS_VALUE_GET_TAG(op1) == JS_TAG_STRING) {
+        p1 = JS_VALUE_GET_STRING(op1);
+        if (p1->header.ref_count != 1 || p1->atom_type)
+            return FALSE;
+        return js_string_append_chars(ctx, p1, p2);
+    }
+    if (JS_VALUE_GET_TAG(op1) != JS_TAG_STRING_ROPE)
+        return FALSE;
+    r = JS_VALUE_GET_PTR(op1);
+    if (r->header.ref_count != 1 || js_rope_is_flat(r)
+    ||  JS_VALUE_GET_TAG(r->right) != JS_TAG_STRING
+    ||  r->len + p2->len > JS_STRING_LEN_MAX)
+        return FALSE;
+    p1 = JS_VALUE_GET_STRING(r->right);
+    len = p1->len + p2->len;
+    if (len > JS_ROPE_LEAF_MAX)
+        return FALSE;
+    if (p1->header.ref_count != 1 || p1->atom_type ||
+        !js_string_append_chars(ctx, p1, p2)) {
+        cap = min_int(max_int(len * 2, 64), JS_ROPE_LEAF_MAX);
+        leaf = js_alloc_string_rt(ctx->rt, cap,
+                                  p1->is_wide_char | p2->is_wide_char);
+        if (!leaf)
+            return FALSE;
+        leaf->len = len;
+        if (leaf->is_wide_char) {
+            copy_str16(leaf->u.str16, p1, 0, p1->len);
+            copy_str16(leaf->u.str16 + p1->len, p2, 0, p2->len);
+        } else {
+            memcpy(leaf->u.str8, p1->u.str8, p1->len);
+            memcpy(leaf->u.str8 + p1->len, p2->u.str8, p2->len);
+            leaf->u.str8[len] = '\0';
+        }
+        js_free_string(ctx->rt, p1);
+        r->right = JS_MKPTR(JS_TAG_STRING, leaf);
+    }
+    r->len += p2->len;
+    r->is_wide_char |= p2->is_wide_char;
+    return TRUE;
+}
+
+/* Concatenate 'op1' and 'op2' (strings or unflattened ropes) without
+   copying them. Short pieces are merged with the neighbouring leaf, so a
+   loop of small appends or prepends adds a level to the tree every
+   JS_ROPE_MIN_LEN characters rather than at every iteration. Both
+   operands are freed. */
+static JSValue js_new_rope(JSContext *ctx, JSValue op1, JSValue op2)
+{
+    JSStringRope *r, *r1;
+    JSValue left, right;
+
+    left = op1;
+    right = op2;
+    if (JS_VALUE_GET_TAG(op1) == JS_TAG_STRING_ROPE &&
+        JS_VALUE_GET_TAG(op2) == JS_TAG_STRING) {
+        r1 = JS_VALUE_GET_PTR(op1);
+        if (JS_VALUE_GET_TAG(r1->right) == JS_TAG_STRING &&
+            js_string_value_len(r1->right) + js_string_value_len(op2) < JS_ROPE_MIN_LEN) {
+            right = JS_ConcatString1(ctx, JS_VALUE_GET_STRING(r1->right),
+                                     JS_VALUE_GET_STRING(op2));
+            if (JS_IsException(right))
+                goto fail;
+            left = js_dup(r1->left);
+            JS_FreeValue(ctx, op1);
+            JS_FreeValue(ctx, op2);
+        }
+    } else if (JS_VALUE_GET_TAG(op1) == JS_TAG_STRING &&
+               JS_VALUE_GET_TAG(op2) == JS_TAG_STRING_ROPE) {
+        r1 = JS_VALUE_GET_PTR(op2);
+        if (JS_VALUE_GET_TAG(r1->left) == JS_TAG_STRING &&
+            js_string_value_len(op1) + js_string_value_len(r1->left) < JS_ROPE_MIN_LEN) {
+            left = JS_ConcatString1(ctx, JS_VALUE_GET_STRING(op1),
+                                    JS_VALUE_GET_STRING(r1->left));
+            if (JS_IsException(left))
+                goto fail;
+            right = js_dup(r1->right);
+            JS_FreeValue(ctx, op1);
+            JS_FreeValue(ctx, op2);
+        }
+    }
+    r = js_malloc(ctx, sizeof(*r));
+    if (!r) {
+        JS_FreeValue(ctx, left);
+        JS_FreeValue(ctx, right);
+        return JS_EXCEPTION;
+    }
+    r->header.ref_count = 1;
+    r->len = js_string_value_len(left) + js_string_value_len(right);
+    r->is_wide_char = js_string_value_is_wide(left) |
+        js_string_value_is_wide(right);
+    r->depth = max_uint32(js_string_value_depth(left),
+                          js_string_value_depth(right)) + 1;
+    r->left = left;
+    r->right = right;
+    return JS_MKPTR(JS_TAG_STRING_ROPE, r);
+ fail:
+    JS_FreeValue(ctx, op1);
+    JS_FreeValue(ctx, op2);
+    return JS_EXCEPTION;
+}
+
 /* op1 and op2 are converted to strings. For convience, op1 or op2 =
    JS_EXCEPTION are accepted and return JS_EXCEPTION.  */
 static JSValue JS_ConcatString(JSContext *ctx, JSValue op1, JSValue op2)
 {
     JSValue ret;
-    JSString *p1, *p2;
+    uint32_t len1, len2;
 
-    if (unlikely(JS_VALUE_GET_TAG(op1) != JS_TAG_STRING)) {
+    if (unlikely(!tag_is_string(JS_VALUE_GET_TAG(op1)))) {
         op1 = JS_ToStringFree(ctx, op1);
         if (JS_IsException(op1)) {
             JS_FreeValue(ctx, op2);
             return JS_EXCEPTION;
         }
     }
-    if (unlikely(JS_VALUE_GET_TAG(op2) != JS_TAG_STRING)) {
+    if (unlikely(!tag_is_string(JS_VALUE_GET_TAG(op2)))) {
         op2 = JS_ToStringFree(ctx, op2);
         if (JS_IsException(op2)) {
             JS_FreeValue(ctx, op1);
             return JS_EXCEPTION;
         }
     }
-    p1 = JS_VALUE_GET_STRING(op1);
-    p2 = JS_VALUE_GET_STRING(op2);
+    /* flattened ropes are used through their flat string */
+    if (JS_VALUE_GET_TAG(op1) == JS_TAG_STRING_ROPE &&
+        js_rope_is_flat(JS_VALUE_GET_PTR(op1)))
+        op1 = js_string_flat_free(ctx, op1);
+    if (JS_VALUE_GET_TAG(op2) == JS_TAG_STRING_ROPE &&
+        js_rope_is_flat(JS_VALUE_GET_PTR(op2)))
+        op2 = js_string_flat_free(ctx, op2);
 
-    /* XXX: could also check if p1 is empty */
-    if (p2->len == 0) {
+    len1 = js_string_value_len(op1);
+    len2 = js_string_value_len(op2);
+    if (len2 == 0)
         goto ret_op1;
+    if (len1 == 0) {
+        JS_FreeValue(ctx, op1);
+        return op2;
     }
-    if (p1->header.ref_count == 1 && p1->is_wide_char == p2->is_wide_char
-    &&  js_malloc_usable_size(ctx, p1) >= sizeof(*p1) + ((p1->len + p2->len) << p2->is_wide_char) + 1 - p1->is_wide_char) {
-        /* Concatenate in place in available space at the end of p1 */
-        if (p1->is_wide_char) {
-            memcpy(p1->u.str16 + p1->len, p2->u.str16, p2->len << 1);
-            p1->len += p2->len;
-        } else {
-            memcpy(p1->u.str8 + p1->len, p2->u.str8, p2->len);
-            p1->len += p2->len;
-            p1->u.str8[p1->len] = '\0';
-        }
+    if (len1 + len2 > JS_STRING_LEN_MAX) {
+        JS_FreeValue(ctx, op1);
+        JS_FreeValue(ctx, op2);
+        return JS_ThrowRangeError(ctx, "invalid string length");
+    }
+    if (js_string_append_in_place(ctx, op1, op2)) {
     ret_op1:
         JS_FreeValue(ctx, op2);
         return op1;
     }
-    ret = JS_ConcatString1(ctx, p1, p2);
+    if (len1 + len2 >= JS_ROPE_MIN_LEN)
+        return js_new_rope(ctx, op1, op2);
+    ret = JS_ConcatString1(ctx, JS_VALUE_GET_STRING(op1),
+                           JS_VALUE_GET_STRING(op2));
     JS_FreeValue(ctx, op1);
     JS_FreeValue(ctx, op2);
     return ret;
@@ -5654,6 +6021,9 @@ static void js_free_value_rt(JSRuntime *rt, JSValue v)
             }
         }
         break;
+    case JS_TAG_STRING_ROPE:
+        js_free_rope(rt, JS_VALUE_GET_PTR(v));
+        break;
     case JS_TAG_OBJECT:
     case JS_TAG_FUNCTION_BYTECODE:
         {
@@ -6007,6 +6377,59 @@ static void compute_jsstring_size(JSString *str, JSMemoryUsage_helper *hp)
     }
 }
 
+/* Count the nodes of a rope and the strings they reference, shared parts
+   in proportion to their reference counts. Right children still to visit
+   go on a local stack: past its size a subtree is counted by its
+   characters alone, as ropes may be millions of levels deep. */
+static void compute_rope_size(JSStringRope *r, JSMemoryUsage_helper *hp)
+{
+    struct {
+        JSValue v;
+        double share;
+    } stack[32];
+    JSValue v;
+    JSString *str;
+    double share;
+    int sp;
+
+    sp = 0;
+    share = 1;
+    v = JS_MKPTR(JS_TAG_STRING_ROPE, r);
+    for(;;) {
+        if (JS_VALUE_GET_TAG(v) == JS_TAG_STRING_ROPE) {
+            r = JS_VALUE_GET_PTR(v);
+            share /= r->header.ref_count;
+            hp->str_count += share;
+            hp->str_size += sizeof(*r) * share;
+            v = r->left;
+            if (!js_rope_is_flat(r)) {
+                if (sp < countof(stack)) {
+                    stack[sp].v = r->right;
+                    stack[sp].share = share;
+                    sp++;
+                } else {
+                    hp->str_size += ((double)js_string_value_len(r->right) *
+                                     (1 + js_string_value_is_wide(r->right)) *
+                                     share);
+                }
+            }
+            continue;
+        }
+        str = JS_VALUE_GET_STRING(v);
+        if (!str->atom_type) {
+            double s_share = share / str->header.ref_count;
+            hp->str_count += s_share;
+            hp->str_size += ((sizeof(*str) + (str->len << str->is_wide_char) +
+                              1 - str->is_wide_char) * s_share);
+        }
+        if (sp == 0)
+            break;
+        sp--;
+        v = stack[sp].v;
+        share = stack[sp].share;
+    }
+}
+
 static void compute_bytecode_size(JSFunctionBytecode *b, JSMemoryUsage_helper *hp)
 {
     int memory_used_count, js_func_size, i;
@@ -6047,6 +6470,9 @@ static void compute_value_size(JSValue val, JSMemoryUsage_helper *hp)
     case JS_TAG_STRING:
         compute_jsstring_size(JS_VALUE_GET_STRING(val), hp);
         break;
+    case JS_TAG_STRING_ROPE:
+        compute_rope_size(JS_VALUE_GET_PTR(val), hp);
+        break;
     case JS_TAG_BIG_INT:
         /* should track JSBigInt usage */
         break;
@@ -6610,7 +7036,7 @@ static const char *get_func_name(JSContext *ctx, JSValue func)
     if ((prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL)
         return NULL;
     val = pr->u.value;
-    if (JS_VALUE_GET_TAG(val) != JS_TAG_STRING)
+    if (!JS_IsString(val))
         return NULL;
     return JS_ToCString(ctx, val);
 }
@@ -7165,6 +7591,7 @@ static JSValue JS_GetPrototypePrimitive(JSContext *ctx, JSValue val)
         val = ctx->class_proto[JS_CLASS_BOOLEAN];
         break;
     case JS_TAG_STRING:
+    case JS_TAG_STRING_ROPE:
         val = ctx->class_proto[JS_CLASS_STRING];
         break;
     case JS_TAG_SYMBOL:
@@ -7370,6 +7797,16 @@ static JSValue JS_GetPropertyInternal2(JSContext *ctx, JSValue obj,
             return JS_ThrowTypeErrorAtom(ctx, "cannot read property '%s' of undefined", prop);
         case JS_TAG_EXCEPTION:
             return JS_EXCEPTION;
+        case JS_TAG_STRING_ROPE:
+            /* only indexing needs the characters */
+            if (prop == JS_ATOM_length)
+                return js_int32(js_string_value_len(obj));
+            if (!__JS_AtomIsTaggedInt(prop))
+                break;
+            obj = js_string_flat(ctx, obj);
+            if (JS_IsException(obj))
+                return JS_EXCEPTION;
+            /* fall through */
         case JS_TAG_STRING:
             {
                 JSString *p1 = JS_VALUE_GET_STRING(obj);
@@ -8325,15 +8762,77 @@ JSValue JS_GetPropertyInt64(JSContext *ctx, JSValue obj, int64_t idx)
 }
 
 /* `prop` may be pure ASCII or UTF-8 encoded */
+/* The names passed to JS_GetPropertyStr() are mostly string literals, such
+   as the fields read by the generated binding unwrappers. Their atoms are
+   kept in a cache indexed by the name address, each with the
+   JS_GetPropertyCached() cache of its call site. An address may be reused
+   for another name, so a hit is confirmed against the atom string. */
 JSValue JS_GetPropertyStr(JSContext *ctx, JSValue this_obj,
                           const char *prop)
 {
+    JSPropStrCacheEntry *e;
+    JSAtomStruct *p;
     JSAtom atom;
     JSValue ret;
-    atom = JS_NewAtom(ctx, prop);
-    ret = JS_GetProperty(ctx, this_obj, atom);
-    JS_FreeAtom(ctx, atom);
-    return ret;
+    uint32_t h;
+    size_t len;
+
+    /* the entry is picked by the contents of the name, and a hit is
+       confirmed against the atom string, as JS_NewAtomLen() finds it */
+    h = 0;
+    for(len = 0; prop[len] != '\0'; len++)
+        h = h * 263 + (uint8_t)prop[len];
+    e = &ctx->prop_str_cache[(h * 0x9E3779B1u) >>
+                             (32 - JS_PROP_STR_CACHE_BITS)];
+    if (e->atom != JS_ATOM_NULL) {
+        p = ctx->rt->atom_array[e->atom];
+        if (!p->is_wide_char && p->len == len &&
+            !memcmp(p->u.str8, prop, len))
+            return JS_GetPropertyCached(ctx, this_obj, e->atom, &e->prop);
+    }
+    atom = JS_NewAtomLen(ctx, prop, len);
+    if (atom == JS_ATOM_NULL || __JS_AtomIsTaggedInt(atom)) {
+        ret = JS_GetProperty(ctx, this_obj, atom);
+        JS_FreeAtom(ctx, atom);
+        return ret;
+    }
+    if (e->atom != JS_ATOM_NULL)
+        JS_FreeAtom(ctx, e->atom);
+    e->atom = atom;
+    memset(&e->prop, 0, sizeof(e->prop));
+    return JS_GetPropertyCached(ctx, this_obj, atom, &e->prop);
+}
+
+/* Same as JS_GetProperty() but remembers the shape and slot of the own
+   data property found in 'this_obj' so that the next lookup on an object
+   with the same shape reads the slot directly. The cache holds no reference
+   to the shape: a hit is confirmed by checking the slot atom and flags, so
+   a recycled shape address can only cause a miss. */
+JSValue JS_GetPropertyCached(JSContext *ctx, JSValue this_obj, JSAtom prop,
+                             JSPropertyCache *cache)
+{
+    JSObject *p;
+    JSShape *sh;
+    JSShapeProperty *prs;
+    JSProperty *pr;
+
+    if (unlikely(JS_VALUE_GET_TAG(this_obj) != JS_TAG_OBJECT))
+        goto slow_path;
+    p = JS_VALUE_GET_OBJ(this_obj);
+    sh = p->shape;
+    if (likely(cache->shape == sh && cache->slot < sh->prop_count)) {
+        prs = &get_shape_prop(sh)[cache->slot];
+        if (likely(prs->atom == prop && !(prs->flags & JS_PROP_TMASK)))
+            return js_dup(p->prop[cache->slot].u.value);
+    }
+    prs = find_own_property(&pr, p, prop);
+    if (prs && !(prs->flags & JS_PROP_TMASK)) {
+        cache->shape = sh;
+        cache->slot = prs - get_shape_prop(sh);
+        return js_dup(pr->u.value);
+    }
+slow_path:
+    return JS_GetProperty(ctx, this_obj, prop);
 }
 
 /* Note: the property value is not initialized. Return NULL if memory
@@ -8666,6 +9165,42 @@ static int add_fast_array_element(JSContext *ctx, JSObject *p,
     return TRUE;
 }
 
+/* Create an Array holding 'count' values in a single allocation. The
+   values are moved into the array, also when an exception is raised. */
+JSValue JS_NewArrayFrom(JSContext *ctx, int count, const JSValue *values)
+{
+    JSValue obj;
+    JSObject *p;
+    int i;
+
+    obj = JS_NewArray(ctx);
+    if (JS_IsException(obj))
+        goto fail;
+    if (count > 0) {
+        p = JS_VALUE_GET_OBJ(obj);
+        if (expand_fast_array(ctx, p, count)) {
+            JS_FreeValue(ctx, obj);
+            goto fail;
+        }
+        memcpy(p->u.array.u.values, values, sizeof(*values) * count);
+        p->u.array.count = count;
+        p->prop[0].u.value = js_int32(count);
+    }
+    return obj;
+ fail:
+    for(i = 0; i < count; i++)
+        JS_FreeValue(ctx, values[i]);
+    return JS_EXCEPTION;
+}
+
+/* Borrow the element storage of a fast Array. The pointer is only valid
+   until the array is modified or any JS code runs. */
+JS_BOOL JS_GetFastArray(JSContext *ctx, JSValue obj, JSValue **arrpp,
+                        uint32_t *countp)
+{
+    return js_get_fast_array(ctx, obj, arrpp, countp);
+}
+
 static void js_free_desc(JSContext *ctx, JSPropertyDescriptor *desc)
 {
     JS_FreeValue(ctx, desc->getter);
@@ -10293,6 +10828,10 @@ static int JS_ToBoolFree(JSContext *ctx, JSValue val)
             JS_FreeValue(ctx, val);
             return ret;
         }
+    case JS_TAG_STRING_ROPE:
+        /* ropes are never empty */
+        JS_FreeValue(ctx, val);
+        return TRUE;
     case JS_TAG_BIG_INT:
         {
             JSBigInt *p = JS_VALUE_GET_PTR(val);
@@ -10631,6 +11170,7 @@ static JSValue JS_ToNumberHintFree(JSContext *ctx, JSValue val,
             return JS_EXCEPTION;
         goto redo;
     case JS_TAG_STRING:
+    case JS_TAG_STRING_ROPE:
         {
             const char *str;
             size_t len;
@@ -11321,6 +11861,209 @@ static int js_ecvt1(double d, int n_digits,
     return n_digits;
 }
 
+/* Grisu3 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+   Accurately with Integers", PLDI 2010): shortest digits for a double
+   using 64-bit integer arithmetic only. It reports failure on the rare
+   inputs (about 0.5%) where the result cannot be proven shortest and
+   correctly rounded; the caller then falls back to the exact method. */
+
+typedef struct {
+    uint64_t f;
+    int e;
+} js_diy_fp;
+
+/* cached powers of ten 10^k as f * 2^e with f normalized, every 8
+   decimal exponents from 10^-348 to 10^340 */
+static const struct {
+    uint64_t f;
+    int16_t e;
+    int16_t k;
+} js_grisu_powers[] = {
+    { 0xfa8fd5a0081c0288, -1220, -348 }, { 0xbaaee17fa23ebf76, -1193, -340 },
+    { 0x8b16fb203055ac76, -1166, -332 }, { 0xcf42894a5dce35ea, -1140, -324 },
+    { 0x9a6bb0aa55653b2d, -1113, -316 }, { 0xe61acf033d1a45df, -1087, -308 },
+    { 0xab70fe17c79ac6ca, -1060, -300 }, { 0xff77b1fcbebcdc4f, -1034, -292 },
+    { 0xbe5691ef416bd60c, -1007, -284 }, { 0x8dd01fad907ffc3c, -980, -276 },
+    { 0xd3515c2831559a83, -954, -268 }, { 0x9d71ac8fada6c9b5, -927, -260 },
+    { 0xea9c227723ee8bcb, -901, -252 }, { 0xaecc49914078536d, -874, -244 },
+    { 0x823c12795db6ce57, -847, -236 }, { 0xc21094364dfb5637, -821, -228 },
+    { 0x9096ea6f3848984f, -794, -220 }, { 0xd77485cb25823ac7, -768, -212 },
+    { 0xa086cfcd97bf97f4, -741, -204 }, { 0xef340a98172aace5, -715, -196 },
+    { 0xb23867fb2a35b28e, -688, -188 }, { 0x84c8d4dfd2c63f3b, -661, -180 },
+    { 0xc5dd44271ad3cdba, -635, -172 }, { 0x936b9fcebb25c996, -608, -164 },
+    { 0xdbac6c247d62a584, -582, -156 }, { 0xa3ab66580d5fdaf6, -555, -148 },
+    { 0xf3e2f893dec3f126, -529, -140 }, { 0xb5b5ada8aaff80b8, -502, -132 },
+    { 0x87625f056c7c4a8b, -475, -124 }, { 0xc9bcff6034c13053, -449, -116 },
+    { 0x964e858c91ba2655, -422, -108 }, { 0xdff9772470297ebd, -396, -100 },
+    { 0xa6dfbd9fb8e5b88f, -369, -92 }, { 0xf8a95fcf88747d94, -343, -84 },
+    { 0xb94470938fa89bcf, -316, -76 }, { 0x8a08f0f8bf0f156b, -289, -68 },
+    { 0xcdb02555653131b6, -263, -60 }, { 0x993fe2c6d07b7fac, -236, -52 },
+    { 0xe45c10c42a2b3b06, -210, -44 }, { 0xaa242499697392d3, -183, -36 },
+    { 0xfd87b5f28300ca0e, -157, -28 }, { 0xbce5086492111aeb, -130, -20 },
+    { 0x8cbccc096f5088cc, -103, -12 }, { 0xd1b71758e219652c, -77, -4 },
+    { 0x9c40000000000000, -50, 4 }, { 0xe8d4a51000000000, -24, 12 },
+    { 0xad78ebc5ac620000, 3, 20 }, { 0x813f3978f8940984, 30, 28 },
+    { 0xc097ce7bc90715b3, 56, 36 }, { 0x8f7e32ce7bea5c70, 83, 44 },
+    { 0xd5d238a4abe98068, 109, 52 }, { 0x9f4f2726179a2245, 136, 60 },
+    { 0xed63a231d4c4fb27, 162, 68 }, { 0xb0de65388cc8ada8, 189, 76 },
+    { 0x83c7088e1aab65db, 216, 84 }, { 0xc45d1df942711d9a, 242, 92 },
+    { 0x924d692ca61be758, 269, 100 }, { 0xda01ee641a708dea, 295, 108 },
+    { 0xa26da3999aef774a, 322, 116 }, { 0xf209787bb47d6b85, 348, 124 },
+    { 0xb454e4a179dd1877, 375, 132 }, { 0x865b86925b9bc5c2, 402, 140 },
+    { 0xc83553c5c8965d3d, 428, 148 }, { 0x952ab45cfa97a0b3, 455, 156 },
+    { 0xde469fbd99a05fe3, 481, 164 }, { 0xa59bc234db398c25, 508, 172 },
+    { 0xf6c69a72a3989f5c, 534, 180 }, { 0xb7dcbf5354e9bece, 561, 188 },
+    { 0x88fcf317f22241e2, 588, 196 }, { 0xcc20ce9bd35c78a5, 614, 204 },
+    { 0x98165af37b2153df, 641, 212 }, { 0xe2a0b5dc971f303a, 667, 220 },
+    { 0xa8d9d1535ce3b396, 694, 228 }, { 0xfb9b7cd9a4a7443c, 720, 236 },
+    { 0xbb764c4ca7a44410, 747, 244 }, { 0x8bab8eefb6409c1a, 774, 252 },
+    { 0xd01fef10a657842c, 800, 260 }, { 0x9b10a4e5e9913129, 827, 268 },
+    { 0xe7109bfba19c0c9d, 853, 276 }, { 0xac2820d9623bf429, 880, 284 },
+    { 0x80444b5e7aa7cf85, 907, 292 }, { 0xbf21e44003acdd2d, 933, 300 },
+    { 0x8e679c2f5e44ff8f, 960, 308 }, { 0xd433179d9c8cb841, 986, 316 },
+    { 0x9e19db92b4e31ba9, 1013, 324 }, { 0xeb96bf6ebadf77d9, 1039, 332 },
+    { 0xaf87023b9bf0ee6b, 1066, 340 },
+};
+
+static js_diy_fp js_diy_fp_mul(js_diy_fp x, js_diy_fp y)
+{
+    uint64_t a = x.f >> 32, b = x.f & 0xffffffff;
+    uint64_t c = y.f >> 32, d = y.f & 0xffffffff;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & 0xffffffff) + (bc & 0xffffffff);
+    js_diy_fp r;
+    tmp += 1U << 31; /* round */
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+static js_diy_fp js_diy_fp_normalize(js_diy_fp x)
+{
+    int shift = clz64(x.f);
+    x.f <<= shift;
+    x.e -= shift;
+    return x;
+}
+
+static BOOL js_grisu_round_weed(char *buf, int len, uint64_t dist_high_w,
+                                uint64_t unsafe_interval, uint64_t rest,
+                                uint64_t ten_kappa, uint64_t unit)
+{
+    uint64_t small_dist = dist_high_w - unit;
+    uint64_t big_dist = dist_high_w + unit;
+
+    /* move the last digit down while it brings the result closer to w */
+    while (rest < small_dist && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_dist ||
+            small_dist - rest >= rest + ten_kappa - small_dist)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+    /* give up if another candidate could be closer given the error */
+    if (rest < big_dist && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_dist ||
+         big_dist - rest > rest + ten_kappa - big_dist))
+        return FALSE;
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+/* `d` is finite and > 0. On success, store the shortest digits into
+   `buf` (at most 17) and return their number, `*pexp` receiving the
+   decimal exponent of the last digit. Return 0 on failure. */
+static int js_grisu3(double d, char *buf, int *pexp)
+{
+    union { double d; uint64_t u; } u;
+    js_diy_fp w, m_plus, m_minus, c_mk, too_low, too_high, one;
+    uint64_t unsafe_interval, fractionals, rest, unit, dist_high_w;
+    uint32_t integrals, divisor;
+    int biased_e, min_e, k, idx, kappa, len, digit;
+
+    u.d = d;
+    biased_e = (u.u >> 52) & 0x7ff;
+    w.f = u.u & (((uint64_t)1 << 52) - 1);
+    if (biased_e) {
+        w.f += (uint64_t)1 << 52;
+        w.e = biased_e - 1075;
+    } else {
+        w.e = -1074;
+    }
+    /* boundaries halfway to the neighbouring doubles */
+    m_plus.f = (w.f << 1) + 1;
+    m_plus.e = w.e - 1;
+    m_plus = js_diy_fp_normalize(m_plus);
+    if (w.f == (uint64_t)1 << 52 && biased_e > 1) {
+        /* the lower neighbour is closer */
+        m_minus.f = (w.f << 2) - 1;
+        m_minus.e = w.e - 2;
+    } else {
+        m_minus.f = (w.f << 1) - 1;
+        m_minus.e = w.e - 1;
+    }
+    m_minus.f <<= m_minus.e - m_plus.e;
+    m_minus.e = m_plus.e;
+    w = js_diy_fp_normalize(w);
+
+    /* pick 10^-k so that the scaled exponent falls in [-60, -32] */
+    min_e = -60 - (w.e + 64);
+    k = (int)ceil((min_e + 63) * 0.30102999566398114);
+    idx = (348 + k - 1) / 8 + 1;
+    c_mk.f = js_grisu_powers[idx].f;
+    c_mk.e = js_grisu_powers[idx].e;
+
+    w = js_diy_fp_mul(w, c_mk);
+    too_low = js_diy_fp_mul(m_minus, c_mk);
+    too_high = js_diy_fp_mul(m_plus, c_mk);
+    /* the products are off by at most one unit */
+    unit = 1;
+    too_low.f -= unit;
+    too_high.f += unit;
+    unsafe_interval = too_high.f - too_low.f;
+    dist_high_w = too_high.f - w.f;
+
+    one.e = w.e;
+    one.f = (uint64_t)1 << -one.e;
+    integrals = (uint32_t)(too_high.f >> -one.e);
+    fractionals = too_high.f & (one.f - 1);
+    divisor = 1;
+    kappa = 1;
+    while (integrals / 10 >= divisor) {
+        divisor *= 10;
+        kappa++;
+    }
+    len = 0;
+    while (kappa > 0) {
+        digit = integrals / divisor;
+        buf[len++] = '0' + digit;
+        integrals %= divisor;
+        kappa--;
+        rest = ((uint64_t)integrals << -one.e) + fractionals;
+        if (rest < unsafe_interval) {
+            *pexp = kappa - js_grisu_powers[idx].k;
+            return js_grisu_round_weed(buf, len, dist_high_w,
+                                       unsafe_interval, rest,
+                                       (uint64_t)divisor << -one.e,
+                                       unit) ? len : 0;
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        digit = (int)(fractionals >> -one.e);
+        buf[len++] = '0' + digit;
+        fractionals &= one.f - 1;
+        kappa--;
+        if (fractionals < unsafe_interval) {
+            *pexp = kappa - js_grisu_powers[idx].k;
+            return js_grisu_round_weed(buf, len, dist_high_w * unit,
+                                       unsafe_interval, fractionals,
+                                       one.f, unit) ? len : 0;
+        }
+    }
+}
+
 /* `js_ecvt`: compute the digits and decimal point spot for a double
    with proper javascript rounding. We cannot use `ecvt` for multiple
    resasons: portability, because of the number of digits is typically
@@ -11336,8 +12079,23 @@ static int js_ecvt(double d, int n_digits,
                    size_t size, int *decpt)
 {
     if (n_digits == 0) {
+        char digits[20];
+        int i, exp10;
+        /* d is 0 or the integer fast path of js_dtoa did not apply */
+        if (d != 0 && (n_digits = js_grisu3(d, digits, &exp10)) > 0) {
+            /* same layout as js_ecvt1() */
+            while (n_digits > 1 && digits[n_digits - 1] == '0') {
+                n_digits--;
+                exp10++;
+            }
+            dest[0] = digits[0];
+            dest[1] = '.';
+            for (i = 1; i < n_digits; i++)
+                dest[i + 1] = digits[i];
+            *decpt = n_digits + exp10;
+            return n_digits;
+        }
         /* find the minimum number of digits (XXX: inefficient but simple) */
-        // TODO(chqrlie) use direct method from quickjs-printf
         unsigned int n_digits_min = 1;
         unsigned int n_digits_max = 17;
         for (;;) {
@@ -11471,26 +12229,18 @@ static JSValue js_dtoa_infinite(JSContext *ctx, double d)
 #define JS_DTOA_FIXED       2  /* force fixed number of fractional digits */
 #define JS_DTOA_PRECISION   3  /* use n_digits significant digits (1 <= n_digits <= 101) */
 
-/* `js_dtoa`: convert a floating point number to a string
-   - `mode`: one of the 4 supported formats
-   - `n_digits`: digit number according to mode
-   -   TOSTRING:    0 only. As many digits as necessary
-   -   EXPONENTIAL: 0 as many decimals as necessary
-   -                1..101 number of significant digits
-   -   FIXED:       0..100 number of decimal places
-   -   PRECISION:   1..101 number of significant digits
+/* `js_dtoa_cstr`: same as `js_dtoa` for a finite `d` without allocating:
+   the characters are stored somewhere in `buf`, return a pointer to the
+   first one and store their number into `*plen`.
  */
-// XXX: should use libbf or quickjs-printf.
-static JSValue js_dtoa(JSContext *ctx, double d, int n_digits, int mode)
+static const char *js_dtoa_cstr(double d, int n_digits, int mode,
+                                char buf[minimum_length(JS_DTOA_BUF_SIZE)],
+                                size_t *plen)
 {
-    char buf[JS_DTOA_BUF_SIZE];
     size_t len;
     char *start;
     int sign, decpt, exp, i, k, n, n_max;
 
-    if (!isfinite(d))
-        return js_dtoa_infinite(ctx, d);
-
     sign = (d < 0);
     start = buf + 8;
     d = fabs(d);  /* also converts -0 to 0 */
@@ -11510,14 +12260,14 @@ static JSValue js_dtoa(JSContext *ctx, double d, int n_digits, int mode)
         }
     }
     if (mode == JS_DTOA_FIXED) {
-        len = js_fcvt(d, n_digits, start, sizeof(buf) - 8);
+        len = js_fcvt(d, n_digits, start, JS_DTOA_BUF_SIZE - 8);
         // TODO(chqrlie) patch the locale specific decimal point
         goto done;
     }
 
     n_max = (n_digits > 0) ? n_digits : 21;
     /* the number has k digits (1 <= k <= n_max) */
-    k = js_ecvt(d, n_digits, start, sizeof(buf) - 8, &decpt);
+    k = js_ecvt(d, n_digits, start, JS_DTOA_BUF_SIZE - 8, &decpt);
     /* buffer contents:
        0:     first digit
        1:     '.' decimal point
@@ -11578,7 +12328,30 @@ static JSValue js_dtoa(JSContext *ctx, double d, int n_digits, int mode)
 
  done:
     start[-1] = '-';    /* prepend the sign if negative */
-    return js_new_string8_len(ctx, start - sign, len + sign);
+    *plen = len + sign;
+    return start - sign;
+}
+
+/* `js_dtoa`: convert a floating point number to a string
+   - `mode`: one of the 4 supported formats
+   - `n_digits`: digit number according to mode
+   -   TOSTRING:    0 only. As many digits as necessary
+   -   EXPONENTIAL: 0 as many decimals as necessary
+   -                1..101 number of significant digits
+   -   FIXED:       0..100 number of decimal places
+   -   PRECISION:   1..101 number of significant digits
+ */
+// XXX: should use libbf or quickjs-printf.
+static JSValue js_dtoa(JSContext *ctx, double d, int n_digits, int mode)
+{
+    char buf[JS_DTOA_BUF_SIZE];
+    const char *str;
+    size_t len;
+
+    if (!isfinite(d))
+        return js_dtoa_infinite(ctx, d);
+    str = js_dtoa_cstr(d, n_digits, mode, buf, &len);
+    return js_new_string8_len(ctx, str, len);
 }
 
 /* `js_dtoa_radix`: convert a floating point number using a specific base
@@ -11685,6 +12458,12 @@ JSValue JS_ToStringInternal(JSContext *ctx, JSValue val, BOOL is_ToPropertyKey)
     switch(tag) {
     case JS_TAG_STRING:
         return js_dup(val);
+    case JS_TAG_STRING_ROPE:
+        /* the string functions only deal with flat strings */
+        val = js_string_flat(ctx, val);
+        if (JS_IsException(val))
+            return JS_EXCEPTION;
+        return js_dup(val);
     case JS_TAG_INT:
         len = i32toa(buf, JS_VALUE_GET_INT(val));
         return js_new_string8_len(ctx, buf, len);
@@ -11760,26 +12539,123 @@ static JSValue JS_ToStringCheckObject(JSContext *ctx, JSValue val)
     return JS_ToString(ctx, val);
 }
 
-static JSValue JS_ToQuotedString(JSContext *ctx, JSValue val1)
+/* Return the first character in [p, end) that JSON.stringify must escape:
+   '"', '\\' or a control character. 16 bytes are tested at a time with
+   SSE2 or NEON where available. */
+static const uint8_t *json_scan_escape8(const uint8_t *p, const uint8_t *end)
+{
+#if defined(JSON_SCAN_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl_max = _mm_set1_epi8(0x1f);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        /* unsigned v <= 0x1f */
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                              _mm_cmpeq_epi8(v, backslash)),
+                                 _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl_max), v));
+        int mask = _mm_movemask_epi8(m);
+        if (mask)
+            return p + ctz32(mask);
+        p += 16;
+    }
+#elif defined(JSON_SCAN_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    while (end - p >= 16) {
+        uint8x16_t v = vld1q_u8(p);
+        uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, quote),
+                                         vceqq_u8(v, backslash)),
+                                vcltq_u8(v, space));
+        uint64_t bits = vget_lane_u64(
+            vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (bits)
+            return p + (ctz64(bits) >> 2);
+        p += 16;
+    }
+#endif
+    while (p < end && *p >= 0x20 && *p != '"' && *p != '\\')
+        p++;
+    return p;
+}
+
+/* Same as json_scan_escape8() for wide strings, also stopping at
+   surrogates so that lone ones get escaped. */
+static const uint16_t *json_scan_escape16(const uint16_t *p,
+                                          const uint16_t *end)
+{
+#if defined(JSON_SCAN_SSE2)
+    const __m128i quote = _mm_set1_epi16('"');
+    const __m128i backslash = _mm_set1_epi16('\\');
+    const __m128i surrogate_mask = _mm_set1_epi16((short)0xf800);
+    const __m128i surrogate = _mm_set1_epi16((short)0xd800);
+    /* unsigned compare through a bias: (v ^ 0x8000) < (0x20 ^ 0x8000) */
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    const __m128i space = _mm_set1_epi16((short)(0x20 ^ 0x8000));
+    while (end - p >= 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi16(v, quote),
+                         _mm_cmpeq_epi16(v, backslash)),
+            _mm_or_si128(_mm_cmplt_epi16(_mm_xor_si128(v, bias), space),
+                         _mm_cmpeq_epi16(_mm_and_si128(v, surrogate_mask),
+                                         surrogate)));
+        int mask = _mm_movemask_epi8(m);
+        if (mask)
+            return p + (ctz32(mask) >> 1);
+        p += 8;
+    }
+#elif defined(JSON_SCAN_NEON)
+    const uint16x8_t quote = vdupq_n_u16('"');
+    const uint16x8_t backslash = vdupq_n_u16('\\');
+    const uint16x8_t space = vdupq_n_u16(0x20);
+    const uint16x8_t surrogate_mask = vdupq_n_u16(0xf800);
+    const uint16x8_t surrogate = vdupq_n_u16(0xd800);
+    while (end - p >= 8) {
+        uint16x8_t v = vld1q_u16(p);
+        uint16x8_t m = vorrq_u16(
+            vorrq_u16(vceqq_u16(v, quote), vceqq_u16(v, backslash)),
+            vorrq_u16(vcltq_u16(v, space),
+                      vceqq_u16(vandq_u16(v, surrogate_mask), surrogate)));
+        /* narrow each lane to 8 bits to get a 64-bit mask */
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(m)), 0);
+        if (bits)
+            return p + (ctz64(bits) >> 3);
+        p += 8;
+    }
+#endif
+    while (p < end && *p >= 0x20 && *p != '"' && *p != '\\' &&
+           !is_surrogate(*p))
+        p++;
+    return p;
+}
+
+/* append the JSON quoted form of `p` to `b` */
+static int json_quote_string(StringBuffer *b, const JSString *p)
 {
-    JSValue val;
-    JSString *p;
-    int i;
+    int i, j;
     uint32_t c;
-    StringBuffer b_s, *b = &b_s;
     char buf[16];
 
-    val = JS_ToStringCheckObject(ctx, val1);
-    if (JS_IsException(val))
-        return val;
-    p = JS_VALUE_GET_STRING(val);
-
-    if (string_buffer_init(ctx, b, p->len + 2))
-        goto fail;
-
     if (string_buffer_putc8(b, '\"'))
-        goto fail;
+        return -1;
     for(i = 0; i < p->len; ) {
+        /* copy the run of characters that need no escaping */
+        if (p->is_wide_char) {
+            j = json_scan_escape16(p->u.str16 + i, p->u.str16 + p->len) -
+                p->u.str16;
+            if (string_buffer_write16(b, p->u.str16 + i, j - i))
+                return -1;
+        } else {
+            j = json_scan_escape8(p->u.str8 + i, p->u.str8 + p->len) -
+                p->u.str8;
+            if (string_buffer_write8(b, p->u.str8 + i, j - i))
+                return -1;
+        }
+        i = j;
+        if (i >= p->len)
+            break;
         c = string_getc(p, &i);
         switch(c) {
         case '\t':
@@ -11801,30 +12677,23 @@ static JSValue JS_ToQuotedString(JSContext *ctx, JSValue val1)
         case '\\':
         quote:
             if (string_buffer_putc8(b, '\\'))
-                goto fail;
+                return -1;
             if (string_buffer_putc8(b, c))
-                goto fail;
+                return -1;
             break;
         default:
             if (c < 32 || is_surrogate(c)) {
                 snprintf(buf, sizeof(buf), "\\u%04x", c);
                 if (string_buffer_write8(b, (uint8_t*)buf, 6))
-                    goto fail;
+                    return -1;
             } else {
                 if (string_buffer_putc(b, c))
-                    goto fail;
+                    return -1;
             }
             break;
         }
     }
-    if (string_buffer_putc8(b, '\"'))
-        goto fail;
-    JS_FreeValue(ctx, val);
-    return string_buffer_end(b);
- fail:
-    JS_FreeValue(ctx, val);
-    string_buffer_free(b);
-    return JS_EXCEPTION;
+    return string_buffer_putc8(b, '\"');
 }
 
 static __maybe_unused void JS_DumpObjectHeader(JSRuntime *rt)
@@ -12020,6 +12889,15 @@ static __maybe_unused void JS_DumpValue(JSRuntime *rt, JSValue val)
             JS_DumpString(rt, p);
         }
         break;
+    case JS_TAG_STRING_ROPE:
+        {
+            JSStringRope *r = JS_VALUE_GET_PTR(val);
+            if (js_rope_is_flat(r))
+                JS_DumpString(rt, JS_VALUE_GET_STRING(r->left));
+            else
+                printf("[rope len=%u]", r->len);
+        }
+        break;
     case JS_TAG_FUNCTION_BYTECODE:
         {
             JSFunctionBytecode *b = JS_VALUE_GET_PTR(val);
@@ -12210,6 +13088,7 @@ static bf_t *JS_ToBigIntFree(JSContext *ctx, bf_t *buf, JSValue val)
         r = &p->num;
         break;
     case JS_TAG_STRING:
+    case JS_TAG_STRING_ROPE:
         val = JS_StringToBigIntErr(ctx, val);
         if (JS_IsException(val))
             return NULL;
@@ -12751,7 +13630,7 @@ static no_inline __exception int js_add_slow(JSContext *ctx, JSValue *sp)
         tag2 = JS_VALUE_GET_NORM_TAG(op2);
     }
 
-    if (tag1 == JS_TAG_STRING || tag2 == JS_TAG_STRING) {
+    if (tag_is_string(tag1) || tag_is_string(tag2)) {
         sp[-2] = JS_ConcatString(ctx, op1, op2);
         if (JS_IsException(sp[-2]))
             goto exception;
@@ -12927,12 +13806,13 @@ static no_inline int js_relational_slow(JSContext *ctx, JSValue *sp,
     tag1 = JS_VALUE_GET_NORM_TAG(op1);
     tag2 = JS_VALUE_GET_NORM_TAG(op2);
 
-    op1 = JS_ToPrimitiveFree(ctx, op1, HINT_NUMBER);
+    /* ropes compare as flat strings */
+    op1 = js_string_flat_free(ctx, JS_ToPrimitiveFree(ctx, op1, HINT_NUMBER));
     if (JS_IsException(op1)) {
         JS_FreeValue(ctx, op2);
         goto exception;
     }
-    op2 = JS_ToPrimitiveFree(ctx, op2, HINT_NUMBER);
+    op2 = js_string_flat_free(ctx, JS_ToPrimitiveFree(ctx, op2, HINT_NUMBER));
     if (JS_IsException(op2)) {
         JS_FreeValue(ctx, op1);
         goto exception;
@@ -13061,6 +13941,16 @@ static no_inline __exception int js_eq_slow(JSContext *ctx, JSValue *sp,
     op1 = sp[-2];
     op2 = sp[-1];
  redo:
+    op1 = js_string_flat_free(ctx, op1);
+    if (JS_IsException(op1)) {
+        JS_FreeValue(ctx, op2);
+        goto exception;
+    }
+    op2 = js_string_flat_free(ctx, op2);
+    if (JS_IsException(op2)) {
+        JS_FreeValue(ctx, op1);
+        goto exception;
+    }
     tag1 = JS_VALUE_GET_NORM_TAG(op1);
     tag2 = JS_VALUE_GET_NORM_TAG(op2);
     if (tag_is_number(tag1) && tag_is_number(tag2)) {
@@ -13228,14 +14118,23 @@ static BOOL js_strict_eq2(JSContext *ctx, JSValue op1, JSValue op2,
         res = (tag1 == tag2);
         break;
     case JS_TAG_STRING:
+    case JS_TAG_STRING_ROPE:
         {
-            JSString *p1, *p2;
-            if (tag1 != tag2) {
+            JSValue v1, v2;
+            if (!tag_is_string(tag2) ||
+                js_string_value_len(op1) != js_string_value_len(op2)) {
                 res = FALSE;
             } else {
-                p1 = JS_VALUE_GET_STRING(op1);
-                p2 = JS_VALUE_GET_STRING(op2);
-                res = (js_string_compare(ctx, p1, p2) == 0);
+                /* XXX: if a rope cannot be flattened, the out of memory
+                   exception is left pending */
+                v1 = js_string_flat(ctx, op1);
+                v2 = js_string_flat(ctx, op2);
+                if (JS_IsException(v1) || JS_IsException(v2)) {
+                    res = FALSE;
+                } else {
+                    res = (js_string_compare(ctx, JS_VALUE_GET_STRING(v1),
+                                             JS_VALUE_GET_STRING(v2)) == 0);
+                }
             }
         }
         break;
@@ -13462,6 +14361,7 @@ static __exception int js_operator_typeof(JSContext *ctx, JSValue op1)
         atom = JS_ATOM_boolean;
         break;
     case JS_TAG_STRING:
+    case JS_TAG_STRING_ROPE:
         atom = JS_ATOM_string;
         break;
     case JS_TAG_OBJECT:
@@ -16730,7 +17630,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValue func_obj,
                         goto add_loc_slow;
                     *pv = js_int32(r);
                     sp--;
-                } else if (JS_VALUE_GET_TAG(*pv) == JS_TAG_STRING) {
+                } else if (tag_is_string(JS_VALUE_GET_TAG(*pv))) {
                     JSValue op1;
                     op1 = sp[-1];
                     sp--;
@@ -16738,10 +17638,22 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValue func_obj,
                     op1 = JS_ToPrimitiveFree(ctx, op1, HINT_NONE);
                     if (JS_IsException(op1))
                         goto exception;
-                    op1 = JS_ConcatString(ctx, js_dup(*pv), op1);
-                    if (JS_IsException(op1))
-                        goto exception;
-                    set_value(ctx, pv, op1);
+                    /* 's += x' on a string only held by the variable
+                       grows it in place. valueOf() may have changed it. */
+                    if (tag_is_string(JS_VALUE_GET_TAG(*pv)) &&
+                        !tag_is_string(JS_VALUE_GET_TAG(op1))) {
+                        op1 = JS_ToStringFree(ctx, op1);
+                        if (JS_IsException(op1))
+                            goto exception;
+                    }
+                    if (js_string_append_in_place(ctx, *pv, op1)) {
+                        JS_FreeValue(ctx, op1);
+                    } else {
+                        op1 = JS_ConcatString(ctx, js_dup(*pv), op1);
+                        if (JS_IsException(op1))
+                            goto exception;
+                        set_value(ctx, pv, op1);
+                    }
                 } else {
                     JSValue ops[2];
                 add_loc_slow:
@@ -19956,6 +20868,50 @@ static int json_parse_error(JSParseState *s, const uint8_t *curp, const char *ms
                           msg, position, line, (int)(p - line_start) + 1);
 }
 
+/* Return the first byte in [p, end) that is not printable ASCII or is a
+   '"' or '\\', i.e. the end of the run json_parse_string can copy as is.
+   16 bytes are tested at a time with SSE2 or NEON where available. */
+static const uint8_t *json_scan_plain(const uint8_t *p, const uint8_t *end)
+{
+#if defined(JSON_SCAN_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        /* signed compare: bytes >= 0x80 are negative, so also < 0x20 */
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                              _mm_cmpeq_epi8(v, backslash)),
+                                 _mm_cmplt_epi8(v, space));
+        int mask = _mm_movemask_epi8(m);
+        if (mask)
+            return p + ctz32(mask);
+        p += 16;
+    }
+#elif defined(JSON_SCAN_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    const uint8x16_t high = vdupq_n_u8(0x80);
+    while (end - p >= 16) {
+        uint8x16_t v = vld1q_u8(p);
+        uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, quote),
+                                         vceqq_u8(v, backslash)),
+                                vorrq_u8(vcltq_u8(v, space),
+                                         vcgeq_u8(v, high)));
+        /* narrow each byte to 4 bits to get a 64-bit mask */
+        uint64_t bits = vget_lane_u64(
+            vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (bits)
+            return p + (ctz64(bits) >> 2);
+        p += 16;
+    }
+#endif
+    while (p < end && *p >= 0x20 && *p < 0x80 && *p != '"' && *p != '\\')
+        p++;
+    return p;
+}
+
 static int json_parse_string(JSParseState *s, const uint8_t **pp)
 {
     const uint8_t *p, *p_next;
@@ -19963,11 +20919,31 @@ static int json_parse_string(JSParseState *s, const uint8_t **pp)
     uint32_t c;
     StringBuffer b_s, *b = &b_s;
 
+    p = *pp;
+    /* fast path: ASCII string without escapes, no StringBuffer needed */
+    p_next = json_scan_plain(p, s->buf_end);
+    if (p_next > p && p_next < s->buf_end && *p_next == '"' &&
+        p_next - p <= JS_STRING_LEN_MAX) {
+        JSValue str = js_new_string8_len(s->ctx, (const char *)p, p_next - p);
+        if (JS_IsException(str))
+            return -1;
+        s->token.val = TOK_STRING;
+        s->token.u.str.sep = '"';
+        s->token.u.str.str = str;
+        *pp = p_next + 1;
+        return 0;
+    }
+
     if (string_buffer_init(s->ctx, b, 32))
         goto fail;
 
-    p = *pp;
     for(;;) {
+        p_next = json_scan_plain(p, s->buf_end);
+        if (p_next > p) {
+            if (string_buffer_write8(b, p, p_next - p))
+                goto fail;
+            p = p_next;
+        }
         if (p >= s->buf_end) {
             goto end_of_input;
         }
@@ -20031,6 +21007,77 @@ static int json_parse_string(JSParseState *s, const uint8_t **pp)
     return -1;
 }
 
+/* Convert a validated JSON number in [p, end). Numbers with at most 15
+   significant digits and a small decimal exponent are exact products or
+   quotients of two doubles (Clinger's fast path), so they round the same
+   as strtod, which handles everything else. */
+static double json_fast_strtod(const uint8_t *p, const uint8_t *end)
+{
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    const uint8_t *start = p;
+    uint64_t mantissa = 0;
+    int digits = 0, exp10 = 0, exp_sign = 1, e = 0;
+    BOOL neg = FALSE;
+    double d;
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+    /* excess precision (x87) would round twice */
+    goto slow;
+#endif
+    if (*p == '-') {
+        neg = TRUE;
+        p++;
+    }
+    while (p < end && *p == '0')
+        p++;
+    while (p < end && is_digit(*p)) {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        if (++digits > 15)
+            goto slow;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        /* leading zeros of a fraction only move the decimal point */
+        if (digits == 0) {
+            while (p < end && *p == '0') {
+                p++;
+                exp10--;
+            }
+        }
+        while (p < end && is_digit(*p)) {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            exp10--;
+            if (++digits > 15)
+                goto slow;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (*p == '+' || *p == '-')
+            exp_sign = (*p++ == '-') ? -1 : 1;
+        while (p < end && is_digit(*p)) {
+            e = e * 10 + (*p++ - '0');
+            if (e > 1000)
+                goto slow;
+        }
+        exp10 += exp_sign * e;
+    }
+    if (exp10 < -22 || exp10 > 22)
+        goto slow;
+    d = (double)mantissa;
+    if (exp10 < 0)
+        d /= pow10[-exp10];
+    else
+        d *= pow10[exp10];
+    return neg ? -d : d;
+ slow:
+    return strtod((const char *)start, NULL);
+}
+
 static int json_parse_number(JSParseState *s, const uint8_t **pp)
 {
     const uint8_t *p = *pp;
@@ -20065,7 +21112,7 @@ static int json_parse_number(JSParseState *s, const uint8_t **pp)
             p++;
     }
     s->token.val = TOK_NUMBER;
-    s->token.u.num.val = js_float64(strtod((const char *)p_start, NULL));
+    s->token.u.num.val = js_float64(json_fast_strtod(p_start, p));
     *pp = p;
     return 0;
 }
@@ -20158,7 +21205,10 @@ static __exception int json_next_token(JSParseState *s)
         goto def_token;
     case ' ':
     case '\t':
-        p++;
+        /* skip indentation runs without going through the switch */
+        do {
+            p++;
+        } while (*p == ' ' || *p == '\t');
         s->mark = p;
         goto redo;
     case '/':
@@ -27432,6 +28482,46 @@ JSAtom JS_GetModuleName(JSContext *ctx, JSModuleDef *m)
     return JS_DupAtom(ctx, m->module_name);
 }
 
+int JS_FreeModules(JSContext *ctx, JSModuleFilterFunc *filter, void *opaque)
+{
+    struct list_head *el, *el1;
+    JSModuleDef *m, *m1;
+    BOOL changed;
+    int i, count;
+
+    list_for_each(el, &ctx->loaded_modules) {
+        m = list_entry(el, JSModuleDef, link);
+        m->free_pending = (m->status == JS_MODULE_STATUS_EVALUATED &&
+                           !m->async_evaluation && filter(ctx, m, opaque));
+    }
+    /* a module stays as long as a module that stays imports it */
+    do {
+        changed = FALSE;
+        list_for_each(el, &ctx->loaded_modules) {
+            m = list_entry(el, JSModuleDef, link);
+            if (m->free_pending)
+                continue;
+            for(i = 0; i < m->req_module_entries_count; i++) {
+                m1 = m->req_module_entries[i].module;
+                if (m1 && m1->free_pending) {
+                    m1->free_pending = FALSE;
+                    changed = TRUE;
+                }
+            }
+        }
+    } while (changed);
+
+    count = 0;
+    list_for_each_safe(el, el1, &ctx->loaded_modules) {
+        m = list_entry(el, JSModuleDef, link);
+        if (m->free_pending) {
+            js_free_module_def(ctx, m);
+            count++;
+        }
+    }
+    return count;
+}
+
 JSValue JS_GetImportMeta(JSContext *ctx, JSModuleDef *m)
 {
     JSValue obj;
@@ -34373,6 +35463,11 @@ static int JS_WriteObjectRec(BCWriterState *s, JSValue obj)
             bc_put_u64(s, u.u64);
         }
         break;
+    case JS_TAG_STRING_ROPE:
+        obj = js_string_flat(s->ctx, obj);
+        if (JS_IsException(obj))
+            goto fail;
+        /* fall through */
     case JS_TAG_STRING:
         {
             JSString *p = JS_VALUE_GET_STRING(obj);
@@ -36241,6 +37336,12 @@ static JSValue JS_ToObject(JSContext *ctx, JSValue val)
     case JS_TAG_FLOAT64:
         obj = JS_NewObjectClass(ctx, JS_CLASS_NUMBER);
         goto set_value;
+    case JS_TAG_STRING_ROPE:
+        /* String objects hold flat strings */
+        val = js_string_flat(ctx, val);
+        if (JS_IsException(val))
+            return JS_EXCEPTION;
+        /* fall through */
     case JS_TAG_STRING:
         /* XXX: should call the string constructor */
         {
@@ -41429,8 +42530,8 @@ static JSValue js_string_constructor(JSContext *ctx, JSValue new_target,
 
 static JSValue js_thisStringValue(JSContext *ctx, JSValue this_val)
 {
-    if (JS_VALUE_GET_TAG(this_val) == JS_TAG_STRING)
-        return js_dup(this_val);
+    if (JS_IsString(this_val))
+        return JS_ToString(ctx, this_val);
 
     if (JS_VALUE_GET_TAG(this_val) == JS_TAG_OBJECT) {
         JSObject *p = JS_VALUE_GET_OBJ(this_val);
@@ -42066,6 +43167,12 @@ static JSValue js_string___GetSubstitution(JSContext *ctx, JSValue this_val,
 
     if (!JS_IsString(rep) || !JS_IsString(str))
         return JS_ThrowTypeError(ctx, "not a string");
+    str = js_string_flat(ctx, str);
+    if (JS_IsException(str))
+        return JS_EXCEPTION;
+    rep = js_string_flat(ctx, rep);
+    if (JS_IsException(rep))
+        return JS_EXCEPTION;
 
     sp = JS_VALUE_GET_STRING(str);
     rp = JS_VALUE_GET_STRING(rep);
@@ -43889,17 +44996,107 @@ void *lre_realloc(void *opaque, void *ptr, size_t size)
     return js_realloc_rt(ctx->rt, ptr, size);
 }
 
+/* Return the matcher of the regexp bytecode 'bc' or NULL. A regexp
+   literal creates a new object sharing the same bytecode each time it
+   is evaluated, hence the cache in the context. On short subjects, the
+   matcher is only built the second time a bytecode is executed so that
+   the regexps used once do not pay for it. */
+static inline JSRegExpMatcherEntry *js_regexp_matcher_entry(JSContext *ctx,
+                                                            JSString *bc)
+{
+    return &ctx->regexp_matchers[((uintptr_t)bc >> 4) &
+                                 (JS_REGEXP_MATCHER_CACHE_SIZE - 1)];
+}
+
+static void js_regexp_free_matcher(JSContext *ctx, JSRegExpMatcherEntry *e)
+{
+    lre_matcher_free(e->matcher);
+    ctx->regexp_matchers_size -= e->size;
+    e->matcher = NULL;
+    e->size = 0;
+}
+
+static LREMatcher *js_regexp_get_matcher(JSContext *ctx, JSString *bc,
+                                         uint32_t subject_len)
+{
+    JSRegExpMatcherEntry *e;
+
+    e = js_regexp_matcher_entry(ctx, bc);
+    if (e->bytecode != bc) {
+        if (e->bytecode) {
+            js_regexp_free_matcher(ctx, e);
+            JS_FreeValue(ctx, JS_MKPTR(JS_TAG_STRING, e->bytecode));
+        }
+        e->bytecode = JS_VALUE_GET_STRING(js_dup(JS_MKPTR(JS_TAG_STRING, bc)));
+        e->matcher = NULL;
+        if (subject_len < 256)
+            return NULL;
+    }
+    if (!e->matcher)
+        e->matcher = lre_matcher_new(bc->u.str8, ctx);
+    return e->matcher;
+}
+
+/* Called after executing the matcher of 'bc', which may have built new
+   DFA states. While the matchers take more than
+   JS_REGEXP_MATCHERS_SIZE_MAX, the largest other one is freed: it is
+   rebuilt from scratch the next time its regexp runs. */
+static void js_regexp_update_matcher_size(JSContext *ctx, JSString *bc)
+{
+    JSRegExpMatcherEntry *e, *e1, *largest;
+    size_t size;
+    int i;
+
+    e = js_regexp_matcher_entry(ctx, bc);
+    if (e->bytecode != bc || !e->matcher)
+        return;
+    size = lre_matcher_size(e->matcher);
+    ctx->regexp_matchers_size += size - e->size;
+    e->size = size;
+    while (ctx->regexp_matchers_size > JS_REGEXP_MATCHERS_SIZE_MAX) {
+        largest = NULL;
+        for(i = 0; i < JS_REGEXP_MATCHER_CACHE_SIZE; i++) {
+            e1 = &ctx->regexp_matchers[i];
+            if (e1 != e && e1->matcher &&
+                (!largest || e1->size > largest->size))
+                largest = e1;
+        }
+        if (!largest)
+            break;
+        js_regexp_free_matcher(ctx, largest);
+    }
+}
+
+static void js_regexp_free_matchers(JSContext *ctx)
+{
+    JSRegExpMatcherEntry *e;
+    int i;
+
+    for(i = 0; i < JS_REGEXP_MATCHER_CACHE_SIZE; i++) {
+        e = &ctx->regexp_matchers[i];
+        if (e->bytecode) {
+            js_regexp_free_matcher(ctx, e);
+            JS_FreeValue(ctx, JS_MKPTR(JS_TAG_STRING, e->bytecode));
+            e->bytecode = NULL;
+        }
+    }
+}
+
 static JSValue js_regexp_escape(JSContext *ctx, JSValue this_val,
                                 int argc, JSValue *argv)
 {
     StringBuffer b_s, *b = &b_s;
+    JSValue str;
     JSString *p;
     uint32_t c, i;
     char s[16];
 
     if (!JS_IsString(argv[0]))
         return JS_ThrowTypeError(ctx, "not a string");
-    p = JS_VALUE_GET_STRING(argv[0]);
+    str = js_string_flat(ctx, argv[0]);
+    if (JS_IsException(str))
+        return JS_EXCEPTION;
+    p = JS_VALUE_GET_STRING(str);
     string_buffer_init2(ctx, b, 0, p->is_wide_char);
     for (i = 0; i < p->len; i++) {
         c = p->is_wide_char ? (uint32_t)p->u.str16[i] : (uint32_t)p->u.str8[i];
@@ -43984,9 +45181,11 @@ static JSValue js_regexp_exec(JSContext *ctx, JSValue this_val,
     if (last_index > str->len) {
         rc = 2;
     } else {
-        rc = lre_exec(capture, re_bytecode,
-                      str_buf, last_index, str->len,
-                      shift, ctx);
+        rc = lre_exec_matcher(capture, re_bytecode,
+                              js_regexp_get_matcher(ctx, re->bytecode, str->len),
+                              str_buf, last_index, str->len,
+                              shift, ctx);
+        js_regexp_update_matcher_size(ctx, re->bytecode);
     }
     if (rc != 1) {
         if (rc >= 0) {
@@ -44181,8 +45380,10 @@ static JSValue JS_RegExpDelete(JSContext *ctx, JSValue this_val, JSValue arg)
         if (last_index > str->len)
             break;
 
-        ret = lre_exec(capture, re_bytecode,
-                       str_buf, last_index, str->len, shift, ctx);
+        ret = lre_exec_matcher(capture, re_bytecode,
+                               js_regexp_get_matcher(ctx, re->bytecode, str->len),
+                               str_buf, last_index, str->len, shift, ctx);
+        js_regexp_update_matcher_size(ctx, re->bytecode);
         if (ret != 1) {
             if (ret >= 0) {
                 if (ret == 2 || (re_flags & (LRE_FLAG_GLOBAL | LRE_FLAG_STICKY))) {
@@ -45280,6 +46481,16 @@ static JSValue js_json_parse(JSContext *ctx, JSValue this_val,
     return obj;
 }
 
+/* Serialized keys of a plain object shape: keys[i] is the quoted name of
+   property i followed by ':', or JS_UNDEFINED if JSON.stringify skips it.
+   keys is NULL if objects of this shape take the generic path. */
+typedef struct JSONShapeKeys {
+    JSShape *sh;
+    JSValue *keys;
+} JSONShapeKeys;
+
+#define JSON_SHAPE_KEYS_SIZE 64 /* must be a power of two */
+
 typedef struct JSONStringifyContext {
     JSValue replacer_func;
     JSValue stack;
@@ -45287,26 +46498,31 @@ typedef struct JSONStringifyContext {
     JSValue gap;
     JSValue empty;
     StringBuffer *b;
+    /* open addressing hash table indexed by shape address */
+    int shape_keys_count;
+    JSONShapeKeys shape_keys[JSON_SHAPE_KEYS_SIZE];
 } JSONStringifyContext;
 
-static JSValue JS_ToQuotedStringFree(JSContext *ctx, JSValue val) {
-    JSValue r = JS_ToQuotedString(ctx, val);
-    JS_FreeValue(ctx, val);
-    return r;
-}
-
+/* `key` is the property name, or an integer for array elements: it is
+   only converted to a string when toJSON or the replacer receives it */
 static JSValue js_json_check(JSContext *ctx, JSONStringifyContext *jsc,
                              JSValue holder, JSValue val, JSValue key)
 {
-    JSValue v;
+    JSValue v, key_str;
     JSValue args[2];
 
+    key_str = JS_UNDEFINED;
     if (JS_IsObject(val) || JS_IsBigInt(ctx, val)) {
 		JSValue f = JS_GetProperty(ctx, val, JS_ATOM_toJSON);
 		if (JS_IsException(f))
 			goto exception;
 		if (JS_IsFunction(ctx, f)) {
-			v = JS_CallFree(ctx, f, val, 1, &key);
+			key_str = JS_ToString(ctx, key);
+			if (JS_IsException(key_str)) {
+				JS_FreeValue(ctx, f);
+				goto exception;
+			}
+			v = JS_CallFree(ctx, f, val, 1, &key_str);
 			JS_FreeValue(ctx, val);
 			val = v;
 			if (JS_IsException(val))
@@ -45317,7 +46533,12 @@ static JSValue js_json_check(JSContext *ctx, JSONStringifyContext *jsc,
 	}
 
     if (!JS_IsUndefined(jsc->replacer_func)) {
-        args[0] = key;
+        if (JS_IsUndefined(key_str)) {
+            key_str = JS_ToString(ctx, key);
+            if (JS_IsException(key_str))
+                goto exception;
+        }
+        args[0] = key_str;
         args[1] = val;
         v = JS_Call(ctx, jsc->replacer_func, holder, 2, args);
         JS_FreeValue(ctx, val);
@@ -45325,12 +46546,14 @@ static JSValue js_json_check(JSContext *ctx, JSONStringifyContext *jsc,
         if (JS_IsException(val))
             goto exception;
     }
+    JS_FreeValue(ctx, key_str);
 
     switch (JS_VALUE_GET_NORM_TAG(val)) {
     case JS_TAG_OBJECT:
         if (JS_IsFunction(ctx, val))
             break;
     case JS_TAG_STRING:
+    case JS_TAG_STRING_ROPE:
     case JS_TAG_INT:
     case JS_TAG_FLOAT64:
     case JS_TAG_BOOL:
@@ -45345,19 +46568,129 @@ static JSValue js_json_check(JSContext *ctx, JSONStringifyContext *jsc,
     return JS_UNDEFINED;
 
 exception:
+    JS_FreeValue(ctx, key_str);
     JS_FreeValue(ctx, val);
     return JS_EXCEPTION;
 }
 
+/* Look up the serialized keys for the shape of `p`, computing them on
+   first use. Store NULL into `*psk` if `p` must take the generic path:
+   exotic objects, getters, array index keys (which are enumerated first)
+   and unhashed shapes, which may be modified in place. The cache holds a
+   reference to each shape: a shared hashed shape is cloned rather than
+   modified, so the cached keys stay valid for the whole call. Running out
+   of memory also leaves `p` to the generic path, which reports the error
+   if memory is still short. */
+static void js_json_shape_keys(JSContext *ctx, JSONStringifyContext *jsc,
+                               JSObject *p, JSONShapeKeys **psk)
+{
+    JSShape *sh = p->shape;
+    JSShapeProperty *prs;
+    JSONShapeKeys *sk;
+    StringBuffer b_s, *b = &b_s;
+    JSValue *keys;
+    uint32_t h, idx;
+    int i;
+
+    *psk = NULL;
+    if (p->class_id != JS_CLASS_OBJECT || p->is_exotic || !sh->is_hashed ||
+        sh->has_small_array_index)
+        return;
+    h = (uint32_t)((uintptr_t)sh >> 4);
+    for(;;) {
+        sk = &jsc->shape_keys[h & (JSON_SHAPE_KEYS_SIZE - 1)];
+        if (sk->sh == sh) {
+            if (sk->keys)
+                *psk = sk;
+            return;
+        }
+        if (!sk->sh)
+            break;
+        h++;
+    }
+    /* keep the table sparse, later shapes take the generic path */
+    if (jsc->shape_keys_count >= JSON_SHAPE_KEYS_SIZE * 3 / 4)
+        return;
+
+    keys = js_malloc(ctx, sizeof(keys[0]) * max_int(sh->prop_count, 1));
+    if (!keys)
+        goto fail;
+    for(i = 0, prs = get_shape_prop(sh); i < sh->prop_count; i++, prs++)
+        keys[i] = JS_UNDEFINED;
+    for(i = 0, prs = get_shape_prop(sh); i < sh->prop_count; i++, prs++) {
+        if (prs->atom == JS_ATOM_NULL ||
+            JS_AtomGetKind(ctx, prs->atom) != JS_ATOM_KIND_STRING ||
+            !(prs->flags & JS_PROP_ENUMERABLE))
+            continue;
+        if ((prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL ||
+            JS_AtomIsArrayIndex(ctx, &idx, prs->atom)) {
+            /* not eligible: remember it to avoid checking again */
+            for(i = 0; i < sh->prop_count; i++)
+                JS_FreeValue(ctx, keys[i]);
+            js_free(ctx, keys);
+            keys = NULL;
+            break;
+        }
+        if (string_buffer_init(ctx, b, 16))
+            goto fail;
+        if (json_quote_string(b, ctx->rt->atom_array[prs->atom]) ||
+            string_buffer_putc8(b, ':')) {
+            string_buffer_free(b);
+            goto fail;
+        }
+        keys[i] = string_buffer_end(b);
+        if (JS_IsException(keys[i])) {
+            keys[i] = JS_UNDEFINED;
+            goto fail;
+        }
+    }
+    sk->sh = js_dup_shape(sh);
+    sk->keys = keys;
+    jsc->shape_keys_count++;
+    if (keys)
+        *psk = sk;
+    return;
+ fail:
+    if (keys) {
+        for(i = 0; i < sh->prop_count; i++)
+            JS_FreeValue(ctx, keys[i]);
+        js_free(ctx, keys);
+    }
+    JS_FreeValue(ctx, JS_GetException(ctx));
+}
+
+static void js_json_free_shape_keys(JSContext *ctx, JSONStringifyContext *jsc)
+{
+    JSONShapeKeys *sk;
+    int i, j;
+
+    for(i = 0; i < JSON_SHAPE_KEYS_SIZE; i++) {
+        sk = &jsc->shape_keys[i];
+        if (!sk->sh)
+            continue;
+        if (sk->keys) {
+            for(j = 0; j < sk->sh->prop_count; j++)
+                JS_FreeValue(ctx, sk->keys[j]);
+            js_free(ctx, sk->keys);
+        }
+        js_free_shape(ctx->rt, sk->sh);
+    }
+}
+
 static int js_json_to_str(JSContext *ctx, JSONStringifyContext *jsc,
                           JSValue holder, JSValue val,
                           JSValue indent)
 {
     JSValue indent1, sep, sep1, tab, v, prop;
     JSObject *p;
+    JSONShapeKeys *sk;
+    JSShape *sh;
     int64_t i, len;
     int cl, ret;
     BOOL has_content;
+    char buf[JS_DTOA_BUF_SIZE];
+    const char *str;
+    size_t str_len;
 
     indent1 = JS_UNDEFINED;
     sep = JS_UNDEFINED;
@@ -45420,13 +46753,7 @@ static int js_json_to_str(JSContext *ctx, JSONStringifyContext *jsc,
                 v = JS_GetPropertyInt64(ctx, val, i);
                 if (JS_IsException(v))
                     goto exception;
-                /* XXX: could do this string conversion only when needed */
-                prop = JS_ToStringFree(ctx, js_int64(i));
-                if (JS_IsException(prop))
-                    goto exception;
-                v = js_json_check(ctx, jsc, val, v, prop);
-                JS_FreeValue(ctx, prop);
-                prop = JS_UNDEFINED;
+                v = js_json_check(ctx, jsc, val, v, js_int64(i));
                 if (JS_IsException(v))
                     goto exception;
                 if (JS_IsUndefined(v))
@@ -45440,6 +46767,57 @@ static int js_json_to_str(JSContext *ctx, JSONStringifyContext *jsc,
             }
             string_buffer_putc8(jsc->b, ']');
         } else {
+            sk = NULL;
+            if (JS_IsUndefined(jsc->property_list) &&
+                JS_IsUndefined(jsc->replacer_func))
+                js_json_shape_keys(ctx, jsc, p, &sk);
+            if (sk) {
+                /* fast path: the keys and their order come from the
+                   shape. Values are read from the object directly while
+                   its shape is unchanged; if toJSON modified it, they
+                   are looked up like in the generic path. */
+                sh = sk->sh;
+                string_buffer_putc8(jsc->b, '{');
+                has_content = FALSE;
+                for(i = 0; i < sh->prop_count; i++) {
+                    if (JS_IsUndefined(sk->keys[i]))
+                        continue;
+                    if (likely(p->shape == sh)) {
+                        v = js_dup(p->prop[i].u.value);
+                    } else {
+                        v = JS_GetProperty(ctx, val, get_shape_prop(sh)[i].atom);
+                        if (JS_IsException(v))
+                            goto exception;
+                    }
+                    if (JS_IsObject(v) || JS_IsBigInt(ctx, v)) {
+                        /* the name is only needed for toJSON */
+                        prop = JS_AtomToString(ctx, get_shape_prop(sh)[i].atom);
+                        v = js_json_check(ctx, jsc, val, v, prop);
+                        JS_FreeValue(ctx, prop);
+                        prop = JS_UNDEFINED;
+                    } else {
+                        v = js_json_check(ctx, jsc, val, v, JS_UNDEFINED);
+                    }
+                    if (JS_IsException(v))
+                        goto exception;
+                    if (!JS_IsUndefined(v)) {
+                        if (has_content)
+                            string_buffer_putc8(jsc->b, ',');
+                        string_buffer_concat_value(jsc->b, sep);
+                        string_buffer_concat_value(jsc->b, sk->keys[i]);
+                        string_buffer_concat_value(jsc->b, sep1);
+                        if (js_json_to_str(ctx, jsc, val, v, indent1))
+                            goto exception;
+                        has_content = TRUE;
+                    }
+                }
+                if (has_content && JS_VALUE_GET_STRING(jsc->gap)->len != 0) {
+                    string_buffer_putc8(jsc->b, '\n');
+                    string_buffer_concat_value(jsc->b, indent);
+                }
+                string_buffer_putc8(jsc->b, '}');
+                goto done;
+            }
             if (!JS_IsUndefined(jsc->property_list))
                 tab = js_dup(jsc->property_list);
             else
@@ -45464,13 +46842,11 @@ static int js_json_to_str(JSContext *ctx, JSONStringifyContext *jsc,
                 if (!JS_IsUndefined(v)) {
                     if (has_content)
                         string_buffer_putc8(jsc->b, ',');
-                    prop = JS_ToQuotedStringFree(ctx, prop);
-                    if (JS_IsException(prop)) {
+                    string_buffer_concat_value(jsc->b, sep);
+                    if (json_quote_string(jsc->b, JS_VALUE_GET_STRING(prop))) {
                         JS_FreeValue(ctx, v);
                         goto exception;
                     }
-                    string_buffer_concat_value(jsc->b, sep);
-                    string_buffer_concat_value(jsc->b, prop);
                     string_buffer_putc8(jsc->b, ':');
                     string_buffer_concat_value(jsc->b, sep1);
                     if (js_json_to_str(ctx, jsc, val, v, indent1))
@@ -45484,6 +46860,7 @@ static int js_json_to_str(JSContext *ctx, JSONStringifyContext *jsc,
             }
             string_buffer_putc8(jsc->b, '}');
         }
+    done:
         if (check_exception_free(ctx, js_array_pop(ctx, jsc->stack, 0, NULL, 0)))
             goto exception;
         JS_FreeValue(ctx, val);
@@ -45495,22 +46872,31 @@ static int js_json_to_str(JSContext *ctx, JSONStringifyContext *jsc,
         return 0;
     }
  concat_primitive:
+    /* primitives are written to the buffer without intermediate strings */
     switch (JS_VALUE_GET_NORM_TAG(val)) {
-    case JS_TAG_STRING:
-        val = JS_ToQuotedStringFree(ctx, val);
+    case JS_TAG_STRING_ROPE:
+        val = js_string_flat_free(ctx, val);
         if (JS_IsException(val))
-            goto exception;
-        goto concat_value;
+            return -1;
+        /* fall through */
+    case JS_TAG_STRING:
+        ret = json_quote_string(jsc->b, JS_VALUE_GET_STRING(val));
+        JS_FreeValue(ctx, val);
+        return ret;
     case JS_TAG_FLOAT64:
-        if (!isfinite(JS_VALUE_GET_FLOAT64(val))) {
-            val = JS_NULL;
-        }
-        goto concat_value;
+        if (!isfinite(JS_VALUE_GET_FLOAT64(val)))
+            return string_buffer_puts8(jsc->b, "null");
+        str = js_dtoa_cstr(JS_VALUE_GET_FLOAT64(val), 0, JS_DTOA_TOSTRING,
+                           buf, &str_len);
+        return string_buffer_write8(jsc->b, (const uint8_t *)str, str_len);
     case JS_TAG_INT:
+        str_len = i32toa(buf, JS_VALUE_GET_INT(val));
+        return string_buffer_write8(jsc->b, (const uint8_t *)buf, str_len);
     case JS_TAG_BOOL:
+        return string_buffer_puts8(jsc->b, JS_VALUE_GET_BOOL(val) ?
+                                   "true" : "false");
     case JS_TAG_NULL:
-    concat_value:
-        return string_buffer_concat_value_free(jsc->b, val);
+        return string_buffer_puts8(jsc->b, "null");
     case JS_TAG_BIG_INT:
         JS_ThrowTypeError(ctx, "BigInt are forbidden in JSON.stringify");
         goto exception;
@@ -45544,6 +46930,8 @@ JSValue JS_JSONStringify(JSContext *ctx, JSValue obj,
     jsc->gap = JS_UNDEFINED;
     jsc->b = &b_s;
     jsc->empty = JS_AtomToString(ctx, JS_ATOM_empty_string);
+    jsc->shape_keys_count = 0;
+    memset(jsc->shape_keys, 0, sizeof(jsc->shape_keys));
     ret = JS_UNDEFINED;
     wrapper = JS_UNDEFINED;
 
@@ -45588,6 +46976,10 @@ JSValue JS_JSONStringify(JSContext *ctx, JSValue obj,
                     JS_FreeValue(ctx, v);
                     continue;
                 }
+                /* the names are quoted as flat strings */
+                v = js_string_flat_free(ctx, v);
+                if (JS_IsException(v))
+                    goto exception;
                 present = js_array_includes(ctx, jsc->property_list,
                                             1, &v);
                 if (JS_IsException(present)) {
@@ -45621,7 +47013,11 @@ JSValue JS_JSONStringify(JSContext *ctx, JSValue obj,
             goto exception;
         jsc->gap = JS_NewStringLen(ctx, "          ", n);
     } else if (JS_IsString(space)) {
-        JSString *p = JS_VALUE_GET_STRING(space);
+        JSString *p;
+        space = js_string_flat_free(ctx, space);
+        if (JS_IsException(space))
+            goto exception;
+        p = JS_VALUE_GET_STRING(space);
         jsc->gap = js_sub_string(ctx, p, 0, min_int(p->len, 10));
     } else {
         jsc->gap = js_dup(jsc->empty);
@@ -45655,6 +47051,7 @@ exception:
 done1:
     string_buffer_free(jsc->b);
 done:
+    js_json_free_shape_keys(ctx, jsc);
     JS_FreeValue(ctx, wrapper);
     JS_FreeValue(ctx, jsc->empty);
     JS_FreeValue(ctx, jsc->gap);
@@ -47088,6 +48485,17 @@ static uint32_t map_hash_key(JSContext *ctx, JSValue key)
     case JS_TAG_STRING:
         h = hash_string(JS_VALUE_GET_STRING(key), 0);
         break;
+    case JS_TAG_STRING_ROPE:
+        /* hash like the flat string. XXX: if the rope cannot be
+           flattened, the out of memory exception is left pending */
+        key = js_string_flat(ctx, key);
+        if (JS_IsException(key)) {
+            h = 0;
+        } else {
+            h = hash_string(JS_VALUE_GET_STRING(key), 0);
+        }
+        tag = JS_TAG_STRING;
+        break;
     case JS_TAG_OBJECT:
     case JS_TAG_SYMBOL:
         h = (uintptr_t)JS_VALUE_GET_PTR(key) * 3163;
@@ -51347,6 +52755,7 @@ static JSValue JS_ToBigIntCtorFree(JSContext *ctx, JSValue val)
         }
         break;
     case JS_TAG_STRING:
+    case JS_TAG_STRING_ROPE:
         val = JS_StringToBigIntErr(ctx, val);
         break;
     case JS_TAG_OBJECT:
@@ -51977,7 +53386,8 @@ static void js_array_buffer_finalizer(JSRuntime *rt, JSValue val)
         if (abuf->shared && rt->sab_funcs.sab_free) {
             rt->sab_funcs.sab_free(rt->sab_funcs.sab_opaque, abuf->data);
         } else {
-            if (abuf->free_func)
+            /* a detached buffer already released or handed over its data */
+            if (abuf->free_func && !abuf->detached)
                 abuf->free_func(rt, abuf->opaque, abuf->data);
         }
         js_free_rt(rt, abuf);
@@ -52132,6 +53542,7 @@ static JSValue js_array_buffer_transfer(JSContext *ctx, JSValue this_val,
 {
     BOOL transfer_to_fixed_length = magic & 1;
     JSArrayBuffer *abuf;
+    struct list_head *el;
     uint64_t new_len, old_len, max_len, *pmax_len;
     uint8_t *bs, *new_bs;
 
@@ -52165,6 +53576,20 @@ static JSValue js_array_buffer_transfer(JSContext *ctx, JSValue this_val,
     }
     bs = abuf->data;
     old_len = abuf->byte_length;
+    /* externally managed memory cannot be reallocated: copy it into a new
+       buffer and let the owner release the old one */
+    if (new_len != old_len && abuf->free_func != js_array_buffer_free) {
+        JSValue obj = js_array_buffer_constructor3(ctx, JS_UNDEFINED, new_len,
+                                                   NULL, JS_CLASS_ARRAY_BUFFER,
+                                                   NULL, js_array_buffer_free,
+                                                   NULL, TRUE);
+        if (JS_IsException(obj))
+            return obj;
+        memcpy(js_get_array_buffer(ctx, obj)->data, bs,
+               min_int(new_len, old_len));
+        JS_DetachArrayBuffer(ctx, this_val);
+        return obj;
+    }
     /* if length mismatch, realloc. Otherwise, use the same backing buffer. */
     if (new_len != old_len) {
         new_bs = js_realloc(ctx, bs, new_len);
@@ -52178,10 +53603,22 @@ static JSValue js_array_buffer_transfer(JSContext *ctx, JSValue this_val,
     abuf->data = NULL;
     abuf->byte_length = 0;
     abuf->detached = TRUE;
+    /* views of the old buffer must not reach the data it handed over */
+    list_for_each(el, &abuf->array_list) {
+        JSTypedArray *ta;
+        JSObject *p;
+
+        ta = list_entry(el, JSTypedArray, link);
+        p = ta->obj;
+        if (p->class_id != JS_CLASS_DATAVIEW) {
+            p->u.array.count = 0;
+            p->u.array.u.ptr = NULL;
+        }
+    }
     return js_array_buffer_constructor3(ctx, JS_UNDEFINED, new_len, pmax_len,
                                         JS_CLASS_ARRAY_BUFFER,
                                         bs, abuf->free_func,
-                                        NULL, FALSE);
+                                        abuf->opaque, FALSE);
 }
 
 static JSValue js_array_buffer_resize(JSContext *ctx, JSValue this_val,
@@ -0,0 +1,65 @@
+// Helpers for the benchmarks that run JS cases on a script_context. A case
+// is a global script that sets globalThis.result once it is done, to its
+// result or to String(error).
+#pragma once
+#include "breeze-js/script.h"
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace bench {
+// Evaluates `code` as a global script on the JS thread
+inline void eval(breeze::script_context &ctx, const std::string &code,
+                 const char *filename = "<case>") {
+  ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    JSValue r = JS_Eval(jsctx, code.c_str(), code.size(), filename,
+                        JS_EVAL_TYPE_GLOBAL);
+    JS_FreeValue(jsctx, r);
+  });
+}
+
+// Sets globalThis[name] to the string `value`
+inline void set_global(breeze::script_context &ctx, const char *name,
+                       const std::string &value) {
+  ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    JSValue global = JS_GetGlobalObject(jsctx);
+    JS_SetPropertyStr(jsctx, global, name, JS_NewString(jsctx, value.c_str()));
+    JS_FreeValue(jsctx, global);
+  });
+}
+
+// Returns globalThis.result as a string and clears it, or nullopt when no
+// case has set it since
+inline std::optional<std::string> take_result(breeze::script_context &ctx) {
+  return ctx.post_sync([&]() -> std::optional<std::string> {
+    auto *jsctx = ctx.js->ctx;
+    JSValue global = JS_GetGlobalObject(jsctx);
+    JSValue v = JS_GetPropertyStr(jsctx, global, "result");
+    std::optional<std::string> s;
+    if (!JS_IsUndefined(v)) {
+      const char *str = JS_ToCString(jsctx, v);
+      s = str ? str : "?";
+      JS_FreeCString(jsctx, str);
+      JS_SetPropertyStr(jsctx, global, "result", JS_UNDEFINED);
+    }
+    JS_FreeValue(jsctx, v);
+    JS_FreeValue(jsctx, global);
+    return s;
+  });
+}
+
+// Waits for a case to set globalThis.result, see take_result()
+inline std::string
+wait_result(breeze::script_context &ctx,
+            std::chrono::microseconds poll = std::chrono::milliseconds(1)) {
+  for (;;) {
+    std::this_thread::sleep_for(poll);
+    if (auto result = take_result(ctx))
+      return *result;
+  }
+}
+} // namespace bench
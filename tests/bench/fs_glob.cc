@@ -0,0 +1,85 @@
+// Measures finding the sources of a monorepo: 500k files (or the count given
+// as argument) in packages of src/ trees next to a node_modules twice their
+// size, matched against **/*.{js,ts} with node_modules ignored. Compares a
+// JS-side recursive readdirEntriesSync and filter with
+// breeze.filesystem.globSync and the streamed glob.
+// xmake build bench-fs_glob && xmake run bench-fs_glob [files]
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using clock_type = std::chrono::steady_clock;
+
+static const char *cases[][2] = {
+    {"readdirEntriesSync+filter", R"(
+globalThis.result = breeze.filesystem
+  .readdirEntriesSync(root, { recursive: true })
+  .filter((e) => !e.path.split("/").includes("node_modules") &&
+                 /\.(js|ts)$/.test(e.path)).length;
+)"},
+    {"globSync", R"(
+globalThis.result = breeze.filesystem.globSync("**/*.{js,ts}", {
+  cwd: root, ignore: ["**/node_modules"] }).length;
+)"},
+    {"glob", R"(
+(async () => {
+  let n = 0;
+  for await (const e of breeze.filesystem.glob("**/*.{js,ts}", {
+    cwd: root, ignore: ["**/node_modules"] }))
+    n++;
+  return n;
+})().then((n) => { globalThis.result = n; },
+          (e) => { globalThis.result = String(e); });
+)"},
+};
+
+// A package: 3 directories of 100 sources and node_modules with 600 files
+static void make_tree(const std::filesystem::path &root, long files) {
+  std::filesystem::remove_all(root);
+  for (long pkg = 0; pkg * 900 < files; pkg++) {
+    auto dir = root / "packages" / ("pkg-" + std::to_string(pkg));
+    for (int sub = 0; sub < 3; sub++) {
+      auto src = dir / "src" / ("mod-" + std::to_string(sub));
+      std::filesystem::create_directories(src);
+      for (int i = 0; i < 100; i++)
+        std::ofstream(src / ("file-" + std::to_string(i) +
+                             (i % 2 ? ".ts" : ".js")));
+    }
+    for (int dep = 0; dep < 12; dep++) {
+      auto lib = dir / "node_modules" / ("dep-" + std::to_string(dep));
+      std::filesystem::create_directories(lib);
+      for (int i = 0; i < 50; i++)
+        std::ofstream(lib / ("index-" + std::to_string(i) + ".js"));
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  long files = argc > 1 ? std::atol(argv[1]) : 500'000;
+  auto root = std::filesystem::temp_directory_path() / "breeze-bench-glob";
+  auto start = clock_type::now();
+  make_tree(root, files);
+  std::chrono::duration<double> setup = clock_type::now() - start;
+  std::printf("created %ld files in %.1f s\n", files, setup.count());
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  bench::set_global(ctx, "root", root.string());
+
+  for (auto [name, code] : cases) {
+    start = clock_type::now();
+    bench::eval(ctx, code);
+    auto result = bench::wait_result(ctx);
+    std::chrono::duration<double, std::milli> elapsed =
+        clock_type::now() - start;
+    std::printf("%-20s %10s %10.1f ms\n", name, result.c_str(),
+                elapsed.count());
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,80 @@
+// Measures scanning a large file from JS: a 128 MiB file (or the size in MiB
+// given as argument) loaded with breeze.filesystem.readFileSync, readFile
+// and mmap, then summed through a Uint32Array. The second mmap case only
+// reads one 4 KiB page out of every 64 KiB.
+// xmake build bench-fs_mmap && xmake run bench-fs_mmap [MiB]
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const char *cases[][2] = {
+    {"readFileSync", R"(
+globalThis.result = sum(breeze.filesystem.readFileSync(path));
+)"},
+    {"readFile", R"(
+breeze.filesystem.readFile(path)
+  .then((buf) => { globalThis.result = sum(buf); },
+        (e) => { globalThis.result = String(e); });
+)"},
+    {"mmap", R"(
+globalThis.result =
+  sum(breeze.filesystem.mmap(path, { advice: "sequential" }));
+)"},
+    {"mmap sparse", R"(
+{
+  const words = new Uint32Array(breeze.filesystem.mmap(path, {
+    advice: "random" }));
+  let s = 0;
+  for (let i = 0; i < words.length; i += 16384) {
+    const end = Math.min(i + 1024, words.length);
+    for (let j = i; j < end; j++) s = (s + words[j]) | 0;
+  }
+  globalThis.result = s;
+}
+)"},
+};
+
+int main(int argc, char **argv) {
+  long mib = argc > 1 ? std::atol(argv[1]) : 128;
+  auto path = std::filesystem::temp_directory_path() / "breeze-bench-mmap.bin";
+  {
+    std::vector<uint32_t> chunk(1 << 18);
+    for (size_t i = 0; i < chunk.size(); i++)
+      chunk[i] = uint32_t(i * 2654435761u);
+    std::ofstream out(path, std::ios::binary);
+    for (long i = 0; i < mib; i++)
+      out.write(reinterpret_cast<const char *>(chunk.data()), 1 << 20);
+  }
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  auto setup = "globalThis.path = '" + path.generic_string() + "';" + R"(
+globalThis.sum = (buf) => {
+  const words = new Uint32Array(buf);
+  let s = 0;
+  for (let i = 0; i < words.length; i++) s = (s + words[i]) | 0;
+  return s;
+};
+)";
+  bench::eval(ctx, setup, "<setup>");
+
+  for (auto [name, code] : cases) {
+    auto start = std::chrono::steady_clock::now();
+    bench::eval(ctx, code);
+    auto result = bench::wait_result(ctx);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::printf("%-14s %12s %10.1f ms\n", name, result.c_str(),
+                elapsed.count());
+    // Unmaps and frees the buffer before the next case
+    ctx.post_sync([&] { JS_RunGC(JS_GetRuntime(ctx.js->ctx)); });
+  }
+  std::filesystem::remove(path);
+  return 0;
+}
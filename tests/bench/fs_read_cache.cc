@@ -0,0 +1,79 @@
+// Measures a plugin re-reading its templates on every request: 50 files of
+// 4 to 32 KiB read 200 times each (or the given number of rounds) with
+// breeze.filesystem.readFileAsString and readFileSync, without and with the
+// read cache.
+// xmake build bench-fs_read_cache && xmake run bench-fs_read_cache [rounds]
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace std::chrono_literals;
+
+static const char *cases[][2] = {
+    {"readFileAsString", R"(
+(async () => {
+  let bytes = 0;
+  for (let r = 0; r < rounds; r++)
+    for (const p of paths)
+      bytes += (await breeze.filesystem.readFileAsString(p)).length;
+  return bytes;
+})().then((n) => { globalThis.result = n; },
+          (e) => { globalThis.result = String(e); });
+)"},
+    {"readFileSync", R"(
+(async () => {
+  let bytes = 0;
+  for (let r = 0; r < rounds; r++)
+    for (const p of paths)
+      bytes += breeze.filesystem.readFileSync(p).byteLength;
+  return bytes;
+})().then((n) => { globalThis.result = n; },
+          (e) => { globalThis.result = String(e); });
+)"},
+};
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+  auto root = std::filesystem::temp_directory_path() / "breeze-bench-cache";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  std::string paths = "[";
+  for (int i = 0; i < 50; i++) {
+    auto path = root / ("template-" + std::to_string(i) + ".html");
+    std::ofstream(path, std::ios::binary)
+        << std::string(4096 + i * 577, 'a' + i % 26);
+    // Files modified in the last 2 seconds are not cached
+    std::filesystem::last_write_time(
+        path, std::filesystem::file_time_type::clock::now() - 1h);
+    paths += (i ? ",'" : "'") + path.generic_string() + "'";
+  }
+  paths += "]";
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  auto setup = "globalThis.paths = " + paths +
+               "; globalThis.rounds = " + std::to_string(rounds) + ";";
+  bench::eval(ctx, setup, "<setup>");
+
+  for (bool cached : {false, true}) {
+    const char *toggle = cached ? "breeze.filesystem.configureReadCache();"
+                                : "breeze.filesystem.disableReadCache();";
+    bench::eval(ctx, toggle, "<setup>");
+    for (auto [name, code] : cases) {
+      auto start = std::chrono::steady_clock::now();
+      bench::eval(ctx, code);
+      auto result = bench::wait_result(ctx);
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::printf("%-18s %-6s %12s bytes %10.1f ms\n", name,
+                  cached ? "cache" : "disk", result.c_str(), elapsed.count());
+    }
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,117 @@
+// Measures the event loop latency while breeze.filesystem lists and then
+// deletes a tree of 1M entries (1000 directories of 999 files each, or the
+// count given as argument). A probe thread posts a task to the JS thread
+// every millisecond; the time each task waits to run is the latency. The
+// readdirEntries and walk cases list with types, with and without stat data.
+// xmake build bench-fs_readdir && xmake run bench-fs_readdir [entries]
+#include "bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using clock_type = std::chrono::steady_clock;
+
+static const char *cases[][2] = {
+    {"readdirSync", R"(
+globalThis.result =
+  breeze.filesystem.readdirSync(root, { recursive: true }).length;
+)"},
+    {"readdir", R"(
+breeze.filesystem.readdir(root, { recursive: true })
+  .then((names) => { globalThis.result = names.length; },
+        (e) => { globalThis.result = String(e); });
+)"},
+    {"readdirEntries", R"(
+breeze.filesystem.readdirEntries(root, { recursive: true })
+  .then((entries) => {
+    globalThis.result = entries.filter((e) => e.type === "file").length;
+  }, (e) => { globalThis.result = String(e); });
+)"},
+    {"+ stat", R"(
+breeze.filesystem.readdirEntries(root, { recursive: true, stat: true })
+  .then((entries) => {
+    globalThis.result = entries.reduce((n, e) => n + (e.size ?? 0), 0);
+  }, (e) => { globalThis.result = String(e); });
+)"},
+    {"walk", R"(
+(async () => {
+  let n = 0;
+  for await (const e of breeze.filesystem.walk(root, { recursive: true }))
+    if (e.type === "file") n++;
+  return n;
+})().then((n) => { globalThis.result = n; },
+          (e) => { globalThis.result = String(e); });
+)"},
+    {"rm", R"(
+breeze.filesystem.rm(root, { recursive: true })
+  .then((ok) => { globalThis.result = ok ? 1 : 0; },
+        (e) => { globalThis.result = String(e); });
+)"},
+};
+
+static void make_tree(const std::filesystem::path &root, long entries) {
+  std::filesystem::remove_all(root);
+  for (long dir = 0; dir * 1000 < entries; dir++) {
+    auto sub = root / ("dir-" + std::to_string(dir));
+    std::filesystem::create_directories(sub);
+    for (long i = 1; i < 1000 && dir * 1000 + i < entries; i++)
+      std::ofstream(sub / ("file-" + std::to_string(i) + ".txt")) << i;
+  }
+}
+
+int main(int argc, char **argv) {
+  long entries = argc > 1 ? std::atol(argv[1]) : 1'000'000;
+  auto root = std::filesystem::temp_directory_path() / "breeze-bench-readdir";
+  auto start = clock_type::now();
+  make_tree(root, entries);
+  std::chrono::duration<double> setup = clock_type::now() - start;
+  std::printf("created %ld entries in %.1f s\n", entries, setup.count());
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  bench::set_global(ctx, "root", root.string());
+
+  for (auto [name, code] : cases) {
+    // Only touched on the JS thread until the probe thread is joined
+    std::vector<double> latencies;
+    std::atomic<bool> stop = false;
+    std::thread probe([&] {
+      while (!stop) {
+        ctx.post([&latencies, posted = clock_type::now()] {
+          std::chrono::duration<double, std::milli> waited =
+              clock_type::now() - posted;
+          latencies.push_back(waited.count());
+        });
+        std::this_thread::sleep_for(1ms);
+      }
+    });
+
+    start = clock_type::now();
+    bench::eval(ctx, code);
+    auto result = bench::wait_result(ctx);
+    std::chrono::duration<double, std::milli> elapsed =
+        clock_type::now() - start;
+    stop = true;
+    probe.join();
+    // Runs after every probe task still queued
+    ctx.post_sync([] {});
+
+    std::sort(latencies.begin(), latencies.end());
+    double p99 = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+    double worst = latencies.empty() ? 0 : latencies.back();
+    std::printf("%-14s %10s %10.1f ms   loop latency p99 %8.1f ms, max %8.1f "
+                "ms\n",
+                name, result.c_str(), elapsed.count(), p99, worst);
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
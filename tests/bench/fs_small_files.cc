@@ -0,0 +1,65 @@
+// Measures loading many small assets at once, as done at startup: 5000
+// files of 2 to 8 KiB (or the count given as argument) read with
+// Promise.all over breeze.filesystem.readFile and readFileAsString, then
+// written back with writeFile.
+// xmake build bench-fs_small_files && xmake run bench-fs_small_files [files]
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+
+static const char *cases[][2] = {
+    {"readFile", R"(
+Promise.all(paths.map((p) => breeze.filesystem.readFile(p)))
+  .then((bufs) => { globalThis.result = bufs.length; },
+        (e) => { globalThis.result = String(e); });
+)"},
+    {"readFileAsString", R"(
+Promise.all(paths.map((p) => breeze.filesystem.readFileAsString(p)))
+  .then((texts) => { globalThis.result = texts.length; },
+        (e) => { globalThis.result = String(e); });
+)"},
+    {"writeFile", R"(
+Promise.all(paths.map((p, i) =>
+    breeze.filesystem.writeFile(p, new Uint8Array(2048 + i % 6144).buffer)))
+  .then((oks) => { globalThis.result = oks.length; },
+        (e) => { globalThis.result = String(e); });
+)"},
+};
+
+int main(int argc, char **argv) {
+  int files = argc > 1 ? std::atoi(argv[1]) : 5000;
+  auto root =
+      std::filesystem::temp_directory_path() / "breeze-bench-small-files";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root);
+  for (int i = 0; i < files; i++) {
+    std::ofstream(root / ("asset-" + std::to_string(i) + ".json"))
+        << std::string(2048 + i % 6144, 'a');
+  }
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  auto setup = std::format(
+      "globalThis.paths = Array.from({{ length: {} }}, (_, i) => "
+      "`{}/asset-${{i}}.json`);",
+      files, root.generic_string());
+  bench::eval(ctx, setup, "<setup>");
+
+  for (auto [name, code] : cases) {
+    auto start = std::chrono::steady_clock::now();
+    bench::eval(ctx, code);
+    auto result = bench::wait_result(ctx);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::printf("%-18s %8s files %10.1f ms\n", name, result.c_str(),
+                elapsed.count());
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
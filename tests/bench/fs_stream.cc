@@ -0,0 +1,99 @@
+// Measures counting the lines of a large log: a 256 MiB file (or the size in
+// MiB given as argument) streamed through a breeze.filesystem.FileHandle,
+// against readFileAsString and split. Prints the time and the peak resident
+// memory after each case; the streaming cases run first since the peak
+// only grows.
+// xmake build bench-fs_stream && xmake run bench-fs_stream [MiB]
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+// K32GetProcessMemoryInfo from kernel32, no psapi.lib needed
+#define PSAPI_VERSION 2
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static const char *cases[][2] = {
+    {"lines()", R"(
+(async () => {
+  const h = await breeze.filesystem.open(path);
+  let n = 0;
+  for await (const line of h.lines()) if (line.includes(" ERROR ")) n++;
+  h.close();
+  return n;
+})().then((n) => { globalThis.result = n; },
+          (e) => { globalThis.result = String(e); });
+)"},
+    {"chunks()", R"(
+(async () => {
+  const h = await breeze.filesystem.open(path);
+  let n = 0;
+  for await (const chunk of h)
+    for (let i = chunk.indexOf(10); i >= 0; i = chunk.indexOf(10, i + 1)) n++;
+  h.close();
+  return n;
+})().then((n) => { globalThis.result = n; },
+          (e) => { globalThis.result = String(e); });
+)"},
+    {"readFileAsString", R"(
+breeze.filesystem.readFileAsString(path)
+  .then((text) => {
+    globalThis.result =
+      text.split("\n").filter((line) => line.includes(" ERROR ")).length;
+  }, (e) => { globalThis.result = String(e); });
+)"},
+};
+
+static double peak_mib() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PeakWorkingSetSize / 1048576.0;
+#else
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1048576.0;
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+int main(int argc, char **argv) {
+  long mib = argc > 1 ? std::atol(argv[1]) : 256;
+  auto path =
+      std::filesystem::temp_directory_path() / "breeze-bench-stream.log";
+  {
+    std::ofstream out(path, std::ios::binary);
+    for (long i = 0; out.tellp() < mib << 20; i++) {
+      out << "2024-05-01T12:00:00Z " << (i % 50 ? "INFO" : "ERROR")
+          << " request " << i << " served in " << i % 997 << " ms\n";
+    }
+  }
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  bench::set_global(ctx, "path", path.string());
+
+  for (auto [name, code] : cases) {
+    auto start = std::chrono::steady_clock::now();
+    bench::eval(ctx, code);
+    auto result = bench::wait_result(ctx);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::printf("%-18s %10s %10.1f ms   peak RSS %8.1f MiB\n", name,
+                result.c_str(), elapsed.count(), peak_mib());
+  }
+  std::filesystem::remove(path);
+  return 0;
+}
@@ -0,0 +1,69 @@
+// Measures the delay from a file write to the breeze.filesystem.watch
+// callback, with 200 directories (or the count given as argument) watched
+// separately, all through one inotify descriptor, and debounce_ms of 0 and
+// 50.
+// xmake build bench-fs_watch && xmake run bench-fs_watch [watchers]
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using clock_type = std::chrono::steady_clock;
+
+int main(int argc, char **argv) {
+  int watchers = argc > 1 ? std::atoi(argv[1]) : 200;
+  auto root = std::filesystem::temp_directory_path() / "breeze-bench-watch";
+  std::filesystem::remove_all(root);
+  for (int i = 0; i < watchers; i++)
+    std::filesystem::create_directories(root / ("dir-" + std::to_string(i)));
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+
+  for (int debounce : {0, 50}) {
+    auto setup = "globalThis.root = '" + root.generic_string() + "';" +
+                 "globalThis.debounce = " + std::to_string(debounce) + ";" +
+                 "globalThis.count = " + std::to_string(watchers) + ";" + R"(
+globalThis.watchers = [];
+for (let i = 0; i < count; i++)
+  watchers.push(breeze.filesystem.watch(`${root}/dir-${i}`,
+    { debounce_ms: debounce }, (events) => { globalThis.result = events.length; }));
+)";
+    bench::eval(ctx, setup, "<setup>");
+
+    std::vector<double> delays;
+    for (int i = 0; i < 50; i++) {
+      auto file = root / ("dir-" + std::to_string(i * 7919 % watchers)) /
+                  "state.json";
+      auto start = clock_type::now();
+      std::ofstream(file) << i;
+      bool seen = false;
+      while (!seen && clock_type::now() - start < 1s) {
+        std::this_thread::sleep_for(100us);
+        seen = bench::take_result(ctx).has_value();
+      }
+      std::chrono::duration<double, std::milli> elapsed =
+          clock_type::now() - start;
+      delays.push_back(seen ? elapsed.count() : -1);
+      // Let the debounce window of this write close
+      std::this_thread::sleep_for(std::chrono::milliseconds(debounce + 10));
+    }
+
+    bench::eval(ctx, "for (const w of watchers) w.close();", "<teardown>");
+
+    std::ranges::sort(delays);
+    std::printf("debounce %3d ms: %d watchers, median %.2f ms, max %.2f ms%s\n",
+                debounce, watchers, delays[delays.size() / 2], delays.back(),
+                delays.front() < 0 ? " (some changes were missed)" : "");
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,58 @@
+// Measures writing 2000 small state files (or the count given as argument)
+// through breeze.filesystem.writeStringToFile, 64 at a time: plain, atomic,
+// and atomic with sync: "data", whose directory syncs are shared between
+// the writes in flight.
+// xmake build bench-fs_write && xmake run bench-fs_write [files]
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+static const char *cases[][2] = {
+    {"plain", "undefined"},
+    {"atomic", "{ atomic: true }"},
+    {"atomic+sync", "{ atomic: true, sync: \"data\" }"},
+};
+
+int main(int argc, char **argv) {
+  long files = argc > 1 ? std::atol(argv[1]) : 2000;
+  auto root = std::filesystem::temp_directory_path() / "breeze-bench-write";
+  std::filesystem::remove_all(root);
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  auto setup = "globalThis.root = '" + root.generic_string() + "';" +
+               "globalThis.files = " + std::to_string(files) + ";" + R"(
+globalThis.run = async (options) => {
+  const state = JSON.stringify({ version: 3, items: new Array(32).fill("x") });
+  for (let i = 0; i < files; i += 64) {
+    const batch = [];
+    for (let j = i; j < Math.min(i + 64, files); j++)
+      batch.push(breeze.filesystem.writeStringToFile(
+        `${root}/state-${j % 256}.json`, state, options));
+    await Promise.all(batch);
+  }
+  return files;
+};
+)";
+  bench::eval(ctx, setup, "<setup>");
+
+  for (auto [name, options] : cases) {
+    auto code = std::string("run(") + options + R"().then(
+  (n) => { globalThis.result = n; },
+  (e) => { globalThis.result = String(e); });
+)";
+    auto start = std::chrono::steady_clock::now();
+    bench::eval(ctx, code);
+    auto result = bench::wait_result(ctx);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::printf("%-12s %8s %10.1f ms %8.1f us/file\n", name, result.c_str(),
+                elapsed.count(), elapsed.count() * 1000 / files);
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,91 @@
+// Measures the delay from saving a module to watch_folder re-evaluating the
+// script importing it, with 50 other scripts (or the count given as argument)
+// in the folder that a change to the module does not touch, and the JS heap
+// before and after the reloads.
+// xmake build bench-hot_reload && xmake run bench-hot_reload [scripts]
+#include "breeze-js/script.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using clock_type = std::chrono::steady_clock;
+
+static size_t heap_size(breeze::script_context &ctx) {
+  return ctx.post_sync([&] {
+    JS_RunGC(ctx.rt->rt);
+    JSMemoryUsage usage;
+    JS_ComputeMemoryUsage(ctx.rt->rt, &usage);
+    return static_cast<size_t>(usage.memory_used_size);
+  });
+}
+
+static int read_result(breeze::script_context &ctx, const char *name) {
+  return ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    JSValue global = JS_GetGlobalObject(jsctx);
+    JSValue v = JS_GetPropertyStr(jsctx, global, name);
+    int32_t n = -1;
+    if (!JS_IsUndefined(v))
+      JS_ToInt32(jsctx, &n, v);
+    JS_FreeValue(jsctx, v);
+    JS_FreeValue(jsctx, global);
+    return n;
+  });
+}
+
+int main(int argc, char **argv) {
+  int scripts = argc > 1 ? std::atoi(argv[1]) : 50;
+  auto root = std::filesystem::temp_directory_path() / "breeze-bench-reload";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root / "lib");
+  std::ofstream(root / "lib" / "value.js") << "export const value = 0;\n";
+  std::ofstream(root / "lib" / "index.js")
+      << "export { value } from './value';\n";
+  std::ofstream(root / "main.js") << R"(
+import { value } from './lib/index';
+globalThis.result = value;
+globalThis.mainRuns = (globalThis.mainRuns ?? 0) + 1;
+)";
+  for (int i = 0; i < scripts; i++)
+    std::ofstream(root / ("other-" + std::to_string(i) + ".js"))
+        << "globalThis.otherRuns = (globalThis.otherRuns ?? 0) + 1;\n";
+
+  breeze::script_context ctx;
+  ctx.start_watch_folder(root);
+  auto heap_before = heap_size(ctx);
+
+  std::vector<double> delays;
+  for (int i = 1; i <= 50; i++) {
+    auto start = clock_type::now();
+    std::ofstream(root / "lib" / "value.js")
+        << "export const value = " << i << ";\n";
+    bool seen = false;
+    while (!seen && clock_type::now() - start < 2s) {
+      std::this_thread::sleep_for(100us);
+      seen = read_result(ctx, "result") == i;
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        clock_type::now() - start;
+    delays.push_back(seen ? elapsed.count() : -1);
+    std::this_thread::sleep_for(20ms);
+  }
+
+  std::ranges::sort(delays);
+  std::printf("%d scripts: median %.2f ms, max %.2f ms%s\n", scripts + 1,
+              delays[delays.size() / 2], delays.back(),
+              delays.front() < 0 ? " (some changes were missed)" : "");
+  std::printf("main.js evaluated %d times, the other scripts %d times\n",
+              read_result(ctx, "mainRuns"), read_result(ctx, "otherRuns"));
+  std::printf("JS heap: %zu bytes before the reloads, %zu after\n",
+              heap_before, heap_size(ctx));
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,116 @@
+// Measures JSON.parse throughput on the usual corpus shapes: twitter.json
+// (string heavy, non-ASCII text), canada.json (float coordinates) and
+// citm_catalog.json (integer ids, indented). Pass the real files as
+// arguments; otherwise generated documents of the same shape are used.
+// xmake build bench-json_corpus && xmake run bench-json_corpus [files...]
+#include "breeze-js/script.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct corpus {
+  std::string name;
+  std::string text;
+};
+
+static std::string twitter_like() {
+  std::string json = "{\n  \"statuses\": [";
+  for (int i = 0; i < 1500; i++) {
+    json += i ? ",\n    {" : "\n    {";
+    json += "\n      \"id\": " + std::to_string(505874924095815681ll + i) +
+            ",\n      \"text\": \"@aym0566x \\n\\n\xe5\x90\x8d\xe5\x89\x8d:"
+            "\xe5\x89\x8d\xe7\x94\xb0\xe3\x81\x82\xe3\x82\x86\xe3\x81\xbf "
+            "\\u2661 RT if you like it #" +
+            std::to_string(i) +
+            "\",\n      \"source\": \"<a href=\\\"https://mobile.twitter.com\\\" "
+            "rel=\\\"nofollow\\\">Mobile Web (M2)</a>\",\n      \"user\": {"
+            "\n        \"screen_name\": \"user_" +
+            std::to_string(i) +
+            "\",\n        \"followers_count\": " + std::to_string(i * 37) +
+            ",\n        \"verified\": false,\n        \"url\": null\n      },"
+            "\n      \"retweet_count\": " +
+            std::to_string(i % 100) + ",\n      \"favorited\": false\n    }";
+  }
+  json += "\n  ]\n}";
+  return json;
+}
+
+static std::string canada_like() {
+  std::string json = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":"
+                     "\"Feature\",\"geometry\":{\"type\":\"Polygon\","
+                     "\"coordinates\":[[";
+  char buf[64];
+  for (int i = 0; i < 110'000; i++) {
+    std::snprintf(buf, sizeof(buf), "%s[%.15g,%.15g]", i ? "," : "",
+                  -65.613616999999977 + i * 1e-5,
+                  43.420273000000009 + i * 3e-6);
+    json += buf;
+  }
+  json += "]]}}]}";
+  return json;
+}
+
+static std::string citm_like() {
+  std::string json = "{\n    \"events\": {";
+  for (int i = 0; i < 4000; i++) {
+    auto id = std::to_string(138586341 + i);
+    json += i ? ",\n        \"" : "\n        \"";
+    json += id + "\": {\n            \"description\": null,\n"
+                 "            \"id\": " +
+            id +
+            ",\n            \"logo\": \"/images/UE0AAAAACEKo6QAAAAZDSVRN\",\n"
+            "            \"name\": \"30th Anniversary Tour\",\n"
+            "            \"subTopicIds\": [\n                337184269,\n"
+            "                337184283\n            ],\n"
+            "            \"topicIds\": [\n                324846099,\n"
+            "                107888604\n            ]\n        }";
+  }
+  json += "\n    }\n}";
+  return json;
+}
+
+int main(int argc, char **argv) {
+  std::vector<corpus> docs;
+  for (int i = 1; i < argc; i++) {
+    std::ifstream in(argv[i], std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    docs.push_back({argv[i], ss.str()});
+  }
+  if (docs.empty()) {
+    docs.push_back({"twitter-like", twitter_like()});
+    docs.push_back({"canada-like", canada_like()});
+    docs.push_back({"citm-like", citm_like()});
+  }
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    for (const auto &doc : docs) {
+      // About 200 MB of input per document keeps the timing stable
+      int iterations = std::max<int>(10, int(200e6 / doc.text.size()));
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        JSValue v =
+            JS_ParseJSON(jsctx, doc.text.c_str(), doc.text.size(), "<json>");
+        if (JS_IsException(v)) {
+          std::printf("%-16s failed to parse\n", doc.name.c_str());
+          break;
+        }
+        JS_FreeValue(jsctx, v);
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      double mb = doc.text.size() / 1e6;
+      std::printf("%-16s %6.2f MB %8.1f MB/s\n", doc.name.c_str(), mb,
+                  mb * iterations / elapsed.count());
+    }
+  });
+  return 0;
+}
@@ -0,0 +1,64 @@
+// Measures Response.json() parse throughput: JS_ParseJSON on the JS thread
+// against json_document, which parses on the executor and only materializes
+// values on the JS thread.
+// xmake build bench-json_parse && xmake run bench-json_parse
+#include "breeze-js/script.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+static std::string make_payload(int records) {
+  std::string json = "[";
+  for (int i = 0; i < records; i++) {
+    if (i)
+      json += ',';
+    json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user-" +
+            std::to_string(i) + "\",\"score\":" + std::to_string(i * 0.37) +
+            ",\"tags\":[\"alpha\",\"beta\",\"gamma\"],\"active\":true,"
+            "\"bio\":\"Lorem ipsum dolor sit amet, consectetur\\n\"}";
+  }
+  json += ']';
+  return json;
+}
+
+int main() {
+  constexpr int iterations = 20;
+  auto payload = make_payload(60'000);
+  double mb = payload.size() / 1e6;
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    using clock = std::chrono::steady_clock;
+
+    auto start = clock::now();
+    for (int i = 0; i < iterations; i++) {
+      JSValue v =
+          JS_ParseJSON(jsctx, payload.c_str(), payload.size(), "<json>");
+      JS_FreeValue(jsctx, v);
+    }
+    std::chrono::duration<double> baseline = clock::now() - start;
+
+    std::chrono::duration<double> parse{}, wrap{};
+    for (int i = 0; i < iterations; i++) {
+      auto t0 = clock::now();
+      auto doc = qjs::json_document::parse(payload);
+      auto t1 = clock::now();
+      JSValue v = qjs::js_traits<qjs::json_document>::wrap(jsctx, doc);
+      wrap += clock::now() - t1;
+      parse += t1 - t0;
+      JS_FreeValue(jsctx, v);
+    }
+
+    std::printf("payload %.1f MB\n", mb);
+    std::printf("JS_ParseJSON (JS thread)   %8.1f MB/s\n",
+                mb * iterations / baseline.count());
+    std::printf("tape parse   (executor)    %8.1f MB/s\n",
+                mb * iterations / parse.count());
+    std::printf("tape wrap    (JS thread)   %8.1f MB/s\n",
+                mb * iterations / wrap.count());
+  });
+  return 0;
+}
@@ -0,0 +1,67 @@
+// Measures JSON.stringify throughput on arrays of same-shape records (log
+// shipping), on long strings needing occasional escapes and on floats.
+// xmake build bench-json_stringify && xmake run bench-json_stringify
+#include "breeze-js/script.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static const char *make_inputs = R"(
+globalThis.inputs = {
+  'log records': Array.from({ length: 20000 }, (_, i) => ({
+    ts: 1718000000000 + i * 17,
+    level: i % 10 ? 'info' : 'warn',
+    msg: 'request finished in ' + (i % 97) + 'ms',
+    path: '/api/v1/items/' + i,
+    status: 200,
+    bytes: i * 31 % 65536,
+    latency: i * 0.731,
+    ok: i % 13 != 0,
+    tags: ['svc-a', 'zone-' + (i % 3)],
+  })),
+  'long strings': Array.from({ length: 2000 }, (_, i) =>
+    'Lorem ipsum dolor sit amet, consectetur adipiscing elit. '.repeat(8) +
+    '"quoted"\n' + i),
+  'floats': Array.from({ length: 100000 }, (_, i) => i * 1.0001 + 0.1),
+};
+)";
+
+int main() {
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    JSValue r = JS_Eval(jsctx, make_inputs, std::strlen(make_inputs),
+                        "<inputs>", JS_EVAL_TYPE_GLOBAL);
+    JS_FreeValue(jsctx, r);
+    JSValue global = JS_GetGlobalObject(jsctx);
+    JSValue inputs = JS_GetPropertyStr(jsctx, global, "inputs");
+    for (const char *name : {"log records", "long strings", "floats"}) {
+      JSValue input = JS_GetPropertyStr(jsctx, inputs, name);
+      JSValue out = JS_JSONStringify(jsctx, input, JS_UNDEFINED, JS_UNDEFINED);
+      size_t len = 0;
+      JS_FreeCString(jsctx, JS_ToCStringLen(jsctx, &len, out));
+      JS_FreeValue(jsctx, out);
+
+      // About 200 MB of output per input keeps the timing stable
+      int iterations = std::max<int>(10, int(200e6 / len));
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        out = JS_JSONStringify(jsctx, input, JS_UNDEFINED, JS_UNDEFINED);
+        JS_FreeValue(jsctx, out);
+      }
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      double mb = len / 1e6;
+      std::printf("%-14s %6.2f MB %8.1f MB/s\n", name, mb,
+                  mb * iterations / elapsed.count());
+      JS_FreeValue(jsctx, input);
+    }
+    JS_FreeValue(jsctx, inputs);
+    JS_FreeValue(jsctx, global);
+  });
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Measures RegExp.prototype.exec over generated log lines (access log,
+// application log with levels and timings, non-ASCII text) with the
+// patterns of our log-parsing scripts: anchored field extraction, IPv4
+// addresses, rare and frequent keywords, case-insensitive words and
+// alternations. Each pattern also runs once with the 'g' flag over the
+// whole text joined with newlines.
+// xmake build bench-regex_log && xmake run bench-regex_log
+#include "breeze-js/script.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+static const char *make_cases = R"(
+const lines = [];
+for (let i = 0; i < 100000; i++) {
+  const ip = `${10 + i % 200}.${i % 256}.${i * 7 % 256}.${i * 13 % 256}`;
+  const status = [200, 200, 200, 404, 500, 302][i % 6];
+  switch (i % 3) {
+  case 0:
+    lines.push(`${ip} - user${i % 97} [10/Oct/2024:13:55:${String(i % 60)
+      .padStart(2, '0')} +0000] "${['GET', 'POST', 'PUT'][i % 3]} ` +
+      `/api/v1/items/${i}?page=${i % 10} HTTP/1.1" ${status} ${i * 31 % 65536}`);
+    break;
+  case 1:
+    lines.push(`2024-10-10T13:55:${i % 60}.${i % 1000}Z ` +
+      `${['INFO', 'INFO', 'INFO', 'DEBUG', 'WARN', 'ERROR'][i % 6]} ` +
+      `[worker-${i % 8}] request ${i} finished in ${i % 977}ms ` +
+      `status=${status}${i % 1000 == 1 ? ' timeout after 30000ms' : ''}`);
+    break;
+  default:
+    lines.push(`message ${i}: utilisateur café ${i % 13} a été déconnecté ` +
+      `(session expirée) après ${i % 300} secondes`);
+    break;
+  }
+}
+const text = lines.join('\n');
+const patterns = {
+  'access log': /^(\S+) \S+ (\S+) \[([^\]]+)\] "(\w+) ([^ "]+) HTTP\/[\d.]+" (\d{3}) (\d+|-)/,
+  'ipv4': /\b(?:\d{1,3}\.){3}\d{1,3}\b/,
+  'rare literal': /timeout after (\d+)ms/,
+  'level': /\b(WARN|ERROR)\b/,
+  'key=value': /status=(\d{3})/,
+  'ignore case': /déconnecté|disconnected/i,
+  'timing': /finished in (\d+)ms/,
+  'no match': /segfault at [0-9a-f]+/,
+};
+globalThis.cases = {};
+for (const [name, re] of Object.entries(patterns)) {
+  globalThis.cases[name] = () => {
+    let n = 0;
+    for (const line of lines) {
+      if (re.exec(line))
+        n++;
+    }
+    const g = new RegExp(re.source, re.flags.replace('g', '') + 'gm');
+    while (g.exec(text))
+      n++;
+    return n;
+  };
+}
+)";
+
+int main() {
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    JSValue r = JS_Eval(jsctx, make_cases, std::strlen(make_cases), "<cases>",
+                        JS_EVAL_TYPE_GLOBAL);
+    JS_FreeValue(jsctx, r);
+    JSValue global = JS_GetGlobalObject(jsctx);
+    JSValue cases = JS_GetPropertyStr(jsctx, global, "cases");
+    for (const char *name :
+         {"access log", "ipv4", "rare literal", "level", "key=value",
+          "ignore case", "timing", "no match"}) {
+      JSValue fn = JS_GetPropertyStr(jsctx, cases, name);
+      auto start = std::chrono::steady_clock::now();
+      JSValue ret = JS_Call(jsctx, fn, JS_UNDEFINED, 0, nullptr);
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      int32_t matches = 0;
+      if (JS_IsException(ret)) {
+        std::printf("%-14s failed\n", name);
+        JS_FreeValue(jsctx, JS_GetException(jsctx));
+      } else {
+        JS_ToInt32(jsctx, &matches, ret);
+        std::printf("%-14s %8d matches %10.1f ms\n", name, matches,
+                    elapsed.count());
+      }
+      JS_FreeValue(jsctx, ret);
+      JS_FreeValue(jsctx, fn);
+    }
+    JS_FreeValue(jsctx, cases);
+    JS_FreeValue(jsctx, global);
+  });
+  return 0;
+}
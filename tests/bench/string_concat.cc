@@ -0,0 +1,77 @@
+// Measures building strings with repeated '+=' in loops of 10^5 and 10^6
+// iterations: appending to a local, to an object property, rebuilding with
+// 's = s + x', prepending and assembling CSV rows from template literals.
+// Each case reads a character in the middle at the end so that the cost of
+// flattening the result is included.
+// xmake build bench-string_concat && xmake run bench-string_concat
+#include "breeze-js/script.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+static const char *make_cases = R"(
+const finish = (s) => s.length + s.charCodeAt(s.length >> 1);
+globalThis.cases = {
+  'local +=': (n) => {
+    let s = '';
+    for (let i = 0; i < n; i++) s += 'item ' + i + ',';
+    return finish(s);
+  },
+  'property +=': (n) => {
+    const o = { s: '' };
+    for (let i = 0; i < n; i++) o.s += 'x' + (i & 7);
+    return finish(o.s);
+  },
+  's = s + x': (n) => {
+    let s = '';
+    for (let i = 0; i < n; i++) s = s + String.fromCharCode(97 + i % 26);
+    return finish(s);
+  },
+  'prepend': (n) => {
+    let s = '';
+    for (let i = 0; i < n; i++) s = (i & 15).toString(16) + s;
+    return finish(s);
+  },
+  'csv rows': (n) => {
+    let csv = 'id,name,score\n';
+    for (let i = 0; i < n; i++) csv += `${i},user-${i},${i * 0.5}\n`;
+    return finish(csv);
+  },
+};
+)";
+
+int main() {
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    JSValue r = JS_Eval(jsctx, make_cases, std::strlen(make_cases), "<cases>",
+                        JS_EVAL_TYPE_GLOBAL);
+    JS_FreeValue(jsctx, r);
+    JSValue global = JS_GetGlobalObject(jsctx);
+    JSValue cases = JS_GetPropertyStr(jsctx, global, "cases");
+    for (const char *name :
+         {"local +=", "property +=", "s = s + x", "prepend", "csv rows"}) {
+      JSValue fn = JS_GetPropertyStr(jsctx, cases, name);
+      for (int n : {100'000, 1'000'000}) {
+        JSValue arg = JS_NewInt32(jsctx, n);
+        auto start = std::chrono::steady_clock::now();
+        JSValue ret = JS_Call(jsctx, fn, JS_UNDEFINED, 1, &arg);
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (JS_IsException(ret)) {
+          std::printf("%-12s %8d failed\n", name, n);
+          JS_FreeValue(jsctx, JS_GetException(jsctx));
+          continue;
+        }
+        std::printf("%-12s %8d %10.1f ms\n", name, n, elapsed.count());
+        JS_FreeValue(jsctx, ret);
+      }
+      JS_FreeValue(jsctx, fn);
+    }
+    JS_FreeValue(jsctx, cases);
+    JS_FreeValue(jsctx, global);
+  });
+  return 0;
+}
@@ -0,0 +1,46 @@
+// Measures std::variant unwrapping for fetch's RequestInit::body.
+// xmake build bench-variant_unwrap && xmake run bench-variant_unwrap
+#include "binding/binding_types.breezejs.qjs.h"
+#include "breeze-js/script.h"
+
+#include <chrono>
+#include <cstdio>
+
+int main() {
+  using Body = std::variant<std::string, std::vector<uint8_t>,
+                            std::shared_ptr<breeze::js::Blob>>;
+  constexpr int iterations = 1'000'000;
+
+  struct bench_case {
+    const char *name;
+    const char *expr;
+  };
+  const bench_case cases[] = {
+      {"string", "'x'.repeat(256)"},
+      {"ArrayBuffer", "new ArrayBuffer(256)"},
+      {"Blob", "new Blob()"},
+  };
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  ctx.post_sync([&] {
+    auto *jsctx = ctx.js->ctx;
+    size_t sink = 0;
+    for (const auto &c : cases) {
+      auto value = ctx.js->eval(c.expr);
+      if (JS_IsException(value.v)) {
+        std::printf("%-12s failed to evaluate '%s'\n", c.name, c.expr);
+        continue;
+      }
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        sink += qjs::js_traits<Body>::unwrap(jsctx, value.v).index();
+      }
+      std::chrono::duration<double, std::nano> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::printf("%-12s %8.1f ns/op\n", c.name, elapsed.count() / iterations);
+    }
+    std::printf("(checksum %zu)\n", sink);
+  });
+  return 0;
+}
@@ -0,0 +1,81 @@
+// Measures std::vector<T> <-> Array marshalling, the shape readdirSync returns,
+// against numeric samples passed as a TypedArray.
+// xmake build bench-vector_marshal && xmake run bench-vector_marshal
+#include "breeze-js/script.h"
+
+#include <chrono>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+template <typename T>
+static void bench(JSContext *ctx, const char *name, const std::vector<T> &data,
+                  int iterations) {
+  using traits = qjs::js_traits<std::vector<T>>;
+  size_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    JSValue arr = traits::wrap(ctx, data);
+    JS_FreeValue(ctx, arr);
+  }
+  std::chrono::duration<double, std::milli> wrap_time =
+      std::chrono::steady_clock::now() - start;
+
+  JSValue arr = traits::wrap(ctx, data);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sink += traits::unwrap(ctx, arr).size();
+  }
+  std::chrono::duration<double, std::milli> unwrap_time =
+      std::chrono::steady_clock::now() - start;
+  JS_FreeValue(ctx, arr);
+
+  std::printf("%-8s wrap %8.2f ms/op  unwrap %8.2f ms/op  (checksum %zu)\n",
+              name, wrap_time.count() / iterations,
+              unwrap_time.count() / iterations, sink);
+}
+
+static void bench_samples(JSContext *ctx, const std::vector<double> &data,
+                          int iterations) {
+  double sink = 0;
+  JSValue arr = qjs::js_traits<qjs::typed_array<double>>::wrap(
+      ctx, qjs::typed_array<double>(data.begin(), data.end()));
+  JSValue argv[] = {arr};
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    auto arg =
+        qjs::detail::unwrap_args<std::span<const double>>(ctx, 1, argv);
+    for (double x : std::span<const double>(std::get<0>(arg)))
+      sink += x;
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  JS_FreeValue(ctx, arr);
+  std::printf("%-8s span %8.2f ms/op  (checksum %g)\n", "f64",
+              elapsed.count() / iterations, sink);
+}
+
+int main() {
+  constexpr size_t entries = 100'000;
+  constexpr int iterations = 50;
+
+  std::vector<int> numbers(entries);
+  std::vector<double> samples(1'000'000, 0.5);
+  std::vector<std::string> names(entries);
+  for (size_t i = 0; i < entries; i++) {
+    numbers[i] = static_cast<int>(i);
+    names[i] = "entry-" + std::to_string(i) + ".txt";
+  }
+
+  breeze::script_context ctx;
+  ctx.reset_runtime();
+  ctx.post_sync([&] {
+    bench(ctx.js->ctx, "int", numbers, iterations);
+    bench(ctx.js->ctx, "string", names, iterations);
+    bench(ctx.js->ctx, "f64", samples, iterations);
+    bench_samples(ctx.js->ctx, samples, iterations);
+  });
+  return 0;
+}
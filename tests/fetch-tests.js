@@ -1,6 +1,9 @@
 /**
  * QuickJS / 现代浏览器通用 Fetch 深度集成测试
+ * 运行: xmake build fetch-tests && xmake run fetch-tests tests/fetch-tests.js
  */
+import { startHttpServer } from "breeze-test";
+
 async function runTests() {
     const LOG = {
         pass: (msg) => console.log(`  \x1b[32m[PASS]\x1b[0m ${msg}`),
@@ -47,19 +50,25 @@ async function runTests() {
     let passed = 0;
     let failed = 0;
 
+    // 仿 httpbin.org 的本地服务器, 见 tests/fetch/http_server.cc
+    const server = startHttpServer();
+    const base = server.url();
+
     const tests = [
         {
             name: "GET 响应体与 Header 深度校验",
             fn: async () => {
-                const res = await fetch('https://httpbin.org/get?name=qjs&id=123', {
+                const res = await fetch(`${base}/get?name=qjs&id=123&text=%E6%B5%8B%20x`, {
                     headers: { 'X-Test-ID': '42' }
                 });
                 const data = await res.json();
-                
+
                 expect(res.status).toBe(200, "状态码异常");
+                expect(data.method).toBe('GET', "请求方法异常");
                 expect(data.args.name).toBe('qjs', "Query 参数 name 校验失败");
                 expect(data.args.id).toBe('123', "Query 参数 id 校验失败");
-                expect(data.headers['X-Test-Id']).toBe('42', "自定义请求头丢失");
+                expect(data.args.text).toBe('测 x', "Query 参数解码失败");
+                expect(data.headers['x-test-id']).toBe('42', "自定义请求头丢失");
                 expect(res.headers.get('content-type')).toInclude('application/json', "响应头类型错误");
             }
         },
@@ -67,45 +76,247 @@ async function runTests() {
             name: "POST JSON 结构完整性校验",
             fn: async () => {
                 const payload = { nested: { a: 1 }, tags: [1, 2], str: "测试" };
-                const res = await fetch('https://httpbin.org/post', {
+                const res = await fetch(`${base}/post`, {
                     method: 'POST',
                     headers: { 'Content-Type': 'application/json' },
                     body: JSON.stringify(payload)
                 });
                 const data = await res.json();
-                
+
                 expect(res.status).toBe(200, "状态码异常");
-                expect(data.json).toDeepEqual(payload, "发送与接收的 JSON 不一致");
+                expect(data.method).toBe('POST', "请求方法异常");
+                expect(data.headers['content-type']).toInclude('application/json', "Content-Type 丢失");
+                expect(JSON.parse(data.data)).toDeepEqual(payload, "发送与接收的 JSON 不一致");
             }
         },
         {
             name: "Binary/ArrayBuffer 逐字节比对",
             fn: async () => {
                 const raw = new Uint8Array([0xDE, 0xAD, 0xBE, 0xEF, 0x00, 0xFF, 0x42, 0x24]);
-                const res = await fetch('https://httpbin.org/post', {
+                const res = await fetch(`${base}/echo`, {
                     method: 'POST',
                     body: raw.buffer
                 });
-                const data = await res.json();
-                
-                expect(data.data.length > 0).toBe(true, "二进制数据未发送成功");
-                LOG.info(`服务器接收长度: ${data.data.length} 字符`);
+                const echoed = new Uint8Array(await res.arrayBuffer());
+
+                expect(Array.from(echoed)).toDeepEqual(Array.from(raw), "回显的二进制数据不一致");
+                expect(res.headers.get('content-type')).toBe('application/octet-stream', "二进制请求体的 Content-Type 异常");
+            }
+        },
+        {
+            name: "拼接字符串 (rope) 作为请求体",
+            fn: async () => {
+                // 256 个字符以上的拼接结果是 rope, 经 std::variant 绑定传入
+                let body = '';
+                for (let i = 0; i < 100; i++) body += `第 ${i} 行, ${'x'.repeat(i % 7)}\n`;
+                const res = await fetch(`${base}/echo`, { method: 'POST', body });
+
+                expect(await res.text()).toBe(body, "回显的字符串不一致");
+                const prefixed = await fetch(`${base}/echo`, { method: 'POST', body: 'p'.repeat(300) + body });
+                expect(await prefixed.text()).toBe('p'.repeat(300) + body, "回显的字符串不一致");
             }
         },
         {
             name: "错误处理 (404 Not Found)",
             fn: async () => {
-                const res = await fetch('https://httpbin.org/status/404');
+                const res = await fetch(`${base}/status/404`);
                 expect(res.ok).toBe(false, "res.ok 应该为 false");
                 expect(res.status).toBe(404, "应该返回 404");
+                expect(res.statusText).toBe('Not Found', "statusText 异常");
             }
         },
         {
             name: "Response 文本流转换校验",
             fn: async () => {
-                const res = await fetch('https://httpbin.org/robots.txt');
-                const text = await res.text();
-                expect(text).toInclude('Disallow', "robots.txt 内容读取异常");
+                const body = '你好, breeze\nDisallow: /deny';
+                const res = await fetch(`${base}/echo`, {
+                    method: 'POST',
+                    headers: { 'Content-Type': 'text/plain; charset=utf-8' },
+                    body
+                });
+                expect(await res.text()).toBe(body, "文本响应读取异常");
+            }
+        },
+        {
+            name: "HTTP 缓存命中与 ETag 重新验证",
+            fn: async () => {
+                const { http } = breeze;
+                http.configureCache();
+                http.clearCache();
+                try {
+                    const before = http.cacheStats();
+                    const requests = server.requests();
+                    // max-age=60: 第二次请求直接命中内存缓存
+                    await fetch(`${base}/cache/60`);
+                    const cached = await fetch(`${base}/cache/60`);
+                    expect(cached.status).toBe(200, "缓存响应状态码异常");
+                    expect((await cached.json()).method).toBe('GET', "缓存响应体异常");
+                    expect(server.requests() - requests).toBe(1, "命中缓存时仍请求了服务器");
+
+                    // no-cache 模式强制重新验证, 服务器返回 304
+                    await fetch(`${base}/etag/breeze`);
+                    const revalidated = await fetch(`${base}/etag/breeze`, { cache: 'no-cache' });
+                    expect(revalidated.status).toBe(200, "304 应作为缓存命中返回");
+                    expect(revalidated.headers.get('etag')).toBe('"breeze"', "ETag 丢失");
+                    expect((await revalidated.json()).method).toBe('GET', "重新验证后的响应体异常");
+                    expect(server.requests() - requests).toBe(3, "重新验证未请求服务器");
+
+                    const stats = http.cacheStats();
+                    expect(stats.hits - before.hits).toBe(2, "缓存命中次数异常");
+                    expect(stats.revalidations - before.revalidations).toBe(1, "重新验证次数异常");
+                    expect(stats.bytes_saved > before.bytes_saved).toBe(true, "节省字节数未增加");
+                    LOG.info(`命中率: ${(stats.hit_ratio * 100).toFixed(1)}%`);
+                } finally {
+                    http.disableCache();
+                }
+            }
+        },
+        {
+            name: "gzip/deflate/brotli 响应自动解压",
+            fn: async () => {
+                const gzipRes = await fetch(`${base}/gzip`);
+                expect(gzipRes.headers.get('content-encoding')).toBe('gzip', "响应未经 gzip 编码");
+                const gzip = await gzipRes.json();
+                expect(gzip.method).toBe('GET', "gzip 响应解压失败");
+                expect(gzip.headers['accept-encoding']).toInclude('gzip', "未发送 Accept-Encoding");
+
+                const deflate = await (await fetch(`${base}/deflate`)).json();
+                expect(deflate.method).toBe('GET', "deflate 响应解压失败");
+
+                const brotliRes = await fetch(`${base}/br`);
+                if (brotliRes.status === 406) {
+                    LOG.info("未启用 brotli, 跳过");
+                    return;
+                }
+                const brotli = await brotliRes.json();
+                expect(brotli.method).toBe('GET', "brotli 响应解压失败");
+                expect(brotli.headers['accept-encoding']).toInclude('br', "未声明支持 br");
+            }
+        },
+        {
+            name: "解压后的响应体大小上限",
+            fn: async () => {
+                // tests/fetch/main.cc 将上限设为 1 MiB
+                const limit = 1024 * 1024;
+                for (const coding of ['gzip', 'deflate', 'br']) {
+                    const res = await fetch(`${base}/${coding}?size=${limit}`);
+                    if (res.status === 406)
+                        continue;
+                    const body = new Uint8Array(await res.arrayBuffer());
+                    expect(body.length).toBe(limit, `${coding} 响应体长度异常`);
+                    expect(body.every(b => b === 0x78)).toBe(true, `${coding} 响应体内容异常`);
+
+                    let error = null;
+                    try {
+                        await fetch(`${base}/${coding}?size=${limit + 1}`);
+                    } catch (e) {
+                        error = e;
+                    }
+                    expect(error !== null).toBe(true, `${coding} 超出上限的响应未失败`);
+                    expect(String(error)).toInclude('exceeds', `${coding} 错误信息异常`);
+                }
+            }
+        },
+        {
+            name: "请求体 compress 选项",
+            fn: async () => {
+                const res = await fetch(`${base}/anything`, {
+                    method: 'POST',
+                    body: JSON.stringify({ data: 'x'.repeat(4096) }),
+                    headers: { 'Content-Type': 'application/json' },
+                    compress: 'gzip'
+                });
+                const data = await res.json();
+                expect(data.method).toBe('POST', "请求方法异常");
+                expect(data.headers['content-encoding']).toBe('gzip', "未设置 Content-Encoding");
+                expect(Number(data.headers['content-length']) < 4096).toBe(true, "请求体未被压缩");
+            }
+        },
+        {
+            name: "并发限制统计",
+            fn: async () => {
+                const before = breeze.http.fetchStats();
+                const responses = await Promise.all(
+                    Array.from({ length: 12 }, (_, i) => fetch(`${base}/get?i=${i}`))
+                );
+                expect(responses.every(r => r.ok)).toBe(true, "并发请求失败");
+                const args = await Promise.all(responses.map(async r => (await r.json()).args.i));
+                expect(args).toDeepEqual(Array.from({ length: 12 }, (_, i) => String(i)), "响应与请求不对应");
+
+                const stats = breeze.http.fetchStats();
+                expect(stats.in_flight).toBe(0, "请求结束后仍有进行中的请求");
+                expect(stats.queued).toBe(0, "请求结束后队列未清空");
+                // 默认每个 origin 最多 6 个并发, 其余请求需要排队
+                expect(stats.waited - before.waited >= 6).toBe(true, "超出 origin 限制的请求未排队");
+            }
+        },
+        {
+            name: "本地服务器: 顺序请求复用 keep-alive 连接",
+            fn: async () => {
+                const server = startHttpServer();
+                try {
+                    const ids = [];
+                    for (let i = 0; i < 5; i++)
+                        ids.push(await (await fetch(`${server.url()}/seq?i=${i}`)).text());
+                    expect(server.requests()).toBe(5, "请求数异常");
+                    expect(server.connections()).toBe(1, "顺序请求未复用连接");
+                    expect(ids.every(id => id === '1')).toBe(true, "响应来自不同连接");
+                } finally {
+                    server.close();
+                }
+            }
+        },
+        {
+            name: "本地服务器: 空闲连接被关闭后自动重试",
+            fn: async () => {
+                const server = startHttpServer();
+                try {
+                    const first = await (await fetch(`${server.url()}/a`)).text();
+                    // 服务器静默关闭连接池中的空闲连接
+                    server.dropConnections();
+                    const res = await fetch(`${server.url()}/b`);
+                    expect(res.ok).toBe(true, "失效连接上的请求未重试");
+                    expect(await res.text()).toBe('2', "重试未使用新连接");
+                    expect(first).toBe('1', "第一个请求的连接编号异常");
+                    expect(server.requests()).toBe(2, "请求数异常");
+                    expect(server.connections()).toBe(2, "连接数异常");
+                } finally {
+                    server.close();
+                }
+            }
+        },
+        {
+            name: "本地服务器: Connection: close 的连接不放回连接池",
+            fn: async () => {
+                const server = startHttpServer({ close_connections: true });
+                try {
+                    for (let i = 1; i <= 3; i++) {
+                        const res = await fetch(`${server.url()}/close?i=${i}`);
+                        expect(await res.text()).toBe(String(i), "复用了已关闭的连接");
+                    }
+                    expect(server.connections()).toBe(3, "连接数异常");
+                } finally {
+                    server.close();
+                }
+            }
+        },
+        {
+            name: "本地服务器: 并发请求共享连接池",
+            fn: async () => {
+                const server = startHttpServer();
+                try {
+                    const batch = () => Promise.all(Array.from({ length: 12 },
+                        (_, i) => fetch(`${server.url()}/fan?i=${i}`).then(r => r.text())));
+                    await batch();
+                    const opened = server.connections();
+                    // 默认每个 origin 最多 6 个并发请求
+                    expect(opened <= 6).toBe(true, `打开了 ${opened} 个连接`);
+                    await batch();
+                    expect(server.connections()).toBe(opened, "第二批请求未复用空闲连接");
+                    expect(server.requests()).toBe(24, "请求数异常");
+                } finally {
+                    server.close();
+                }
             }
         }
     ];
@@ -122,10 +333,13 @@ async function runTests() {
             failed++;
         }
     }
+    server.close();
 
     LOG.result(passed, failed);
     return { passed, failed };
 }
 
 // 启动执行
-await runTests();
\ No newline at end of file
+const { failed } = await runTests();
+if (failed > 0)
+    throw new Error(`${failed} 个测试失败`);
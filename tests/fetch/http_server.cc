@@ -0,0 +1,418 @@
+#include "http_server.h"
+#include "binding/std/http_encoding.h"
+#include "breeze-js/script.h"
+#include <asio/executor_work_guard.hpp>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/post.hpp>
+#include <asio/read.hpp>
+#include <asio/read_until.hpp>
+#include <asio/write.hpp>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <ranges>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace breeze::test {
+
+namespace {
+struct http_connection;
+}
+
+struct HttpServer::$state {
+  asio::io_context io;
+  asio::executor_work_guard<asio::io_context::executor_type> work =
+      asio::make_work_guard(io);
+  asio::ip::tcp::acceptor acceptor{io};
+  std::thread thread;
+  bool close_connections = false;
+  std::string url;
+  std::atomic<size_t> connections = 0;
+  std::atomic<size_t> requests = 0;
+  // Open connections by number. IO thread only.
+  std::unordered_map<size_t, std::shared_ptr<http_connection>> open;
+
+  void accept();
+  // Runs fn on the IO thread and waits for it
+  template <typename F> void run_sync(F &&fn) {
+    std::promise<void> done;
+    asio::post(io, [&] {
+      fn();
+      done.set_value();
+    });
+    done.get_future().wait();
+  }
+  void stop();
+  ~$state() { stop(); }
+};
+
+namespace {
+struct http_request {
+  std::string method;
+  std::string path;
+  // Query parameters, percent-decoded
+  std::vector<std::pair<std::string, std::string>> args;
+  // Names lowercased
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+
+  std::string_view header(std::string_view name) const {
+    for (auto &[n, v] : headers)
+      if (n == name)
+        return v;
+    return {};
+  }
+
+  std::optional<std::string_view> arg(std::string_view name) const {
+    for (auto &[n, v] : args)
+      if (n == name)
+        return v;
+    return std::nullopt;
+  }
+};
+
+struct http_response {
+  int status = 200;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+};
+
+std::string percent_decode(std::string_view s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '+') {
+      out += ' ';
+    } else if (s[i] == '%' && i + 2 < s.size() &&
+               std::isxdigit(static_cast<unsigned char>(s[i + 1])) &&
+               std::isxdigit(static_cast<unsigned char>(s[i + 2]))) {
+      out += static_cast<char>(
+          std::stoi(std::string(s.substr(i + 1, 2)), nullptr, 16));
+      i += 2;
+    } else {
+      out += s[i];
+    }
+  }
+  return out;
+}
+
+// Parses the request line and headers of head, which ends in a blank line
+http_request parse_head(std::string_view head) {
+  http_request req;
+  auto line_end = head.find("\r\n");
+  auto line = head.substr(0, line_end);
+  auto sp = line.find(' ');
+  req.method = line.substr(0, sp);
+  auto target = line.substr(sp + 1, line.find(' ', sp + 1) - sp - 1);
+  auto q = target.find('?');
+  req.path = target.substr(0, q);
+  if (q != std::string_view::npos) {
+    for (auto part : std::views::split(target.substr(q + 1), '&')) {
+      std::string_view kv(part.begin(), part.end());
+      if (kv.empty())
+        continue;
+      auto eq = kv.find('=');
+      auto value =
+          eq == std::string_view::npos ? std::string_view{} : kv.substr(eq + 1);
+      req.args.emplace_back(percent_decode(kv.substr(0, eq)),
+                            percent_decode(value));
+    }
+  }
+  for (size_t pos = line_end + 2; pos < head.size();) {
+    auto end = head.find("\r\n", pos);
+    line = head.substr(pos, end - pos);
+    pos = end == std::string_view::npos ? head.size() : end + 2;
+    auto colon = line.find(':');
+    if (colon == std::string_view::npos)
+      continue;
+    std::string name(line.substr(0, colon));
+    for (auto &c : name)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    auto value = line.substr(colon + 1);
+    while (!value.empty() && value.front() == ' ')
+      value.remove_prefix(1);
+    req.headers.emplace_back(std::move(name), std::string(value));
+  }
+  return req;
+}
+
+std::string json_string(std::string_view s) {
+  std::string out = "\"";
+  for (unsigned char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof buf, "\\u%04x", c);
+      out += buf;
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+  return out + '"';
+}
+
+std::string json_object(
+    const std::vector<std::pair<std::string, std::string>> &fields) {
+  std::string out = "{";
+  for (auto &[name, value] : fields) {
+    if (out.size() > 1)
+      out += ',';
+    out += json_string(name) + ':' + json_string(value);
+  }
+  return out + '}';
+}
+
+// The request as httpbin.org echoes it
+std::string echo(const http_request &req) {
+  return "{\"method\":" + json_string(req.method) +
+         ",\"args\":" + json_object(req.args) +
+         ",\"headers\":" + json_object(req.headers) +
+         ",\"data\":" + json_string(req.body) + '}';
+}
+
+std::string_view status_text(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 304:
+    return "Not Modified";
+  case 404:
+    return "Not Found";
+  case 406:
+    return "Not Acceptable";
+  default:
+    return "Status";
+  }
+}
+
+// Routes after httpbin.org:
+//   /get, /post, /anything  echo the request as JSON
+//   /echo                   the request body with its Content-Type
+//   /status/<code>          an empty response with that status
+//   /cache/<seconds>        the echo, fresh for that long
+//   /etag/<tag>             the echo with ETag "<tag>", or a 304 when
+//                           If-None-Match has it
+//   /gzip, /deflate, /br    the echo in that coding, a 406 when this build
+//                           cannot encode it. With ?size=<n>, n bytes of
+//                           'x' instead of the echo.
+// Anything else answers with the number of the connection.
+http_response route(const http_request &req, size_t connection) {
+  http_response res;
+  auto json = [&] {
+    res.headers.emplace_back("Content-Type", "application/json");
+    res.body = echo(req);
+  };
+  auto rest = [&](std::string_view prefix) -> std::optional<std::string> {
+    if (!req.path.starts_with(prefix))
+      return std::nullopt;
+    return req.path.substr(prefix.size());
+  };
+
+  if (req.path == "/get" || req.path == "/post" || req.path == "/anything") {
+    json();
+  } else if (req.path == "/echo") {
+    res.headers.emplace_back("Content-Type",
+                             std::string(req.header("content-type")));
+    res.body = req.body;
+  } else if (auto code = rest("/status/")) {
+    res.status = std::atoi(code->c_str());
+  } else if (auto seconds = rest("/cache/")) {
+    json();
+    res.headers.emplace_back("Cache-Control", "max-age=" + *seconds);
+  } else if (auto tag = rest("/etag/")) {
+    auto etag = '"' + *tag + '"';
+    res.headers.emplace_back("ETag", etag);
+    if (req.header("if-none-match") == etag)
+      res.status = 304;
+    else
+      json();
+  } else if (req.path == "/gzip" || req.path == "/deflate" ||
+             req.path == "/br") {
+    auto coding = std::string_view(req.path).substr(1);
+    if (!js::http_encoding::supported(coding)) {
+      res.status = 406;
+      return res;
+    }
+    if (auto size = req.arg("size")) {
+      res.headers.emplace_back("Content-Type", "text/plain");
+      res.body.assign(std::strtoull(std::string(*size).c_str(), nullptr, 10),
+                      'x');
+    } else {
+      json();
+    }
+    res.body = js::http_encoding::encode(coding, res.body);
+    res.headers.emplace_back("Content-Encoding", std::string(coding));
+  } else {
+    res.headers.emplace_back("Content-Type", "text/plain");
+    res.body = std::to_string(connection);
+  }
+  return res;
+}
+
+struct http_connection : std::enable_shared_from_this<http_connection> {
+  HttpServer::$state &server;
+  size_t id;
+  asio::ip::tcp::socket socket;
+  std::string buffer;
+  http_request request;
+  std::string response;
+
+  http_connection(HttpServer::$state &server, size_t id,
+                  asio::ip::tcp::socket socket)
+      : server(server), id(id), socket(std::move(socket)) {}
+
+  void read_head() {
+    asio::async_read_until(
+        socket, asio::dynamic_buffer(buffer), "\r\n\r\n",
+        [self = shared_from_this()](std::error_code ec, size_t head_size) {
+          if (ec)
+            return self->finish();
+          self->request =
+              parse_head(std::string_view(self->buffer).substr(0, head_size));
+          self->buffer.erase(0, head_size);
+          self->read_body();
+        });
+  }
+
+  void read_body() {
+    auto size = std::strtoull(
+        std::string(request.header("content-length")).c_str(), nullptr, 10);
+    if (buffer.size() >= size) {
+      request.body = buffer.substr(0, size);
+      buffer.erase(0, size);
+      return respond();
+    }
+    asio::async_read(socket, asio::dynamic_buffer(buffer),
+                     asio::transfer_exactly(size - buffer.size()),
+                     [self = shared_from_this()](std::error_code ec, size_t) {
+                       if (ec)
+                         return self->finish();
+                       self->read_body();
+                     });
+  }
+
+  void respond() {
+    server.requests++;
+    auto res = route(request, id);
+    response = "HTTP/1.1 " + std::to_string(res.status) + ' ' +
+               std::string(status_text(res.status)) + "\r\n";
+    for (auto &[name, value] : res.headers)
+      response += name + ": " + value + "\r\n";
+    response += "Content-Length: " + std::to_string(res.body.size()) +
+                "\r\nConnection: " +
+                (server.close_connections ? "close" : "keep-alive") +
+                "\r\n\r\n" + res.body;
+    asio::async_write(socket, asio::buffer(response),
+                      [self = shared_from_this()](std::error_code ec, size_t) {
+                        if (ec || self->server.close_connections)
+                          return self->finish();
+                        self->read_head();
+                      });
+  }
+
+  void finish() {
+    std::error_code ec;
+    socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    socket.close(ec);
+    server.open.erase(id);
+  }
+};
+} // namespace
+
+void HttpServer::$state::accept() {
+  acceptor.async_accept([this](std::error_code ec,
+                               asio::ip::tcp::socket socket) {
+    if (ec)
+      return;
+    auto id = ++connections;
+    auto conn =
+        std::make_shared<http_connection>(*this, id, std::move(socket));
+    open.emplace(id, conn);
+    conn->read_head();
+    accept();
+  });
+}
+
+void HttpServer::$state::stop() {
+  if (!thread.joinable())
+    return;
+  run_sync([this] {
+    std::error_code ec;
+    acceptor.close(ec);
+    for (auto &[id, conn] : open)
+      conn->socket.close(ec);
+    open.clear();
+  });
+  work.reset();
+  io.stop();
+  thread.join();
+}
+
+std::shared_ptr<HttpServer>
+startHttpServer(std::optional<HttpServerOptions> options) {
+  if (!options)
+    options.emplace();
+  auto server = std::make_shared<HttpServer>();
+  server->$s = std::make_shared<HttpServer::$state>();
+  auto &s = *server->$s;
+  s.close_connections = options->close_connections;
+
+  asio::ip::tcp::endpoint endpoint(asio::ip::make_address("127.0.0.1"), 0);
+  s.acceptor.open(endpoint.protocol());
+  s.acceptor.bind(endpoint);
+  s.acceptor.listen();
+  s.url = "http://127.0.0.1:" +
+          std::to_string(s.acceptor.local_endpoint().port());
+  s.accept();
+  s.thread = std::thread([&s] { s.io.run(); });
+  return server;
+}
+
+std::string HttpServer::url() { return $s->url; }
+
+size_t HttpServer::connections() { return $s->connections; }
+
+size_t HttpServer::requests() { return $s->requests; }
+
+void HttpServer::dropConnections() {
+  if (!$s->thread.joinable())
+    return;
+  $s->run_sync([s = $s.get()] {
+    std::error_code ec;
+    for (auto &[id, conn] : s->open)
+      conn->socket.close(ec);
+    s->open.clear();
+  });
+}
+
+void HttpServer::close() { $s->stop(); }
+
+} // namespace breeze::test
+
+template <> struct qjs::js_traits<breeze::test::HttpServerOptions> {
+  static breeze::test::HttpServerOptions unwrap(JSContext *ctx,
+                                                JSValueConst v) {
+    breeze::test::HttpServerOptions options;
+    options.close_connections = detail::unwrap_free<bool>(
+        ctx, JS_GetPropertyStr(ctx, v, "close_connections"));
+    return options;
+  }
+};
+
+void breeze::test::bind(script_context &ctx) {
+  auto &module = ctx.js->addModule("breeze-test");
+  module.class_<HttpServer>("HttpServer")
+      .fun<&HttpServer::url>("url")
+      .fun<&HttpServer::connections>("connections")
+      .fun<&HttpServer::requests>("requests")
+      .fun<&HttpServer::dropConnections>("dropConnections")
+      .fun<&HttpServer::close>("close");
+  module.function<&startHttpServer>("startHttpServer");
+}
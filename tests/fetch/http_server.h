@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace breeze {
+struct script_context;
+}
+
+namespace breeze::test {
+struct HttpServerOptions {
+  // Answer with "Connection: close" and close each connection after one
+  // response
+  bool close_connections = false;
+};
+
+// A local HTTP/1.1 server for the fetch tests. A few paths answer like
+// httpbin.org does, see route() in http_server.cc. Any other path gets a 200
+// whose body is the number of the connection it was sent on, counting
+// from 1.
+struct HttpServer {
+  // http://127.0.0.1:<port>
+  std::string url();
+  // Connections accepted and requests answered so far
+  size_t connections();
+  size_t requests();
+  // Closes the open connections without telling the clients, as a server
+  // dropping idle keep-alive connections does
+  void dropConnections();
+  void close();
+
+  struct $state;
+  std::shared_ptr<$state> $s;
+};
+
+std::shared_ptr<HttpServer>
+startHttpServer(std::optional<HttpServerOptions> options);
+
+// Adds the "breeze-test" module exporting startHttpServer, call it from
+// script_context::on_bind
+void bind(script_context &ctx);
+} // namespace breeze::test
@@ -0,0 +1,36 @@
+// Runs a fetch test script with the local HTTP server it tests against,
+// which scripts import from "breeze-test". Fails when the script throws.
+// xmake build fetch-tests && xmake run fetch-tests tests/fetch-tests.js
+#include "async_simple/coro/SyncAwait.h"
+#include "breeze-js/script.h"
+#include "http_server.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "usage: fetch-tests <script>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto ctx = std::make_shared<breeze::script_context>();
+  // Small enough for the tests to decode a body just past it
+  ctx->set_fetch_limits({.max_decoded_size = 1024 * 1024});
+  ctx->on_bind.push_back([ctx = ctx.get()] { breeze::test::bind(*ctx); });
+  ctx->reset_runtime();
+
+  auto result = ctx->eval_file(std::filesystem::absolute(argv[1]));
+  if (!result.has_value()) {
+    std::cerr << "Error executing file: " << result.error() << std::endl;
+    return EXIT_FAILURE;
+  }
+  try {
+    async_simple::coro::syncAwait(result.value().await());
+  } catch (const std::exception &e) {
+    std::cerr << "Error awaiting result: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -2,6 +2,7 @@ import { runTests } from "./test"
 // import "./tests/infra"
 // import "./tests/filesystem"
 import "./tests/webapi"
+import "./tests/engine"
 
 try {
     await runTests()
@@ -0,0 +1,4 @@
+import "./engine/json-parse.test"
+import "./engine/json-stringify.test"
+import "./engine/regexp.test"
+import "./engine/string-rope.test"
\ No newline at end of file
@@ -0,0 +1,63 @@
+import { expect } from 'chai';
+import { describe, it } from '../../test';
+
+describe('JSON.parse', () => {
+  it('should parse strings whose escapes fall on every offset', () => {
+    // The scanner skips plain runs 16 bytes at a time
+    for (let i = 0; i < 40; i++) {
+      const plain = 'a'.repeat(i);
+      expect(JSON.parse(`"${plain}\\n${plain}"`)).to.equal(`${plain}\n${plain}`);
+      expect(JSON.parse(`"${plain}\\"x"`)).to.equal(`${plain}"x`);
+      expect(JSON.parse(`"${plain}\\u00e9\\ud83d\\ude00"`)).to.equal(`${plain}é😀`);
+      expect(JSON.parse(`"${plain}é${plain}"`)).to.equal(`${plain}é${plain}`);
+    }
+  });
+
+  it('should reject control characters and bad escapes in strings', () => {
+    for (const text of ['"a\nb"', '"a\tb"', '"\\x41"', '"\\u12"', '"abc']) {
+      expect(() => JSON.parse(text)).to.throw(SyntaxError);
+    }
+    expect(() => JSON.parse(`"${'a'.repeat(20)}\u0001"`)).to.throw(SyntaxError);
+  });
+
+  it('should parse numbers exactly', () => {
+    const cases: [string, number][] = [
+      ['0', 0],
+      ['-0', -0],
+      ['123456789', 123456789],
+      ['-9007199254740991', -9007199254740991],
+      ['9007199254740993', 9007199254740992],
+      ['18446744073709551616', 18446744073709551616],
+      ['0.1', 0.1],
+      ['3.141592653589793', 3.141592653589793],
+      ['1e21', 1e21],
+      ['1.5E-7', 1.5e-7],
+      ['2.2250738585072014e-308', 2.2250738585072014e-308],
+      ['5e-324', 5e-324],
+      ['1.7976931348623157e308', 1.7976931348623157e308],
+      ['1e400', Infinity],
+      ['0.30000000000000004', 0.30000000000000004],
+      ['123456789012345678901234567890', 1.2345678901234568e29],
+    ];
+    for (const [text, value] of cases) {
+      const parsed = JSON.parse(text);
+      expect(Object.is(parsed, value)).to.equal(true, text);
+      expect(JSON.parse(`[${text}]`)[0]).to.equal(value);
+    }
+  });
+
+  it('should reject malformed numbers', () => {
+    for (const text of ['01', '-', '1.', '.5', '1e', '+1', '0x10', '1e+']) {
+      expect(() => JSON.parse(text)).to.throw(SyntaxError);
+    }
+  });
+
+  it('should parse nested documents', () => {
+    const text = '{"a":[1,2.5,{"b":"c\\u0041"}],"d":{"e":null,"f":true},"g":""}';
+    expect(JSON.parse(text)).to.deep.equal({
+      a: [1, 2.5, { b: 'cA' }],
+      d: { e: null, f: true },
+      g: '',
+    });
+  });
+});
@@ -0,0 +1,97 @@
+import { expect } from 'chai';
+import { describe, it } from '../../test';
+
+describe('JSON.stringify', () => {
+  it('should round-trip objects sharing a shape', () => {
+    // Objects built the same way share a shape, whose quoted keys are cached
+    const rows = [];
+    for (let i = 0; i < 50; i++) {
+      rows.push({ id: i, name: `row ${i}`, tags: ['a', 'b'], nested: { x: i / 2 } });
+    }
+    const text = JSON.stringify(rows);
+    expect(JSON.parse(text)).to.deep.equal(rows);
+    expect(text.startsWith('[{"id":0,"name":"row 0","tags":["a","b"],"nested":{"x":0}}'))
+      .to.equal(true);
+  });
+
+  it('should escape keys that need quoting', () => {
+    const keys = ['"', '\\', 'a"b', '\n', '\t\r\b\f', '\u0001\u001f', 'é', '😀',
+      '\ud800', 'x\udc00y', '  ', ''];
+    const make = () => {
+      const o: Record<string, number> = {};
+      keys.forEach((k, i) => { o[k] = i; });
+      return o;
+    };
+    const objs = [make(), make(), make()];
+    const text = JSON.stringify(objs);
+    expect(JSON.parse(text)).to.deep.equal(objs);
+    expect(JSON.stringify({ '"': 1, '\\': 2, '\n': 3 }))
+      .to.equal('{"\\"":1,"\\\\":2,"\\n":3}');
+    expect(JSON.stringify({ '\u0001': 1 })).to.equal('{"\\u0001":1}');
+    expect(JSON.stringify({ '\ud800': 1 })).to.equal('{"\\ud800":1}');
+    expect(JSON.stringify({ 'é😀': 1 })).to.equal('{"é😀":1}');
+  });
+
+  it('should follow changes made by toJSON', () => {
+    const make = (i: number) => ({
+      a: i,
+      b: {
+        toJSON(this: any, key: string) {
+          // Changes the shape of the parent while it is being written
+          delete parent[i].c;
+          parent[i].d = key;
+          return 'b';
+        },
+      },
+      c: 'gone',
+    });
+    const parent: any[] = [];
+    for (let i = 0; i < 3; i++) parent.push(make(i));
+    expect(JSON.stringify(parent)).to.equal(
+      '[{"a":0,"b":"b"},{"a":1,"b":"b"},{"a":2,"b":"b"}]');
+    expect(JSON.stringify(parent)).to.equal(
+      '[{"a":0,"b":"b","d":"b"},{"a":1,"b":"b","d":"b"},{"a":2,"b":"b","d":"b"}]');
+  });
+
+  it('should write the shortest digits that round-trip', () => {
+    const cases: [number, string][] = [
+      [2 ** -44, '5.684341886080802e-14'],
+      [0.1, '0.1'],
+      [1 / 3, '0.3333333333333333'],
+      [5e-324, '5e-324'],
+      [1.7976931348623157e308, '1.7976931348623157e+308'],
+      [123e-20, '1.23e-18'],
+      [0.1 + 0.2, '0.30000000000000004'],
+      [1e21, '1e+21'],
+      [123456789012345680000, '123456789012345680000'],
+      [-0, '0'],
+      [NaN, 'null'],
+      [Infinity, 'null'],
+    ];
+    for (const [value, text] of cases) {
+      expect(JSON.stringify(value)).to.equal(text);
+      expect(JSON.stringify({ v: value })).to.equal(`{"v":${text}}`);
+    }
+  });
+
+  it('should round-trip many doubles', () => {
+    // A fixed LCG, so failures reproduce
+    let seed = 12345;
+    const next = () => {
+      seed = (seed * 1103515245 + 12345) % 2147483648;
+      return seed / 2147483648;
+    };
+    const buf = new DataView(new ArrayBuffer(8));
+    for (let i = 0; i < 20000; i++) {
+      const scaled = (next() - 0.5) * 10 ** Math.floor(next() * 40 - 20);
+      buf.setUint32(0, Math.floor(next() * 0x7fefffff));
+      buf.setUint32(4, Math.floor(next() * 0x100000000));
+      for (const x of [scaled, buf.getFloat64(0)]) {
+        const text = JSON.stringify(x);
+        expect(Number(text)).to.equal(x);
+        expect(Number(String(x))).to.equal(x);
+        expect(text).to.equal(String(x));
+      }
+    }
+  });
+});
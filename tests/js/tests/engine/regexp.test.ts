@@ -0,0 +1,131 @@
+import { expect } from 'chai';
+import { describe, it } from '../../test';
+
+// Subjects of 256 characters or more go through the literal prefilter and
+// the lazy DFA before the backtracker, shorter ones only once a regexp has
+// run twice: each case is checked on both
+const pad = (s: string) => `${'-'.repeat(300)}\n${s}`;
+
+describe('RegExp', () => {
+  it('should match with every flag combination', () => {
+    const subject = 'Foo bar\nfoo BAR\nfoo';
+    const cases: [RegExp, (string | null)[]][] = [
+      [/foo/g, ['foo', 'foo']],
+      [/foo/gi, ['Foo', 'foo', 'foo']],
+      [/^foo/g, []],
+      [/^foo/gm, ['foo', 'foo']],
+      [/^foo/gim, ['Foo', 'foo', 'foo']],
+      [/bar$/gim, ['bar', 'BAR']],
+      [/o.b/g, ['o b']],
+      [/o\s+b/gi, ['o b', 'o B']],
+      [/r.f/gs, ['r\nf']],
+      [/r.f/gis, ['r\nf', 'R\nf']],
+      [/\bfoo\b/gi, ['Foo', 'foo', 'foo']],
+      [/\Bo\B/g, ['o', 'o', 'o']],
+    ];
+    for (const [re, expected] of cases) {
+      for (let run = 0; run < 3; run++) {
+        expect(subject.match(re) ?? [], `${re}`).to.deep.equal(expected);
+        expect(pad(subject).match(re) ?? [], `${re}`).to.deep.equal(
+          re.source.startsWith('^') && !re.multiline ? [] : expected);
+      }
+    }
+  });
+
+  it('should update lastIndex of global regexps', () => {
+    for (const subject of ['a1b22c333', pad('a1b22c333')]) {
+      const re = /\d+/g;
+      const found: [string, number][] = [];
+      let m;
+      while ((m = re.exec(subject)) !== null)
+        found.push([m[0], re.lastIndex]);
+      const base = subject.length - 9;
+      expect(found).to.deep.equal([
+        ['1', base + 2], ['22', base + 5], ['333', base + 9]]);
+      expect(re.lastIndex).to.equal(0);
+
+      re.lastIndex = subject.length + 1;
+      expect(re.exec(subject)).to.equal(null);
+      expect(re.lastIndex).to.equal(0);
+      re.lastIndex = base + 4;
+      expect(re.exec(subject)![0]).to.equal('2');
+      expect(re.test(subject)).to.equal(true);
+      expect(re.lastIndex).to.equal(base + 9);
+    }
+  });
+
+  it('should only match at lastIndex when sticky', () => {
+    for (const subject of ['ab ab', pad('ab ab')]) {
+      const base = subject.length - 5;
+      const re = /ab/y;
+      expect(re.test(subject)).to.equal(base === 0);
+      re.lastIndex = base;
+      expect(re.exec(subject)![0]).to.equal('ab');
+      expect(re.lastIndex).to.equal(base + 2);
+      expect(re.exec(subject)).to.equal(null);
+      expect(re.lastIndex).to.equal(0);
+      re.lastIndex = base + 3;
+      expect(re.test(subject)).to.equal(true);
+      expect('xab'.replace(/ab/y, '!')).to.equal('xab');
+      expect(subject.split(/\s/y)).to.deep.equal(subject.split(/\s/));
+    }
+    const words = /\w+\s*/gy;
+    expect('one two  three!four'.match(words)).to.deep.equal(['one ', 'two  ', 'three']);
+  });
+
+  it('should match code points in unicode mode', () => {
+    const text = 'a😀b\u{1F600}c é';
+    for (const subject of [text, pad(text)]) {
+      expect(subject.match(/./gu)!.slice(-7)).to.deep.equal(['a', '😀', 'b', '😀', 'c', ' ', 'é']);
+      expect(subject.match(/😀/g)!.length).to.equal(2);
+      expect(/^.b/u.test('😀b')).to.equal(true);
+      expect(/^.b/.test('😀b')).to.equal(false);
+      expect(subject.match(/\u{1F600}/gu)!.length).to.equal(2);
+      expect(subject.match(/[😀]/gu)!.length).to.equal(2);
+      expect(subject.match(/\p{L}/gu)!.slice(-4)).to.deep.equal(['a', 'b', 'c', 'é']);
+      expect(subject.match(/\p{Emoji_Presentation}/gu)!.length).to.equal(2);
+      expect(subject.match(/[\uD83D]/g)!.length).to.equal(2);
+      expect(subject.match(/[\uD83D]/gu)).to.equal(null);
+    }
+    expect(/\u{61}/.test('a')).to.equal(false);
+    expect(() => new RegExp('\\u{110000}', 'u')).to.throw(SyntaxError);
+    expect('K'.match(/k/iu)).to.not.equal(null);
+    expect('K'.match(/k/i)).to.equal(null);
+  });
+
+  it('should give capture groups and indices', () => {
+    for (const subject of ['x 2024-10-19 y', pad('x 2024-10-19 y')]) {
+      const m = /(?<y>\d{4})-(?<m>\d\d)-(?<d>\d\d)/d.exec(subject)!;
+      const base = subject.length - 14;
+      expect(m.groups).to.deep.equal({ y: '2024', m: '10', d: '19' });
+      expect(m.index).to.equal(base + 2);
+      expect(m.indices![1]).to.deep.equal([base + 2, base + 6]);
+      expect(subject.replace(/(\d+)-(\d+)-(\d+)/, '$3/$2/$1')).to.equal(
+        subject.slice(0, base) + 'x 19/10/2024 y');
+      expect([...subject.matchAll(/(\d)(\d)/g)].map((x) => x[2])).to.deep.equal(
+        ['0', '4', '0', '9']);
+    }
+  });
+
+  it('should keep matching when many large regexps take turns', () => {
+    // Each pattern needs many DFA states, so the matchers do not all fit
+    // in the cache at once and are freed and rebuilt as they take turns
+    const patterns = Array.from({ length: 40 },
+      (_, i) => new RegExp(`a[a-c]{${8 + (i % 5)}}x${i}y`, 'g'));
+    let subject = '';
+    let seed = 1;
+    for (let i = 0; i < 20000; i++) {
+      seed = (seed * 1103515245 + 12345) % 2147483648;
+      subject += 'abc'[Math.floor(seed / 2147483648 * 3)];
+    }
+    for (let i = 0; i < 40; i++) subject += `${'a'.repeat(16)}x${i}y`;
+    for (let round = 0; round < 3; round++) {
+      patterns.forEach((re, i) => {
+        const m = subject.match(re);
+        expect(m, `${re}`).to.not.equal(null);
+        expect(m!.length).to.equal(1);
+        expect(m![0].endsWith(`x${i}y`)).to.equal(true);
+      });
+    }
+  });
+});
@@ -0,0 +1,104 @@
+import { expect } from 'chai';
+import { describe, it } from '../../test';
+
+// Concatenations of 256 characters or more build a rope, whose characters
+// are only copied into a flat string when they are first needed
+describe('string concatenation', () => {
+  const chunk = (i: number) => `${i}:${'abcdefghij'.repeat(3)};`;
+
+  it('should keep the characters of appends and prepends', () => {
+    let appended = '';
+    let prepended = '';
+    const parts: string[] = [];
+    for (let i = 0; i < 2000; i++) {
+      appended += chunk(i);
+      prepended = chunk(i) + prepended;
+      parts.push(chunk(i));
+    }
+    expect(appended.length).to.equal(parts.join('').length);
+    expect(appended).to.equal(parts.join(''));
+    expect(prepended).to.equal(parts.reverse().join(''));
+  });
+
+  it('should concatenate ropes with each other', () => {
+    const a = 'a'.repeat(200) + 'b'.repeat(200);
+    const b = 'c'.repeat(300) + 'd'.repeat(100);
+    const both = a + b;
+    expect(both.length).to.equal(800);
+    expect(both).to.equal(`${'a'.repeat(200)}${'b'.repeat(200)}${'c'.repeat(300)}${'d'.repeat(100)}`);
+    // Both operands are still usable, and unchanged
+    expect(a + a).to.equal('a'.repeat(200) + 'b'.repeat(200) + 'a'.repeat(200) + 'b'.repeat(200));
+    expect(a.length).to.equal(400);
+    expect(b.endsWith('d')).to.equal(true);
+  });
+
+  it('should not change a shared rope when appending to it', () => {
+    let s = 'x'.repeat(300);
+    s += 'y';
+    const kept = s;
+    s += 'z';
+    expect(kept).to.equal('x'.repeat(300) + 'y');
+    expect(s).to.equal('x'.repeat(300) + 'yz');
+    const obj = { s: kept };
+    obj.s += '!';
+    expect(kept.length).to.equal(301);
+    expect(obj.s.length).to.equal(302);
+  });
+
+  it('should index, slice and search ropes', () => {
+    let s = '';
+    for (let i = 0; i < 100; i++) s += chunk(i);
+    const flat = Array.from({ length: 100 }, (_, i) => chunk(i)).join('');
+    for (const i of [0, 1, 255, 256, 1000, s.length - 1]) {
+      expect(s[i]).to.equal(flat[i]);
+      expect(s.charCodeAt(i)).to.equal(flat.charCodeAt(i));
+    }
+    expect(s[s.length]).to.equal(undefined);
+    expect(s.slice(300, 400)).to.equal(flat.slice(300, 400));
+    expect(s.substring(1000)).to.equal(flat.substring(1000));
+    expect(s.indexOf('99:')).to.equal(flat.indexOf('99:'));
+    expect(s.split(';').length).to.equal(101);
+    expect(s.replace(/abc/g, '-')).to.equal(flat.replace(/abc/g, '-'));
+    expect(/42:a/.test(s)).to.equal(true);
+  });
+
+  it('should compare ropes like flat strings', () => {
+    const a = 'a'.repeat(300) + 'b';
+    const b = 'a'.repeat(150) + 'a'.repeat(150) + 'b';
+    const c = 'a'.repeat(300) + 'c';
+    expect(a === b).to.equal(true);
+    expect(a == b).to.equal(true);
+    expect(a !== c).to.equal(true);
+    expect(a < c).to.equal(true);
+    expect(c > b).to.equal(true);
+    expect(Object.is(a, b)).to.equal(true);
+    expect(new Set([a, b, c]).size).to.equal(2);
+    const map = new Map([[a, 1]]);
+    expect(map.get(b)).to.equal(1);
+    const obj: Record<string, number> = {};
+    obj[a] = 1;
+    expect(obj[b]).to.equal(1);
+    expect(a.localeCompare(c)).to.equal(-1);
+  });
+
+  it('should convert ropes like flat strings', () => {
+    const digits = '1'.repeat(200) + '2'.repeat(100);
+    expect(Number(digits)).to.equal(Number(`${'1'.repeat(200)}${'2'.repeat(100)}`));
+    expect(typeof digits).to.equal('string');
+    expect(Boolean('x'.repeat(300) + '')).to.equal(true);
+    expect(JSON.parse(JSON.stringify({ v: digits })).v).to.equal(digits);
+    expect(String(new String(digits))).to.equal(digits);
+    expect([...('é'.repeat(200) + '😀'.repeat(100))].length).to.equal(300);
+  });
+
+  it('should handle ropes many levels deep', () => {
+    let s = '';
+    for (let i = 0; i < 200000; i++) s = `${s}${i % 10}` + 'x'.repeat(i % 3);
+    expect(s.length).to.equal(200000 + 199999);
+    expect(s.slice(0, 6)).to.equal('01x2xx');
+    let t = 'y'.repeat(256);
+    for (let i = 0; i < 20000; i++) t = 'y'.repeat(256) + t;
+    expect(t.length).to.equal(256 * 20001);
+    expect(t.lastIndexOf('y')).to.equal(t.length - 1);
+  });
+});
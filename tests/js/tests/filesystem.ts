@@ -2,7 +2,7 @@
 
 import { expect } from "chai";
 import { describe, it, beforeEach, afterEach } from "../test";
-import { filesystem } from "breeze";
+import { filesystem, infra } from "breeze";
 
 const testDir = 'D:\\breeze-js\\tests\\js\\tests\\tests';
 
@@ -25,6 +25,99 @@ describe('filesystem', () => {
         expect(readContent).to.equal(content, 'File content should match written content');
     });
 
+    it('should replace a file whole with an atomic write', async () => {
+        const dirPath = testDir + '/atomic';
+        const filePath = dirPath + '/data.txt';
+        const versions = ['a', 'b', 'c', 'd'].map(c => c.repeat(1 << 20));
+        await filesystem.writeStringToFile(filePath, 'old', { atomic: true, sync: 'full' });
+        const first = await filesystem.readFileAsString(filePath);
+
+        // Readers racing the writers only ever see one whole version
+        const writes = Promise.all(versions.map(v => filesystem.writeStringToFile(filePath, v, { atomic: true })));
+        for (let i = 0; i < 20; i++) {
+            const content = await filesystem.readFileAsString(filePath);
+            expect(content === 'old' || versions.includes(content)).to.be.true;
+        }
+        await writes;
+        const last = await filesystem.readFileAsString(filePath);
+
+        expect(first).to.equal('old');
+        expect(versions).to.include(last);
+        expect(filesystem.readdirSync(dirPath)).to.deep.equal(['data.txt']);
+        await filesystem.writeStringToFile(filePath, 'new', { atomic: true, sync: 'data' });
+        expect(await filesystem.readFileAsString(filePath)).to.equal('new');
+        let error: unknown;
+        await filesystem.writeStringToFile(filePath, 'x', { atomic: true, sync: 'never' }).catch(e => { error = e; });
+        expect(String(error)).to.include('Unknown sync mode');
+        expect(await filesystem.readFileAsString(filePath)).to.equal('new');
+    });
+
+    it('should not serve cached content after a write', async () => {
+        const filePath = testDir + '/cached.txt';
+        filesystem.configureReadCache({ memory_limit: 0, max_file_size: 0 });
+        try {
+            await filesystem.writeStringToFile(filePath, 'version 1');
+            // Files modified in the last 2 seconds are not cached yet
+            await infra.sleep(2100);
+            const before = filesystem.readCacheStats();
+            const first = await filesystem.readFileAsString(filePath);
+            const cached = filesystem.readFileAsStringSync(filePath);
+            const afterHit = filesystem.readCacheStats();
+
+            // Same size, so only the identity of the file tells them apart
+            await filesystem.writeStringToFile(filePath, 'version 2');
+            const second = await filesystem.readFileAsString(filePath);
+            await filesystem.writeStringToFile(filePath, 'version 3, longer', { atomic: true });
+            const third = new Uint8Array(await filesystem.readFile(filePath));
+            const after = filesystem.readCacheStats();
+
+            expect(first).to.equal('version 1');
+            expect(cached).to.equal('version 1');
+            expect(afterHit.hits - before.hits).to.equal(1);
+            expect(second).to.equal('version 2');
+            expect(String.fromCharCode(...third)).to.equal('version 3, longer');
+            expect(after.hits).to.equal(afterHit.hits);
+            expect(after.stale - afterHit.stale).to.equal(1);
+        } finally {
+            filesystem.disableReadCache();
+        }
+    });
+
+    it('should report a burst of changes once per file', async () => {
+        const dirPath = testDir + '/watched';
+        await filesystem.mkdir(dirPath, { recursive: true });
+        await filesystem.writeStringToFile(dirPath + '/existing.txt', 'v0');
+        const batches: filesystem.WatchEvent[][] = [];
+        const watcher = filesystem.watch(dirPath, { recursive: false, debounce_ms: 300 },
+            events => { batches.push(events); });
+        const byPath = (events: filesystem.WatchEvent[]) =>
+            events.map(e => ({ path: e.path, type: e.type })).sort((a, b) => a.path.localeCompare(b.path));
+
+        for (let i = 1; i <= 5; i++) {
+            await filesystem.writeStringToFile(dirPath + '/existing.txt', 'v' + i);
+            await filesystem.writeStringToFile(dirPath + '/new.txt', 'v' + i);
+        }
+        // Created and removed before the batch is out: not reported at all
+        await filesystem.writeStringToFile(dirPath + '/gone.txt', 'gone');
+        await filesystem.rm(dirPath + '/gone.txt');
+        await infra.sleep(800);
+        const firstBatches = batches.length;
+
+        await filesystem.rm(dirPath + '/new.txt');
+        await infra.sleep(800);
+        watcher.close();
+        await filesystem.writeStringToFile(dirPath + '/existing.txt', 'closed');
+        await infra.sleep(800);
+
+        expect(firstBatches).to.equal(1);
+        expect(byPath(batches[0])).to.deep.equal([
+            { path: 'existing.txt', type: 'modified' },
+            { path: 'new.txt', type: 'added' },
+        ]);
+        expect(batches.length).to.equal(2);
+        expect(byPath(batches[1])).to.deep.equal([{ path: 'new.txt', type: 'removed' }]);
+    });
+
     it('should create a directory', async () => {
         const dirPath = testDir + '/newdir';
         const existsBefore = filesystem.exists(dirPath);
@@ -51,6 +144,49 @@ describe('filesystem', () => {
         expect(files).to.include('file2.txt');
     });
 
+    it('should list nested files by name, each directory before its files', async () => {
+        const dirPath = testDir + '/nested';
+        await filesystem.writeStringToFile(dirPath + '/top.txt', 'top');
+        await filesystem.writeStringToFile(dirPath + '/sub/inner.txt', 'inner');
+        await filesystem.writeStringToFile(dirPath + '/sub/deeper/deep.txt', 'deep');
+
+        const files = await filesystem.readdir(dirPath, { recursive: true, follow_symlinks: false });
+        const filesSync = filesystem.readdirSync(dirPath, { recursive: true, follow_symlinks: false });
+        const entries = await filesystem.readdirEntries(dirPath, { recursive: true, follow_symlinks: false, stat: false });
+
+        expect([...files].sort()).to.deep.equal(['deep.txt', 'deeper', 'inner.txt', 'sub', 'top.txt']);
+        expect(filesSync).to.deep.equal(files);
+        expect(files.indexOf('sub')).to.be.lessThan(files.indexOf('inner.txt'));
+        expect(files.indexOf('deeper')).to.be.lessThan(files.indexOf('deep.txt'));
+        expect(entries.map(e => e.path).sort()).to.deep.equal(
+            ['sub', 'sub/deeper', 'sub/deeper/deep.txt', 'sub/inner.txt', 'top.txt']);
+        expect(() => filesystem.readdirSync(dirPath + '/missing')).to.throw("Error reading directory");
+    });
+
+    it('should match glob patterns', async () => {
+        const cwd = testDir + '/glob';
+        for (const file of ['README.md', 'src/a.js', 'src/b.ts', 'src/c.txt', 'src/lib/d.js',
+            'src/.hidden.js', 'node_modules/m/index.js'])
+            await filesystem.writeStringToFile(cwd + '/' + file, file);
+        const glob = (patterns: string | string[], options: Partial<filesystem.GlobOptions> = {}) =>
+            filesystem.globSync(patterns, { cwd, dot: false, ...options }).sort();
+
+        const sources = glob('**/*.{js,ts}', { ignore: ['**/node_modules'] });
+        const streamed: string[] = [];
+        for await (const entry of filesystem.glob('**/*.{js,ts}', { cwd, ignore: ['**/node_modules'], dot: false }))
+            streamed.push(entry.path);
+
+        expect(sources).to.deep.equal(['src/a.js', 'src/b.ts', 'src/lib/d.js']);
+        expect(streamed.sort()).to.deep.equal(sources);
+        expect(glob('**/*.js', { dot: true, ignore: ['node_modules/**'] }))
+            .to.deep.equal(['src/.hidden.js', 'src/a.js', 'src/lib/d.js']);
+        expect(glob(['src/*/', 'README.md'])).to.deep.equal(['README.md', 'src/lib']);
+        expect(glob('src/[ab].*')).to.deep.equal(['src/a.js', 'src/b.ts']);
+        expect(glob('src/[!a]*')).to.deep.equal(['src/b.ts', 'src/c.txt', 'src/lib']);
+        expect(glob('src/?.t?')).to.deep.equal(['src/b.ts']);
+        expect(() => glob('../*')).to.throw('leaves the base directory');
+    });
+
     it('should remove a file', async () => {
         const filePath = testDir + '/remove.txt';
         await filesystem.writeStringToFile(filePath, 'To be removed');
@@ -100,4 +236,89 @@ describe('filesystem', () => {
 
         expect(true).to.be.true; // Just to ensure the test runs without crashing
     })
+
+    it('should map the contents of a file', async () => {
+        const filePath = testDir + '/mapped.txt';
+        await filesystem.writeStringToFile(filePath, 'Hello, mapped file!');
+
+        const buffer = filesystem.mmap(filePath);
+        const bytes = new Uint8Array(buffer);
+        const range = filesystem.mmap(filePath, { offset: 7, length: 6 });
+
+        expect(buffer.byteLength).to.equal(19);
+        expect(String.fromCharCode(...bytes)).to.equal('Hello, mapped file!');
+        expect(String.fromCharCode(...new Uint8Array(range))).to.equal('mapped');
+        expect(() => filesystem.mmap(filePath, { offset: 10, length: 10 })).to.throw();
+    });
+
+    it('should keep writes to a mapping out of the file', async () => {
+        const filePath = testDir + '/private.txt';
+        await filesystem.writeStringToFile(filePath, 'unchanged');
+
+        const bytes = new Uint8Array(filesystem.mmap(filePath));
+        bytes[0] = 'U'.charCodeAt(0);
+
+        expect(String.fromCharCode(...bytes)).to.equal('Unchanged');
+        expect(await filesystem.readFileAsString(filePath)).to.equal('unchanged');
+    });
+
+    it('should detach a mapping when it is transferred', async () => {
+        const filePath = testDir + '/transfer.txt';
+        await filesystem.writeStringToFile(filePath, 'transferred');
+
+        const buffer = filesystem.mmap(filePath);
+        const view = new Uint8Array(buffer);
+        // @ts-ignore ArrayBuffer.prototype.transfer is newer than the ES2022 lib
+        const moved = buffer.transfer();
+        // @ts-ignore
+        const shrunk = filesystem.mmap(filePath).transfer(8);
+
+        expect(buffer.byteLength).to.equal(0);
+        expect(view.length).to.equal(0);
+        expect(String.fromCharCode(...new Uint8Array(moved))).to.equal('transferred');
+        expect(String.fromCharCode(...new Uint8Array(shrunk))).to.equal('transfer');
+        // @ts-ignore
+        expect(() => buffer.transfer()).to.throw(TypeError);
+        expect(filesystem.mmap(filePath, { offset: 11 }).byteLength).to.equal(0);
+    });
+
+    it('should read lines across chunk boundaries', async () => {
+        const filePath = testDir + '/lines.txt';
+        // Lines are read in chunks of 64 KiB: these end on, across and past
+        // the boundaries, with a \r\n split between two chunks
+        const expected = ['first', 'x'.repeat(65536 - 7), 'y'.repeat(100000), '', 'z'.repeat(65535), 'last'];
+        const content = expected[0] + '\n' + expected[1] + '\r\n' + expected[2] + '\n\n' +
+            expected[4] + '\n' + expected[5];
+        await filesystem.writeStringToFile(filePath, content);
+
+        const handle = await filesystem.open(filePath);
+        const lines: string[] = [];
+        for await (const line of handle.lines())
+            lines.push(line);
+        handle.close();
+
+        expect(lines.length).to.equal(expected.length);
+        expect(lines).to.deep.equal(expected);
+    });
+
+    it('should reject lines longer than the maximum', async () => {
+        const filePath = testDir + '/longline.txt';
+        await filesystem.writeStringToFile(filePath, 'short\n' + 'a'.repeat(200000));
+
+        const handle = await filesystem.open(filePath);
+        const lines: string[] = [];
+        let error: unknown;
+        try {
+            for await (const line of handle.lines(1000))
+                lines.push(line);
+        } catch (e) {
+            error = e;
+        }
+        const after = await handle.readLines();
+        handle.close();
+
+        expect(String(error)).to.include('Line longer than 1000 bytes');
+        expect(lines).to.deep.equal([]);
+        expect(after).to.equal(null);
+    });
 });
\ No newline at end of file
@@ -1,4 +1,5 @@
 import "./webapi/arraybuffer.test"
 import "./webapi/base64.test"
 import "./webapi/uint8array.test"
-import "./webapi/url.test"
\ No newline at end of file
+import "./webapi/url.test"
+import "./webapi/headers.test"
\ No newline at end of file
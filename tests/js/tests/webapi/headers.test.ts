@@ -0,0 +1,38 @@
+import { expect } from 'chai';
+import { describe, it } from '../../test';
+
+describe('Headers', () => {
+  it('should look up names case-insensitively', () => {
+    const headers = new Headers();
+    headers.append('Content-Type', 'text/html');
+    headers.set('content-type', 'application/json');
+
+    expect(headers.get('CONTENT-TYPE')).to.equal('application/json');
+    expect(headers.has('Content-type')).to.equal(true);
+    expect(headers.has('accept')).to.equal(false);
+  });
+
+  it('should keep insertion order', () => {
+    const headers = new Headers();
+    headers.append('B', '1');
+    headers.append('A', '2');
+    headers.append('b', '3');
+
+    expect(headers.entries()).to.deep.equal([['B', '1'], ['A', '2'], ['b', '3']]);
+
+    const seen: string[] = [];
+    headers.forEach((value, name) => seen.push(`${name}=${value}`));
+    expect(seen).to.deep.equal(['B=1', 'A=2', 'b=3']);
+  });
+
+  it('should remove every header with a name', () => {
+    const headers = new Headers();
+    headers.append('Set-Cookie', 'a');
+    headers.append('X-Id', '1');
+    headers.append('set-cookie', 'b');
+    headers.remove_('SET-COOKIE');
+
+    expect(headers.entries()).to.deep.equal([['X-Id', '1']]);
+    expect(headers.get('x-id')).to.equal('1');
+  });
+});
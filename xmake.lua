@@ -6,7 +6,26 @@ set_warnings("all")
 add_rules("plugin.compile_commands.autoupdate", {outputdir = "build"})
 add_rules("mode.releasedbg")
 
-add_requires("cxxopts", "ctre", "concurrentqueue")
+add_requires("cxxopts", "ctre", "concurrentqueue", "zlib")
+
+option("brotli")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Decode and encode brotli fetch bodies")
+option_end()
+
+option("zstd")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Decode and encode zstd fetch bodies")
+option_end()
+
+if has_config("brotli") then
+    add_requires("brotli")
+end
+if has_config("zstd") then
+    add_requires("zstd")
+end
 
 includes("deps/yalantinglibs.lua")
 add_requires("yalantinglibs", {
@@ -37,6 +56,15 @@ target("breeze-js-runtime")
     add_packages("yalantinglibs", { public = true })
     add_packages("ctre")
     add_packages("concurrentqueue", { public = true })
+    add_packages("zlib")
+    if has_config("brotli") then
+        add_packages("brotli")
+        add_defines("BREEZE_ENABLE_BROTLI")
+    end
+    if has_config("zstd") then
+        add_packages("zstd")
+        add_defines("BREEZE_ENABLE_ZSTD")
+    end
     -- add_rules("breezejs.bindgen", {
     --     name_filter = "breeze::js",
     --     ts_module_name = "breeze",
@@ -67,4 +95,38 @@ target("cli")
 
     if is_plat("windows") then
         add_syslinks("ws2_32", "user32", "shell32")
-    end
\ No newline at end of file
+    end
+
+-- Microbenchmarks, not built by default: xmake build bench-<name>
+for _, file in ipairs(os.files("tests/bench/*.cc")) do
+    target("bench-" .. path.basename(file))
+        set_kind("binary")
+        set_default(false)
+        add_deps("breeze-js-runtime")
+        add_includedirs("src/breeze-js")
+        add_files(file)
+        if is_plat("linux", "bsd", "cross") then
+            add_linkgroups("breeze-js-runtime", "breeze-quickjs-ng", {group = true})
+        end
+
+        if is_plat("windows") then
+            add_syslinks("ws2_32", "user32", "shell32")
+        end
+end
+
+-- fetch tests against a local HTTP server, not built by default:
+-- xmake build fetch-tests && xmake run fetch-tests tests/fetch-tests.js
+target("fetch-tests")
+    set_kind("binary")
+    set_default(false)
+    set_rundir("$(projectdir)")
+    add_deps("breeze-js-runtime")
+    add_includedirs("src/breeze-js")
+    add_files("tests/fetch/*.cc")
+    if is_plat("linux", "bsd", "cross") then
+        add_linkgroups("breeze-js-runtime", "breeze-quickjs-ng", {group = true})
+    end
+
+    if is_plat("windows") then
+        add_syslinks("ws2_32", "user32", "shell32")
+    end